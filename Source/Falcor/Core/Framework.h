@@ -284,11 +284,14 @@ namespace Falcor
 #pragma comment(linker,"/manifestdependency:\"type='win32' name='Microsoft.Windows.Common-Controls' version='6.0.0.0' processorArchitecture='*' publicKeyToken='6595b64144ccf1df' language='*'\"")
 #define deprecate(_ver_, _msg_) __declspec(deprecated("This function has been deprecated in " ##  _ver_ ## ". " ## _msg_))
 #define forceinline __forceinline
+// Marks a function using AVX2 or F16C intrinsics. Only call it if isCpuFeatureSupported() returns true for the features used.
+#define target_avx2
 using DllHandle = HMODULE;
 #define suppress_deprecation __pragma(warning(suppress : 4996));
 #elif defined(__GNUC__)
 #define deprecate(_ver_, _msg_) __attribute__ ((deprecated("This function has been deprecated in " _ver_ ". " _msg_)))
 #define forceinline __attribute__((always_inline))
+#define target_avx2 __attribute__((target("avx2,f16c")))
 using DllHandle = void*;
 #define suppress_deprecation _Pragma("GCC diagnostic ignored \"-Wdeprecated-declarations\"")
 #endif
@@ -229,6 +229,23 @@ namespace Falcor
         return strpath;
     }
 
+    bool findSharedLibrary(const std::string& filename, std::string& fullPath)
+    {
+        std::vector<std::string> dirs = { getExecutableDirectory() };
+        if (const char* libraryPath = ::getenv("LD_LIBRARY_PATH"))
+        {
+            for (const auto& dir : splitString(libraryPath, ":")) if (!dir.empty()) dirs.push_back(dir);
+        }
+        dirs.insert(dirs.end(), { "/lib", "/usr/lib", "/usr/local/lib" });
+
+        for (const auto& dir : dirs)
+        {
+            fullPath = canonicalizeFilename(dir + "/" + filename);
+            if (!fullPath.empty()) return true;
+        }
+        return false;
+    }
+
     const std::string getWorkingDirectory()
     {
         char cwd[1024];
@@ -514,6 +531,18 @@ namespace Falcor
         return (uint32_t)__builtin_popcount(a);
     }
 
+    bool isCpuFeatureSupported(CpuFeature feature)
+    {
+        // The builtins check both CPU and OS support.
+        switch (feature)
+        {
+        case CpuFeature::AVX2: return __builtin_cpu_supports("avx2");
+        case CpuFeature::F16C: return __builtin_cpu_supports("f16c");
+        case CpuFeature::FMA: return __builtin_cpu_supports("fma");
+        default: should_not_get_here(); return false;
+        }
+    }
+
     DllHandle loadDll(const std::string& libPath)
     {
         return dlopen(libPath.c_str(), RTLD_LAZY);
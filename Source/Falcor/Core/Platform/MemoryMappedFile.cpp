@@ -0,0 +1,100 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "MemoryMappedFile.h"
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Falcor
+{
+#ifdef _WIN32
+    MemoryMappedFile::UniquePtr MemoryMappedFile::open(const std::string& filename)
+    {
+        UniquePtr pFile(new MemoryMappedFile(filename));
+
+        HANDLE hFile = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (hFile == INVALID_HANDLE_VALUE) return nullptr;
+        pFile->mFile = hFile;
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(hFile, &size)) return nullptr;
+        pFile->mSize = (size_t)size.QuadPart;
+
+        // Empty files can't be mapped.
+        if (pFile->mSize == 0) return pFile;
+
+        HANDLE hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (hMapping == nullptr) return nullptr;
+        pFile->mMapping = hMapping;
+
+        pFile->mpData = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+        if (pFile->mpData == nullptr) return nullptr;
+
+        return pFile;
+    }
+
+    MemoryMappedFile::~MemoryMappedFile()
+    {
+        if (mpData) UnmapViewOfFile(mpData);
+        if (mMapping) CloseHandle(mMapping);
+        if (mFile) CloseHandle(mFile);
+    }
+#else
+    MemoryMappedFile::UniquePtr MemoryMappedFile::open(const std::string& filename)
+    {
+        UniquePtr pFile(new MemoryMappedFile(filename));
+
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd == -1) return nullptr;
+        pFile->mFile = fd;
+
+        struct stat st;
+        if (fstat(fd, &st) != 0) return nullptr;
+        pFile->mSize = (size_t)st.st_size;
+
+        // Empty files can't be mapped.
+        if (pFile->mSize == 0) return pFile;
+
+        void* pData = mmap(nullptr, pFile->mSize, PROT_READ, MAP_SHARED, fd, 0);
+        if (pData == MAP_FAILED) return nullptr;
+        pFile->mpData = pData;
+
+        return pFile;
+    }
+
+    MemoryMappedFile::~MemoryMappedFile()
+    {
+        if (mpData) munmap(const_cast<void*>(mpData), mSize);
+        if (mFile != -1) close(mFile);
+    }
+#endif
+}
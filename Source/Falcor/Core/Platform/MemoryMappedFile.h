@@ -0,0 +1,77 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+
+namespace Falcor
+{
+    /** Read-only memory mapped file.
+        The file contents are mapped into the address space of the process and paged in on demand,
+        which allows large files to be accessed without first copying them into memory.
+    */
+    class dlldecl MemoryMappedFile
+    {
+    public:
+        using UniquePtr = std::unique_ptr<MemoryMappedFile>;
+
+        /** Open and map a file for reading.
+            \param[in] filename Full path of the file.
+            \return A new object, or nullptr if the file could not be opened or mapped.
+        */
+        static UniquePtr open(const std::string& filename);
+
+        ~MemoryMappedFile();
+
+        MemoryMappedFile(const MemoryMappedFile&) = delete;
+        MemoryMappedFile& operator=(const MemoryMappedFile&) = delete;
+
+        /** Get a pointer to the mapped file contents. Returns nullptr for empty files.
+        */
+        const void* getData() const { return mpData; }
+
+        /** Get the size of the file in bytes.
+        */
+        size_t getSize() const { return mSize; }
+
+        /** Get the filename.
+        */
+        const std::string& getFilename() const { return mFilename; }
+
+    private:
+        MemoryMappedFile(const std::string& filename) : mFilename(filename) {}
+
+        std::string mFilename;
+        const void* mpData = nullptr;
+        size_t mSize = 0;
+#ifdef _WIN32
+        void* mFile = nullptr;          ///< File handle.
+        void* mMapping = nullptr;       ///< File mapping handle.
+#else
+        int mFile = -1;                 ///< File descriptor.
+#endif
+    };
+}
@@ -282,4 +282,43 @@ namespace Falcor
         str.assign(std::istreambuf_iterator<char>(filestream), std::istreambuf_iterator<char>());
         return str;
     }
+
+    void writeFileAtomic(const std::string& filename, const std::function<void(const std::string& tempFilename)>& writeFunc)
+    {
+        // Keep the extension, so that writers that check it accept the temporary file.
+        fs::path path = filename;
+        std::string tempFilename = fs::path(path).replace_extension(".tmp" + path.extension().string()).string();
+
+        try
+        {
+            if (path.has_parent_path()) fs::create_directories(path.parent_path());
+            writeFunc(tempFilename);
+        }
+        catch (const std::exception& e)
+        {
+            std::error_code ec;
+            fs::remove(tempFilename, ec);
+            throw std::runtime_error("Failed to write '" + filename + "'. " + e.what());
+        }
+
+        std::error_code ec;
+        fs::rename(tempFilename, filename, ec);
+        if (ec)
+        {
+            fs::remove(tempFilename, ec);
+            throw std::runtime_error("Failed to rename '" + tempFilename + "' to '" + filename + "'.");
+        }
+    }
+
+    void writeFileAtomic(const std::string& filename, const std::function<void(std::ostream& stream)>& writeFunc)
+    {
+        writeFileAtomic(filename, [&writeFunc](const std::string& tempFilename)
+        {
+            std::ofstream stream(tempFilename, std::ios::binary | std::ios::trunc);
+            if (!stream) throw std::runtime_error("Failed to open '" + tempFilename + "' for writing.");
+            writeFunc(stream);
+            stream.close();
+            if (stream.fail()) throw std::runtime_error("Failed to write '" + tempFilename + "'.");
+        });
+    }
 }
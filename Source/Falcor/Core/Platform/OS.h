@@ -28,6 +28,7 @@
 #pragma once
 #include <thread>
 #include <functional>
+#include <iosfwd>
 #pragma warning (disable : 4251)
 
 namespace Falcor
@@ -152,6 +153,13 @@ namespace Falcor
     */
     dlldecl bool findFileInShaderDirectories(const std::string& filename, std::string& fullPath);
 
+    /** Finds a shared library in the directories the OS searches when loading it, starting with the executable directory.
+        \param[in] filename The library filename, including the extension
+        \param[in] fullPath If the library was found, the full path to the library. If the library wasn't found, this is invalid.
+        \return true if the library was found, otherwise false
+    */
+    dlldecl bool findSharedLibrary(const std::string& filename, std::string& fullPath);
+
     /** Get a list of all shader directories.
     */
     dlldecl const std::vector<std::string>& getShaderDirectoriesList();
@@ -398,10 +406,40 @@ namespace Falcor
     */
     dlldecl uint32_t popcount(uint32_t a);
 
+    /** CPU instruction set extensions that can be queried at runtime.
+    */
+    enum class CpuFeature
+    {
+        AVX2,   ///< AVX and AVX2, including OS support for the 256-bit registers.
+        F16C,   ///< Half-precision float conversion instructions.
+        FMA,    ///< Fused multiply-add (FMA3).
+    };
+
+    /** Check if the CPU supports an instruction set extension.
+        Use this to select code paths compiled for instruction sets beyond the x64 baseline (SSE2).
+        The result is cached, so this is cheap to call.
+    */
+    dlldecl bool isCpuFeatureSupported(CpuFeature feature);
+
     /** Load the content of a file into a string
     */
     dlldecl std::string readFile(const std::string& filename);
 
+    /** Write a file by writing to a temporary file in the same directory first and renaming it when done.
+        This avoids leaving partially written files behind. The directory is created if it doesn't exist.
+        The temporary file is removed on failure and a std::runtime_error is thrown.
+        \param[in] filename Name of the file to write.
+        \param[in] writeFunc Function writing the file contents to the temporary file with the given name. Must throw an exception on failure.
+    */
+    dlldecl void writeFileAtomic(const std::string& filename, const std::function<void(const std::string& tempFilename)>& writeFunc);
+
+    /** Write a file by writing to a temporary file in the same directory first and renaming it when done.
+        The stream is checked for errors after writeFunc returns. See the overload above for details.
+        \param[in] filename Name of the file to write.
+        \param[in] writeFunc Function writing the file contents to a binary stream.
+    */
+    dlldecl void writeFileAtomic(const std::string& filename, const std::function<void(std::ostream& stream)>& writeFunc);
+
     /** Load a shared-library
     */
     dlldecl DllHandle loadDll(const std::string& libPath);
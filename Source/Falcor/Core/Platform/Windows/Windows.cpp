@@ -31,6 +31,8 @@
 #include <commdlg.h>
 #include <ShlObj_core.h>
 #include <comutil.h>
+#include <intrin.h>
+#include <immintrin.h>
 
 // Always run in Optimus mode on laptops
 extern "C"
@@ -239,6 +241,16 @@ namespace Falcor
         return std::string();
     }
 
+    bool findSharedLibrary(const std::string& filename, std::string& fullPath)
+    {
+        // Without a path, SearchPath uses the same search order as LoadLibrary, starting with the executable directory.
+        CHAR path[MAX_PATH];
+        DWORD length = SearchPathA(nullptr, filename.c_str(), nullptr, ARRAYSIZE(path), path, nullptr);
+        if (length == 0 || length >= ARRAYSIZE(path)) return false;
+        fullPath = canonicalizeFilename(path);
+        return !fullPath.empty();
+    }
+
     const std::string& getExecutableName()
     {
         static std::string filename;
@@ -711,6 +723,47 @@ namespace Falcor
         return __popcnt(a);
     }
 
+    bool isCpuFeatureSupported(CpuFeature feature)
+    {
+        struct Features
+        {
+            bool avx2 = false;
+            bool f16c = false;
+            bool fma = false;
+
+            Features()
+            {
+                int info[4];
+                __cpuid(info, 0);
+                const int maxLeaf = info[0];
+
+                __cpuid(info, 1);
+                const bool osxsave = (info[2] & (1 << 27)) != 0;
+                const bool avx = (info[2] & (1 << 28)) != 0;
+                // The OS has to save the XMM and YMM registers on context switches.
+                const bool ymmEnabled = osxsave && (_xgetbv(0) & 0x6) == 0x6;
+                if (!avx || !ymmEnabled) return;
+
+                f16c = (info[2] & (1 << 29)) != 0;
+                fma = (info[2] & (1 << 12)) != 0;
+                if (maxLeaf >= 7)
+                {
+                    __cpuidex(info, 7, 0);
+                    avx2 = (info[1] & (1 << 5)) != 0;
+                }
+            }
+        };
+        static const Features features;
+
+        switch (feature)
+        {
+        case CpuFeature::AVX2: return features.avx2;
+        case CpuFeature::F16C: return features.f16c;
+        case CpuFeature::FMA: return features.fma;
+        default: should_not_get_here(); return false;
+        }
+    }
+
 
     DllHandle loadDll(const std::string& libPath)
     {
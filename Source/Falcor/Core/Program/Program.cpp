@@ -47,6 +47,23 @@ namespace Falcor
         return pShader;
     }
 
+    /** Get the filenames of the downstream compiler libraries that Slang loads at runtime for a compilation target.
+    */
+    static std::vector<std::string> getDownstreamCompilerLibraries(SlangCompileTarget format)
+    {
+        switch (format)
+        {
+        case SLANG_DXIL:
+            return { "dxcompiler.dll", "dxil.dll" };
+        case SLANG_DXBC:
+            return { "d3dcompiler_47.dll" };
+        case SLANG_SPIRV:
+            return { "slang-glslang.dll" };
+        default:
+            return {};
+        }
+    }
+
     Program::Desc::Desc() = default;
 
     Program::Desc::Desc(std::string const& path)
@@ -752,6 +769,20 @@ namespace Falcor
         ProgramReflection::SharedPtr pReflector;
         doSlangReflection(pVersion, pSpecializedSlangProgram, pLinkedEntryPoints, pReflector, log);
 
+        // The kernel code depends on the program version and the types bound to the specialization parameters.
+        // Include these in the shader cache key. Each entry point is cached separately.
+        SHA1 kernelsHash;
+        if (pVersion->mShaderCacheKey)
+        {
+            kernelsHash.update(*pVersion->mShaderCacheKey);
+            kernelsHash.update((uint64_t)specializationArgs.size());
+            for (const auto& specializationArg : specializationArgs)
+            {
+                kernelsHash.update(std::string(specializationArg.type->getName()));
+                kernelsHash.update(uint8_t(0));
+            }
+        }
+
         // Create Shader objects for each entry point and cache them here
         std::vector<Shader::SharedPtr> allShaders;
         for (uint32_t i = 0; i < allEntryPointCount; i++)
@@ -759,20 +790,35 @@ namespace Falcor
             auto pLinkedEntryPoint = pLinkedEntryPoints[i];
             auto entryPointDesc = mDesc.mEntryPoints[i];
 
+            std::optional<ShaderCache::Key> cacheKey;
+            if (pVersion->mShaderCacheKey)
+            {
+                SHA1 sha1 = kernelsHash;
+                sha1.update(i);
+                cacheKey = sha1.final();
+            }
+
             Shader::Blob blob;
-            ComPtr<slang::IBlob> pSlangDiagnostics;
-            bool failed = SLANG_FAILED(pLinkedEntryPoint->getEntryPointCode(
-                /* entryPointIndex: */ 0,
-                /* targetIndex: */ 0,
-                blob.writeRef(),
-                pSlangDiagnostics.writeRef()));
+            if (cacheKey) blob = ShaderCache::read(*cacheKey);
 
-            if (pSlangDiagnostics && pSlangDiagnostics->getBufferSize() > 0)
+            if (!blob)
             {
-                log += (char const*)pSlangDiagnostics->getBufferPointer();
-            }
+                ComPtr<slang::IBlob> pSlangDiagnostics;
+                bool failed = SLANG_FAILED(pLinkedEntryPoint->getEntryPointCode(
+                    /* entryPointIndex: */ 0,
+                    /* targetIndex: */ 0,
+                    blob.writeRef(),
+                    pSlangDiagnostics.writeRef()));
+
+                if (pSlangDiagnostics && pSlangDiagnostics->getBufferSize() > 0)
+                {
+                    log += (char const*)pSlangDiagnostics->getBufferPointer();
+                }
+
+                if (failed) return nullptr;
 
-            if (failed) return nullptr;
+                if (cacheKey) ShaderCache::write(*cacheKey, blob->getBufferPointer(), blob->getBufferSize());
+            }
 
             Shader::SharedPtr shader = createShaderFromBlob(blob, entryPointDesc.stage, entryPointDesc.name, mDesc.getCompilerFlags(), log);
             if (!shader) return nullptr;
@@ -871,10 +917,12 @@ namespace Falcor
 
         // Extract list of files referenced, for dependency-tracking purposes
         int depFileCount = spGetDependencyFileCount(pSlangRequest);
+        std::vector<std::string> depFilePaths;
         for (int ii = 0; ii < depFileCount; ++ii)
         {
             std::string depFilePath = spGetDependencyFilePath(pSlangRequest, ii);
             mFileTimeMap[depFilePath] = getFileModifiedTime(depFilePath);
+            depFilePaths.push_back(depFilePath);
         }
 
         // Note: the `ProgramReflection` needs to be able to refer back to the
@@ -916,9 +964,97 @@ namespace Falcor
             getProgramDescString(),
             pSlangEntryPoints);
 
+        pVersion->mShaderCacheKey = computeShaderCacheKey(depFilePaths);
+
         return pVersion;
     }
 
+    std::optional<ShaderCache::Key> Program::computeShaderCacheKey(const std::vector<std::string>& dependencies) const
+    {
+        // Dumping intermediates is a side effect of the compilation, so always compile in that case.
+        if (is_set(mDesc.getCompilerFlags(), Shader::CompilerFlags::DumpIntermediates)) return {};
+
+        SHA1 sha1;
+        sha1.update(std::string(spGetBuildTagString()));
+        sha1.update(uint8_t(0));
+
+        // Compilation target.
+        slang::TargetDesc targetDesc;
+        const char* targetMacroName = "";
+        setUpSlangCompilationTarget(targetDesc, targetMacroName);
+        sha1.update(targetDesc.format);
+
+        // Downstream compiler. Slang loads it at runtime, so it can be updated without changing the Slang build tag.
+        sha1.update(ShaderCache::getLibraryHash(getDownstreamCompilerLibraries(targetDesc.format)));
+        sha1.update(std::string(targetMacroName));
+        sha1.update(uint8_t(0));
+        sha1.update(mDesc.mShaderModel);
+        sha1.update(uint8_t(0));
+        sha1.update(mDesc.getCompilerFlags());
+
+        // Defines. Both lists are sorted by name.
+        auto hashDefines = [&sha1](const DefineList& defineList)
+        {
+            sha1.update((uint64_t)defineList.size());
+            for (const auto& define : defineList)
+            {
+                sha1.update(define.first);
+                sha1.update(uint8_t(0));
+                sha1.update(define.second);
+                sha1.update(uint8_t(0));
+            }
+        };
+        hashDefines(sGlobalDefineList);
+        hashDefines(mDefineList);
+
+        // Sources and entry points.
+        sha1.update((uint64_t)mDesc.mSources.size());
+        for (const auto& src : mDesc.mSources)
+        {
+            sha1.update(src.type);
+            if (src.type == Desc::Source::Type::File)
+            {
+                std::string fullpath;
+                if (!findFileInShaderDirectories(src.pLibrary->getFilename(), fullpath)) return {};
+                ShaderCache::Key fileHash;
+                if (!ShaderCache::getFileHash(fullpath, fileHash)) return {};
+                sha1.update(fileHash);
+            }
+            else
+            {
+                sha1.update((uint64_t)src.str.size());
+                sha1.update(src.str);
+            }
+        }
+
+        sha1.update((uint64_t)mDesc.mEntryPoints.size());
+        for (const auto& entryPoint : mDesc.mEntryPoints)
+        {
+            sha1.update(entryPoint.name);
+            sha1.update(uint8_t(0));
+            sha1.update(entryPoint.stage);
+            sha1.update(entryPoint.sourceIndex);
+        }
+
+        sha1.update((uint64_t)mDesc.mGroups.size());
+        for (const auto& group : mDesc.mGroups)
+        {
+            sha1.update((uint64_t)group.entryPoints.size());
+            for (auto entryPointIndex : group.entryPoints) sha1.update(entryPointIndex);
+        }
+
+        // Contents of all included files, in the order reported by Slang.
+        sha1.update((uint64_t)dependencies.size());
+        for (const auto& path : dependencies)
+        {
+            ShaderCache::Key fileHash;
+            if (!ShaderCache::getFileHash(path, fileHash)) return {};
+            sha1.update(fileHash);
+        }
+
+        return sha1.final();
+    }
+
     EntryPointGroupKernels::SharedPtr Program::createEntryPointGroupKernels(
         const std::vector<Shader::SharedPtr>& shaders,
         EntryPointBaseReflection::SharedPtr const& pReflector) const
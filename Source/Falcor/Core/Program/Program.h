@@ -260,6 +260,8 @@ namespace Falcor
 
         ProgramVersion::SharedPtr preprocessAndCreateProgramVersion(std::string& log) const;
 
+        std::optional<ShaderCache::Key> computeShaderCacheKey(const std::vector<std::string>& dependencies) const;
+
         ProgramKernels::SharedPtr preprocessAndCreateProgramKernels(
             ProgramVersion const* pVersion,
             ProgramVars    const* pVars,
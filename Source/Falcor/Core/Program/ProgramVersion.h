@@ -29,6 +29,8 @@
 #include "Core/Program/ProgramReflection.h"
 #include "Core/API/Shader.h"
 #include "Core/API/RootSignature.h"
+#include "Core/Program/ShaderCache.h"
+#include <optional>
 
 #include <slang/slang.h>
 
@@ -256,6 +258,9 @@ namespace Falcor
         ComPtr<slang::IComponentType>   mpSlangGlobalScope;
         std::vector<ComPtr<slang::IComponentType>> mpSlangEntryPoints;
 
+        // Shader cache key covering all inputs to the compilation, or empty if the kernels should not be cached.
+        std::optional<ShaderCache::Key> mShaderCacheKey;
+
         // Cached version of compiled kernels for this program version
         mutable std::unordered_map<std::string, ProgramKernels::SharedPtr> mpKernels;
     };
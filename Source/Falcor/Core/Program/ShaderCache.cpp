@@ -0,0 +1,440 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "ShaderCache.h"
+#include "Slang/slang.h"
+#include <filesystem>
+#include <fstream>
+#include <atomic>
+#include <mutex>
+
+namespace Falcor
+{
+    namespace
+    {
+        const uint32_t kMagic = 0x43485346; // 'FSHC'
+        const uint32_t kVersion = 1;
+        const std::string kExtension = ".bin";
+
+        const uint64_t kDefaultMaxSize = 1ull << 30;
+
+        // When the cache exceeds its maximum size, entries are evicted until the size drops below this fraction
+        // of the maximum. This avoids scanning the cache directory on every write once the cache is full.
+        const double kEvictionTargetFraction = 0.9;
+
+        struct Header
+        {
+            uint32_t magic = kMagic;
+            uint32_t version = kVersion;
+            ShaderCache::Key key;
+            uint64_t size = 0;
+        };
+
+        struct FileHash
+        {
+            uint64_t size;
+            std::filesystem::file_time_type modifiedTime; ///< Modification time at full file system resolution. Saving a file twice within a second must change the hash.
+            ShaderCache::Key hash;
+        };
+
+        struct CacheState
+        {
+            std::mutex mutex;
+            bool enabled = true;
+            uint64_t maxSize = kDefaultMaxSize;
+            std::string directory;
+            bool sizeValid = false;
+            uint64_t size = 0;
+            ShaderCache::Stats stats;
+            std::unordered_map<std::string, FileHash> fileHashes;
+            std::unordered_map<std::string, ShaderCache::Key> libraryHashes;
+        };
+
+        CacheState& getState()
+        {
+            static CacheState state;
+            return state;
+        }
+
+        std::string getDefaultCacheDirectory()
+        {
+            std::string dir = getAppDataDirectory();
+            if (dir.empty()) dir = getExecutableDirectory();
+            return dir + "/Falcor/ShaderCache";
+        }
+
+        std::string getEntryFilename(const CacheState& state, const ShaderCache::Key& key)
+        {
+            return state.directory + "/" + SHA1::toString(key) + kExtension;
+        }
+
+        /** Blob holding kernel code loaded from the cache.
+            Slang uses the same interface ID for ISlangBlob as D3D uses for ID3DBlob, so the blob can be used in place of compiler output.
+        */
+        class CachedBlob : public ISlangBlob
+        {
+        public:
+            CachedBlob(std::vector<uint8_t>&& data) : mData(std::move(data)) {}
+            virtual ~CachedBlob() = default;
+
+            SLANG_NO_THROW SlangResult SLANG_MCALL queryInterface(SlangUUID const& uuid, void** outObject) override
+            {
+                static const SlangUUID kBlobUUID = SLANG_UUID_ISlangBlob;
+                static const SlangUUID kUnknownUUID = SLANG_UUID_ISlangUnknown;
+                if (std::memcmp(&uuid, &kBlobUUID, sizeof(SlangUUID)) == 0 || std::memcmp(&uuid, &kUnknownUUID, sizeof(SlangUUID)) == 0)
+                {
+                    addRef();
+                    *outObject = static_cast<ISlangBlob*>(this);
+                    return SLANG_OK;
+                }
+                *outObject = nullptr;
+                return SLANG_E_NO_INTERFACE;
+            }
+
+            SLANG_NO_THROW uint32_t SLANG_MCALL addRef() override { return ++mRefCount; }
+
+            SLANG_NO_THROW uint32_t SLANG_MCALL release() override
+            {
+                uint32_t refCount = --mRefCount;
+                if (refCount == 0) delete this;
+                return refCount;
+            }
+
+            SLANG_NO_THROW void const* SLANG_MCALL getBufferPointer() override { return mData.data(); }
+            SLANG_NO_THROW size_t SLANG_MCALL getBufferSize() override { return mData.size(); }
+
+        private:
+            std::atomic<uint32_t> mRefCount{ 0 };
+            std::vector<uint8_t> mData;
+        };
+
+        void initDirectory(CacheState& state)
+        {
+            if (state.directory.empty()) state.directory = getDefaultCacheDirectory();
+        }
+
+        // Check if a file is a cache entry. Temporary files of entries that are being written are skipped.
+        bool isEntryFile(const std::filesystem::directory_entry& entry)
+        {
+            std::error_code ec;
+            return entry.is_regular_file(ec) && entry.path().extension() == kExtension && entry.path().stem().extension() != ".tmp";
+        }
+
+        // Compute the total size of the cache entries. The caller must hold the mutex.
+        void updateSize(CacheState& state)
+        {
+            if (state.sizeValid) return;
+            initDirectory(state);
+
+            state.size = 0;
+            std::error_code ec;
+            for (const auto& entry : std::filesystem::directory_iterator(state.directory, ec))
+            {
+                if (isEntryFile(entry)) state.size += entry.file_size(ec);
+            }
+            state.sizeValid = true;
+        }
+
+        // Delete the least recently used entries until the cache is below the given size. The caller must hold the mutex.
+        void evict(CacheState& state, uint64_t targetSize)
+        {
+            updateSize(state);
+            if (state.size <= targetSize) return;
+
+            struct Entry
+            {
+                std::filesystem::path path;
+                std::filesystem::file_time_type time;
+                uint64_t size;
+            };
+
+            std::vector<Entry> entries;
+            std::error_code ec;
+            for (const auto& entry : std::filesystem::directory_iterator(state.directory, ec))
+            {
+                if (!isEntryFile(entry)) continue;
+                entries.push_back({ entry.path(), entry.last_write_time(ec), entry.file_size(ec) });
+            }
+
+            std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.time < b.time; });
+
+            for (const auto& entry : entries)
+            {
+                if (state.size <= targetSize) break;
+                if (std::filesystem::remove(entry.path, ec))
+                {
+                    state.size -= std::min(state.size, entry.size);
+                    state.stats.evictions++;
+                }
+            }
+        }
+    }
+
+    void ShaderCache::setEnabled(bool enabled)
+    {
+        CacheState& state = getState();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.enabled = enabled;
+    }
+
+    bool ShaderCache::isEnabled()
+    {
+        CacheState& state = getState();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        return state.enabled;
+    }
+
+    void ShaderCache::setMaxSize(uint64_t maxSize)
+    {
+        CacheState& state = getState();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.maxSize = maxSize;
+        evict(state, maxSize);
+    }
+
+    uint64_t ShaderCache::getMaxSize()
+    {
+        CacheState& state = getState();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        return state.maxSize;
+    }
+
+    void ShaderCache::setCacheDirectory(const std::string& dir)
+    {
+        CacheState& state = getState();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.directory = dir;
+        state.sizeValid = false;
+    }
+
+    std::string ShaderCache::getCacheDirectory()
+    {
+        CacheState& state = getState();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        initDirectory(state);
+        return state.directory;
+    }
+
+    bool ShaderCache::getFileHash(const std::string& path, Key& hash)
+    {
+        std::error_code ec;
+        uint64_t size = std::filesystem::file_size(path, ec);
+        if (ec) return false;
+        auto modifiedTime = std::filesystem::last_write_time(path, ec);
+        if (ec) return false;
+
+        CacheState& state = getState();
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            auto it = state.fileHashes.find(path);
+            if (it != state.fileHashes.end() && it->second.size == size && it->second.modifiedTime == modifiedTime)
+            {
+                hash = it->second.hash;
+                return true;
+            }
+        }
+
+        std::ifstream stream(path, std::ios::binary);
+        if (!stream) return false;
+        std::vector<char> data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+        if (stream.bad()) return false;
+
+        SHA1 sha1;
+        sha1.update((uint64_t)data.size());
+        sha1.update(data.data(), data.size());
+        hash = sha1.final();
+
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.fileHashes[path] = { size, modifiedTime, hash };
+        return true;
+    }
+
+    ShaderCache::Key ShaderCache::getLibraryHash(const std::vector<std::string>& libraries)
+    {
+        std::string name = joinStrings(libraries, ";");
+
+        CacheState& state = getState();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        if (auto it = state.libraryHashes.find(name); it != state.libraryHashes.end()) return it->second;
+
+        SHA1 sha1;
+        for (const auto& library : libraries)
+        {
+            sha1.update(library);
+            sha1.update(uint8_t(0));
+
+            std::string fullPath;
+            if (!findSharedLibrary(library, fullPath)) continue;
+            std::error_code sizeError, timeError;
+            uint64_t size = std::filesystem::file_size(fullPath, sizeError);
+            int64_t modifiedTime = std::filesystem::last_write_time(fullPath, timeError).time_since_epoch().count();
+            if (sizeError || timeError) continue;
+            sha1.update(fullPath);
+            sha1.update(uint8_t(0));
+            sha1.update(size);
+            sha1.update(modifiedTime);
+        }
+        return state.libraryHashes[name] = sha1.final();
+    }
+
+    Shader::Blob ShaderCache::read(const Key& key)
+    {
+        CacheState& state = getState();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        if (!state.enabled) return nullptr;
+        initDirectory(state);
+
+        std::string filename = getEntryFilename(state, key);
+        std::ifstream stream(filename, std::ios::binary);
+        if (!stream)
+        {
+            state.stats.misses++;
+            return nullptr;
+        }
+
+        // Validate the entry. Entries written by other versions or truncated entries are treated as misses and overwritten.
+        std::error_code ec;
+        uint64_t fileSize = std::filesystem::file_size(filename, ec);
+        Header header;
+        stream.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (!stream || header.magic != kMagic || header.version != kVersion || header.key != key || fileSize != sizeof(Header) + header.size)
+        {
+            state.stats.misses++;
+            return nullptr;
+        }
+
+        std::vector<uint8_t> data(header.size);
+        stream.read(reinterpret_cast<char*>(data.data()), data.size());
+        if (!stream)
+        {
+            state.stats.misses++;
+            return nullptr;
+        }
+        stream.close();
+
+        // Touch the entry to mark it as recently used.
+        std::filesystem::last_write_time(filename, std::filesystem::file_time_type::clock::now(), ec);
+
+        state.stats.hits++;
+        state.stats.bytesRead += data.size();
+
+        return Shader::Blob(new CachedBlob(std::move(data)));
+    }
+
+    void ShaderCache::write(const Key& key, const void* pData, size_t size)
+    {
+        CacheState& state = getState();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        if (!state.enabled) return;
+
+        uint64_t entrySize = sizeof(Header) + size;
+        if (entrySize > state.maxSize) return;
+
+        updateSize(state);
+
+        std::string filename = getEntryFilename(state, key);
+
+        try
+        {
+            std::error_code ec;
+            uint64_t oldSize = std::filesystem::exists(filename, ec) ? std::filesystem::file_size(filename, ec) : 0;
+
+            writeFileAtomic(filename, [&](std::ostream& stream)
+            {
+                Header header;
+                header.key = key;
+                header.size = size;
+                stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+                stream.write(reinterpret_cast<const char*>(pData), size);
+            });
+
+            state.size = state.size - std::min(state.size, oldSize) + entrySize;
+            state.stats.writes++;
+            state.stats.bytesWritten += entrySize;
+        }
+        catch (const std::exception& e)
+        {
+            logWarning("Failed to write shader cache entry: " + std::string(e.what()));
+            return;
+        }
+
+        if (state.size > state.maxSize) evict(state, (uint64_t)(state.maxSize * kEvictionTargetFraction));
+    }
+
+    void ShaderCache::clear()
+    {
+        CacheState& state = getState();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        evict(state, 0);
+    }
+
+    uint64_t ShaderCache::getSize()
+    {
+        CacheState& state = getState();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        updateSize(state);
+        return state.size;
+    }
+
+    ShaderCache::Stats ShaderCache::getStats()
+    {
+        CacheState& state = getState();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        return state.stats;
+    }
+
+    void ShaderCache::resetStats()
+    {
+        CacheState& state = getState();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.stats = Stats();
+    }
+
+    pybind11::dict ShaderCache::Stats::toPython() const
+    {
+        pybind11::dict d;
+        d["hits"] = hits;
+        d["misses"] = misses;
+        d["writes"] = writes;
+        d["evictions"] = evictions;
+        d["bytesRead"] = bytesRead;
+        d["bytesWritten"] = bytesWritten;
+        return d;
+    }
+
+    SCRIPT_BINDING(ShaderCache)
+    {
+        pybind11::class_<ShaderCache> shaderCache(m, "ShaderCache");
+        shaderCache.def_property_static("enabled", [](pybind11::object) { return ShaderCache::isEnabled(); }, [](pybind11::object, bool enabled) { ShaderCache::setEnabled(enabled); });
+        shaderCache.def_property_static("maxSize", [](pybind11::object) { return ShaderCache::getMaxSize(); }, [](pybind11::object, uint64_t maxSize) { ShaderCache::setMaxSize(maxSize); });
+        shaderCache.def_property_readonly_static("size", [](pybind11::object) { return ShaderCache::getSize(); });
+        shaderCache.def_property_readonly_static("stats", [](pybind11::object) { return ShaderCache::getStats().toPython(); });
+        shaderCache.def_static("clear", &ShaderCache::clear);
+        shaderCache.def_static("resetStats", &ShaderCache::resetStats);
+    }
+}
@@ -0,0 +1,120 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Core/API/Shader.h"
+#include "Utils/CryptoUtils.h"
+
+namespace Falcor
+{
+    /** Persistent on-disk cache of compiled shader kernels.
+
+        Each cache entry stores the target code (DXIL/DXBC/SPIR-V) of a single entry point.
+        Entries are content addressed: the key is a hash over the contents of all source files
+        and included files, the program and global define lists, the entry points, the shader
+        model, the compiler flags, the compilation target, the specialization arguments, and the
+        versions of Slang and the downstream compiler (DXC, fxc or glslang).
+        Editing any of these results in a new key, so stale entries are never returned and
+        are eventually removed by the eviction.
+
+        The cache is bounded in size. When the total size exceeds the limit, the least recently
+        used entries are deleted. Reading an entry updates its modification time, which is used
+        as the LRU timestamp and persists across process restarts.
+    */
+    class dlldecl ShaderCache
+    {
+    public:
+        using Key = SHA1::MD;
+
+        /** Cache statistics, accumulated since startup or the last call to resetStats().
+        */
+        struct Stats
+        {
+            uint64_t hits = 0;              ///< Number of entry points loaded from the cache.
+            uint64_t misses = 0;            ///< Number of entry points not found in the cache.
+            uint64_t writes = 0;            ///< Number of entries written to the cache.
+            uint64_t evictions = 0;         ///< Number of entries deleted by the eviction.
+            uint64_t bytesRead = 0;         ///< Total size of the entries loaded from the cache.
+            uint64_t bytesWritten = 0;      ///< Total size of the entries written to the cache.
+
+            pybind11::dict toPython() const;
+        };
+
+        /** Enable/disable the cache. When disabled, read() always returns nullptr and write() does nothing.
+        */
+        static void setEnabled(bool enabled);
+        static bool isEnabled();
+
+        /** Set the maximum total size of the cache in bytes. Excess entries are evicted immediately.
+        */
+        static void setMaxSize(uint64_t maxSize);
+        static uint64_t getMaxSize();
+
+        /** Set the cache directory. The default is 'Falcor/ShaderCache' in the application data directory.
+        */
+        static void setCacheDirectory(const std::string& dir);
+        static std::string getCacheDirectory();
+
+        /** Compute the hash of a file's contents. The hashes are memoized by path, size and modification time.
+            \param[in] path Full path of the file.
+            \param[out] hash The file hash.
+            \return Returns false if the file could not be read.
+        */
+        static bool getFileHash(const std::string& path, Key& hash);
+
+        /** Compute a hash identifying a set of shared libraries, such as the downstream compilers that Slang loads at runtime.
+            The libraries are identified by path, size and modification time, so updating them changes the hash. The hashes are memoized for the lifetime of the process.
+            \param[in] libraries Library filenames, including the extension. Libraries are searched for like the OS does when loading them (see findSharedLibrary()).
+            \return The hash. Libraries that are not found only contribute their name.
+        */
+        static Key getLibraryHash(const std::vector<std::string>& libraries);
+
+        /** Load a compiled kernel from the cache.
+            \param[in] key Cache key.
+            \return Returns the kernel code, or nullptr on a cache miss.
+        */
+        static Shader::Blob read(const Key& key);
+
+        /** Store a compiled kernel in the cache. Errors are logged and otherwise ignored.
+            \param[in] key Cache key.
+            \param[in] pData Kernel code.
+            \param[in] size Size of the kernel code in bytes.
+        */
+        static void write(const Key& key, const void* pData, size_t size);
+
+        /** Delete all cache entries.
+        */
+        static void clear();
+
+        /** Get the current total size of the cache entries in bytes.
+        */
+        static uint64_t getSize();
+
+        static Stats getStats();
+        static void resetStats();
+    };
+}
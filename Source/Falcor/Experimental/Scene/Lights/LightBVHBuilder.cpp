@@ -27,7 +27,9 @@
  **************************************************************************/
 #include "stdafx.h"
 #include "LightBVHBuilder.h"
+#include "Utils/Threading.h"
 #include <algorithm>
+#include <immintrin.h>
 
 namespace
 {
@@ -41,6 +43,12 @@ namespace
     const uint32_t kMaxLeafTriangleCount = 1 << PackedNode::kTriangleCountBits;
     const uint32_t kMaxLeafTriangleOffset = 1 << PackedNode::kTriangleOffsetBits;
 
+    // Minimum number of triangles in a node for building its subtrees in parallel.
+    const uint32_t kParallelBuildMinTriangleCount = 16384;
+
+    // Minimum number of triangles in a node for evaluating the split axes in parallel.
+    const uint32_t kParallelBinningMinTriangleCount = 4096;
+
     inline float safeACos(float v)
     {
         return std::acos(glm::clamp(v, -1.0f, 1.0f));
@@ -215,6 +223,316 @@ namespace
         return dims.x * dims.y * dims.z;
     }
 
+    /** Computes the cosine of the cone angle around coneDir that bounds another cone, for eight cones at a time.
+        This is the vectorized version of the arithmetic in computeCosConeAngle(). The operations are the same, so the results are identical.
+        \param[out] cosTotalTheta Cosine of the cone angle needed to include the other cone.
+        \return Mask of the lanes where the other cone is valid and can be included without covering the whole sphere.
+    */
+    target_avx2 inline __m256 computeCosConeAngleCandidatesAVX2(__m256 coneDirX, __m256 coneDirY, __m256 coneDirZ, __m256 otherDirX, __m256 otherDirY, __m256 otherDirZ, __m256 cosOtherTheta, __m256& cosTotalTheta)
+    {
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 one = _mm256_set1_ps(1.f);
+
+        __m256 cosDiffTheta = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(coneDirX, otherDirX), _mm256_mul_ps(coneDirY, otherDirY)), _mm256_mul_ps(coneDirZ, otherDirZ));
+        __m256 sinDiffTheta = _mm256_sqrt_ps(_mm256_max_ps(_mm256_sub_ps(one, _mm256_mul_ps(cosDiffTheta, cosDiffTheta)), zero));
+        __m256 sinOtherTheta = _mm256_sqrt_ps(_mm256_max_ps(_mm256_sub_ps(one, _mm256_mul_ps(cosOtherTheta, cosOtherTheta)), zero));
+
+        cosTotalTheta = _mm256_sub_ps(_mm256_mul_ps(cosOtherTheta, cosDiffTheta), _mm256_mul_ps(sinOtherTheta, sinDiffTheta));
+        __m256 sinTotalTheta = _mm256_add_ps(_mm256_mul_ps(sinOtherTheta, cosDiffTheta), _mm256_mul_ps(cosOtherTheta, sinDiffTheta));
+
+        __m256 validOther = _mm256_cmp_ps(cosOtherTheta, _mm256_set1_ps(kInvalidCosConeAngle), _CMP_NEQ_UQ);
+        return _mm256_and_ps(validOther, _mm256_cmp_ps(sinTotalTheta, zero, _CMP_GT_OQ));
+    }
+
+    /** Folds a cone angle candidate into a cosine cone angle, with the same result as computeCosConeAngle().
+    */
+    inline float accumulateCosConeAngle(float cosTheta, bool valid, float cosTotalTheta)
+    {
+        return cosTheta != kInvalidCosConeAngle && valid ? std::min(cosTheta, cosTotalTheta) : kInvalidCosConeAngle;
+    }
+
+    /** Bounding cones of the bins in structure-of-arrays layout.
+        The arrays are padded to a multiple of the SIMD width.
+    */
+    struct BinCones
+    {
+        std::vector<float> coneDirection[3];
+        std::vector<float> cosConeAngle;
+
+        BinCones(uint32_t binCount)
+        {
+            const size_t paddedCount = align_to(8, binCount);
+            for (auto& c : coneDirection) c.resize(paddedCount, 0.f);
+            cosConeAngle.resize(paddedCount, kInvalidCosConeAngle);
+        }
+
+        float3 getConeDirection(uint32_t i) const { return float3(coneDirection[0][i], coneDirection[1][i], coneDirection[2][i]); }
+    };
+
+    target_avx2 float computeBinsCosConeAngleAVX2(const float3& coneDir, const BinCones& bins, uint32_t begin, uint32_t end)
+    {
+        const __m256 coneDirX = _mm256_set1_ps(coneDir.x);
+        const __m256 coneDirY = _mm256_set1_ps(coneDir.y);
+        const __m256 coneDirZ = _mm256_set1_ps(coneDir.z);
+
+        // Compute the candidates for all blocks of eight bins overlapping the range.
+        // The fold is done in order with scalar code, to handle the invalid cone angle exactly like computeCosConeAngle().
+        float cosTheta = 1.f;
+        for (uint32_t blockBegin = begin & ~7u; blockBegin < end; blockBegin += 8)
+        {
+            __m256 cosTotalTheta;
+            __m256 valid = computeCosConeAngleCandidatesAVX2(coneDirX, coneDirY, coneDirZ,
+                _mm256_loadu_ps(&bins.coneDirection[0][blockBegin]), _mm256_loadu_ps(&bins.coneDirection[1][blockBegin]), _mm256_loadu_ps(&bins.coneDirection[2][blockBegin]),
+                _mm256_loadu_ps(&bins.cosConeAngle[blockBegin]), cosTotalTheta);
+
+            alignas(32) float cosTotalThetas[8];
+            _mm256_store_ps(cosTotalThetas, cosTotalTheta);
+            const int validMask = _mm256_movemask_ps(valid);
+
+            for (uint32_t i = std::max(begin, blockBegin); i < std::min(end, blockBegin + 8); ++i)
+            {
+                const uint32_t lane = i - blockBegin;
+                cosTheta = accumulateCosConeAngle(cosTheta, (validMask & (1 << lane)) != 0, cosTotalThetas[lane]);
+            }
+        }
+        return cosTheta;
+    }
+
+    /** Computes the cosine of the cone angle around a given direction that bounds the cones of a range of bins.
+        This is the same as folding computeCosConeAngle() over the bins, starting with a zero cone angle.
+        \param[in] coneDir Direction of the cone.
+        \param[in] bins Bounding cones of the bins.
+        \param[in] begin First bin.
+        \param[in] end One past the last bin.
+        \return The cosine of the cone angle, or kInvalidCosConeAngle if the cone is invalid.
+    */
+    float computeBinsCosConeAngle(const float3& coneDir, const BinCones& bins, uint32_t begin, uint32_t end)
+    {
+        static const bool kUseAVX2 = isCpuFeatureSupported(CpuFeature::AVX2);
+        if (kUseAVX2) return computeBinsCosConeAngleAVX2(coneDir, bins, begin, end);
+
+        float cosTheta = 1.f;
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            cosTheta = computeCosConeAngle(coneDir, cosTheta, bins.getConeDirection(i), bins.cosConeAngle[i]);
+        }
+        return cosTheta;
+    }
+
+    /** Accessor for triangle data in array-of-structures layout.
+        The split heuristics are written against this interface, so they work with both the AoS and SoA layouts.
+    */
+    template<typename TriangleSortData>
+    class AoSTriangles
+    {
+    public:
+        AoSTriangles(const std::vector<TriangleSortData>& triangles) : mTriangles(triangles) {}
+
+        AABB getBounds(uint32_t i) const { return mTriangles[i].bounds; }
+        float3 getConeDirection(uint32_t i) const { return mTriangles[i].coneDirection; }
+        float getCosConeAngle(uint32_t i) const { return mTriangles[i].cosConeAngle; }
+        float getFlux(uint32_t i) const { return mTriangles[i].flux; }
+        uint32_t getTriangleIndex(uint32_t i) const { return mTriangles[i].triangleIndex; }
+
+        /** Computes the bin index along one dimension for a range of triangles.
+            The bin index is computed from the center of the triangle bounds as (center - bmin) * scale, truncated and clamped to the last bin.
+            Four triangles are processed at a time using SSE. The arithmetic is the same as for the scalar remainder, so the results are identical.
+            \param[in] begin First triangle.
+            \param[in] end One past the last triangle.
+            \param[in] dimension Dimension to bin along.
+            \param[in] bmin Minimum node bounds along the dimension.
+            \param[in] scale Bin count divided by the node extent along the dimension.
+            \param[in] binCount Number of bins.
+            \param[out] pBinIds Bin index for each triangle in the range.
+        */
+        void computeBinIds(uint32_t begin, uint32_t end, uint32_t dimension, float bmin, float scale, uint32_t binCount, uint32_t* pBinIds) const
+        {
+            const __m128 vHalf = _mm_set1_ps(0.5f);
+            const __m128 vMin = _mm_set1_ps(bmin);
+            const __m128 vScale = _mm_set1_ps(scale);
+
+            uint32_t i = begin;
+            for (; i + 4 <= end; i += 4)
+            {
+                const TriangleSortData* t = &mTriangles[i];
+                __m128 lo = _mm_setr_ps(t[0].bounds.minPoint[dimension], t[1].bounds.minPoint[dimension], t[2].bounds.minPoint[dimension], t[3].bounds.minPoint[dimension]);
+                __m128 hi = _mm_setr_ps(t[0].bounds.maxPoint[dimension], t[1].bounds.maxPoint[dimension], t[2].bounds.maxPoint[dimension], t[3].bounds.maxPoint[dimension]);
+                __m128 p = _mm_mul_ps(_mm_add_ps(lo, hi), vHalf);
+                __m128i bin = _mm_cvttps_epi32(_mm_mul_ps(_mm_sub_ps(p, vMin), vScale));
+
+                alignas(16) uint32_t binIds[4];
+                _mm_store_si128(reinterpret_cast<__m128i*>(binIds), bin);
+                for (uint32_t j = 0; j < 4; j++) pBinIds[i - begin + j] = std::min(binIds[j], binCount - 1);
+            }
+            for (; i < end; i++)
+            {
+                float p = mTriangles[i].bounds.center()[dimension];
+                pBinIds[i - begin] = std::min((uint32_t)((p - bmin) * scale), binCount - 1);
+            }
+        }
+
+        /** Grows the bounding cones of the bins to include the cones of a range of triangles.
+            \param[in] begin First triangle.
+            \param[in] end One past the last triangle.
+            \param[in] pBinIds Bin index for each triangle in the range.
+            \param[in,out] bins Bounding cones of the bins. The cone directions are expected to be final.
+        */
+        void computeBinConeAngles(uint32_t begin, uint32_t end, const uint32_t* pBinIds, BinCones& bins) const
+        {
+            for (uint32_t i = begin; i < end; ++i)
+            {
+                const auto& td = mTriangles[i];
+                const uint32_t binId = pBinIds[i - begin];
+                bins.cosConeAngle[binId] = computeCosConeAngle(bins.getConeDirection(binId), bins.cosConeAngle[binId], td.coneDirection, td.cosConeAngle);
+            }
+        }
+
+    private:
+        const std::vector<TriangleSortData>& mTriangles;
+    };
+
+    /** Accessor for triangle data in structure-of-arrays layout.
+        This has the same interface as AoSTriangles, but the bulk operations use AVX2 if supported.
+    */
+    template<typename TriangleSortDataSoA>
+    class SoATriangles
+    {
+    public:
+        SoATriangles(const TriangleSortDataSoA& triangles) : mTriangles(triangles) {}
+
+        AABB getBounds(uint32_t i) const
+        {
+            return AABB(float3(mTriangles.boundsMin[0][i], mTriangles.boundsMin[1][i], mTriangles.boundsMin[2][i]),
+                float3(mTriangles.boundsMax[0][i], mTriangles.boundsMax[1][i], mTriangles.boundsMax[2][i]));
+        }
+        float3 getConeDirection(uint32_t i) const { return float3(mTriangles.coneDirection[0][i], mTriangles.coneDirection[1][i], mTriangles.coneDirection[2][i]); }
+        float getCosConeAngle(uint32_t i) const { return mTriangles.cosConeAngle[i]; }
+        float getFlux(uint32_t i) const { return mTriangles.flux[i]; }
+        uint32_t getTriangleIndex(uint32_t i) const { return mTriangles.triangleIndex[i]; }
+
+        // See AoSTriangles::computeBinIds().
+        void computeBinIds(uint32_t begin, uint32_t end, uint32_t dimension, float bmin, float scale, uint32_t binCount, uint32_t* pBinIds) const
+        {
+            static const bool kUseAVX2 = isCpuFeatureSupported(CpuFeature::AVX2);
+            const float* pCentroid = mTriangles.centroid[dimension].data();
+
+            uint32_t i = begin;
+            if (kUseAVX2) i = computeBinIdsAVX2(pCentroid, begin, end, bmin, scale, binCount, pBinIds);
+            for (; i < end; i++)
+            {
+                pBinIds[i - begin] = std::min((uint32_t)((pCentroid[i] - bmin) * scale), binCount - 1);
+            }
+        }
+
+        // See AoSTriangles::computeBinConeAngles().
+        void computeBinConeAngles(uint32_t begin, uint32_t end, const uint32_t* pBinIds, BinCones& bins) const
+        {
+            static const bool kUseAVX2 = isCpuFeatureSupported(CpuFeature::AVX2);
+
+            uint32_t i = begin;
+            if (kUseAVX2) i = computeBinConeAnglesAVX2(begin, end, pBinIds, bins);
+            for (; i < end; ++i)
+            {
+                const uint32_t binId = pBinIds[i - begin];
+                bins.cosConeAngle[binId] = computeCosConeAngle(bins.getConeDirection(binId), bins.cosConeAngle[binId], getConeDirection(i), getCosConeAngle(i));
+            }
+        }
+
+    private:
+        /** Computes the bin indices for blocks of eight triangles.
+            \return Index of the first triangle that was not processed.
+        */
+        target_avx2 static uint32_t computeBinIdsAVX2(const float* pCentroid, uint32_t begin, uint32_t end, float bmin, float scale, uint32_t binCount, uint32_t* pBinIds)
+        {
+            const __m256 vMin = _mm256_set1_ps(bmin);
+            const __m256 vScale = _mm256_set1_ps(scale);
+            const __m256i vLastBin = _mm256_set1_epi32((int)(binCount - 1));
+
+            uint32_t i = begin;
+            for (; i + 8 <= end; i += 8)
+            {
+                __m256 p = _mm256_loadu_ps(pCentroid + i);
+                __m256i bin = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_sub_ps(p, vMin), vScale));
+                // The bin index is non-negative for centroids inside the node bounds, or 0x80000000 if out of range.
+                // Use an unsigned min to clamp both cases to the last bin.
+                bin = _mm256_min_epu32(bin, vLastBin);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(pBinIds + (i - begin)), bin);
+            }
+            return i;
+        }
+
+        /** Computes the cone angle candidates for blocks of eight triangles and folds them into the bins in order.
+            \return Index of the first triangle that was not processed.
+        */
+        target_avx2 uint32_t computeBinConeAnglesAVX2(uint32_t begin, uint32_t end, const uint32_t* pBinIds, BinCones& bins) const
+        {
+            uint32_t i = begin;
+            for (; i + 8 <= end; i += 8)
+            {
+                __m256i binIds = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pBinIds + (i - begin)));
+
+                __m256 cosTotalTheta;
+                __m256 valid = computeCosConeAngleCandidatesAVX2(
+                    _mm256_i32gather_ps(bins.coneDirection[0].data(), binIds, 4), _mm256_i32gather_ps(bins.coneDirection[1].data(), binIds, 4), _mm256_i32gather_ps(bins.coneDirection[2].data(), binIds, 4),
+                    _mm256_loadu_ps(&mTriangles.coneDirection[0][i]), _mm256_loadu_ps(&mTriangles.coneDirection[1][i]), _mm256_loadu_ps(&mTriangles.coneDirection[2][i]),
+                    _mm256_loadu_ps(&mTriangles.cosConeAngle[i]), cosTotalTheta);
+
+                alignas(32) float cosTotalThetas[8];
+                _mm256_store_ps(cosTotalThetas, cosTotalTheta);
+                const int validMask = _mm256_movemask_ps(valid);
+
+                for (uint32_t lane = 0; lane < 8; ++lane)
+                {
+                    float& cosTheta = bins.cosConeAngle[pBinIds[i - begin + lane]];
+                    cosTheta = accumulateCosConeAngle(cosTheta, (validMask & (1 << lane)) != 0, cosTotalThetas[lane]);
+                }
+            }
+            return i;
+        }
+
+        const TriangleSortDataSoA& mTriangles;
+    };
+
+    /** Calls a function with an accessor for the triangle data of the build, in whichever layout it is stored.
+    */
+    template<typename BuildingData, typename Function>
+    auto visitTriangles(const BuildingData& data, Function&& func)
+    {
+        if (!data.trianglesSoA.empty()) return func(SoATriangles(data.trianglesSoA));
+        return func(AoSTriangles(data.trianglesData));
+    }
+
+    /** Reorders a range of triangles in SoA layout so that the triangle at position nth is the one that would be there
+        if the range was sorted by the centroid along the given dimension, as done by std::nth_element().
+        The selection is done on (key, index) pairs with the same comparisons as for the AoS layout, so the resulting order is identical.
+    */
+    template<typename TriangleSortDataSoA>
+    void selectNthTriangle(TriangleSortDataSoA& triangles, uint32_t begin, uint32_t nth, uint32_t end, uint32_t dimension)
+    {
+        std::vector<std::pair<float, uint32_t>> keys(end - begin);
+        for (uint32_t i = begin; i < end; ++i) keys[i - begin] = { triangles.centroid[dimension][i], i };
+
+        std::nth_element(keys.begin(), keys.begin() + (nth - begin), keys.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+        // Apply the permutation to all arrays.
+        auto permute = [&](auto& values)
+        {
+            auto permuted = std::vector<typename std::decay_t<decltype(values)>::value_type>(end - begin);
+            for (uint32_t i = 0; i < end - begin; ++i) permuted[i] = values[keys[i].second];
+            std::copy(permuted.begin(), permuted.end(), values.begin() + begin);
+        };
+        for (uint32_t d = 0; d < 3; ++d)
+        {
+            permute(triangles.centroid[d]);
+            permute(triangles.boundsMin[d]);
+            permute(triangles.boundsMax[d]);
+            permute(triangles.coneDirection[d]);
+        }
+        permute(triangles.cosConeAngle);
+        permute(triangles.flux);
+        permute(triangles.triangleIndex);
+    }
+
     const Gui::DropdownList kSplitHeuristicList =
     {
         { (uint32_t)LightBVHBuilder::SplitHeuristic::Equal, "Equal" },
@@ -247,7 +565,8 @@ namespace Falcor
         // Create list of triangles that should be included in BVH.
         // For each triangle, precompute data we need for the build.
         BuildingData data(bvh.mNodes);
-        data.trianglesData.reserve(triangles.size());
+        if (mOptions.useSoALayout) data.trianglesSoA.reserve(triangles.size());
+        else data.trianglesData.reserve(triangles.size());
 
         for (size_t i = 0; i < triangles.size(); i++)
         {
@@ -264,19 +583,37 @@ namespace Falcor
                 tri.flux = triangles[i].flux;
                 tri.triangleIndex = static_cast<uint32_t>(i);
 
-                data.trianglesData.push_back(tri);
+                if (mOptions.useSoALayout) data.trianglesSoA.push_back(tri);
+                else data.trianglesData.push_back(tri);
             }
         }
 
         // If there are no non-culled triangles, we're done.
-        if (data.trianglesData.empty()) return;
+        if (data.triangleCount() == 0) return;
+
+        buildNodes(triangles.size(), data);
+
+        // The BVH is ready, mark it as valid and upload the data.
+        bvh.mIsValid = true;
+        bvh.mMaxTriangleCountPerLeaf = mOptions.maxTriangleCountPerLeaf;
+        bvh.uploadCPUBuffers(data.triangleIndices, data.triangleBitmasks);
+
+        // Computate metadata.
+        bvh.finalize();
+    }
+
+    void LightBVHBuilder::buildNodes(size_t globalTriangleCount, BuildingData& data)
+    {
+        assert(mOptions.useSoALayout ? data.trianglesData.empty() : data.trianglesSoA.empty());
+        const size_t triangleCount = data.triangleCount();
+        assert(triangleCount > 0);
 
         // Validate options.
         if (mOptions.maxTriangleCountPerLeaf > kMaxLeafTriangleCount)
         {
             throw std::exception(("Max triangle count per leaf exceeds the maximum supported (" + std::to_string(kMaxLeafTriangleCount) + ")").c_str());
         }
-        if (data.trianglesData.size() > kMaxLeafTriangleOffset + kMaxLeafTriangleCount)
+        if (triangleCount > kMaxLeafTriangleOffset + kMaxLeafTriangleCount)
         {
             throw std::exception(("Emissive triangle count exceeds the maximum supported (" + std::to_string(kMaxLeafTriangleOffset + kMaxLeafTriangleCount) + ")").c_str());
         }
@@ -286,33 +623,25 @@ namespace Falcor
         // This is only system RAM and shouldn't be that much, so it's not worth being more careful about it.
         // TODO: Better estimate of how many nodes we will need.
         data.nodes.clear();
-        data.nodes.reserve(2 * data.trianglesData.size());
-        data.triangleIndices.reserve(data.trianglesData.size());
+        data.nodes.reserve(2 * triangleCount);
+        data.triangleIndices.reserve(triangleCount);
 
         const uint64_t invalidBitmask = std::numeric_limits<uint64_t>::max();
-        data.triangleBitmasks.resize(triangles.size(), invalidBitmask); // This is sized based on input triangle count, as it's indexed by global triangle index.
+        data.triangleBitmasks.resize(globalTriangleCount, invalidBitmask); // This is sized based on input triangle count, as it's indexed by global triangle index.
 
         // Build the tree.
         SplitHeuristicFunction splitFunc = getSplitFunction(mOptions.splitHeuristicSelection);
-        buildInternal(mOptions, splitFunc, 0ull, 0, Range(0, static_cast<uint32_t>(data.trianglesData.size())), data);
+        buildInternal(mOptions, splitFunc, 0ull, 0, Range(0, static_cast<uint32_t>(triangleCount)), data, data.nodes, data.triangleIndices);
         assert(!data.nodes.empty());
 
         size_t numValid = 0;
         for (auto mask : data.triangleBitmasks)
             if (mask != invalidBitmask) numValid++;
-        assert(numValid == data.trianglesData.size());
+        assert(numValid == triangleCount);
 
         // Compute per-node light bounding cones.
         float cosConeAngle;
         computeLightingConesInternal(0, data, cosConeAngle);
-
-        // The BVH is ready, mark it as valid and upload the data.
-        bvh.mIsValid = true;
-        bvh.mMaxTriangleCountPerLeaf = mOptions.maxTriangleCountPerLeaf;
-        bvh.uploadCPUBuffers(data.triangleIndices, data.triangleBitmasks);
-
-        // Computate metadata.
-        bvh.finalize();
     }
 
     bool LightBVHBuilder::renderUI(Gui::Widgets& widget)
@@ -353,31 +682,66 @@ namespace Falcor
             }
         }
 
+        optionsChanged |= widget.checkbox("Parallel build", options.useParallelBuild);
+        widget.tooltip("Build large subtrees and evaluate the split axes in parallel. The resulting BVH is identical to the serial build.", true);
+        optionsChanged |= widget.checkbox("SoA layout", options.useSoALayout);
+        widget.tooltip("Store the triangle data in structure-of-arrays layout during the build, which allows SIMD binning. The resulting BVH is identical to the array-of-structures layout.", true);
+
         return optionsChanged;
     }
 
+    void LightBVHBuilder::TriangleSortDataSoA::reserve(size_t count)
+    {
+        for (uint32_t d = 0; d < 3; ++d)
+        {
+            centroid[d].reserve(count);
+            boundsMin[d].reserve(count);
+            boundsMax[d].reserve(count);
+            coneDirection[d].reserve(count);
+        }
+        cosConeAngle.reserve(count);
+        flux.reserve(count);
+        triangleIndex.reserve(count);
+    }
+
+    void LightBVHBuilder::TriangleSortDataSoA::push_back(const TriangleSortData& tri)
+    {
+        const float3 center = tri.bounds.center();
+        for (uint32_t d = 0; d < 3; ++d)
+        {
+            centroid[d].push_back(center[d]);
+            boundsMin[d].push_back(tri.bounds.minPoint[d]);
+            boundsMax[d].push_back(tri.bounds.maxPoint[d]);
+            coneDirection[d].push_back(tri.coneDirection[d]);
+        }
+        cosConeAngle.push_back(tri.cosConeAngle);
+        flux.push_back(tri.flux);
+        triangleIndex.push_back(tri.triangleIndex);
+    }
+
     LightBVHBuilder::LightBVHBuilder(const Options& options) : mOptions(options)
     {
     }
 
-    uint32_t LightBVHBuilder::buildInternal(const Options& options, const SplitHeuristicFunction& splitHeuristic, uint64_t bitmask, uint32_t depth, const Range& triangleRange, BuildingData& data)
+    uint32_t LightBVHBuilder::buildInternal(const Options& options, const SplitHeuristicFunction& splitHeuristic, uint64_t bitmask, uint32_t depth, const Range& triangleRange, BuildingData& data, std::vector<PackedNode>& nodes, std::vector<uint32_t>& triangleIndices)
     {
         assert(triangleRange.begin < triangleRange.end);
 
         // Compute the AABB and total flux of the node.
         float nodeFlux = 0.f;
         AABB nodeBounds;
-        for (uint32_t dataIndex = triangleRange.begin; dataIndex < triangleRange.end; ++dataIndex)
+        visitTriangles(data, [&](const auto& triangles)
         {
-            nodeBounds |= data.trianglesData[dataIndex].bounds;
-            nodeFlux += data.trianglesData[dataIndex].flux;
-        }
+            for (uint32_t dataIndex = triangleRange.begin; dataIndex < triangleRange.end; ++dataIndex)
+            {
+                nodeBounds |= triangles.getBounds(dataIndex);
+                nodeFlux += triangles.getFlux(dataIndex);
+            }
+        });
         assert(nodeBounds.valid());
 
-        data.currentNodeFlux = nodeFlux;
-
         bool trySplitting = triangleRange.length() > (options.createLeavesASAP ? options.maxTriangleCountPerLeaf : 1);
-        const SplitResult splitResult = trySplitting ? splitHeuristic(data, triangleRange, nodeBounds, options) : SplitResult();
+        const SplitResult splitResult = trySplitting ? splitHeuristic(data, triangleRange, nodeBounds, nodeFlux, options) : SplitResult();
 
         // If we should split, then create an internal node and split.
         if (splitResult.isValid())
@@ -385,13 +749,20 @@ namespace Falcor
             assert(triangleRange.begin < splitResult.triangleIndex && splitResult.triangleIndex < triangleRange.end);
 
             // Sort the centroids and update the lists accordingly.
-            auto comp = [dim = splitResult.axis](const TriangleSortData& d1, const TriangleSortData& d2) { return d1.bounds.center()[dim] < d2.bounds.center()[dim]; };
-            std::nth_element(std::begin(data.trianglesData) + triangleRange.begin, std::begin(data.trianglesData) + splitResult.triangleIndex, std::begin(data.trianglesData) + triangleRange.end, comp);
+            if (!data.trianglesSoA.empty())
+            {
+                selectNthTriangle(data.trianglesSoA, triangleRange.begin, splitResult.triangleIndex, triangleRange.end, splitResult.axis);
+            }
+            else
+            {
+                auto comp = [dim = splitResult.axis](const TriangleSortData& d1, const TriangleSortData& d2) { return d1.bounds.center()[dim] < d2.bounds.center()[dim]; };
+                std::nth_element(std::begin(data.trianglesData) + triangleRange.begin, std::begin(data.trianglesData) + splitResult.triangleIndex, std::begin(data.trianglesData) + triangleRange.end, comp);
+            }
 
             // Allocate internal node.
-            assert(data.nodes.size() < std::numeric_limits<uint32_t>::max());
-            const uint32_t nodeIndex = (uint32_t)data.nodes.size();
-            data.nodes.push_back({});
+            assert(nodes.size() < std::numeric_limits<uint32_t>::max());
+            const uint32_t nodeIndex = (uint32_t)nodes.size();
+            nodes.push_back({});
 
             InternalNode node = {};
             node.attribs.setAABB(nodeBounds.minPoint, nodeBounds.maxPoint);
@@ -405,13 +776,62 @@ namespace Falcor
                 throw std::exception(("BVH depth of " + std::to_string(depth + 1) + " reached; maximum of " + std::to_string(kMaxBVHDepth) + " allowed.").c_str());
             }
 
-            uint32_t leftIndex = buildInternal(options, splitHeuristic, bitmask | (0ull << depth), depth + 1, Range(triangleRange.begin, splitResult.triangleIndex), data);
-            uint32_t rightIndex = buildInternal(options, splitHeuristic, bitmask | (1ull << depth), depth + 1, Range(splitResult.triangleIndex, triangleRange.end), data);
+            const Range leftRange(triangleRange.begin, splitResult.triangleIndex);
+            const Range rightRange(splitResult.triangleIndex, triangleRange.end);
+
+            uint32_t leftIndex = 0;
+            uint32_t rightIndex = 0;
+
+            if (options.useParallelBuild && triangleRange.length() >= kParallelBuildMinTriangleCount)
+            {
+                // Build the right subtree in a separate task. The subtrees operate on disjoint triangle ranges, so the
+                // only shared output is the per-triangle bitmask array, which is written at disjoint indices.
+                std::vector<PackedNode> rightNodes;
+                std::vector<uint32_t> rightTriangleIndices;
+                auto task = Threading::dispatchTask([&]()
+                {
+                    buildInternal(options, splitHeuristic, bitmask | (1ull << depth), depth + 1, rightRange, data, rightNodes, rightTriangleIndices);
+                });
+
+                // The task references local variables, so we have to wait for it even if building the left subtree fails.
+                std::exception_ptr leftException;
+                try
+                {
+                    leftIndex = buildInternal(options, splitHeuristic, bitmask | (0ull << depth), depth + 1, leftRange, data, nodes, triangleIndices);
+                }
+                catch (...)
+                {
+                    leftException = std::current_exception();
+                }
+                task.finish();
+                if (leftException) std::rethrow_exception(leftException);
+
+                // Append the right subtree after the left subtree. The node indices and triangle offsets of the right subtree
+                // are relative to its own lists, so we offset them in place. The offsets are stored in the lower bits of the
+                // first dword for both internal and leaf nodes. We patch the packed data directly, as unpacking and repacking
+                // the node attributes is lossy.
+                assert(nodes.size() + rightNodes.size() <= std::numeric_limits<uint32_t>::max());
+                const uint32_t nodeOffset = (uint32_t)nodes.size();
+                const uint32_t triangleOffset = (uint32_t)triangleIndices.size();
+                assert(triangleOffset + rightTriangleIndices.size() <= kMaxLeafTriangleOffset);
+                for (auto& rightNode : rightNodes)
+                {
+                    rightNode.data[0].x += rightNode.isLeaf() ? triangleOffset : nodeOffset;
+                }
+                rightIndex = nodeOffset;
+                nodes.insert(nodes.end(), rightNodes.begin(), rightNodes.end());
+                triangleIndices.insert(triangleIndices.end(), rightTriangleIndices.begin(), rightTriangleIndices.end());
+            }
+            else
+            {
+                leftIndex = buildInternal(options, splitHeuristic, bitmask | (0ull << depth), depth + 1, leftRange, data, nodes, triangleIndices);
+                rightIndex = buildInternal(options, splitHeuristic, bitmask | (1ull << depth), depth + 1, rightRange, data, nodes, triangleIndices);
+            }
 
             assert(leftIndex == nodeIndex + 1); // The left node should always be placed immediately after the current node.
             node.rightChildIdx = rightIndex;
 
-            data.nodes[nodeIndex].setInternalNode(node);
+            nodes[nodeIndex].setInternalNode(node);
             return nodeIndex;
         }
         else // No split => create leaf node
@@ -419,9 +839,9 @@ namespace Falcor
             assert(triangleRange.length() <= options.maxTriangleCountPerLeaf);
 
             // Allocate leaf node.
-            assert(data.nodes.size() < std::numeric_limits<uint32_t>::max());
-            const uint32_t nodeIndex = (uint32_t)data.nodes.size();
-            data.nodes.push_back({});
+            assert(nodes.size() < std::numeric_limits<uint32_t>::max());
+            const uint32_t nodeIndex = (uint32_t)nodes.size();
+            nodes.push_back({});
 
             LeafNode node = {};
             node.attribs.setAABB(nodeBounds.minPoint, nodeBounds.maxPoint);
@@ -431,19 +851,22 @@ namespace Falcor
             node.attribs.cosConeAngle = cosTheta;
 
             node.triangleCount = triangleRange.length();
-            node.triangleOffset = (uint32_t)data.triangleIndices.size();
+            node.triangleOffset = (uint32_t)triangleIndices.size();
             assert(node.triangleCount < kMaxLeafTriangleCount);
             assert(node.triangleOffset < kMaxLeafTriangleOffset);
 
-            for (uint32_t triangleIdx = triangleRange.begin, index = 0; triangleIdx < triangleRange.end; ++triangleIdx, ++index)
+            visitTriangles(data, [&](const auto& triangles)
             {
-                uint32_t globalTriangleIndex = data.trianglesData[triangleIdx].triangleIndex;
-                data.triangleIndices.push_back(globalTriangleIndex);
-                data.triangleBitmasks[globalTriangleIndex] = bitmask;
-            }
-            assert(data.triangleIndices.size() == node.triangleOffset + node.triangleCount);
+                for (uint32_t triangleIdx = triangleRange.begin; triangleIdx < triangleRange.end; ++triangleIdx)
+                {
+                    uint32_t globalTriangleIndex = triangles.getTriangleIndex(triangleIdx);
+                    triangleIndices.push_back(globalTriangleIndex);
+                    data.triangleBitmasks[globalTriangleIndex] = bitmask;
+                }
+            });
+            assert(triangleIndices.size() == node.triangleOffset + node.triangleCount);
 
-            data.nodes[nodeIndex].setLeafNode(node);
+            nodes[nodeIndex].setLeafNode(node);
             return nodeIndex;
         }
     }
@@ -490,25 +913,27 @@ namespace Falcor
 
         // We use the average normal as cone direction and grow the cone to include all light normals.
         // TODO: Switch to a more sophisticated algorithm to compute tighter bounding cones.
-        float3 coneDirectionSum = float3(0.0f);
-        for (uint32_t triangleIdx = triangleRange.begin; triangleIdx < triangleRange.end; ++triangleIdx)
+        visitTriangles(data, [&](const auto& triangles)
         {
-            coneDirectionSum += data.trianglesData[triangleIdx].coneDirection;
-        }
-        if (glm::length(coneDirectionSum) >= FLT_MIN)
-        {
-            coneDirection = glm::normalize(coneDirectionSum);
-            cosTheta = 1.f;
+            float3 coneDirectionSum = float3(0.0f);
             for (uint32_t triangleIdx = triangleRange.begin; triangleIdx < triangleRange.end; ++triangleIdx)
             {
-                const TriangleSortData& td = data.trianglesData[triangleIdx];
-                cosTheta = computeCosConeAngle(coneDirection, cosTheta, td.coneDirection, td.cosConeAngle);
+                coneDirectionSum += triangles.getConeDirection(triangleIdx);
             }
-        }
+            if (glm::length(coneDirectionSum) >= FLT_MIN)
+            {
+                coneDirection = glm::normalize(coneDirectionSum);
+                cosTheta = 1.f;
+                for (uint32_t triangleIdx = triangleRange.begin; triangleIdx < triangleRange.end; ++triangleIdx)
+                {
+                    cosTheta = computeCosConeAngle(coneDirection, cosTheta, triangles.getConeDirection(triangleIdx), triangles.getCosConeAngle(triangleIdx));
+                }
+            }
+        });
         return coneDirection;
     }
 
-    LightBVHBuilder::SplitResult LightBVHBuilder::computeSplitWithEqual(const BuildingData& /*data*/, const Range& triangleRange, const AABB& nodeBounds, const Options& /*parameters*/)
+    LightBVHBuilder::SplitResult LightBVHBuilder::computeSplitWithEqual(const BuildingData& /*data*/, const Range& triangleRange, const AABB& nodeBounds, float /*nodeFlux*/, const Options& /*parameters*/)
     {
         // Find the largest dimension.
         float3 dimensions = nodeBounds.extent();
@@ -535,10 +960,36 @@ namespace Falcor
         return cost;
     }
 
-    LightBVHBuilder::SplitResult LightBVHBuilder::computeSplitWithBinnedSAH(const BuildingData& data, const Range& triangleRange, const AABB& nodeBounds, const Options& parameters)
+    template<typename BinFunction>
+    std::pair<float, LightBVHBuilder::SplitResult> LightBVHBuilder::selectBestSplit(const BinFunction& binAlongDimension, const Range& triangleRange, const Options& parameters)
+    {
+        std::pair<float, SplitResult> axisBestSplits[3];
+        if (parameters.useParallelBuild && triangleRange.length() >= kParallelBinningMinTriangleCount)
+        {
+            Threading::parallelFor(0, 3, [&](size_t dimension) { axisBestSplits[dimension] = binAlongDimension((uint32_t)dimension); }, 1);
+        }
+        else
+        {
+            for (uint32_t dimension = 0; dimension < 3; ++dimension) axisBestSplits[dimension] = binAlongDimension(dimension);
+        }
+
+        std::pair<float, SplitResult> overallBestSplit = std::make_pair(std::numeric_limits<float>::infinity(), SplitResult());
+        for (const auto& axisBestSplit : axisBestSplits)
+        {
+            if (axisBestSplit.second.isValid() && axisBestSplit.first < overallBestSplit.first)
+            {
+                overallBestSplit = axisBestSplit;
+                assert(triangleRange.begin < overallBestSplit.second.triangleIndex && overallBestSplit.second.triangleIndex < triangleRange.end);
+            }
+        }
+        return overallBestSplit;
+    }
+
+    LightBVHBuilder::SplitResult LightBVHBuilder::computeSplitWithBinnedSAH(const BuildingData& data, const Range& triangleRange, const AABB& nodeBounds, float nodeFlux, const Options& parameters)
     {
         std::pair<float, SplitResult> overallBestSplit = std::make_pair(std::numeric_limits<float>::infinity(), SplitResult());
         assert(!overallBestSplit.second.isValid());
+        const std::pair<float, SplitResult> noSplit = overallBestSplit;
 
         struct Bin
         {
@@ -546,7 +997,6 @@ namespace Falcor
             uint32_t triangleCount = 0;
 
             Bin() = default;
-            Bin(const TriangleSortData& tri) : bounds(tri.bounds), triangleCount(1) {}
             Bin& operator|= (const Bin& rhs)
             {
                 bounds |= rhs.bounds;
@@ -556,34 +1006,31 @@ namespace Falcor
         };
 
         assert(parameters.binCount > 1);
-        std::vector<Bin> bins(parameters.binCount);
-        std::vector<float> costs(parameters.binCount - 1);
 
         /** Helper function that computes the best split along the given dimension using the SAH metric.
             The triangles are binned to n bins, storing only the aggregate parameters (triangle count and bounds).
             Then the cost metric is evaluated for each of the n-1 potential splits.
+            The function only reads shared data, so it can be called for multiple dimensions in parallel.
+            \return The best split along the dimension, or an invalid split if all lights fall on either side of the split.
         */
-        const auto binAlongDimension = [&bins, &costs, &triangleRange, &data, &parameters, &overallBestSplit, &nodeBounds](uint32_t dimension)
+        const auto binAlongDimension = [&triangleRange, &parameters, &nodeBounds, &noSplit](const auto& triangles, uint32_t dimension)
         {
-            // Helper to compute the bin id for a given triangle.
-            auto getBinId = [&](const TriangleSortData& td)
-            {
-                float bmin = nodeBounds.minPoint[dimension], bmax = nodeBounds.maxPoint[dimension];
-                assert(bmin < bmax);
-                float scale = (float)parameters.binCount / (bmax - bmin);
-                float p = td.bounds.center()[dimension];
-                assert(bmin <= p && p <= bmax);
-                return std::min((uint32_t)((p - bmin) * scale), parameters.binCount - 1);
-            };
+            std::vector<Bin> bins(parameters.binCount);
+            std::vector<float> costs(parameters.binCount - 1);
 
-            // Reset the bins.
-            for (Bin& bin : bins) bin = Bin();
+            // Compute the bin id for all triangles.
+            float bmin = nodeBounds.minPoint[dimension], bmax = nodeBounds.maxPoint[dimension];
+            assert(bmin < bmax);
+            float scale = (float)parameters.binCount / (bmax - bmin);
+            std::vector<uint32_t> binIds(triangleRange.length());
+            triangles.computeBinIds(triangleRange.begin, triangleRange.end, dimension, bmin, scale, parameters.binCount, binIds.data());
 
             // Fill the bins with all triangles.
             for (uint32_t i = triangleRange.begin; i < triangleRange.end; ++i)
             {
-                const auto& td = data.trianglesData[i];
-                bins[getBinId(td)] |= td;
+                Bin& bin = bins[binIds[i - triangleRange.begin]];
+                bin.bounds |= triangles.getBounds(i);
+                bin.triangleCount++;
             }
 
             // First, compute A_j(L) * N_j(L) by sweeping over the bins from left to right.
@@ -617,38 +1064,33 @@ namespace Falcor
 
             // Early out if all lights fall on either side of the split.
             if (axisBestSplit.second.triangleIndex == triangleRange.begin ||
-                axisBestSplit.second.triangleIndex == triangleRange.end) return;
+                axisBestSplit.second.triangleIndex == triangleRange.end) return noSplit;
 
-            if (axisBestSplit.first < overallBestSplit.first)
-            {
-                overallBestSplit = axisBestSplit;
-                assert(triangleRange.begin < overallBestSplit.second.triangleIndex && overallBestSplit.second.triangleIndex < triangleRange.end);
-            }
+            return axisBestSplit;
         };
 
-        if (parameters.splitAlongLargest)
+        overallBestSplit = visitTriangles(data, [&](const auto& triangles)
         {
-            // Find the largest dimension.
-            float3 dimensions = nodeBounds.extent();
-            uint32_t largestDimension = dimensions[2] >= dimensions[0] && dimensions[2] >= dimensions[1] ?
-                2 : (dimensions[1] >= dimensions[0] && dimensions[1] >= dimensions[2] ? 1 : 0);
+            const auto binTrianglesAlongDimension = [&](uint32_t dimension) { return binAlongDimension(triangles, dimension); };
 
-            binAlongDimension(largestDimension);
-        }
-        else
-        {
-            for (uint32_t dimension = 0; dimension < 3; ++dimension)
+            if (parameters.splitAlongLargest)
             {
-                binAlongDimension(dimension);
+                // Find the largest dimension.
+                float3 dimensions = nodeBounds.extent();
+                uint32_t largestDimension = dimensions[2] >= dimensions[0] && dimensions[2] >= dimensions[1] ?
+                    2 : (dimensions[1] >= dimensions[0] && dimensions[1] >= dimensions[2] ? 1 : 0);
+
+                return binTrianglesAlongDimension(largestDimension);
             }
-        }
+            return selectBestSplit(binTrianglesAlongDimension, triangleRange, parameters);
+        });
 
         // If we couldn't find a valid split, create leaf node immediately if possible or revert to equal splitting.
         if (!overallBestSplit.second.isValid())
         {
             if (triangleRange.length() <= parameters.maxTriangleCountPerLeaf) return SplitResult();
             logWarning("LightBVHBuilder::computeSplitWithBinnedSAH() was not able to compute a proper split: reverting to LightBVHBuilder::computeSplitWithEqual()");
-            return computeSplitWithEqual(data, triangleRange, nodeBounds, parameters);
+            return computeSplitWithEqual(data, triangleRange, nodeBounds, nodeFlux, parameters);
         }
 
         // If the best split we found is more expensive than the cost of a leaf node (and we can create one), then create a leaf node.
@@ -690,10 +1132,11 @@ namespace Falcor
         return cost;
     }
 
-    LightBVHBuilder::SplitResult LightBVHBuilder::computeSplitWithBinnedSAOH(const BuildingData& data, const Range& triangleRange, const AABB& nodeBounds, const Options& parameters)
+    LightBVHBuilder::SplitResult LightBVHBuilder::computeSplitWithBinnedSAOH(const BuildingData& data, const Range& triangleRange, const AABB& nodeBounds, float nodeFlux, const Options& parameters)
     {
         std::pair<float, SplitResult> overallBestSplit = std::make_pair(std::numeric_limits<float>::infinity(), SplitResult());
         assert(!overallBestSplit.second.isValid());
+        const std::pair<float, SplitResult> noSplit = overallBestSplit;
 
         // Find the largest dimension.
         float3 dimensions = nodeBounds.extent();
@@ -706,24 +1149,20 @@ namespace Falcor
             uint32_t triangleCount = 0;
             float flux = 0.0f;
             float3 coneDirection = float3(0.0f);
-            float cosConeAngle = 1.0f;
 
             Bin() = default;
-            Bin(const TriangleSortData& tri) : bounds(tri.bounds), triangleCount(1), flux(tri.flux), coneDirection(tri.coneDirection), cosConeAngle(tri.cosConeAngle) {}
             Bin& operator|= (const Bin& rhs)
             {
                 bounds |= rhs.bounds;
                 triangleCount += rhs.triangleCount;
                 flux += rhs.flux;
                 coneDirection += rhs.coneDirection;
-                // Note: cosConeAngle should be computed separately after the final cone direction is known
+                // Note: The cone angle is computed separately after the final cone direction is known
                 return *this;
             }
         };
 
         assert(parameters.binCount > 1);
-        std::vector<Bin> bins(parameters.binCount);
-        std::vector<float> costs(parameters.binCount - 1);
 
         /** Helper function that computes the best split along the given dimension using the SAOH metric.
             The triangles are binned to n bins, storing only the aggregate parameters (triangle count, bounds, flux, and cone direction).
@@ -731,51 +1170,51 @@ namespace Falcor
             Note that while the bounds and flux are accurately represented by the aggregated parameters,
             the bounding cones are approximates based on the bins' bounding cones. This is less expensive,
             but also less precise than computing them directly from the triangles.
+            The function only reads shared data, so it can be called for multiple dimensions in parallel.
+            \return The best split along the dimension, or an invalid split if all lights fall on either side of the split.
         */
-        const auto binAlongDimension = [&bins, &costs, &triangleRange, &data, &parameters, &overallBestSplit, &nodeBounds, largestDimension, dimensions](uint32_t dimension)
+        const auto binAlongDimension = [&triangleRange, &parameters, &nodeBounds, &noSplit, largestDimension, dimensions](const auto& triangles, uint32_t dimension)
         {
-            // Helper to compute the bin id for a given triangle.
-            auto getBinId = [&](const TriangleSortData& td)
-            {
-                float bmin = nodeBounds.minPoint[dimension], bmax = nodeBounds.maxPoint[dimension];
-                float w = bmax - bmin;
-                assert(w >= 0.f); // The node bounds can be zero if all primitives are axis-aligned and coplanar
-                float scale = w > FLT_MIN ? (float)parameters.binCount / w : 0.f;
-                float p = td.bounds.center()[dimension];
-                assert(bmin <= p && p <= bmax);
-                return std::min((uint32_t)((p - bmin) * scale), parameters.binCount - 1);
-            };
+            std::vector<Bin> bins(parameters.binCount);
+            std::vector<float> costs(parameters.binCount - 1);
 
-            // Reset the bins.
-            for (Bin& bin : bins) bin = Bin();
+            // Compute the bin id for all triangles.
+            float bmin = nodeBounds.minPoint[dimension], bmax = nodeBounds.maxPoint[dimension];
+            float w = bmax - bmin;
+            assert(w >= 0.f); // The node bounds can be zero if all primitives are axis-aligned and coplanar
+            float scale = w > FLT_MIN ? (float)parameters.binCount / w : 0.f;
+            std::vector<uint32_t> binIds(triangleRange.length());
+            triangles.computeBinIds(triangleRange.begin, triangleRange.end, dimension, bmin, scale, parameters.binCount, binIds.data());
 
             // Fill the bins with all triangles.
             for (uint32_t i = triangleRange.begin; i < triangleRange.end; ++i)
             {
-                const auto& td = data.trianglesData[i];
-                bins[getBinId(td)] |= td;
+                Bin& bin = bins[binIds[i - triangleRange.begin]];
+                bin.bounds |= triangles.getBounds(i);
+                bin.triangleCount++;
+                bin.flux += triangles.getFlux(i);
+                bin.coneDirection += triangles.getConeDirection(i);
             }
 
             // Compute the lighting cones for each bin.
             // The cone direction is the average direction over all lights in the bin and the cone angle is grown to include all.
             // If the vector is zero length (no lights or if all directions cancelled out), the cone is marked as invalid.
+            // The cones are stored in SoA layout, which allows evaluating them with SIMD both here and in the sweeps below.
             // TODO: Switch to a more sophisticated algorithm to get narrower cones.
-            for (Bin& bin : bins)
+            BinCones binCones(parameters.binCount);
+            for (uint32_t i = 0; i < parameters.binCount; ++i)
             {
-                bin.cosConeAngle = glm::length(bin.coneDirection) < FLT_MIN ? kInvalidCosConeAngle : 1.0f;
+                Bin& bin = bins[i];
+                binCones.cosConeAngle[i] = glm::length(bin.coneDirection) < FLT_MIN ? kInvalidCosConeAngle : 1.0f;
                 bin.coneDirection = glm::normalize(bin.coneDirection);
+                for (uint32_t d = 0; d < 3; ++d) binCones.coneDirection[d][i] = bin.coneDirection[d];
             }
-            for (uint32_t i = triangleRange.begin; i < triangleRange.end; ++i)
-            {
-                const auto& td = data.trianglesData[i];
-                Bin& bin = bins[getBinId(td)];
-                bin.cosConeAngle = computeCosConeAngle(bin.coneDirection, bin.cosConeAngle, td.coneDirection, td.cosConeAngle);
-            }
+            triangles.computeBinConeAngles(triangleRange.begin, triangleRange.end, binIds.data(), binCones);
 
             // First, compute A_j(L) * N_j(L) by sweeping over the bins from left to right.
             // Note that the costs vector has n-1 elements when there are n bins; the i:th elements represents the split between bin i and i+1.
             Bin total = Bin();
-            for (std::size_t i = 0; i < costs.size(); ++i)
+            for (uint32_t i = 0; i < costs.size(); ++i)
             {
                 total |= bins[i];
 
@@ -783,12 +1222,7 @@ namespace Falcor
                 float cosTheta = kInvalidCosConeAngle;
                 if (glm::length(total.coneDirection) >= FLT_MIN)
                 {
-                    cosTheta = 1.f;
-                    float3 coneDir = glm::normalize(total.coneDirection);
-                    for (std::size_t j = 0; j <= i; ++j)
-                    {
-                        cosTheta = computeCosConeAngle(coneDir, cosTheta, bins[j].coneDirection, bins[j].cosConeAngle);
-                    }
+                    cosTheta = computeBinsCosConeAngle(glm::normalize(total.coneDirection), binCones, 0, i + 1);
                 }
 
                 costs[i] = evalSAOH(total.bounds, total.flux, cosTheta, parameters);
@@ -796,7 +1230,7 @@ namespace Falcor
 
             // Then, compute A_j(R) * N_j(R) by sweeping over the bins from right to left.
             total = Bin();
-            for (std::size_t i = costs.size(); i > 0; --i)
+            for (uint32_t i = (uint32_t)costs.size(); i > 0; --i)
             {
                 total |= bins[i];
 
@@ -804,12 +1238,7 @@ namespace Falcor
                 float cosTheta = kInvalidCosConeAngle;
                 if (glm::length(total.coneDirection) >= FLT_MIN)
                 {
-                    cosTheta = 1.f;
-                    float3 coneDir = glm::normalize(total.coneDirection);
-                    for (std::size_t j = i; j <= costs.size(); ++j)
-                    {
-                        cosTheta = computeCosConeAngle(coneDir, cosTheta, bins[j].coneDirection, bins[j].cosConeAngle);
-                    }
+                    cosTheta = computeBinsCosConeAngle(glm::normalize(total.coneDirection), binCones, i, parameters.binCount);
                 }
 
                 costs[i - 1] += evalSAOH(total.bounds, total.flux, cosTheta, parameters);
@@ -832,34 +1261,26 @@ namespace Falcor
 
             // Early out if all lights fall on either side of the split.
             if (axisBestSplit.second.triangleIndex == triangleRange.begin ||
-                axisBestSplit.second.triangleIndex == triangleRange.end) return;
+                axisBestSplit.second.triangleIndex == triangleRange.end) return noSplit;
 
-            if (axisBestSplit.first < overallBestSplit.first)
-            {
-                overallBestSplit = axisBestSplit;
-                assert(triangleRange.begin < overallBestSplit.second.triangleIndex && overallBestSplit.second.triangleIndex < triangleRange.end);
-            }
+            return axisBestSplit;
         };
 
         // Compute the best split.
-        if (parameters.splitAlongLargest)
+        overallBestSplit = visitTriangles(data, [&](const auto& triangles)
         {
-            binAlongDimension(largestDimension);
-        }
-        else
-        {
-            for (uint32_t dimension = 0; dimension < 3; ++dimension)
-            {
-                binAlongDimension(dimension);
-            }
-        }
+            const auto binTrianglesAlongDimension = [&](uint32_t dimension) { return binAlongDimension(triangles, dimension); };
+
+            if (parameters.splitAlongLargest) return binTrianglesAlongDimension(largestDimension);
+            return selectBestSplit(binTrianglesAlongDimension, triangleRange, parameters);
+        });
 
         // If we couldn't find a valid split, create leaf node immediately if possible or revert to equal splitting.
         if (!overallBestSplit.second.isValid())
         {
             if (triangleRange.length() <= parameters.maxTriangleCountPerLeaf) return SplitResult();
             logWarning("LightBVHBuilder::computeSplitWithBinnedSAOH() was not able to compute a proper split: reverting to LightBVHBuilder::computeSplitWithEqual()");
-            return computeSplitWithEqual(data, triangleRange, nodeBounds, parameters);
+            return computeSplitWithEqual(data, triangleRange, nodeBounds, nodeFlux, parameters);
         }
 
         // If the best split we found is more expensive than the cost of a leaf node (and we can create one), then create a leaf node.
@@ -869,7 +1290,7 @@ namespace Falcor
             // Evaluate the cost metric for the node. This requires us to first compute the cone angle.
             float cosTheta = kInvalidCosConeAngle;
             computeLightingCone(triangleRange, data, cosTheta);
-            float leafCost = evalSAOH(nodeBounds, data.currentNodeFlux, cosTheta, parameters);
+            float leafCost = evalSAOH(nodeBounds, nodeFlux, cosTheta, parameters);
             if (leafCost <= overallBestSplit.first) return SplitResult();
         }
 
@@ -913,6 +1334,8 @@ namespace Falcor
         options.field(allowRefitting);
         options.field(usePreintegration);
         options.field(useLightingCones);
+        options.field(useParallelBuild);
+        options.field(useSoALayout);
 #undef field
     }
 }
@@ -71,6 +71,8 @@ namespace Falcor
             bool           allowRefitting = true;                                ///< Rather than always rebuilding the BVH from scratch, keep the hierarchy but update the bounds and lighting cones.
             bool           usePreintegration = true;                             ///< Use pre-integration for culling out emissive triangles and use their flux when computing the splits. Only valid when using the BinnedSAOH split heuristic.
             bool           useLightingCones = true;                              ///< Use lighting cones when computing the splits. Only valid when using the BinnedSAOH split heuristic.
+            bool           useParallelBuild = true;                              ///< Build large subtrees and evaluate the split axes in parallel. The resulting BVH is identical to the serial build.
+            bool           useSoALayout = true;                                  ///< Store the triangle data in structure-of-arrays layout during the build, which allows SIMD binning. The resulting BVH is identical to the array-of-structures layout.
         };
 
         /** Creates a new object.
@@ -120,24 +122,47 @@ namespace Falcor
             uint32_t triangleIndex = MeshLightData::kInvalidIndex; ///< Index into global triangle list.
         };
 
+        /** Triangle data in structure-of-arrays layout.
+            Each attribute is stored in a separate array, so the binning passes only load the attributes they use.
+            All arrays are reordered together when a triangle range is split.
+        */
+        struct TriangleSortDataSoA
+        {
+            std::vector<float> centroid[3];                 ///< Center of the triangle bounds along each dimension. This is the sort key for the splits.
+            std::vector<float> boundsMin[3];                ///< Minimum point of the triangle bounds along each dimension.
+            std::vector<float> boundsMax[3];                ///< Maximum point of the triangle bounds along each dimension.
+            std::vector<float> coneDirection[3];            ///< Light emission normal direction.
+            std::vector<float> cosConeAngle;                ///< Cosine normal bounding cone (half) angle.
+            std::vector<float> flux;                        ///< Precomputed triangle flux.
+            std::vector<uint32_t> triangleIndex;            ///< Index into global triangle list.
+
+            size_t size() const { return triangleIndex.size(); }
+            bool empty() const { return triangleIndex.empty(); }
+            void reserve(size_t count);
+            void push_back(const TriangleSortData& tri);
+        };
+
         struct BuildingData
         {
             std::vector<PackedNode>& nodes;                 ///< BVH nodes generated by the builder.
             std::vector<TriangleSortData> trianglesData;    ///< Compact list of triangles to include in build.
+            TriangleSortDataSoA trianglesSoA;               ///< Compact list of triangles in SoA layout. Used instead of trianglesData if Options::useSoALayout is enabled.
             std::vector<uint32_t> triangleIndices;          ///< Triangle indices sorted by leaf node. Each leaf node refers to a contiguous array of triangle indices.
             std::vector<uint64_t> triangleBitmasks;         ///< Array containing the per triangle bit pattern retracing the tree traversal to reach the triangle: 0=left child, 1=right child; this array gets filled in during the build process. Indexed by global triangle index.
-            float currentNodeFlux = 0.f;                    ///< Used by computeSAOHSplit() as the leaf creation cost.
 
             BuildingData(std::vector<PackedNode>& bvhNodes) : nodes(bvhNodes) {}
+
+            size_t triangleCount() const { return trianglesSoA.empty() ? trianglesData.size() : trianglesSoA.size(); }
         };
 
         /** Compute the split according to a specified heuristic.
             \param[in] data Prepared light data.
             \param[in] triangleRange Range of triangles to process.
             \param[in] nodeBounds Bounds for the node to be splitted.
+            \param[in] nodeFlux Total flux of the node to be splitted. Used by computeSplitWithBinnedSAOH() as the leaf creation cost.
             \param[in] parameters Various parameters defining how the building should occur.
         */
-        using SplitHeuristicFunction = std::function<SplitResult(const BuildingData& data, const Range& triangleRange, const AABB& nodeBounds, const Options& parameters)>;
+        using SplitHeuristicFunction = std::function<SplitResult(const BuildingData& data, const Range& triangleRange, const AABB& nodeBounds, float nodeFlux, const Options& parameters)>;
 
         LightBVHBuilder(const Options& options);
 
@@ -145,15 +170,28 @@ namespace Falcor
         */
         bool renderOptions(Gui::Widgets& widget, Options& options) const;
 
+        /** Build the BVH nodes from the prepared triangle data.
+            This expects data.trianglesSoA or data.trianglesData to be filled in depending on Options::useSoALayout,
+            and produces the nodes, triangle indices and triangle bitmasks.
+            \param[in] globalTriangleCount Total number of triangles, including culled ones. Used to size the bitmask array.
+            \param[in,out] data Prepared light data.
+        */
+        void buildNodes(size_t globalTriangleCount, BuildingData& data);
+
         /** Recursive BVH build.
+            Subtrees above a size threshold are built in parallel if enabled in the options. The right subtree is then built
+            into separate node and triangle index lists, which are appended after the left subtree when both are done.
+            This results in the same depth-first node order as the serial build.
             \param[in] splitHeuristic The splitting heuristic to be used.
             \param[in] bitmask Bit pattern retracing the tree traversal to reach the node to be built: 0=left child, 1=right child.
             \param[in] depth Depth of the node to be built
             \param[in] triangleRange Range of triangles to process.
             \param[in,out] data Prepared light data.
+            \param[in,out] nodes Node list to append the nodes of the subtree to.
+            \param[in,out] triangleIndices Triangle index list to append the triangle indices of the subtree to.
             \return Index of the allocated node.
         */
-        uint32_t buildInternal(const Options& options, const SplitHeuristicFunction& splitHeuristic, uint64_t bitmask, uint32_t depth, const Range& triangleRange, BuildingData& data);
+        uint32_t buildInternal(const Options& options, const SplitHeuristicFunction& splitHeuristic, uint64_t bitmask, uint32_t depth, const Range& triangleRange, BuildingData& data, std::vector<PackedNode>& nodes, std::vector<uint32_t>& triangleIndices);
 
         /** Recursive computation of lighting cones for all internal nodes.
             \param[in] nodeIndex Index of the current node.
@@ -172,12 +210,23 @@ namespace Falcor
         static float3 computeLightingCone(const Range& triangleRange, const BuildingData& data, float& cosTheta);
 
         // See the documentation of SplitHeuristicFunction.
-        static SplitResult computeSplitWithEqual(const BuildingData& /*data*/, const Range& triangleRange, const AABB& nodeBounds, const Options& /*parameters*/);
-        static SplitResult computeSplitWithBinnedSAH(const BuildingData& data, const Range& triangleRange, const AABB& nodeBounds, const Options& parameters);
-        static SplitResult computeSplitWithBinnedSAOH(const BuildingData& data, const Range& triangleRange, const AABB& nodeBounds, const Options& parameters);
+        static SplitResult computeSplitWithEqual(const BuildingData& /*data*/, const Range& triangleRange, const AABB& nodeBounds, float /*nodeFlux*/, const Options& /*parameters*/);
+        static SplitResult computeSplitWithBinnedSAH(const BuildingData& data, const Range& triangleRange, const AABB& nodeBounds, float /*nodeFlux*/, const Options& parameters);
+        static SplitResult computeSplitWithBinnedSAOH(const BuildingData& data, const Range& triangleRange, const AABB& nodeBounds, float nodeFlux, const Options& parameters);
 
         static SplitHeuristicFunction getSplitFunction(SplitHeuristic heuristic);
 
+        /** Computes the best split along each of the three dimensions and returns the cheapest one.
+            The dimensions are evaluated in parallel for large nodes if enabled in the options. The results are
+            always reduced in dimension order, so the selected split is the same as for the serial evaluation.
+            \param[in] binAlongDimension Function returning the cost and split for a given dimension, or an invalid split if there is none.
+            \param[in] triangleRange Range of triangles to process.
+            \param[in] parameters Various parameters defining how the building should occur.
+            \return The best split and its cost, or an invalid split with infinite cost.
+        */
+        template<typename BinFunction>
+        static std::pair<float, SplitResult> selectBestSplit(const BinFunction& binAlongDimension, const Range& triangleRange, const Options& parameters);
+
         // Configuration
         Options mOptions;
     };
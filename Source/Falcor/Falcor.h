@@ -89,6 +89,7 @@
 #include "Core/Program/ProgramReflection.h"
 #include "Core/Program/ProgramVars.h"
 #include "Core/Program/ProgramVersion.h"
+#include "Core/Program/ShaderCache.h"
 #include "Core/Program/ShaderLibrary.h"
 
 // Core/State
@@ -134,6 +135,8 @@
 #include "Utils/Algorithm/ParallelReduction.h"
 #include "Utils/Image/Bitmap.h"
 #include "Utils/Image/ImageIO.h"
+#include "Utils/Image/PixelConversion.h"
+#include "Utils/Image/TexturePreprocessor.h"
 #include "Utils/Math/CubicSpline.h"
 #include "Utils/Math/FalcorMath.h"
 #include "Utils/Scripting/Dictionary.h"
@@ -29,7 +29,8 @@
 #include "Animation.h"
 #include "AnimationController.h"
 #include "glm/gtc/quaternion.hpp"
-#include "glm/gtx/transform.hpp"
+#include "Utils/Threading.h"
+#include <immintrin.h>
 
 namespace Falcor
 {
@@ -45,64 +46,135 @@ namespace Falcor
             { (uint32_t)Animation::Behavior::Oscillate, "Oscillate" },
         };
 
+        // Number of animations evaluated per task in Animation::animate().
+        const size_t kAnimationBatchSize = 64;
+
+        __m128 loadVector(const float4& v) { return _mm_loadu_ps(&v.x); }
+
+        // Same form as glm::mix(): a * (1 - t) + b * t.
+        __m128 lerpSSE(__m128 a, __m128 b, float t)
+        {
+            return _mm_add_ps(_mm_mul_ps(a, _mm_set1_ps(1.f - t)), _mm_mul_ps(b, _mm_set1_ps(t)));
+        }
+
+        float dot4(__m128 a, __m128 b)
+        {
+            __m128 m = _mm_mul_ps(a, b);
+            __m128 s = _mm_add_ps(m, _mm_movehl_ps(m, m));
+            s = _mm_add_ss(s, _mm_shuffle_ps(s, s, _MM_SHUFFLE(1, 1, 1, 1)));
+            return _mm_cvtss_f32(s);
+        }
+
+        // Slerp of quaternions stored as (x, y, z, w). Follows glm::slerp(), including the shortest path and the fallback to linear interpolation for nearly identical rotations.
+        __m128 slerpSSE(__m128 q0, __m128 q1, float t)
+        {
+            float cosTheta = dot4(q0, q1);
+            if (cosTheta < 0.f)
+            {
+                q1 = _mm_xor_ps(q1, _mm_set1_ps(-0.f));
+                cosTheta = -cosTheta;
+            }
+
+            if (cosTheta > 1.f - std::numeric_limits<float>::epsilon()) return lerpSSE(q0, q1, t);
+
+            float angle = std::acos(cosTheta);
+            __m128 q = _mm_add_ps(_mm_mul_ps(q0, _mm_set1_ps(std::sin((1.f - t) * angle))), _mm_mul_ps(q1, _mm_set1_ps(std::sin(t * angle))));
+            return _mm_div_ps(q, _mm_set1_ps(std::sin(angle)));
+        }
+
+        // Bezier control point: p1 + (p2 - p0) * 0.5 / 3.
+        __m128 bezierControlPoint(__m128 p0, __m128 p1, __m128 p2)
+        {
+            return _mm_add_ps(p1, _mm_div_ps(_mm_mul_ps(_mm_sub_ps(p2, p0), _mm_set1_ps(0.5f)), _mm_set1_ps(3.f)));
+        }
+
         // Bezier form hermite spline
-        float3 interpolateHermite(const float3& p0, const float3& p1, const float3& p2, const float3& p3, float t)
+        __m128 interpolateHermite(__m128 p0, __m128 p1, __m128 p2, __m128 p3, float t)
         {
-            float3 b0 = p1;
-            float3 b1 = p1 + (p2 - p0) * 0.5f / 3.f;
-            float3 b2 = p2 - (p3 - p1) * 0.5f / 3.f;
-            float3 b3 = p2;
+            __m128 b0 = p1;
+            __m128 b1 = bezierControlPoint(p0, p1, p2);
+            __m128 b2 = bezierControlPoint(p3, p2, p1);
+            __m128 b3 = p2;
 
-            float3 q0 = lerp(b0, b1, t);
-            float3 q1 = lerp(b1, b2, t);
-            float3 q2 = lerp(b2, b3, t);
+            __m128 q0 = lerpSSE(b0, b1, t);
+            __m128 q1 = lerpSSE(b1, b2, t);
+            __m128 q2 = lerpSSE(b2, b3, t);
 
-            float3 qq0 = lerp(q0, q1, t);
-            float3 qq1 = lerp(q1, q2, t);
+            __m128 qq0 = lerpSSE(q0, q1, t);
+            __m128 qq1 = lerpSSE(q1, q2, t);
 
-            return lerp(qq0, qq1, t);
+            return lerpSSE(qq0, qq1, t);
         }
 
         // Bezier hermite slerp
-        glm::quat interpolateHermite(const glm::quat& r0, const glm::quat& r1, const glm::quat& r2, const glm::quat& r3, float t)
+        __m128 interpolateHermiteRotation(__m128 r0, __m128 r1, __m128 r2, __m128 r3, float t)
         {
-            glm::quat b0 = r1;
-            glm::quat b1 = r1 + (r2 - r0) * 0.5f / 3.0f;
-            glm::quat b2 = r2 - (r3 - r1) * 0.5f / 3.0f;
-            glm::quat b3 = r2;
+            __m128 b0 = r1;
+            __m128 b1 = bezierControlPoint(r0, r1, r2);
+            __m128 b2 = bezierControlPoint(r3, r2, r1);
+            __m128 b3 = r2;
 
-            glm::quat q0 = slerp(b0, b1, t);
-            glm::quat q1 = slerp(b1, b2, t);
-            glm::quat q2 = slerp(b2, b3, t);
+            __m128 q0 = slerpSSE(b0, b1, t);
+            __m128 q1 = slerpSSE(b1, b2, t);
+            __m128 q2 = slerpSSE(b2, b3, t);
 
-            glm::quat qq0 = slerp(q0, q1, t);
-            glm::quat qq1 = slerp(q1, q2, t);
+            __m128 qq0 = slerpSSE(q0, q1, t);
+            __m128 qq1 = slerpSSE(q1, q2, t);
 
-            return slerp(qq0, qq1, t);
+            return slerpSSE(qq0, qq1, t);
         }
 
-        // This function performs linear extrapolation when either t < 0 or t > 1
-        Animation::Keyframe interpolateLinear(const Animation::Keyframe& k0, const Animation::Keyframe& k1, float t)
+        /** Computes translate(t) * mat4_cast(r) * scale(s) directly, without the matrix products.
+            The rotation is stored as (x, y, z, w).
+        */
+        glm::mat4 composeTransform(__m128 t, __m128 r, __m128 s)
         {
-            Animation::Keyframe result;
-            result.translation = lerp(k0.translation, k1.translation, t);
-            result.scaling = lerp(k0.scaling, k1.scaling, t);
-            result.rotation = slerp(k0.rotation, k1.rotation, t);
-            result.time = glm::lerp(k0.time, k1.time, (double)t);
-            return result;
+            const __m128 r2 = _mm_add_ps(r, r);
+
+            // Rotation matrix columns as in glm::mat3_cast(), e.g. column 0 is (1 - 2yy - 2zz, 2xy + 2wz, 2xz - 2wy).
+            // The sign vectors have a zero last component to clear the w component of the columns.
+            __m128 a0 = _mm_mul_ps(_mm_shuffle_ps(r, r, _MM_SHUFFLE(0, 0, 0, 1)), _mm_shuffle_ps(r2, r2, _MM_SHUFFLE(0, 2, 1, 1)));
+            __m128 b0 = _mm_mul_ps(_mm_shuffle_ps(r, r, _MM_SHUFFLE(0, 3, 3, 2)), _mm_shuffle_ps(r2, r2, _MM_SHUFFLE(0, 1, 2, 2)));
+            __m128 c0 = _mm_add_ps(_mm_setr_ps(1.f, 0.f, 0.f, 0.f), _mm_add_ps(_mm_mul_ps(a0, _mm_setr_ps(-1.f, 1.f, 1.f, 0.f)), _mm_mul_ps(b0, _mm_setr_ps(-1.f, 1.f, -1.f, 0.f))));
+
+            __m128 a1 = _mm_mul_ps(_mm_shuffle_ps(r, r, _MM_SHUFFLE(0, 1, 0, 0)), _mm_shuffle_ps(r2, r2, _MM_SHUFFLE(0, 2, 0, 1)));
+            __m128 b1 = _mm_mul_ps(_mm_shuffle_ps(r, r, _MM_SHUFFLE(0, 3, 2, 3)), _mm_shuffle_ps(r2, r2, _MM_SHUFFLE(0, 0, 2, 2)));
+            __m128 c1 = _mm_add_ps(_mm_setr_ps(0.f, 1.f, 0.f, 0.f), _mm_add_ps(_mm_mul_ps(a1, _mm_setr_ps(1.f, -1.f, 1.f, 0.f)), _mm_mul_ps(b1, _mm_setr_ps(-1.f, -1.f, 1.f, 0.f))));
+
+            __m128 a2 = _mm_mul_ps(_mm_shuffle_ps(r, r, _MM_SHUFFLE(0, 0, 1, 0)), _mm_shuffle_ps(r2, r2, _MM_SHUFFLE(0, 0, 2, 2)));
+            __m128 b2 = _mm_mul_ps(_mm_shuffle_ps(r, r, _MM_SHUFFLE(0, 1, 3, 3)), _mm_shuffle_ps(r2, r2, _MM_SHUFFLE(0, 1, 0, 1)));
+            __m128 c2 = _mm_add_ps(_mm_setr_ps(0.f, 0.f, 1.f, 0.f), _mm_add_ps(_mm_mul_ps(a2, _mm_setr_ps(1.f, 1.f, -1.f, 0.f)), _mm_mul_ps(b2, _mm_setr_ps(1.f, -1.f, -1.f, 0.f))));
+
+            const __m128 xyzMask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+            glm::mat4 m;
+            _mm_storeu_ps(&m[0][0], _mm_mul_ps(c0, _mm_shuffle_ps(s, s, _MM_SHUFFLE(0, 0, 0, 0))));
+            _mm_storeu_ps(&m[1][0], _mm_mul_ps(c1, _mm_shuffle_ps(s, s, _MM_SHUFFLE(1, 1, 1, 1))));
+            _mm_storeu_ps(&m[2][0], _mm_mul_ps(c2, _mm_shuffle_ps(s, s, _MM_SHUFFLE(2, 2, 2, 2))));
+            _mm_storeu_ps(&m[3][0], _mm_or_ps(_mm_and_ps(t, xyzMask), _mm_setr_ps(0.f, 0.f, 0.f, 1.f)));
+            return m;
         }
+    }
 
-        Animation::Keyframe interpolateHermite(const Animation::Keyframe& k0, const Animation::Keyframe& k1, const Animation::Keyframe& k2, const Animation::Keyframe& k3, float t)
+    /** Interpolated keyframe in SIMD registers. Rotations are stored as (x, y, z, w).
+    */
+    struct Animation::Sample
+    {
+        double time;
+        __m128 translation;
+        __m128 scaling;
+        __m128 rotation;
+
+        // This function performs linear extrapolation when either t < 0 or t > 1
+        static Sample interpolateLinear(const Sample& k0, const Sample& k1, float t)
         {
-            assert(t >= 0.f && t <= 1.f);
-            Animation::Keyframe result;
-            result.translation = interpolateHermite(k0.translation, k1.translation, k2.translation, k3.translation, t);
-            result.scaling = lerp(k1.scaling, k2.scaling, t);
-            result.rotation = interpolateHermite(k0.rotation, k1.rotation, k2.rotation, k3.rotation, t);
-            result.time = glm::lerp(k1.time, k2.time, (double)t);
+            Sample result;
+            result.translation = lerpSSE(k0.translation, k1.translation, t);
+            result.scaling = lerpSSE(k0.scaling, k1.scaling, t);
+            result.rotation = slerpSSE(k0.rotation, k1.rotation, t);
+            result.time = glm::lerp(k0.time, k1.time, (double)t);
             return result;
         }
-    }
+    };
 
     Animation::SharedPtr Animation::create(const std::string& name, uint32_t nodeID, double duration)
     {
@@ -117,86 +189,93 @@ namespace Falcor
 
     glm::mat4 Animation::animate(double currentTime)
     {
+        const auto& times = mKeyframeData.times;
+
         // Calculate the sample time.
         double time = currentTime;
-        if (time < mKeyframes.front().time || time > mKeyframes.back().time)
+        if (time < times.front() || time > times.back())
         {
             time = calcSampleTime(currentTime);
         }
 
         // Determine if the animation behaves linearly outside of defined keyframes.
-        bool isLinearPostInfinity = time > mKeyframes.back().time && this->getPostInfinityBehavior() == Behavior::Linear;
-        bool isLinearPreInfinity = time < mKeyframes.front().time && this->getPreInfinityBehavior() == Behavior::Linear;
+        bool isLinearPostInfinity = time > times.back() && this->getPostInfinityBehavior() == Behavior::Linear;
+        bool isLinearPreInfinity = time < times.front() && this->getPreInfinityBehavior() == Behavior::Linear;
 
-        Keyframe interpolated;
+        Sample interpolated;
 
-        if (isLinearPreInfinity && mKeyframes.size() > 1)
+        if (isLinearPreInfinity && times.size() > 1)
         {
-            const auto& k0 = mKeyframes.front();
-            auto k1 = interpolate(mInterpolationMode, k0.time + kEpsilonTime);
+            Sample k0 = loadKeyframe(0);
+            Sample k1 = interpolate(mInterpolationMode, k0.time + kEpsilonTime);
             double segmentDuration = k1.time - k0.time;
             float t = (float)((time - k0.time) / segmentDuration);
-            interpolated = interpolateLinear(k0, k1, t);
+            interpolated = Sample::interpolateLinear(k0, k1, t);
         }
-        else if (isLinearPostInfinity && mKeyframes.size() > 1)
+        else if (isLinearPostInfinity && times.size() > 1)
         {
-            const auto& k1 = mKeyframes.back();
-            auto k0 = interpolate(mInterpolationMode, k1.time - kEpsilonTime);
+            Sample k1 = loadKeyframe(times.size() - 1);
+            Sample k0 = interpolate(mInterpolationMode, k1.time - kEpsilonTime);
             double segmentDuration = k1.time - k0.time;
             float t = (float)((time - k0.time) / segmentDuration);
-            interpolated = interpolateLinear(k0, k1, t);
+            interpolated = Sample::interpolateLinear(k0, k1, t);
         }
         else
         {
             interpolated = interpolate(mInterpolationMode, time);
         }
 
-        glm::mat4 T = translate(interpolated.translation);
-        glm::mat4 R = mat4_cast(interpolated.rotation);
-        glm::mat4 S = scale(interpolated.scaling);
-        glm::mat4 transform = T * R * S;
+        return composeTransform(interpolated.translation, interpolated.rotation, interpolated.scaling);
+    }
 
-        return transform;
+    void Animation::animate(const std::vector<SharedPtr>& animations, double currentTime, std::vector<glm::mat4>& matrices)
+    {
+        matrices.resize(animations.size());
+        Threading::parallelFor(0, animations.size(), [&](size_t i)
+        {
+            matrices[i] = animations[i]->animate(currentTime);
+        }, kAnimationBatchSize);
     }
 
-    Animation::Keyframe Animation::interpolate(InterpolationMode mode, double time) const
+    Animation::Sample Animation::loadKeyframe(size_t index) const
     {
-        assert(!mKeyframes.empty());
+        Sample sample;
+        sample.time = mKeyframeData.times[index];
+        sample.translation = loadVector(mKeyframeData.translations[index]);
+        sample.scaling = loadVector(mKeyframeData.scalings[index]);
+        sample.rotation = loadVector(mKeyframeData.rotations[index]);
+        return sample;
+    }
 
-        // Validate cached frame index.
-        size_t frameIndex = clamp(mCachedFrameIndex, (size_t)0, mKeyframes.size() - 1);
-        if (time < mKeyframes[frameIndex].time) frameIndex = 0;
+    Animation::Sample Animation::interpolate(InterpolationMode mode, double time) const
+    {
+        const auto& times = mKeyframeData.times;
+        assert(!times.empty());
 
-        // Find frame index.
-        while (frameIndex < mKeyframes.size() - 1)
-        {
-            if (mKeyframes[frameIndex + 1].time > time) break;
-            frameIndex++;
-        }
+        size_t frameIndex = findFrameIndex(time);
 
         // Cache frame index;
         mCachedFrameIndex = frameIndex;
 
         // Compute index of adjacent frame including optional warping.
-        auto adjacentFrame = [this] (size_t frame, int32_t offset = 1)
+        auto adjacentFrame = [this, count = times.size()] (size_t frame, int32_t offset = 1)
         {
-            size_t count = mKeyframes.size();
             return mEnableWarping ? (frame + count + offset) % count : clamp(frame + offset, (size_t)0, count - 1);
         };
 
-        if (mode == InterpolationMode::Linear || mKeyframes.size() < 4)
+        if (mode == InterpolationMode::Linear || times.size() < 4)
         {
             size_t i0 = frameIndex;
             size_t i1 = adjacentFrame(i0);
 
-            const Keyframe& k0 = mKeyframes[i0];
-            const Keyframe& k1 = mKeyframes[i1];
+            Sample k0 = loadKeyframe(i0);
+            Sample k1 = loadKeyframe(i1);
 
             double segmentDuration = k1.time - k0.time;
             if (mEnableWarping && segmentDuration < 0.0) segmentDuration += mDuration;
             float t = (float)clamp((segmentDuration > 0.0 ? (time - k0.time) / segmentDuration : 1.0), 0.0, 1.0);
 
-            return interpolateLinear(k0, k1, t);
+            return Sample::interpolateLinear(k0, k1, t);
         }
         else if (mode == InterpolationMode::Hermite)
         {
@@ -205,16 +284,22 @@ namespace Falcor
             size_t i2 = adjacentFrame(i1, 1);
             size_t i3 = adjacentFrame(i1, 2);
 
-            const Keyframe& k0 = mKeyframes[i0];
-            const Keyframe& k1 = mKeyframes[i1];
-            const Keyframe& k2 = mKeyframes[i2];
-            const Keyframe& k3 = mKeyframes[i3];
+            Sample k0 = loadKeyframe(i0);
+            Sample k1 = loadKeyframe(i1);
+            Sample k2 = loadKeyframe(i2);
+            Sample k3 = loadKeyframe(i3);
 
             double segmentDuration = k2.time - k1.time;
             if (mEnableWarping && segmentDuration < 0.0) segmentDuration += mDuration;
             float t = (float)clamp(segmentDuration > 0.0 ? (time - k1.time) / segmentDuration : 1.0, 0.0, 1.0);
+            assert(t >= 0.f && t <= 1.f);
 
-            return interpolateHermite(k0, k1, k2, k3, t);
+            Sample result;
+            result.translation = interpolateHermite(k0.translation, k1.translation, k2.translation, k3.translation, t);
+            result.scaling = lerpSSE(k1.scaling, k2.scaling, t);
+            result.rotation = interpolateHermiteRotation(k0.rotation, k1.rotation, k2.rotation, k3.rotation, t);
+            result.time = glm::lerp(k1.time, k2.time, (double)t);
+            return result;
         }
         else
         {
@@ -222,6 +307,23 @@ namespace Falcor
         }
     }
 
+    size_t Animation::findFrameIndex(double time) const
+    {
+        const auto& times = mKeyframeData.times;
+
+        // The time usually advances by less than a keyframe per frame, so try the cached frame and its successors first.
+        size_t frameIndex = std::min(mCachedFrameIndex, times.size() - 1);
+        if (times[frameIndex] <= time)
+        {
+            for (uint32_t i = 0; i < 2 && frameIndex + 1 < times.size() && times[frameIndex + 1] <= time; i++) frameIndex++;
+            if (frameIndex + 1 == times.size() || times[frameIndex + 1] > time) return frameIndex;
+        }
+
+        // Otherwise search for the last keyframe at or before the time.
+        auto it = std::upper_bound(times.begin(), times.end(), time);
+        return it == times.begin() ? 0 : (size_t)(it - times.begin()) - 1;
+    }
+
     // Calculates the sample time within the keyframe range if the current time lies outside and
     // the animation does not behave linearly. If the animation behaves linearly, then the
     // current time is returned. This function should not be used if the current time lies
@@ -229,8 +331,8 @@ namespace Falcor
     double Animation::calcSampleTime(double currentTime)
     {
         double modifiedTime = currentTime;
-        double firstKeyframeTime = mKeyframes.front().time;
-        double lastKeyframeTime = mKeyframes.back().time;
+        double firstKeyframeTime = mKeyframeData.times.front();
+        double lastKeyframeTime = mKeyframeData.times.back();
         double duration = lastKeyframeTime - firstKeyframeTime;
 
         assert(currentTime < firstKeyframeTime || currentTime > lastKeyframeTime);
@@ -261,56 +363,52 @@ namespace Falcor
     {
         assert(keyframe.time <= mDuration);
 
-        if (mKeyframes.size() == 0 || mKeyframes[0].time > keyframe.time)
+        auto& times = mKeyframeData.times;
+        auto it = std::lower_bound(times.begin(), times.end(), keyframe.time);
+        size_t index = it - times.begin();
+
+        float4 translation(keyframe.translation, 0.f);
+        float4 scaling(keyframe.scaling, 0.f);
+        float4 rotation(keyframe.rotation.x, keyframe.rotation.y, keyframe.rotation.z, keyframe.rotation.w);
+
+        // If we already have a keyframe at the same time, replace it
+        if (it != times.end() && *it == keyframe.time)
         {
-            mKeyframes.insert(mKeyframes.begin(), keyframe);
+            mKeyframeData.translations[index] = translation;
+            mKeyframeData.scalings[index] = scaling;
+            mKeyframeData.rotations[index] = rotation;
             return;
         }
-        else
-        {
-            for (size_t i = 0; i < mKeyframes.size(); i++)
-            {
-                auto& current = mKeyframes[i];
-                // If we already have a key-frame at the same time, replace it
-                if (current.time == keyframe.time)
-                {
-                    current = keyframe;
-                    return;
-                }
-
-                // If this is not the last frame, Check if we are in between frames
-                if (i < mKeyframes.size() - 1)
-                {
-                    auto& Next = mKeyframes[i + 1];
-                    if (current.time < keyframe.time && Next.time > keyframe.time)
-                    {
-                        mKeyframes.insert(mKeyframes.begin() + i + 1, keyframe);
-                        return;
-                    }
-                }
-            }
 
-            // If we got here, need to push it to the end of the list
-            mKeyframes.push_back(keyframe);
-        }
+        times.insert(it, keyframe.time);
+        mKeyframeData.translations.insert(mKeyframeData.translations.begin() + index, translation);
+        mKeyframeData.scalings.insert(mKeyframeData.scalings.begin() + index, scaling);
+        mKeyframeData.rotations.insert(mKeyframeData.rotations.begin() + index, rotation);
     }
 
-    const Animation::Keyframe& Animation::getKeyframe(double time) const
+    Animation::Keyframe Animation::getKeyframe(double time) const
     {
-        for (const auto& k : mKeyframes)
+        const auto& times = mKeyframeData.times;
+        auto it = std::lower_bound(times.begin(), times.end(), time);
+        if (it == times.end() || *it != time)
         {
-            if (k.time == time) return k;
+            throw std::runtime_error(("Animation::getKeyframe() - can't find a keyframe at time " + std::to_string(time)).c_str());
         }
-        throw std::runtime_error(("Animation::getKeyframe() - can't find a keyframe at time " + std::to_string(time)).c_str());
+
+        size_t index = it - times.begin();
+        const float4& r = mKeyframeData.rotations[index];
+        Keyframe keyframe;
+        keyframe.time = time;
+        keyframe.translation = float3(mKeyframeData.translations[index]);
+        keyframe.scaling = float3(mKeyframeData.scalings[index]);
+        keyframe.rotation = glm::quat(r.w, r.x, r.y, r.z);
+        return keyframe;
     }
 
     bool Animation::doesKeyframeExists(double time) const
     {
-        for (const auto& k : mKeyframes)
-        {
-            if (k.time == time) return true;
-        }
-        return false;
+        const auto& times = mKeyframeData.times;
+        return std::binary_search(times.begin(), times.end(), time);
     }
 
     void Animation::renderUI(Gui::Widgets& widget)
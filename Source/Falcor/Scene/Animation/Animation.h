@@ -122,7 +122,7 @@ namespace Falcor
             \param[in] time Time of the keyframe.
             \return Returns the keyframe.
         */
-        const Keyframe& getKeyframe(double time) const;
+        Keyframe getKeyframe(double time) const;
 
         /** Check if a keyframe exists at the specified time.
             \param[in] time Time of the keyframe.
@@ -136,6 +136,14 @@ namespace Falcor
         */
         glm::mat4 animate(double currentTime);
 
+        /** Compute a list of animations.
+            The animations are evaluated in parallel batches. Each animation must only appear once in the list.
+            \param[in] animations List of animations.
+            \param[in] currentTime The current time in seconds.
+            \param[out] matrices The animations' transform matrices, in the same order as the list of animations.
+        */
+        static void animate(const std::vector<SharedPtr>& animations, double currentTime, std::vector<glm::mat4>& matrices);
+
         /* Render the UI.
         */
         void renderUI(Gui::Widgets& widget);
@@ -143,7 +151,11 @@ namespace Falcor
     private:
         Animation(const std::string& name, uint32_t nodeID, double duration);
 
-        Keyframe interpolate(InterpolationMode mode, double time) const;
+        struct Sample;
+
+        Sample loadKeyframe(size_t index) const;
+        Sample interpolate(InterpolationMode mode, double time) const;
+        size_t findFrameIndex(double time) const;
         double calcSampleTime(double currentTime);
 
         const std::string mName;
@@ -156,7 +168,21 @@ namespace Falcor
         InterpolationMode mInterpolationMode = InterpolationMode::Linear;
         bool mEnableWarping = false;
 
-        std::vector<Keyframe> mKeyframes;
         mutable size_t mCachedFrameIndex = 0;
+
+        /** Keyframes in structure-of-arrays layout, sorted by time.
+            Vectors are padded to four components for SIMD loads and rotations are stored as (x, y, z, w).
+        */
+        struct KeyframeData
+        {
+            std::vector<double> times;
+            std::vector<float4> translations;
+            std::vector<float4> scalings;
+            std::vector<float4> rotations;
+        };
+
+        KeyframeData mKeyframeData;
+
+        friend class SceneCache;
     };
 }
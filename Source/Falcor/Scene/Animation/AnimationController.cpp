@@ -27,6 +27,7 @@
  **************************************************************************/
 #include "stdafx.h"
 #include "AnimationController.h"
+#include "glm/gtc/matrix_inverse.hpp"
 #include <fstream>
 
 namespace Falcor
@@ -36,11 +37,51 @@ namespace Falcor
         const std::string kWorldMatrices = "worldMatrices";
         const std::string kInverseTransposeWorldMatrices = "inverseTransposeWorldMatrices";
         const std::string kPreviousFrameWorldMatrices = "previousFrameWorldMatrices";
+
+        // Changed matrices closer than this are uploaded in a single range, to reduce the number of copies.
+        const uint32_t kMaxMatrixRangeGap = 64;
+
+        /** Add a range of matrices to a list of ranges in increasing order, merging it with the last range if close enough.
+        */
+        void addMatrixRange(std::vector<std::pair<uint32_t, uint32_t>>& ranges, uint32_t first, uint32_t last)
+        {
+            if (!ranges.empty() && first <= ranges.back().second + kMaxMatrixRangeGap)
+            {
+                ranges.back().second = std::max(ranges.back().second, last);
+            }
+            else
+            {
+                ranges.push_back({ first, last });
+            }
+        }
+
+        /** Merge two lists of ranges in increasing order.
+        */
+        std::vector<std::pair<uint32_t, uint32_t>> mergeMatrixRanges(const std::vector<std::pair<uint32_t, uint32_t>>& a, const std::vector<std::pair<uint32_t, uint32_t>>& b)
+        {
+            std::vector<std::pair<uint32_t, uint32_t>> sorted;
+            sorted.reserve(a.size() + b.size());
+            std::merge(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(sorted));
+
+            std::vector<std::pair<uint32_t, uint32_t>> merged;
+            for (const auto& range : sorted) addMatrixRange(merged, range.first, range.second);
+            return merged;
+        }
+
+        /** Computes transpose(inverse(m)).
+            Affine matrices are inverted using the inverse of the upper 3x3 part, which is much cheaper than the general inverse.
+        */
+        glm::mat4 inverseTranspose(const glm::mat4& m)
+        {
+            bool isAffine = m[0][3] == 0.f && m[1][3] == 0.f && m[2][3] == 0.f && m[3][3] == 1.f;
+            return glm::transpose(isAffine ? glm::affineInverse(m) : glm::inverse(m));
+        }
     }
 
     AnimationController::AnimationController(Scene* pScene, const StaticVertexVector& staticVertexData, const DynamicVertexVector& dynamicVertexData, const std::vector<Animation::SharedPtr>& animations)
         : mpScene(pScene)
         , mLocalMatrices(pScene->mSceneGraph.size())
+        , mGlobalMatrices(pScene->mSceneGraph.size())
         , mInvTransposeGlobalMatrices(pScene->mSceneGraph.size())
         , mMatricesAnimated(pScene->mSceneGraph.size())
         , mMatricesChanged(pScene->mSceneGraph.size())
@@ -101,6 +142,12 @@ namespace Falcor
                 mMatricesAnimated[i] = mMatricesAnimated[i] || mMatricesAnimated[parent];
             }
         }
+
+        mAnimatedMatrixIDs.clear();
+        for (uint32_t i = 0; i < (uint32_t)mMatricesAnimated.size(); i++)
+        {
+            if (mMatricesAnimated[i]) mAnimatedMatrixIDs.push_back(i);
+        }
     }
 
     void AnimationController::initLocalMatrices()
@@ -115,8 +162,10 @@ namespace Falcor
     {
         PROFILE("animate");
 
-        mMatricesChanged.assign(mMatricesChanged.size(), false);
+        // Only animated matrices can be flagged as changed.
+        for (uint32_t matrixID : mAnimatedMatrixIDs) mMatricesChanged[matrixID] = false;
 
+        const bool updateAll = mAnimationChanged;
         if (mAnimationChanged == false)
         {
             if (!mEnabled || !hasAnimations()) return false;
@@ -124,6 +173,8 @@ namespace Falcor
             {
                 // Copy the current matrices to the previous matrices. We can do that only once, but not sure if it we'll help perf (it only occures when the animation is paused)
                 pContext->copyResource(mpPrevWorldMatricesBuffer.get(), mpWorldMatricesBuffer.get());
+                // Both buffers are now up to date.
+                mPrevChangedRanges.clear();
                 return false;
             }
         }
@@ -135,46 +186,91 @@ namespace Falcor
         if (mEnabled)
         {
             double time = (mLoopAnimations == true) ? std::fmod(currentTime, mGlobalAnimationLength) : currentTime;
-            for (auto& pAnimation : mAnimations)
+            Animation::animate(mAnimations, time, mAnimationMatrices);
+
+            // Scatter the results in animation order, which also resolves multiple animations of the same node like before.
+            for (size_t i = 0; i < mAnimations.size(); i++)
             {
-                uint32_t nodeID = pAnimation->getNodeID();
-                mLocalMatrices[nodeID] = pAnimation->animate(time);
+                uint32_t nodeID = mAnimations[i]->getNodeID();
+                mLocalMatrices[nodeID] = mAnimationMatrices[i];
                 mMatricesChanged[nodeID] = true;
             }
         }
 
         swap(mpPrevWorldMatricesBuffer, mpWorldMatricesBuffer);
-        updateMatrices();
+        updateMatrices(updateAll);
         bindBuffers();
         executeSkinningPass(pContext);
 
         return true;
     }
 
-    void AnimationController::updateMatrices()
+    void AnimationController::updateMatrices(bool updateAll)
     {
-        // We can optimize this
-        mGlobalMatrices = mLocalMatrices;
+        mChangedRanges.clear();
 
-        for (size_t i = 0; i < mGlobalMatrices.size(); i++)
+        if (updateAll)
         {
-            if (mpScene->mSceneGraph[i].parent != SceneBuilder::kInvalidNode)
+            // The local matrices have been reset, so all animated matrices may have changed.
+            for (uint32_t matrixID : mAnimatedMatrixIDs) mMatricesChanged[matrixID] = true;
+
+            for (uint32_t i = 0; i < (uint32_t)mGlobalMatrices.size(); i++) updateMatrix(i);
+            if (!mGlobalMatrices.empty()) mChangedRanges.push_back({ 0, (uint32_t)mGlobalMatrices.size() });
+        }
+        else
+        {
+            // Only matrices under animated nodes can change. Propagate the changed flags down the animated subtrees
+            // and update the changed matrices. The IDs are sorted, so parents are updated before their children.
+            for (uint32_t i : mAnimatedMatrixIDs)
             {
-                mGlobalMatrices[i] = mGlobalMatrices[mpScene->mSceneGraph[i].parent] * mGlobalMatrices[i];
-                mMatricesChanged[i] = mMatricesChanged[i] || mMatricesChanged[mpScene->mSceneGraph[i].parent];
-                assert(!mMatricesChanged[i] || mMatricesAnimated[i]);
+                if (uint32_t parent = mpScene->mSceneGraph[i].parent; parent != SceneBuilder::kInvalidNode)
+                {
+                    mMatricesChanged[i] = mMatricesChanged[i] || mMatricesChanged[parent];
+                }
+                if (mMatricesChanged[i])
+                {
+                    updateMatrix(i);
+                    addMatrixRange(mChangedRanges, i, i + 1);
+                }
             }
+        }
 
-            mInvTransposeGlobalMatrices[i] = transpose(inverse(mGlobalMatrices[i]));
+        // The world matrix buffer was swapped with the previous frame buffer, so it is also missing the matrices changed in the previous update.
+        uploadMatrices(mpWorldMatricesBuffer, mGlobalMatrices, mergeMatrixRanges(mChangedRanges, mPrevChangedRanges));
+        uploadMatrices(mpInvTransposeWorldMatricesBuffer, mInvTransposeGlobalMatrices, mChangedRanges);
+        mPrevChangedRanges = mChangedRanges;
+    }
 
-            if (mpSkinningPass)
-            {
-                mSkinningMatrices[i] = mGlobalMatrices[i] * mpScene->mSceneGraph[i].localToBindSpace;
-                mInvTransposeSkinningMatrices[i] = transpose(inverse(mSkinningMatrices[i]));
-            }
+    void AnimationController::updateMatrix(uint32_t matrixID)
+    {
+        const auto& node = mpScene->mSceneGraph[matrixID];
+        if (node.parent != SceneBuilder::kInvalidNode)
+        {
+            assert(node.parent < matrixID);
+            mGlobalMatrices[matrixID] = mGlobalMatrices[node.parent] * mLocalMatrices[matrixID];
+            assert(!mMatricesChanged[matrixID] || mMatricesAnimated[matrixID]);
+        }
+        else
+        {
+            mGlobalMatrices[matrixID] = mLocalMatrices[matrixID];
+        }
+
+        mInvTransposeGlobalMatrices[matrixID] = inverseTranspose(mGlobalMatrices[matrixID]);
+
+        if (mpSkinningPass)
+        {
+            mSkinningMatrices[matrixID] = mGlobalMatrices[matrixID] * node.localToBindSpace;
+            mInvTransposeSkinningMatrices[matrixID] = inverseTranspose(mSkinningMatrices[matrixID]);
+        }
+    }
+
+    void AnimationController::uploadMatrices(const Buffer::SharedPtr& pBuffer, const std::vector<glm::mat4>& matrices, const std::vector<MatrixRange>& ranges)
+    {
+        for (const auto& range : ranges)
+        {
+            assert(range.first < range.second && range.second <= matrices.size());
+            pBuffer->setBlob(&matrices[range.first], range.first * sizeof(glm::mat4), (range.second - range.first) * sizeof(glm::mat4));
         }
-        mpWorldMatricesBuffer->setBlob(mGlobalMatrices.data(), 0, mpWorldMatricesBuffer->getSize());
-        mpInvTransposeWorldMatricesBuffer->setBlob(mInvTransposeGlobalMatrices.data(), 0, mpInvTransposeWorldMatricesBuffer->getSize());
     }
 
     void AnimationController::bindBuffers()
@@ -200,12 +296,17 @@ namespace Falcor
         return m;
     }
 
-    void AnimationController::createSkinningPass(const std::vector<PackedStaticVertexData>& staticVertexData, const std::vector<DynamicVertexData>& dynamicVertexData)
+    void AnimationController::createSkinningPass(const StaticVertexVector& staticVertexData, const DynamicVertexVector& dynamicVertexData)
     {
         // We always copy the static data, to initialize the non-skinned vertices.
+        // The static data is empty if the vertex buffer has already been initialized (compressed vertices).
         const Buffer::SharedPtr& pVB = mpScene->mpVao->getVertexBuffer(Scene::kStaticDataBufferIndex);
-        assert(pVB->getSize() == staticVertexData.size() * sizeof(staticVertexData[0]));
-        pVB->setBlob(staticVertexData.data(), 0, pVB->getSize());
+        if (!staticVertexData.empty())
+        {
+            assert(pVB->getSize() == staticVertexData.size() * sizeof(staticVertexData[0]));
+            pVB->setBlob(staticVertexData.data(), 0, pVB->getSize());
+        }
+        else assert(dynamicVertexData.empty());
 
         if (!dynamicVertexData.empty())
         {
@@ -259,8 +360,8 @@ namespace Falcor
     void AnimationController::executeSkinningPass(RenderContext* pContext)
     {
         if (!mpSkinningPass) return;
-        mpSkinningMatricesBuffer->setBlob(mSkinningMatrices.data(), 0, mpSkinningMatricesBuffer->getSize());
-        mpInvTransposeSkinningMatricesBuffer->setBlob(mInvTransposeSkinningMatrices.data(), 0, mpInvTransposeSkinningMatricesBuffer->getSize());
+        uploadMatrices(mpSkinningMatricesBuffer, mSkinningMatrices, mChangedRanges);
+        uploadMatrices(mpInvTransposeSkinningMatricesBuffer, mInvTransposeSkinningMatrices, mChangedRanges);
         mpSkinningPass->execute(pContext, mSkinningDispatchSize, 1, 1);
     }
 
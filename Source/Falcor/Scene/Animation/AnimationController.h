@@ -29,6 +29,7 @@
 #include "Animation.h"
 #include "RenderGraph/BasePasses/ComputePass.h"
 #include "Scene/SceneTypes.slang"
+#include "Utils/ArrayView.h"
 
 namespace Falcor
 {
@@ -56,8 +57,10 @@ namespace Falcor
         static const uint32_t kInvalidBoneID = -1;
         ~AnimationController() = default;
 
-        using StaticVertexVector = std::vector<PackedStaticVertexData>;
-        using DynamicVertexVector = std::vector<DynamicVertexData>;
+        using MatrixRange = std::pair<uint32_t, uint32_t>;  ///< Range [first, second) of matrix IDs.
+
+        using StaticVertexVector = ArrayView<PackedStaticVertexData>;
+        using DynamicVertexVector = ArrayView<DynamicVertexData>;
 
         /** Create a new object.
             \return A new object, or throws an exception if creation failed.
@@ -101,6 +104,11 @@ namespace Falcor
         */
         bool isMatrixChanged(size_t matrixID) const { return mMatricesChanged[matrixID]; }
 
+        /** Get the ranges of matrix IDs updated in the last call to animate() that returned true.
+            The ranges are sorted and disjoint. They cover all changed matrices but may also include unchanged ones, use isMatrixChanged() to check individual matrices.
+        */
+        const std::vector<MatrixRange>& getChangedMatrixRanges() const { return mChangedRanges; }
+
         /** Get the global matrices.
         */
         const std::vector<glm::mat4>& getGlobalMatrices() const { return mGlobalMatrices; }
@@ -125,19 +133,29 @@ namespace Falcor
 
         void initFlags();
         void bindBuffers();
-        void updateMatrices();
 
-        void createSkinningPass(const std::vector<PackedStaticVertexData>& staticVertexData, const std::vector<DynamicVertexData>& dynamicVertexData);
+        /** Update the global matrices and upload the changed ones to the GPU.
+            \param[in] updateAll Update all matrices. Otherwise only animated matrices that changed or have a changed ancestor are updated.
+        */
+        void updateMatrices(bool updateAll);
+        void updateMatrix(uint32_t matrixID);
+        static void uploadMatrices(const Buffer::SharedPtr& pBuffer, const std::vector<glm::mat4>& matrices, const std::vector<MatrixRange>& ranges);
+
+        void createSkinningPass(const StaticVertexVector& staticVertexData, const DynamicVertexVector& dynamicVertexData);
         void executeSkinningPass(RenderContext* pContext);
         void initLocalMatrices();
 
         // Animation
         std::vector<Animation::SharedPtr> mAnimations;
+        std::vector<glm::mat4> mAnimationMatrices;  ///< Transform matrix per animation, computed in parallel before being copied to the local matrices.
         std::vector<glm::mat4> mLocalMatrices;
         std::vector<glm::mat4> mGlobalMatrices;
         std::vector<glm::mat4> mInvTransposeGlobalMatrices;
         std::vector<bool> mMatricesAnimated;        ///< Flag per matrix, true if matrix is affected by animations.
         std::vector<bool> mMatricesChanged;         ///< Flag per matrix, true if matrix changed since last frame.
+        std::vector<uint32_t> mAnimatedMatrixIDs;   ///< IDs of all matrices affected by animations, in increasing order so parents come before their children.
+        std::vector<MatrixRange> mChangedRanges;    ///< Ranges of matrices changed in the last update.
+        std::vector<MatrixRange> mPrevChangedRanges;///< Ranges of matrices changed in the update before, i.e. the matrices that are stale in the previous frame world matrix buffer.
 
         bool mEnabled = true;
         bool mAnimationChanged = true;
@@ -0,0 +1,158 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "BlasBuildPlanner.h"
+
+namespace Falcor
+{
+    namespace
+    {
+        // Number of evenly spaced splits of the budget into result and scratch buffer capacity that are tried.
+        const uint32_t kCapacitySplitCount = 16;
+
+        double getFraction(uint64_t byteSize, uint64_t capacity)
+        {
+            return capacity > 0 ? (double)byteSize / (double)capacity : 0.0;
+        }
+
+        // Packs the BLASes into groups that fit the given result and scratch buffer capacities.
+        // The groups are filled one at a time. The BLASes are split into result-heavy and scratch-heavy ones relative to the capacities,
+        // and a group takes the largest fitting BLAS from the list that balances its use of the two buffers, so that neither fills up early.
+        BlasBuildPlanner::Plan packGroups(const std::vector<BlasBuildPlanner::BlasSize>& blasSizes, uint64_t resultCapacity, uint64_t scratchCapacity)
+        {
+            std::vector<uint32_t> lists[2];     // Result-heavy and scratch-heavy BLASes, by decreasing fraction of the capacity they take up.
+            std::vector<double> fractions(blasSizes.size());
+            for (uint32_t i = 0; i < (uint32_t)blasSizes.size(); i++)
+            {
+                double resultFraction = getFraction(blasSizes[i].resultByteSize, resultCapacity);
+                double scratchFraction = getFraction(blasSizes[i].scratchByteSize, scratchCapacity);
+                fractions[i] = std::max(resultFraction, scratchFraction);
+                lists[resultFraction >= scratchFraction ? 0 : 1].push_back(i);
+            }
+            for (auto& list : lists)
+            {
+                std::stable_sort(list.begin(), list.end(), [&fractions](uint32_t a, uint32_t b) { return fractions[a] > fractions[b]; });
+            }
+
+            BlasBuildPlanner::Plan plan;
+            std::vector<uint8_t> isPacked(blasSizes.size(), 0);
+            while (!lists[0].empty() || !lists[1].empty())
+            {
+                BlasBuildPlanner::Group group;
+
+                // A BLAS that doesn't fit the group now won't fit it later, so each list is scanned once per group.
+                size_t scanPos[2] = { 0, 0 };
+                bool isAdded = true;
+                while (isAdded)
+                {
+                    isAdded = false;
+                    uint32_t preferredList = getFraction(group.resultByteSize, resultCapacity) <= getFraction(group.scratchByteSize, scratchCapacity) ? 0 : 1;
+                    for (uint32_t listIndex : { preferredList, 1 - preferredList })
+                    {
+                        const auto& list = lists[listIndex];
+                        size_t& pos = scanPos[listIndex];
+                        for (; pos < list.size() && !isAdded; pos++)
+                        {
+                            uint32_t blasIndex = list[pos];
+                            const auto& size = blasSizes[blasIndex];
+                            if (group.resultByteSize + size.resultByteSize > resultCapacity || group.scratchByteSize + size.scratchByteSize > scratchCapacity) continue;
+
+                            group.blasIndices.push_back(blasIndex);
+                            group.resultByteSize += size.resultByteSize;
+                            group.scratchByteSize += size.scratchByteSize;
+                            isPacked[blasIndex] = 1;
+                            isAdded = true;
+                        }
+                        if (isAdded) break;
+                    }
+                }
+
+                // The capacities hold the largest BLAS, so every group gets at least one.
+                assert(!group.blasIndices.empty());
+                for (auto& list : lists)
+                {
+                    list.erase(std::remove_if(list.begin(), list.end(), [&isPacked](uint32_t blasIndex) { return isPacked[blasIndex] != 0; }), list.end());
+                }
+                plan.groups.push_back(std::move(group));
+            }
+
+            for (auto& group : plan.groups)
+            {
+                std::sort(group.blasIndices.begin(), group.blasIndices.end());
+                plan.resultBufferByteSize = std::max(plan.resultBufferByteSize, group.resultByteSize);
+                plan.scratchBufferByteSize = std::max(plan.scratchBufferByteSize, group.scratchByteSize);
+            }
+            plan.peakByteSize = plan.resultBufferByteSize + plan.scratchBufferByteSize;
+            return plan;
+        }
+    }
+
+    BlasBuildPlanner::Plan BlasBuildPlanner::plan(const std::vector<BlasSize>& blasSizes, uint64_t memoryBudget)
+    {
+        if (blasSizes.empty()) return {};
+
+        uint64_t maxResultByteSize = 0;
+        uint64_t maxScratchByteSize = 0;
+        uint64_t totalResultByteSize = 0;
+        uint64_t totalScratchByteSize = 0;
+        for (const auto& size : blasSizes)
+        {
+            maxResultByteSize = std::max(maxResultByteSize, size.resultByteSize);
+            maxScratchByteSize = std::max(maxScratchByteSize, size.scratchByteSize);
+            totalResultByteSize += size.resultByteSize;
+            totalScratchByteSize += size.scratchByteSize;
+        }
+
+        // The shared buffers must hold the largest BLAS, so the budget is split into a result and a scratch capacity that are at least that large.
+        // Try a range of splits, including one proportional to the total sizes, and keep the plan with the fewest groups and then the lowest peak memory.
+        uint64_t budget = std::max(memoryBudget, maxResultByteSize + maxScratchByteSize);
+        uint64_t slack = budget - maxResultByteSize - maxScratchByteSize;
+
+        std::vector<uint64_t> resultCapacities;
+        for (uint32_t i = 0; i <= kCapacitySplitCount; i++)
+        {
+            resultCapacities.push_back(maxResultByteSize + (uint64_t)(slack * ((double)i / kCapacitySplitCount)));
+        }
+        double resultRatio = getFraction(totalResultByteSize, totalResultByteSize + totalScratchByteSize);
+        resultCapacities.push_back(std::clamp((uint64_t)(budget * resultRatio), maxResultByteSize, budget - maxScratchByteSize));
+
+        Plan bestPlan;
+        for (uint64_t resultCapacity : resultCapacities)
+        {
+            Plan plan = packGroups(blasSizes, resultCapacity, budget - resultCapacity);
+            if (bestPlan.groups.empty() || plan.groups.size() < bestPlan.groups.size() ||
+                (plan.groups.size() == bestPlan.groups.size() && plan.peakByteSize < bestPlan.peakByteSize))
+            {
+                bestPlan = std::move(plan);
+            }
+        }
+
+        assert(bestPlan.peakByteSize <= budget);
+        return bestPlan;
+    }
+}
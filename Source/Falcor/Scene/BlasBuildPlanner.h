@@ -0,0 +1,75 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+
+namespace Falcor
+{
+    /** Plans how to split the build of the bottom-level acceleration structures (BLASes) of a scene into groups under a memory budget.
+        The BLASes of a group are built at the same time into a shared result buffer and a shared scratch buffer. Both buffers are
+        reused by all groups, so the peak memory of the build is the size of the largest group result plus the largest group scratch.
+        The planner works only on the prebuild sizes and bin-packs the BLASes to minimize the number of groups.
+    */
+    class dlldecl BlasBuildPlanner
+    {
+    public:
+        static const uint64_t kDefaultMemoryBudget = 1ull << 29;   ///< Default memory budget of 512 MB.
+
+        /** Prebuild sizes of a BLAS, including padding.
+        */
+        struct BlasSize
+        {
+            uint64_t resultByteSize = 0;    ///< Maximum result data size.
+            uint64_t scratchByteSize = 0;   ///< Scratch data size.
+        };
+
+        /** Group of BLASes built at the same time.
+        */
+        struct Group
+        {
+            std::vector<uint32_t> blasIndices;  ///< Indices of the BLASes in the group, in ascending order.
+            uint64_t resultByteSize = 0;        ///< Total result data size of the BLASes in the group.
+            uint64_t scratchByteSize = 0;       ///< Total scratch data size of the BLASes in the group.
+        };
+
+        struct Plan
+        {
+            std::vector<Group> groups;
+            uint64_t resultBufferByteSize = 0;  ///< Size of the shared result buffer, i.e. the largest group result size.
+            uint64_t scratchBufferByteSize = 0; ///< Size of the shared scratch buffer, i.e. the largest group scratch size.
+            uint64_t peakByteSize = 0;          ///< Planned peak memory of the build, the sum of the result and scratch buffer sizes.
+        };
+
+        /** Plan the BLAS build.
+            If the largest BLAS result plus the largest BLAS scratch exceed the budget, that sum is used as the budget instead.
+            \param[in] blasSizes Prebuild sizes per BLAS.
+            \param[in] memoryBudget Maximum peak memory of the build in bytes.
+            \return The plan. Every BLAS is in exactly one group.
+        */
+        static Plan plan(const std::vector<BlasSize>& blasSizes, uint64_t memoryBudget);
+    };
+}
@@ -27,6 +27,7 @@
  **************************************************************************/
 #include "stdafx.h"
 #include "assimp/Importer.hpp"
+#include "assimp/DefaultIOSystem.h"
 #include "assimp/postprocess.h"
 #include "assimp/scene.h"
 #include "assimp/pbrmaterial.h"
@@ -76,6 +77,24 @@ namespace Falcor
             return transpose(glmMat);
         }
 
+        /** IO system that records the files opened by Assimp, i.e. the scene file and any files it references.
+        */
+        class RecordingIOSystem : public Assimp::DefaultIOSystem
+        {
+        public:
+            Assimp::IOStream* Open(const char* pFile, const char* pMode) override
+            {
+                Assimp::IOStream* pStream = Assimp::DefaultIOSystem::Open(pFile, pMode);
+                if (pStream) mFiles.push_back(pFile);
+                return pStream;
+            }
+
+            const std::vector<std::string>& getFiles() const { return mFiles; }
+
+        private:
+            std::vector<std::string> mFiles;
+        };
+
         float3 aiCast(const aiColor3D& ai)
         {
             return float3(ai.r, ai.g, ai.b);
@@ -1024,9 +1043,20 @@ namespace Falcor
         Assimp::Importer importer;
         importer.SetPropertyInteger(AI_CONFIG_PP_RVC_FLAGS, removeFlags);
 
+        // The importer takes ownership of the IO system.
+        auto pIOSystem = new RecordingIOSystem();
+        importer.SetIOHandler(pIOSystem);
+
         const aiScene* pScene = importer.ReadFile(fullpath, assimpFlags);
         timeReport.measure("Loading asset file");
 
+        // Report referenced files such as material libraries and geometry buffers to the builder.
+        for (const auto& file : pIOSystem->getFiles())
+        {
+            std::string fileFullpath = canonicalizeFilename(file);
+            if (!fileFullpath.empty() && fileFullpath != fullpath) builder.addDependentFile(fileFullpath);
+        }
+
         if (pScene == nullptr)
         {
             std::string str("Can't open file '");
@@ -0,0 +1,237 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "InstanceBVH.h"
+
+namespace Falcor
+{
+    namespace
+    {
+        // Trees with fewer instances are culled on the calling thread.
+        const uint32_t kMinParallelInstanceCount = 4096;
+
+        // Number of subtrees per worker thread to traverse in parallel, for load balancing.
+        const uint32_t kSubtreesPerThread = 4;
+    }
+
+    InstanceBVH::Frustum InstanceBVH::Frustum::fromViewProjMatrix(const glm::mat4& viewProj)
+    {
+        // Extract the planes from the rows of the matrix.
+        // See: https://fgiesen.wordpress.com/2012/08/31/frustum-planes-from-the-projection-matrix/
+        Frustum frustum;
+        glm::mat4 rows = glm::transpose(viewProj);
+        for (int i = 0; i < 6; i++)
+        {
+            float4 plane = (i & 1) ? rows[i >> 1] : -rows[i >> 1];
+            if (i != 5) plane += rows[3]; // Z range is [0, w]. For the 0 <= z plane we don't need to add w.
+            frustum.planes[i] = plane;
+        }
+        return frustum;
+    }
+
+    InstanceBVH::Frustum InstanceBVH::Frustum::fromShadowViewProjMatrix(const glm::mat4& lightViewProj)
+    {
+        // Replace the near plane by a plane that everything is inside of.
+        Frustum frustum = fromViewProjMatrix(lightViewProj);
+        frustum.planes[5] = float4(0.f, 0.f, 0.f, 1.f);
+        return frustum;
+    }
+
+    bool InstanceBVH::Frustum::intersects(const AABB& box, uint32_t& planeMask) const
+    {
+        float3 center = box.center();
+        float3 halfExtent = 0.5f * box.extent();
+        for (uint32_t i = 0; i < 6; i++)
+        {
+            if ((planeMask & (1u << i)) == 0) continue;
+
+            float3 normal = float3(planes[i]);
+            float distance = glm::dot(center, normal) + planes[i].w;
+            float radius = glm::dot(halfExtent, glm::abs(normal));
+            if (distance + radius < 0.f) return false;
+            if (distance - radius >= 0.f) planeMask &= ~(1u << i);
+        }
+        return true;
+    }
+
+    void InstanceBVH::build(const std::vector<AABB>& bounds)
+    {
+        mInstanceBounds = bounds;
+        mInstanceIDs.resize(bounds.size());
+        for (uint32_t i = 0; i < (uint32_t)bounds.size(); i++) mInstanceIDs[i] = i;
+
+        std::vector<float3> centroids(bounds.size());
+        for (size_t i = 0; i < bounds.size(); i++) centroids[i] = bounds[i].valid() ? bounds[i].center() : float3(0.f);
+
+        mNodes.clear();
+        if (bounds.empty()) return;
+        mNodes.reserve(2 * (bounds.size() / kMaxLeafSize + 1));
+        buildRecursive(0, (uint32_t)bounds.size(), centroids);
+    }
+
+    uint32_t InstanceBVH::buildRecursive(uint32_t begin, uint32_t end, const std::vector<float3>& centroids)
+    {
+        uint32_t nodeIndex = (uint32_t)mNodes.size();
+        mNodes.push_back({});
+
+        AABB bounds, centroidBounds;
+        for (uint32_t i = begin; i < end; i++)
+        {
+            bounds |= mInstanceBounds[mInstanceIDs[i]];
+            centroidBounds.include(centroids[mInstanceIDs[i]]);
+        }
+
+        if (end - begin > kMaxLeafSize)
+        {
+            // Split at the median along the axis of largest centroid extent.
+            float3 extent = centroidBounds.extent();
+            int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+            uint32_t mid = begin + (end - begin) / 2;
+            std::nth_element(mInstanceIDs.begin() + begin, mInstanceIDs.begin() + mid, mInstanceIDs.begin() + end, [&](uint32_t a, uint32_t b)
+            {
+                return centroids[a][axis] < centroids[b][axis];
+            });
+
+            buildRecursive(begin, mid, centroids);
+            mNodes[nodeIndex].rightChild = buildRecursive(mid, end, centroids);
+        }
+
+        Node& node = mNodes[nodeIndex];
+        node.bounds = bounds;
+        node.firstInstance = begin;
+        node.instanceCount = end - begin;
+        return nodeIndex;
+    }
+
+    void InstanceBVH::refit(const std::vector<AABB>& bounds)
+    {
+        assert(bounds.size() == mInstanceBounds.size());
+        mInstanceBounds = bounds;
+
+        // Children are stored after their parent, so a reverse pass updates them first.
+        for (size_t i = mNodes.size(); i-- > 0;)
+        {
+            Node& node = mNodes[i];
+            if (node.rightChild == 0)
+            {
+                node.bounds = AABB();
+                for (uint32_t j = 0; j < node.instanceCount; j++) node.bounds |= mInstanceBounds[mInstanceIDs[node.firstInstance + j]];
+            }
+            else
+            {
+                node.bounds = mNodes[i + 1].bounds | mNodes[node.rightChild].bounds;
+            }
+        }
+    }
+
+    void InstanceBVH::traverseNode(const Frustum& frustum, const StackEntry& entry, std::vector<StackEntry>& stack, uint8_t* visible, CullStats& stats) const
+    {
+        const Node& node = mNodes[entry.nodeIndex];
+        uint32_t planeMask = entry.planeMask;
+
+        stats.nodeTestCount++;
+        if (!frustum.intersects(node.bounds, planeMask)) return;
+
+        if (planeMask == 0)
+        {
+            // The subtree is entirely inside the frustum.
+            for (uint32_t i = 0; i < node.instanceCount; i++) visible[mInstanceIDs[node.firstInstance + i]] = 1;
+            stats.visibleCount += node.instanceCount;
+        }
+        else if (node.rightChild == 0)
+        {
+            for (uint32_t i = 0; i < node.instanceCount; i++)
+            {
+                uint32_t instanceID = mInstanceIDs[node.firstInstance + i];
+                uint32_t instancePlaneMask = planeMask;
+                stats.boxTestCount++;
+                if (frustum.intersects(mInstanceBounds[instanceID], instancePlaneMask))
+                {
+                    visible[instanceID] = 1;
+                    stats.visibleCount++;
+                }
+            }
+        }
+        else
+        {
+            stack.push_back({ node.rightChild, planeMask });
+            stack.push_back({ entry.nodeIndex + 1, planeMask });
+        }
+    }
+
+    InstanceBVH::CullStats InstanceBVH::cull(const Frustum& frustum, std::vector<uint8_t>& visible) const
+    {
+        visible.assign(mInstanceBounds.size(), 0);
+        CullStats stats;
+        if (mNodes.empty()) return stats;
+
+        std::vector<StackEntry> stack;
+        stack.push_back({ 0, kAllPlanesMask });
+
+        // Expand the upper levels breadth-first until there are enough subtrees to distribute over the worker threads.
+        if (getInstanceCount() >= kMinParallelInstanceCount)
+        {
+            const size_t subtreeCount = kSubtreesPerThread * Threading::getLogicalThreadCount();
+            std::vector<StackEntry> level;
+            while (!stack.empty() && stack.size() < subtreeCount)
+            {
+                level.swap(stack);
+                stack.clear();
+                for (const auto& entry : level) traverseNode(frustum, entry, stack, visible.data(), stats);
+            }
+
+            std::vector<CullStats> subtreeStats(stack.size());
+            Threading::parallelFor(0, stack.size(), [&](size_t i)
+            {
+                std::vector<StackEntry> subtreeStack = { stack[i] };
+                while (!subtreeStack.empty())
+                {
+                    StackEntry entry = subtreeStack.back();
+                    subtreeStack.pop_back();
+                    traverseNode(frustum, entry, subtreeStack, visible.data(), subtreeStats[i]);
+                }
+            }, 1);
+
+            for (const auto& s : subtreeStats)
+            {
+                stats.visibleCount += s.visibleCount;
+                stats.nodeTestCount += s.nodeTestCount;
+                stats.boxTestCount += s.boxTestCount;
+            }
+            return stats;
+        }
+
+        while (!stack.empty())
+        {
+            StackEntry entry = stack.back();
+            stack.pop_back();
+            traverseNode(frustum, entry, stack, visible.data(), stats);
+        }
+        return stats;
+    }
+}
@@ -0,0 +1,134 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Utils/Math/AABB.h"
+
+namespace Falcor
+{
+    /** Bounding volume hierarchy over instance bounding boxes for frustum culling on the CPU.
+        The hierarchy is built once with median splits and refitted when the instances move.
+        Culling traverses the upper levels of the tree serially and the subtrees below them in parallel.
+    */
+    class dlldecl InstanceBVH
+    {
+    public:
+        static const uint32_t kMaxLeafSize = 4;         ///< Maximum number of instances per leaf.
+        static const uint32_t kAllPlanesMask = 0x3f;    ///< Plane mask with the bits of all six frustum planes set.
+
+        /** View frustum given by six planes. A point p is inside a plane if dot(plane.xyz, p) + plane.w >= 0.
+        */
+        struct Frustum
+        {
+            float4 planes[6];
+
+            /** Create the frustum of a view-projection matrix with clip space depth range [0, 1].
+                The planes are stored in the order right, left, top, bottom, far, near.
+            */
+            static Frustum fromViewProjMatrix(const glm::mat4& viewProj);
+
+            /** Create the frustum containing the shadow casters of a shadow map rendered with a light view-projection matrix.
+                This is the view frustum extruded toward the light, i.e. without the near plane, as geometry between the light and
+                the near plane still casts shadows into the frustum (with its depth clamped to the near plane).
+            */
+            static Frustum fromShadowViewProjMatrix(const glm::mat4& lightViewProj);
+
+            /** Test a box against a subset of the planes.
+                \param[in] box Bounding box.
+                \param[in,out] planeMask Bit i is set if plane i is tested. On return, the bits of the planes the box is entirely inside of are cleared.
+                \return False if the box is entirely outside one of the tested planes.
+            */
+            bool intersects(const AABB& box, uint32_t& planeMask) const;
+
+            /** Check if a box is entirely outside the frustum.
+                The test is conservative, boxes outside of the frustum near its corners may not be culled.
+            */
+            bool isCulled(const AABB& box) const { uint32_t planeMask = kAllPlanesMask; return !intersects(box, planeMask); }
+        };
+
+        /** Statistics of a culling query.
+        */
+        struct CullStats
+        {
+            uint32_t visibleCount = 0;      ///< Number of instances that passed the test.
+            uint32_t nodeTestCount = 0;     ///< Number of BVH nodes tested against the frustum.
+            uint32_t boxTestCount = 0;      ///< Number of instance bounding boxes tested against the frustum.
+        };
+
+        /** Build the hierarchy.
+            \param[in] bounds World space bounding box per instance.
+        */
+        void build(const std::vector<AABB>& bounds);
+
+        /** Update the node bounds for moved instances, keeping the tree topology.
+            \param[in] bounds World space bounding box per instance. Must have the same size as the bounds the hierarchy was built with.
+        */
+        void refit(const std::vector<AABB>& bounds);
+
+        /** Find the instances that are not entirely outside a frustum.
+            \param[in] frustum Frustum to test against.
+            \param[out] visible Flag per instance, set to 1 if the instance's bounding box passed the test and 0 otherwise.
+            \return Statistics of the query.
+        */
+        CullStats cull(const Frustum& frustum, std::vector<uint8_t>& visible) const;
+
+        /** Get the number of instances.
+        */
+        uint32_t getInstanceCount() const { return (uint32_t)mInstanceBounds.size(); }
+
+        /** Get the number of BVH nodes.
+        */
+        uint32_t getNodeCount() const { return (uint32_t)mNodes.size(); }
+
+    private:
+        /** BVH node. Nodes are stored in depth-first order, so the left child of an inner node directly follows it
+            and the instances of every subtree form a contiguous range in mInstanceIDs.
+        */
+        struct Node
+        {
+            AABB bounds;
+            uint32_t firstInstance = 0;     ///< Index of the first instance of the subtree in mInstanceIDs.
+            uint32_t instanceCount = 0;     ///< Number of instances in the subtree.
+            uint32_t rightChild = 0;        ///< Index of the right child, or 0 if the node is a leaf.
+        };
+
+        /** Entry in the traversal stack, a node with the planes its parent was not entirely inside of.
+        */
+        struct StackEntry
+        {
+            uint32_t nodeIndex;
+            uint32_t planeMask;
+        };
+
+        uint32_t buildRecursive(uint32_t begin, uint32_t end, const std::vector<float3>& centroids);
+        void traverseNode(const Frustum& frustum, const StackEntry& entry, std::vector<StackEntry>& stack, uint8_t* visible, CullStats& stats) const;
+
+        std::vector<Node> mNodes;
+        std::vector<uint32_t> mInstanceIDs;     ///< Instance IDs in leaf order.
+        std::vector<AABB> mInstanceBounds;      ///< Bounding box per instance.
+    };
+}
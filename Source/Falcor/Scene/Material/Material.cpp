@@ -461,6 +461,49 @@ namespace Falcor
         return true;
     }
 
+    size_t Material::getHash() const
+    {
+        // FNV-1a style hashing of 32-bit words.
+        uint64_t h = 0xcbf29ce484222325ull;
+        auto mix = [&h](uint32_t k) { h = (h ^ k) * 0x100000001b3ull; };
+        auto mixFloats = [&mix](const float* pData, size_t count)
+        {
+            // Adding zero maps -0 to +0, as they compare equal.
+            for (size_t i = 0; i < count; i++) mix(asuint(pData[i] + 0.f));
+        };
+        auto mixPointer = [&mix](const void* ptr)
+        {
+            uint64_t bits = reinterpret_cast<uintptr_t>(ptr);
+            mix((uint32_t)bits);
+            mix((uint32_t)(bits >> 32));
+        };
+
+        mixFloats(&mData.baseColor.x, 4);
+        mixFloats(&mData.specular.x, 4);
+        mixFloats(&mData.emissive.x, 3);
+        mixFloats(&mData.emissiveFactor, 1);
+        mixFloats(&mData.alphaThreshold, 1);
+        mixFloats(&mData.IoR, 1);
+        mixFloats(&mData.specularTransmission, 1);
+        mix(mData.flags);
+        mixFloats(&mData.volumeAbsorption.x, 3);
+
+        mixPointer(mResources.baseColor.get());
+        mixPointer(mResources.specular.get());
+        mixPointer(mResources.emissive.get());
+        mixPointer(mResources.normalMap.get());
+        mixPointer(mResources.occlusionMap.get());
+        mixPointer(mResources.specularTransmission.get());
+        mixPointer(mResources.displacementMap.get());
+        mixPointer(mResources.samplerState.get());
+
+        const glm::mat4 textureTransform = mTextureTransform.getMatrix();
+        mixFloats(&textureTransform[0].x, 16);
+        mix(mOcclusionMapEnabled ? 1 : 0);
+
+        return (size_t)h;
+    }
+
     void Material::markUpdates(UpdateFlags updates)
     {
         mUpdates |= updates;
@@ -348,6 +348,11 @@ namespace Falcor
         */
         bool operator==(const Material& other) const;
 
+        /** Get a hash of the material properties.
+            The hash covers the same properties as operator==, so materials that compare equal have the same hash.
+        */
+        size_t getHash() const;
+
         /** Bind a sampler to the material
         */
         void setSampler(Sampler::SharedPtr pSampler);
@@ -397,6 +402,8 @@ namespace Falcor
         bool mOcclusionMapEnabled = false;
         mutable UpdateFlags mUpdates = UpdateFlags::None;
         static UpdateFlags sGlobalUpdates;
+
+        friend class SceneCache;
     };
 
     enum_class_operators(Material::UpdateFlags);
@@ -27,11 +27,105 @@
  **************************************************************************/
 #include "stdafx.h"
 #include "MaterialTextureLoader.h"
+#include "Core/Platform/MemoryMappedFile.h"
+#include "Utils/Image/TexturePreprocessor.h"
+#include <filesystem>
 
 namespace Falcor
 {
-    MaterialTextureLoader::MaterialTextureLoader(bool useSrgb)
+    namespace
+    {
+        const size_t kSampleHashSize = 64 * 1024; ///< Number of bytes hashed at the start and the end of a file when comparing files.
+
+        /** Compute a 64-bit FNV-1a style hash of a block of memory, processing 8 bytes at a time.
+        */
+        uint64_t hashMemory(const void* pData, size_t size)
+        {
+            const uint8_t* pBytes = static_cast<const uint8_t*>(pData);
+            uint64_t h = 0xcbf29ce484222325ull;
+            size_t i = 0;
+            for (; i + 8 <= size; i += 8)
+            {
+                uint64_t k;
+                std::memcpy(&k, pBytes + i, sizeof(k));
+                h = (h ^ k) * 0x100000001b3ull;
+            }
+            for (; i < size; i++) h = (h ^ pBytes[i]) * 0x100000001b3ull;
+            return h;
+        }
+
+        /** Compute a hash of the start and the end of a file. Image files with the same size differ early in practice,
+            and files with matching hashes are compared in full, so there is no need to read all of each file.
+        */
+        uint64_t getContentHash(const std::string& fullPath)
+        {
+            uint64_t hash = 0;
+            if (auto pFile = MemoryMappedFile::open(fullPath))
+            {
+                const uint8_t* pData = static_cast<const uint8_t*>(pFile->getData());
+                const size_t size = pFile->getSize();
+                if (size <= 2 * kSampleHashSize) hash = hashMemory(pData, size);
+                else hash = hashMemory(pData, kSampleHashSize) ^ (hashMemory(pData + size - kSampleHashSize, kSampleHashSize) * 31);
+            }
+            return hash;
+        }
+
+        bool isSameContent(const std::string& fullPathA, const std::string& fullPathB)
+        {
+            auto pFileA = MemoryMappedFile::open(fullPathA);
+            auto pFileB = MemoryMappedFile::open(fullPathB);
+            if (!pFileA || !pFileB || pFileA->getSize() != pFileB->getSize()) return false;
+            return pFileA->getSize() == 0 || std::memcmp(pFileA->getData(), pFileB->getData(), pFileA->getSize()) == 0;
+        }
+
+        TexturePreprocessor::Usage getTextureUsage(Material::TextureSlot slot)
+        {
+            switch (slot)
+            {
+            case Material::TextureSlot::Specular:
+                return TexturePreprocessor::Usage::PackedData;
+            case Material::TextureSlot::Normal:
+                return TexturePreprocessor::Usage::Normal;
+            case Material::TextureSlot::Occlusion:
+            case Material::TextureSlot::Displacement:
+                return TexturePreprocessor::Usage::Scalar;
+            default:
+                return TexturePreprocessor::Usage::Color;
+            }
+        }
+
+        /** Returns true if the alpha channel of the texture in the given slot is used for shading.
+        */
+        bool isAlphaUsed(Material::TextureSlot slot)
+        {
+            return slot == Material::TextureSlot::BaseColor || slot == Material::TextureSlot::Specular;
+        }
+
+        /** Get the load priority of a texture file. Large textures are loaded first to reduce the time spent waiting for the last few textures.
+        */
+        uint64_t getLoadPriority(const std::string& path)
+        {
+            std::error_code ec;
+            uint64_t size = std::filesystem::file_size(path, ec);
+            return ec ? 0 : size;
+        }
+
+        /** Convert a texture to a block compressed DDS file. Throws an exception on failure.
+        */
+        void convertTexture(const std::string& sourcePath, Material::TextureSlot slot, bool srgb, const std::string& filename)
+        {
+            auto pBitmap = Bitmap::createFromFile(sourcePath, true);
+            if (!pBitmap) throw std::exception(("Failed to load '" + sourcePath + "'").c_str());
+
+            bool hasAlpha = isAlphaUsed(slot) && TexturePreprocessor::hasNonOpaqueAlpha(*pBitmap);
+            auto mode = TexturePreprocessor::getCompressionMode(getTextureUsage(slot), pBitmap->getFormat(), pBitmap->getWidth(), pBitmap->getHeight(), hasAlpha, srgb);
+            TexturePreprocessor::convert(*pBitmap, mode, srgb, filename);
+        }
+    }
+
+    MaterialTextureLoader::MaterialTextureLoader(bool useSrgb, bool compressTextures)
         : mUseSrgb(useSrgb)
+        , mCompressTextures(compressTextures)
     {
     }
 
@@ -53,20 +147,119 @@ namespace Falcor
             return;
         }
 
-        TextureKey textureKey{fullPath, srgb};
+        // Use the first requested file with identical contents, so that each image is only loaded once.
+        std::string loadPath = getCanonicalPath(fullPath);
 
-        // Load texture if not already requested before.
-        if (mRequestedTextures.find(textureKey) == mRequestedTextures.end())
+        // Redirect to the converted texture in the texture cache. Missing or outdated files are converted before loading.
+        if (mCompressTextures && !hasSuffix(loadPath, ".dds", false))
         {
-            mRequestedTextures[textureKey] = mAsyncTextureLoader.loadFromFile(fullPath, true, srgb);
+            std::string variant = "slot" + std::to_string((uint32_t)slot) + (srgb ? "-srgb" : "");
+            std::string cacheFilename = TexturePreprocessor::getCacheFilename(loadPath, variant);
+            if (mPendingConversions.find(cacheFilename) == mPendingConversions.end() && !TexturePreprocessor::isCacheValid(loadPath, cacheFilename))
+            {
+                mPendingConversions[cacheFilename] = TextureConversion{ loadPath, slot, srgb };
+            }
+            loadPath = cacheFilename;
+        }
+
+        TextureKey textureKey{loadPath, srgb};
+
+        // Load texture if not already requested before. Textures pending conversion are requested in assignTextures().
+        if (mRequestedTextures.find(textureKey) == mRequestedTextures.end() && mPendingConversions.find(loadPath) == mPendingConversions.end())
+        {
+            mRequestedTextures[textureKey] = mAsyncTextureLoader.loadFromFile(loadPath, true, srgb, Resource::BindFlags::ShaderResource, getLoadPriority(loadPath));
         }
 
         // Store assignment to material for later.
         mTextureAssignments.emplace_back(TextureAssignment{ pMaterial, slot, textureKey });
     }
 
+    const std::string& MaterialTextureLoader::getCanonicalPath(const std::string& fullPath)
+    {
+        if (auto it = mCanonicalPaths.find(fullPath); it != mCanonicalPaths.end()) return it->second;
+
+        std::error_code ec;
+        uint64_t size = std::filesystem::file_size(fullPath, ec);
+        if (ec) return mCanonicalPaths[fullPath] = fullPath;
+
+        // Only files of the same size can be identical. The first file of each size is not read until a second file of that size is requested.
+        auto [firstIt, isFirst] = mUnhashedFilesBySize.try_emplace(size, fullPath);
+        if (isFirst) return mCanonicalPaths[fullPath] = fullPath;
+
+        if (!firstIt->second.empty())
+        {
+            mUniqueFilesByContent[{ size, getContentHash(firstIt->second) }].push_back(firstIt->second);
+            firstIt->second.clear();
+        }
+
+        // Files with the same size and sampled hash are compared in full. Different files only get here on a hash collision.
+        auto& candidates = mUniqueFilesByContent[{ size, getContentHash(fullPath) }];
+        for (const auto& candidate : candidates)
+        {
+            if (isSameContent(candidate, fullPath))
+            {
+                mDuplicateFileCount++;
+                return mCanonicalPaths[fullPath] = candidate;
+            }
+        }
+
+        candidates.push_back(fullPath);
+        return mCanonicalPaths[fullPath] = fullPath;
+    }
+
+    void MaterialTextureLoader::convertTextures()
+    {
+        if (mPendingConversions.empty()) return;
+
+        auto startTime = CpuTimer::getCurrentTimePoint();
+
+        std::vector<std::pair<std::string, TextureConversion>> conversions(mPendingConversions.begin(), mPendingConversions.end());
+        std::vector<std::string> errors(conversions.size());
+
+        // Convert textures in parallel. The conversion of each texture is single threaded.
+        Threading::parallelFor(0, conversions.size(), [&](size_t i)
+        {
+            const auto& [filename, conversion] = conversions[i];
+            try
+            {
+                convertTexture(conversion.sourcePath, conversion.textureSlot, conversion.srgb, filename);
+            }
+            catch (const std::exception& e)
+            {
+                errors[i] = e.what();
+            }
+        }, 1);
+
+        // Request loading the converted textures. Fall back to the source image if the conversion failed.
+        size_t failedCount = 0;
+        for (size_t i = 0; i < conversions.size(); i++)
+        {
+            const auto& [filename, conversion] = conversions[i];
+            std::string loadPath = filename;
+            if (!errors[i].empty())
+            {
+                logWarning("Failed to convert texture '" + conversion.sourcePath + "': " + errors[i]);
+                loadPath = conversion.sourcePath;
+                failedCount++;
+            }
+            mRequestedTextures[TextureKey{filename, conversion.srgb}] = mAsyncTextureLoader.loadFromFile(loadPath, true, conversion.srgb, Resource::BindFlags::ShaderResource, getLoadPriority(loadPath));
+        }
+
+        double duration = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint()) * 1e-3;
+        logInfo("Converted " + std::to_string(conversions.size() - failedCount) + " textures to block compressed DDS files in " + std::to_string(duration) + " seconds.");
+
+        mPendingConversions.clear();
+    }
+
     void MaterialTextureLoader::assignTextures()
     {
+        if (mDuplicateFileCount > 0)
+        {
+            logInfo("Found " + std::to_string(mDuplicateFileCount) + " texture files with identical contents as other texture files. Each image is only loaded once.");
+        }
+
+        convertTextures();
+
         // Wait for all textures to be loaded.
         std::map<TextureKey, Texture::SharedPtr> loadedTextures;
         for (auto &[key, texture] : mRequestedTextures)
@@ -74,6 +267,13 @@ namespace Falcor
             loadedTextures[key] = texture.get();
         }
 
+        if (!mRequestedTextures.empty())
+        {
+            auto stats = mAsyncTextureLoader.getStats();
+            logInfo("Loaded " + std::to_string(stats.requestCount - stats.failedCount) + " textures (" + std::to_string(stats.decodedBytes >> 20) + " MB decoded, " +
+                std::to_string(stats.peakInFlightBytes >> 20) + " MB peak in flight). Decode " + std::to_string(stats.decodeTime) + " s, upload " + std::to_string(stats.uploadTime) + " s.");
+        }
+
         // Assign textures to materials.
         for (const auto& assignment : mTextureAssignments)
         {
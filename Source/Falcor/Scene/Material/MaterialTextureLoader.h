@@ -39,11 +39,28 @@ namespace Falcor
         material assignment is stored. When the client destroys the instance of the
         `MaterialTextureLoader`, it blocks until all textures are loaded and assigns
         them to the materials.
+
+        Texture files with identical contents are only loaded once, even if they are
+        stored under different filenames. Files are compared by size first. Files of the
+        same size are compared by a hash of their first and last 64 KB, and only files
+        with matching hashes are compared in full.
+
+        If texture compression is enabled, textures are loaded from block compressed DDS
+        files with a full mip chain created by the `TexturePreprocessor`. The format is chosen
+        based on the material slot, the color space and the image contents. Missing or outdated
+        DDS files are converted in parallel before the textures are loaded.
+
+        Textures are loaded in order of decreasing file size, so that the largest images are
+        not left to the end of the load.
     */
-    class MaterialTextureLoader
+    class dlldecl MaterialTextureLoader
     {
     public:
-        MaterialTextureLoader(bool useSrgb);
+        /** Constructor.
+            \param[in] useSrgb Load color textures as sRGB.
+            \param[in] compressTextures Load textures from block compressed DDS files in the texture cache, converting them if needed.
+        */
+        MaterialTextureLoader(bool useSrgb, bool compressTextures = false);
         ~MaterialTextureLoader();
 
         /** Request loading a material texture.
@@ -55,11 +72,21 @@ namespace Falcor
 
     private:
         void assignTextures();
+        void convertTextures();
+        const std::string& getCanonicalPath(const std::string& fullPath);
 
         bool mUseSrgb;
+        bool mCompressTextures;
 
         using TextureKey = std::pair<std::string, bool>; // filename, srgb
 
+        using ContentKey = std::pair<uint64_t, uint64_t>; // file size, sampled content hash
+
+        std::unordered_map<std::string, std::string> mCanonicalPaths;               ///< Map from texture file to the first requested file with identical contents.
+        std::unordered_map<uint64_t, std::string> mUnhashedFilesBySize;             ///< First requested file of each size. Cleared once a second file of that size is requested and the first file is hashed.
+        std::map<ContentKey, std::vector<std::string>> mUniqueFilesByContent;       ///< Requested files with unique contents, grouped by file size and sampled content hash.
+        size_t mDuplicateFileCount = 0;                                             ///< Number of requested files that are duplicates of other files.
+
         struct TextureAssignment
         {
             Material::SharedPtr pMaterial;
@@ -67,6 +94,14 @@ namespace Falcor
             TextureKey textureKey;
         };
 
+        struct TextureConversion
+        {
+            std::string sourcePath;
+            Material::TextureSlot textureSlot;
+            bool srgb;
+        };
+
+        std::map<std::string, TextureConversion> mPendingConversions;               ///< Textures to convert before loading, indexed by converted filename.
         std::map<TextureKey, std::future<Texture::SharedPtr>> mRequestedTextures;
         std::vector<TextureAssignment> mTextureAssignments;
         AsyncTextureLoader mAsyncTextureLoader;
@@ -0,0 +1,739 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "MeshOptimizer.h"
+#include <queue>
+#include <unordered_map>
+
+namespace Falcor
+{
+    namespace
+    {
+        // Parameters of the Forsyth vertex scoring function.
+        const uint32_t kMaxCacheSize = 32;      ///< Size of the simulated LRU cache used for scoring.
+        const uint32_t kMaxValence = 32;        ///< Valence scores are tabulated up to this number of remaining triangles.
+        const float kCacheDecayPower = 1.5f;
+        const float kLastTriangleScore = 0.75f;
+        const float kValenceBoostScale = 2.0f;
+        const float kValenceBoostPower = 0.5f;
+
+        const uint32_t kInvalidIndex = std::numeric_limits<uint32_t>::max();
+
+        // Tolerances for matching meshes up to a rigid transform. The position tolerance is relative to the mesh size.
+        // The precision is relative to the largest coordinate, as positions far from the origin are stored with fewer significant bits.
+        const float kRigidPositionTolerance = 1e-5f;
+        const float kRigidPositionPrecision = 4.f * std::numeric_limits<float>::epsilon();
+        const float kRigidDirectionTolerance = 1e-4f;
+
+        /** Create an orthonormal frame from three non-collinear points.
+        */
+        glm::mat3 createFrame(const float3& p0, const float3& p1, const float3& p2)
+        {
+            float3 e0 = glm::normalize(p1 - p0);
+            float3 e1 = glm::normalize(glm::cross(e0, p2 - p0));
+            float3 e2 = glm::cross(e0, e1);
+            return glm::mat3(e0, e1, e2);
+        }
+
+        // Minimum cosine of the angle between the normals of a triangle before and after an edge collapse.
+        const double kMinCollapseNormalCosine = 0.2;
+
+        bool isClose(const float3& a, const float3& b, float tolerance)
+        {
+            return glm::length(a - b) <= tolerance;
+        }
+
+        struct VertexScoreTable
+        {
+            float cache[kMaxCacheSize];
+            float valence[kMaxValence];
+
+            VertexScoreTable()
+            {
+                for (uint32_t i = 0; i < kMaxCacheSize; i++)
+                {
+                    // The three most recently used vertices get a fixed score, so that the next triangle does not prefer to reuse the last triangle's edge.
+                    cache[i] = i < 3 ? kLastTriangleScore : std::pow(1.f - float(i - 3) / float(kMaxCacheSize - 3), kCacheDecayPower);
+                }
+                valence[0] = 0.f;
+                for (uint32_t i = 1; i < kMaxValence; i++) valence[i] = kValenceBoostScale * std::pow(float(i), -kValenceBoostPower);
+            }
+
+            float score(uint32_t cachePosition, uint32_t remainingTriangles) const
+            {
+                // Vertices without remaining triangles are never considered again.
+                if (remainingTriangles == 0) return -1.f;
+                float s = cachePosition < kMaxCacheSize ? cache[cachePosition] : 0.f;
+                s += remainingTriangles < kMaxValence ? valence[remainingTriangles] : kValenceBoostScale * std::pow(float(remainingTriangles), -kValenceBoostPower);
+                return s;
+            }
+        };
+    }
+
+    namespace
+    {
+        /** Quadric error metric, i.e. the sum of the squared distances to a set of planes.
+            The error at a point x is x^T A x + 2 b^T x + c, where A is a symmetric 3x3 matrix.
+        */
+        struct Quadric
+        {
+            double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+            double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+            double c = 0.0;
+
+            /** Add the plane with unit normal n through the point p.
+            */
+            void addPlane(const glm::dvec3& n, const glm::dvec3& p)
+            {
+                double d = -glm::dot(n, p);
+                a00 += n.x * n.x; a01 += n.x * n.y; a02 += n.x * n.z;
+                a11 += n.y * n.y; a12 += n.y * n.z; a22 += n.z * n.z;
+                b0 += n.x * d; b1 += n.y * d; b2 += n.z * d;
+                c += d * d;
+            }
+
+            Quadric& operator+=(const Quadric& other)
+            {
+                a00 += other.a00; a01 += other.a01; a02 += other.a02;
+                a11 += other.a11; a12 += other.a12; a22 += other.a22;
+                b0 += other.b0; b1 += other.b1; b2 += other.b2;
+                c += other.c;
+                return *this;
+            }
+
+            double error(const glm::dvec3& p) const
+            {
+                double e = a00 * p.x * p.x + a11 * p.y * p.y + a22 * p.z * p.z
+                    + 2.0 * (a01 * p.x * p.y + a02 * p.x * p.z + a12 * p.y * p.z)
+                    + 2.0 * (b0 * p.x + b1 * p.y + b2 * p.z) + c;
+                return std::max(e, 0.0);
+            }
+        };
+
+        /** Edge collapse mesh simplification using quadric error metrics.
+
+            The vertices are welded by position. The welded vertices ("positions") are the nodes of the collapses,
+            and the original vertices at a position ("wedges") differ only by their attributes. A collapse moves
+            all wedges of a position onto the wedges of a neighboring position that they share an edge with, which
+            only exists if the collapse follows the seams between the wedges. Each position accumulates the planes of
+            its triangles, and the planes perpendicular to its border and seam edges, in a quadric. The error of a
+            collapse is the quadric error of both positions at the remaining position.
+        */
+        class MeshSimplifier
+        {
+        public:
+            MeshSimplifier(const std::vector<uint32_t>& indices, const std::vector<float3>& positions)
+                : mIndices(indices)
+            {
+                assert(indices.size() % 3 == 0);
+                const uint32_t vertexCount = (uint32_t)positions.size();
+                const uint32_t triangleCount = (uint32_t)(indices.size() / 3);
+
+                // Store the positions relative to the center of the mesh to reduce the cancellation in the quadric errors.
+                AABB bounds;
+                for (uint32_t index : indices)
+                {
+                    assert(index < vertexCount);
+                    bounds.include(positions[index]);
+                }
+                float3 center = bounds.valid() ? bounds.center() : float3(0.f);
+                mPositions.resize(vertexCount);
+                for (uint32_t i = 0; i < vertexCount; i++) mPositions[i] = glm::dvec3(positions[i] - center);
+
+                // Weld the vertices with identical positions by sorting them. Each position is represented by its first vertex.
+                std::vector<uint32_t> order(vertexCount);
+                for (uint32_t i = 0; i < vertexCount; i++) order[i] = i;
+                auto lessPosition = [&](uint32_t a, uint32_t b)
+                {
+                    const float3& pa = positions[a];
+                    const float3& pb = positions[b];
+                    if (pa.x != pb.x) return pa.x < pb.x;
+                    if (pa.y != pb.y) return pa.y < pb.y;
+                    if (pa.z != pb.z) return pa.z < pb.z;
+                    return a < b;
+                };
+                std::sort(order.begin(), order.end(), lessPosition);
+
+                mPositionId.resize(vertexCount);
+                for (uint32_t i = 0; i < vertexCount; i++)
+                {
+                    bool isSame = i > 0 && positions[order[i]] == positions[order[i - 1]];
+                    mPositionId[order[i]] = isSame ? mPositionId[order[i - 1]] : order[i];
+                }
+
+                mPositionTriangles.resize(vertexCount);
+                mQuadrics.resize(vertexCount);
+                mCollapsed.resize(vertexCount, false);
+                mTriangleAlive.resize(triangleCount, false);
+
+                // Triangles with repeated positions have no area and are removed.
+                std::unordered_map<uint64_t, uint32_t> wedgeEdgeCounts;
+                for (uint32_t t = 0; t < triangleCount; t++)
+                {
+                    uint32_t p0 = getPosition(t, 0), p1 = getPosition(t, 1), p2 = getPosition(t, 2);
+                    if (p0 == p1 || p1 == p2 || p2 == p0) continue;
+
+                    mTriangleAlive[t] = true;
+                    mTriangleCount++;
+
+                    glm::dvec3 n = getNormal(mPositions[p0], mPositions[p1], mPositions[p2]);
+                    double length = glm::length(n);
+                    for (uint32_t k = 0; k < 3; k++)
+                    {
+                        uint32_t p = getPosition(t, k);
+                        mPositionTriangles[p].push_back(t);
+                        if (length > 0.0) mQuadrics[p].addPlane(n / length, mPositions[p0]);
+                        wedgeEdgeCounts[getEdgeKey(mIndices[3 * t + k], mIndices[3 * t + (k + 1) % 3])]++;
+                    }
+                }
+
+                // Add the planes through the border and seam edges, perpendicular to the triangle. Both are edges with a single triangle on the same wedges.
+                for (uint32_t t = 0; t < triangleCount; t++)
+                {
+                    if (!mTriangleAlive[t]) continue;
+                    for (uint32_t k = 0; k < 3; k++)
+                    {
+                        uint32_t a = mIndices[3 * t + k];
+                        uint32_t b = mIndices[3 * t + (k + 1) % 3];
+                        if (wedgeEdgeCounts[getEdgeKey(a, b)] != 1) continue;
+
+                        uint32_t pa = mPositionId[a], pb = mPositionId[b];
+                        glm::dvec3 n = glm::cross(mPositions[pb] - mPositions[pa], getNormal(mPositions[getPosition(t, 0)], mPositions[getPosition(t, 1)], mPositions[getPosition(t, 2)]));
+                        double length = glm::length(n);
+                        if (length == 0.0) continue;
+                        mQuadrics[pa].addPlane(n / length, mPositions[pa]);
+                        mQuadrics[pb].addPlane(n / length, mPositions[pa]);
+                    }
+                }
+
+                for (uint32_t t = 0; t < triangleCount; t++)
+                {
+                    if (mTriangleAlive[t]) pushTriangleCollapses(t);
+                }
+            }
+
+            /** Collapse edges in order of increasing error until the triangle count is at most the target.
+                \return True if the target was reached, false if the next collapse exceeds the maximum error or no collapses are left.
+            */
+            bool run(uint32_t targetTriangleCount, double maxErrorSq)
+            {
+                while (mTriangleCount > targetTriangleCount && !mQueue.empty())
+                {
+                    Collapse collapse = mQueue.top();
+                    if (mCollapsed[collapse.from] || mCollapsed[collapse.to])
+                    {
+                        mQueue.pop();
+                        continue;
+                    }
+
+                    // The quadrics only grow, so the queued cost is a lower bound. Requeue the collapse if the cost has increased.
+                    double cost = getCollapseCost(collapse.from, collapse.to);
+                    if (cost > collapse.cost)
+                    {
+                        mQueue.pop();
+                        mQueue.push({ cost, collapse.from, collapse.to });
+                        continue;
+                    }
+
+                    if (cost > maxErrorSq) return false;
+                    mQueue.pop();
+
+                    // Invalid collapses are discarded. They are queued again when the neighborhood changes.
+                    if (!canCollapse(collapse.from, collapse.to)) continue;
+                    applyCollapse(collapse.from, collapse.to);
+                    mMaxCost = std::max(mMaxCost, cost);
+                }
+
+                return mTriangleCount <= targetTriangleCount;
+            }
+
+            uint32_t getTriangleCount() const { return mTriangleCount; }
+
+            float getError() const { return (float)std::sqrt(mMaxCost); }
+
+            std::vector<uint32_t> getIndices() const
+            {
+                std::vector<uint32_t> indices;
+                indices.reserve(mTriangleCount * 3);
+                for (size_t t = 0; t < mTriangleAlive.size(); t++)
+                {
+                    if (mTriangleAlive[t]) indices.insert(indices.end(), mIndices.begin() + 3 * t, mIndices.begin() + 3 * t + 3);
+                }
+                return indices;
+            }
+
+        private:
+            struct Collapse
+            {
+                double cost;
+                uint32_t from;
+                uint32_t to;
+
+                bool operator<(const Collapse& other) const { return cost > other.cost; } // Smallest cost at the top of the priority queue.
+            };
+
+            static uint64_t getEdgeKey(uint32_t a, uint32_t b)
+            {
+                return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+            }
+
+            static glm::dvec3 getNormal(const glm::dvec3& p0, const glm::dvec3& p1, const glm::dvec3& p2)
+            {
+                return glm::cross(p1 - p0, p2 - p0);
+            }
+
+            uint32_t getPosition(uint32_t triangle, uint32_t corner) const
+            {
+                return mPositionId[mIndices[3 * triangle + corner]];
+            }
+
+            double getCollapseCost(uint32_t from, uint32_t to) const
+            {
+                const glm::dvec3& p = mPositions[to];
+                return mQuadrics[from].error(p) + mQuadrics[to].error(p);
+            }
+
+            void pushTriangleCollapses(uint32_t triangle)
+            {
+                for (uint32_t k = 0; k < 3; k++)
+                {
+                    uint32_t a = getPosition(triangle, k);
+                    uint32_t b = getPosition(triangle, (k + 1) % 3);
+                    mQueue.push({ getCollapseCost(a, b), a, b });
+                    mQueue.push({ getCollapseCost(b, a), b, a });
+                }
+            }
+
+            /** Check that collapsing position 'from' onto position 'to' preserves the seams, borders and topology, and does not flip triangles.
+                On success, mWedgeMap holds the wedge of 'to' that each wedge of 'from' is moved to.
+            */
+            bool canCollapse(uint32_t from, uint32_t to)
+            {
+                mWedgeMap.clear();
+                mNeighbors.clear();
+
+                for (uint32_t t : mPositionTriangles[from])
+                {
+                    if (!mTriangleAlive[t]) continue;
+
+                    uint32_t k = getPosition(t, 0) == from ? 0 : getPosition(t, 1) == from ? 1 : 2;
+                    uint32_t wedge = mIndices[3 * t + k];
+                    uint32_t k1 = (k + 1) % 3, k2 = (k + 2) % 3;
+                    mNeighbors.push_back(getPosition(t, k1));
+                    mNeighbors.push_back(getPosition(t, k2));
+
+                    uint32_t target = getPosition(t, k1) == to ? mIndices[3 * t + k1] : getPosition(t, k2) == to ? mIndices[3 * t + k2] : kInvalidIndex;
+                    auto it = std::find_if(mWedgeMap.begin(), mWedgeMap.end(), [&](const auto& entry) { return entry.first == wedge; });
+                    if (it == mWedgeMap.end()) mWedgeMap.push_back({ wedge, target });
+                    else if (it->second == kInvalidIndex) it->second = target;
+                    else if (target != kInvalidIndex && target != it->second) return false; // The wedge shares edges with several wedges of 'to'.
+                }
+
+                // Each wedge must share an edge with a distinct wedge of 'to', otherwise the collapse would cross or merge seams.
+                for (size_t i = 0; i < mWedgeMap.size(); i++)
+                {
+                    if (mWedgeMap[i].second == kInvalidIndex) return false;
+                    for (size_t j = 0; j < i; j++)
+                    {
+                        if (mWedgeMap[i].second == mWedgeMap[j].second) return false;
+                    }
+                }
+
+                // Each neighbor is listed once per triangle of the edge to it. Border edges have one triangle, non-manifold edges more than two.
+                std::sort(mNeighbors.begin(), mNeighbors.end());
+                uint32_t sharedCount = 0;
+                bool isBorder = false;
+                for (size_t i = 0; i < mNeighbors.size();)
+                {
+                    size_t j = i;
+                    while (j < mNeighbors.size() && mNeighbors[j] == mNeighbors[i]) j++;
+                    uint32_t count = (uint32_t)(j - i);
+                    if (count > 2) return false;
+                    if (count == 1) isBorder = true;
+                    if (mNeighbors[i] == to) sharedCount = count;
+                    i = j;
+                }
+                if (sharedCount == 0) return false;
+
+                // Border vertices only collapse along the border.
+                if (isBorder && sharedCount != 1) return false;
+
+                // Link condition: the only common neighbors are the opposite vertices of the collapsed triangles.
+                mNeighbors.erase(std::unique(mNeighbors.begin(), mNeighbors.end()), mNeighbors.end());
+                uint32_t commonCount = 0;
+                for (uint32_t t : mPositionTriangles[to])
+                {
+                    if (!mTriangleAlive[t]) continue;
+                    for (uint32_t k = 0; k < 3; k++)
+                    {
+                        uint32_t p = getPosition(t, k);
+                        if (p == to || p == from || !std::binary_search(mNeighbors.begin(), mNeighbors.end(), p)) continue;
+                        // Count each common neighbor only once by marking it as visited.
+                        auto it = std::lower_bound(mNeighbors.begin(), mNeighbors.end(), p);
+                        mNeighbors.erase(it);
+                        commonCount++;
+                    }
+                }
+                if (commonCount != sharedCount) return false;
+
+                // Reject collapses that flip or degenerate the remaining triangles.
+                for (uint32_t t : mPositionTriangles[from])
+                {
+                    if (!mTriangleAlive[t]) continue;
+                    uint32_t p[3] = { getPosition(t, 0), getPosition(t, 1), getPosition(t, 2) };
+                    if (p[0] == to || p[1] == to || p[2] == to) continue;
+
+                    glm::dvec3 n0 = getNormal(mPositions[p[0]], mPositions[p[1]], mPositions[p[2]]);
+                    for (uint32_t k = 0; k < 3; k++) if (p[k] == from) p[k] = to;
+                    glm::dvec3 n1 = getNormal(mPositions[p[0]], mPositions[p[1]], mPositions[p[2]]);
+
+                    double l0 = glm::length(n0), l1 = glm::length(n1);
+                    if (l0 == 0.0) continue;
+                    if (l1 == 0.0 || glm::dot(n0, n1) < kMinCollapseNormalCosine * l0 * l1) return false;
+                }
+
+                return true;
+            }
+
+            /** Collapse position 'from' onto position 'to' using the wedge mapping computed by canCollapse().
+            */
+            void applyCollapse(uint32_t from, uint32_t to)
+            {
+                auto& toTriangles = mPositionTriangles[to];
+                for (uint32_t t : mPositionTriangles[from])
+                {
+                    if (!mTriangleAlive[t]) continue;
+
+                    if (getPosition(t, 0) == to || getPosition(t, 1) == to || getPosition(t, 2) == to)
+                    {
+                        mTriangleAlive[t] = false;
+                        mTriangleCount--;
+                        continue;
+                    }
+
+                    for (uint32_t k = 0; k < 3; k++)
+                    {
+                        uint32_t& index = mIndices[3 * t + k];
+                        if (mPositionId[index] != from) continue;
+                        auto it = std::find_if(mWedgeMap.begin(), mWedgeMap.end(), [&](const auto& entry) { return entry.first == index; });
+                        assert(it != mWedgeMap.end());
+                        index = it->second;
+                    }
+                    toTriangles.push_back(t);
+                }
+
+                mPositionTriangles[from] = {};
+                mQuadrics[to] += mQuadrics[from];
+                mCollapsed[from] = true;
+
+                toTriangles.erase(std::remove_if(toTriangles.begin(), toTriangles.end(), [&](uint32_t t) { return !mTriangleAlive[t]; }), toTriangles.end());
+                for (uint32_t t : toTriangles) pushTriangleCollapses(t);
+            }
+
+            std::vector<uint32_t> mIndices;                             ///< Triangle list indices of the wedges.
+            std::vector<glm::dvec3> mPositions;                         ///< Vertex positions relative to the mesh center.
+            std::vector<uint32_t> mPositionId;                          ///< Position (first vertex with the same position) of each vertex.
+            std::vector<std::vector<uint32_t>> mPositionTriangles;      ///< Triangles at each position. May contain removed triangles.
+            std::vector<Quadric> mQuadrics;                             ///< Quadric of each position.
+            std::vector<bool> mCollapsed;                               ///< True if the position has been collapsed onto another position.
+            std::vector<bool> mTriangleAlive;                           ///< True if the triangle has not been removed.
+            uint32_t mTriangleCount = 0;                                ///< Number of remaining triangles.
+            double mMaxCost = 0.0;                                      ///< Largest error of the applied collapses.
+            std::priority_queue<Collapse> mQueue;                       ///< Candidate collapses.
+
+            // Scratch data of canCollapse().
+            std::vector<std::pair<uint32_t, uint32_t>> mWedgeMap;
+            std::vector<uint32_t> mNeighbors;
+        };
+    }
+
+    MeshOptimizer::VertexCacheStats MeshOptimizer::analyzeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize)
+    {
+        assert(indices.size() % 3 == 0);
+        assert(cacheSize > 0);
+
+        VertexCacheStats stats;
+        stats.triangleCount = indices.size() / 3;
+
+        // A vertex is in the FIFO cache if it was inserted less than 'cacheSize' insertions ago.
+        // The timestamps start past the cache size so that all vertices initially miss.
+        std::vector<uint32_t> timestamps(vertexCount, 0);
+        uint32_t timestamp = cacheSize + 1;
+
+        for (uint32_t index : indices)
+        {
+            assert(index < vertexCount);
+            if (timestamps[index] == 0) stats.vertexCount++;
+            if (timestamp - timestamps[index] > cacheSize)
+            {
+                timestamps[index] = timestamp++;
+                stats.transformedVertexCount++;
+            }
+        }
+
+        return stats;
+    }
+
+    void MeshOptimizer::optimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertexCount)
+    {
+        assert(indices.size() % 3 == 0);
+        const size_t triangleCount = indices.size() / 3;
+        if (triangleCount == 0) return;
+
+        static const VertexScoreTable kScoreTable;
+
+        // Build vertex to triangle adjacency. Emitted triangles are removed from the lists, so the live
+        // part of each list is [triangleOffsets[v], triangleOffsets[v] + remainingTriangles[v]).
+        std::vector<uint32_t> remainingTriangles(vertexCount, 0);
+        for (uint32_t index : indices)
+        {
+            assert(index < vertexCount);
+            remainingTriangles[index]++;
+        }
+
+        std::vector<uint32_t> triangleOffsets(vertexCount);
+        uint32_t offset = 0;
+        for (uint32_t v = 0; v < vertexCount; v++)
+        {
+            triangleOffsets[v] = offset;
+            offset += remainingTriangles[v];
+        }
+
+        std::vector<uint32_t> adjacentTriangles(indices.size());
+        {
+            std::vector<uint32_t> fill = triangleOffsets;
+            for (size_t i = 0; i < indices.size(); i++) adjacentTriangles[fill[indices[i]]++] = (uint32_t)(i / 3);
+        }
+
+        // Initialize scores.
+        std::vector<uint32_t> cachePositions(vertexCount, kInvalidIndex);
+        std::vector<float> vertexScores(vertexCount);
+        for (uint32_t v = 0; v < vertexCount; v++) vertexScores[v] = kScoreTable.score(kInvalidIndex, remainingTriangles[v]);
+
+        std::vector<float> triangleScores(triangleCount);
+        std::vector<bool> emitted(triangleCount, false);
+        for (size_t t = 0; t < triangleCount; t++)
+        {
+            triangleScores[t] = vertexScores[indices[3 * t + 0]] + vertexScores[indices[3 * t + 1]] + vertexScores[indices[3 * t + 2]];
+        }
+
+        std::vector<uint32_t> optimizedIndices;
+        optimizedIndices.reserve(indices.size());
+
+        // The cache holds up to kMaxCacheSize entries, plus up to three entries pushed out by the emitted triangle.
+        std::vector<uint32_t> cache, nextCache;
+        cache.reserve(kMaxCacheSize + 3);
+        nextCache.reserve(kMaxCacheSize + 3);
+
+        // Start with the best scoring triangle. After that, candidates are only searched among the triangles adjacent to the cache,
+        // and a linear scan is used to find the next triangle when no candidate is left.
+        uint32_t bestTriangle = (uint32_t)std::distance(triangleScores.begin(), std::max_element(triangleScores.begin(), triangleScores.end()));
+        size_t scanPosition = 0;
+
+        for (size_t i = 0; i < triangleCount; i++)
+        {
+            if (bestTriangle == kInvalidIndex)
+            {
+                while (emitted[scanPosition]) scanPosition++;
+                bestTriangle = (uint32_t)scanPosition;
+            }
+
+            // Emit the triangle.
+            const uint32_t* pTriangle = &indices[3 * bestTriangle];
+            optimizedIndices.insert(optimizedIndices.end(), pTriangle, pTriangle + 3);
+            emitted[bestTriangle] = true;
+
+            // Remove the triangle from the adjacency lists of its vertices and move the vertices to the front of the cache.
+            nextCache.clear();
+            for (uint32_t j = 0; j < 3; j++)
+            {
+                const uint32_t v = pTriangle[j];
+                uint32_t* pBegin = &adjacentTriangles[triangleOffsets[v]];
+                uint32_t* pEnd = pBegin + remainingTriangles[v];
+                uint32_t* pIt = std::find(pBegin, pEnd, bestTriangle);
+                assert(pIt != pEnd);
+                *pIt = *(pEnd - 1);
+                remainingTriangles[v]--;
+
+                if (std::find(nextCache.begin(), nextCache.end(), v) == nextCache.end()) nextCache.push_back(v);
+            }
+            for (uint32_t v : cache)
+            {
+                if (v != pTriangle[0] && v != pTriangle[1] && v != pTriangle[2]) nextCache.push_back(v);
+            }
+
+            // Update the scores of the vertices in the cache, including the ones that were just evicted.
+            for (uint32_t j = 0; j < (uint32_t)nextCache.size(); j++)
+            {
+                const uint32_t v = nextCache[j];
+                cachePositions[v] = j < kMaxCacheSize ? j : kInvalidIndex;
+                vertexScores[v] = kScoreTable.score(cachePositions[v], remainingTriangles[v]);
+            }
+
+            // Update the scores of the live triangles adjacent to the cache and pick the best one.
+            bestTriangle = kInvalidIndex;
+            float bestScore = -1.f;
+            for (uint32_t v : nextCache)
+            {
+                const uint32_t* pBegin = &adjacentTriangles[triangleOffsets[v]];
+                for (const uint32_t* pIt = pBegin; pIt != pBegin + remainingTriangles[v]; pIt++)
+                {
+                    const uint32_t t = *pIt;
+                    const float score = vertexScores[indices[3 * t + 0]] + vertexScores[indices[3 * t + 1]] + vertexScores[indices[3 * t + 2]];
+                    triangleScores[t] = score;
+                    if (score > bestScore)
+                    {
+                        bestScore = score;
+                        bestTriangle = t;
+                    }
+                }
+            }
+
+            if (nextCache.size() > kMaxCacheSize) nextCache.resize(kMaxCacheSize);
+            std::swap(cache, nextCache);
+        }
+
+        assert(optimizedIndices.size() == indices.size());
+        indices = std::move(optimizedIndices);
+    }
+
+    std::vector<uint32_t> MeshOptimizer::optimizeVertexFetch(std::vector<uint32_t>& indices, uint32_t vertexCount)
+    {
+        std::vector<uint32_t> remap(vertexCount, kInvalidIndex);
+        uint32_t nextVertex = 0;
+
+        for (uint32_t& index : indices)
+        {
+            assert(index < vertexCount);
+            if (remap[index] == kInvalidIndex) remap[index] = nextVertex++;
+            index = remap[index];
+        }
+
+        // Place unreferenced vertices last.
+        for (uint32_t& r : remap)
+        {
+            if (r == kInvalidIndex) r = nextVertex++;
+        }
+        assert(nextVertex == vertexCount);
+
+        return remap;
+    }
+
+    std::vector<MeshOptimizer::SimplifiedMesh> MeshOptimizer::simplify(const std::vector<uint32_t>& indices, const std::vector<float3>& positions, const std::vector<uint32_t>& targetTriangleCounts, float maxError)
+    {
+        std::vector<SimplifiedMesh> levels;
+        if (indices.empty()) return levels;
+
+        MeshSimplifier simplifier(indices, positions);
+        const double maxErrorSq = double(maxError) * double(maxError);
+        size_t prevTriangleCount = indices.size() / 3;
+
+        // The levels are snapshots of a single simplification run, so the error is cumulative over the chain.
+        for (uint32_t targetTriangleCount : targetTriangleCounts)
+        {
+            bool reachedTarget = simplifier.run(targetTriangleCount, maxErrorSq);
+            if (simplifier.getTriangleCount() < prevTriangleCount)
+            {
+                levels.push_back({ simplifier.getIndices(), simplifier.getError() });
+                prevTriangleCount = simplifier.getTriangleCount();
+            }
+            if (!reachedTarget) break;
+        }
+
+        return levels;
+    }
+
+    bool MeshOptimizer::findRigidTransform(const std::vector<StaticVertexData>& src, const std::vector<StaticVertexData>& dst, glm::mat4& transform)
+    {
+        if (src.size() != dst.size() || src.empty()) return false;
+
+        // Exactly identical meshes map with the identity transform.
+        if (std::memcmp(src.data(), dst.data(), src.size() * sizeof(StaticVertexData)) == 0)
+        {
+            transform = glm::identity<glm::mat4>();
+            return true;
+        }
+
+        // Pick three well-separated source vertices: the first vertex, the vertex farthest away from it,
+        // and the vertex farthest away from the line through the first two.
+        const float3& p0 = src[0].position;
+        size_t i1 = 0, i2 = 0;
+        float maxDist = 0.f, maxArea = 0.f;
+        for (size_t i = 1; i < src.size(); i++)
+        {
+            float dist = glm::length(src[i].position - p0);
+            if (dist > maxDist) { maxDist = dist; i1 = i; }
+        }
+        if (!(maxDist > 0.f) || !std::isfinite(maxDist)) return false;
+
+        const float3 axis = (src[i1].position - p0) / maxDist;
+        for (size_t i = 1; i < src.size(); i++)
+        {
+            float area = glm::length(glm::cross(axis, src[i].position - p0));
+            if (area > maxArea) { maxArea = area; i2 = i; }
+        }
+        if (maxArea <= maxDist * kRigidPositionTolerance) return false; // All vertices are collinear.
+
+        float maxCoord = 0.f;
+        for (size_t i = 0; i < src.size(); i++)
+        {
+            for (uint32_t j = 0; j < 3; j++) maxCoord = std::max({ maxCoord, std::abs(src[i].position[j]), std::abs(dst[i].position[j]) });
+        }
+
+        // The precision of the positions limits how accurately the rotation can be determined from the three vertices.
+        // Account for this in the tolerances. It is negligible for meshes close to the origin.
+        const float precision = maxCoord * kRigidPositionPrecision;
+        const float positionTolerance = maxDist * kRigidPositionTolerance + precision * (1.f + 4.f * maxDist / maxArea);
+        const float directionTolerance = kRigidDirectionTolerance + 2.f * precision / maxArea;
+
+        // Rigid transforms preserve distances.
+        if (std::abs(glm::length(dst[i1].position - dst[0].position) - maxDist) > positionTolerance) return false;
+
+        // Compute the rotation between the frames defined by the three vertices, and the translation between the first vertices.
+        glm::mat3 srcFrame = createFrame(src[0].position, src[i1].position, src[i2].position);
+        glm::mat3 dstFrame = createFrame(dst[0].position, dst[i1].position, dst[i2].position);
+        glm::mat3 rotation = dstFrame * glm::transpose(srcFrame);
+        float3 translation = dst[0].position - rotation * src[0].position;
+
+        // Verify that all vertices are mapped correctly. The positions are compared relative to the first vertex,
+        // which avoids the cancellation in the translation for meshes far from the origin.
+        for (size_t i = 0; i < src.size(); i++)
+        {
+            const auto& s = src[i];
+            const auto& d = dst[i];
+            if (s.texCrd != d.texCrd || s.tangent.w != d.tangent.w) return false;
+            if (!isClose(rotation * (s.position - src[0].position), d.position - dst[0].position, positionTolerance)) return false;
+            if (!isClose(rotation * s.normal, d.normal, directionTolerance)) return false;
+            if (!isClose(rotation * float3(s.tangent.xyz), float3(d.tangent.xyz), directionTolerance)) return false;
+        }
+
+        transform = glm::mat4(rotation);
+        transform[3] = float4(translation, 1.f);
+        return true;
+    }
+}
@@ -0,0 +1,136 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "SceneTypes.slang"
+
+namespace Falcor
+{
+    /** Utility functions for optimizing triangle meshes for rendering performance and memory usage.
+        The index functions operate on 32-bit indexed triangle lists.
+    */
+    class dlldecl MeshOptimizer
+    {
+    public:
+        static const uint32_t kDefaultCacheSize = 16;   ///< Cache size used for the statistics. This is a conservative estimate for current GPUs.
+
+        /** Statistics of the post-transform vertex cache efficiency of an index buffer.
+        */
+        struct VertexCacheStats
+        {
+            uint64_t transformedVertexCount = 0;    ///< Number of vertex shader invocations (cache misses).
+            uint64_t triangleCount = 0;             ///< Number of triangles.
+            uint64_t vertexCount = 0;               ///< Number of unique vertices referenced by the triangles.
+
+            /** Average cache miss ratio, i.e. transformed vertices per triangle. The optimum is ~0.5 for regular grids and the worst case 3.0.
+            */
+            float getACMR() const { return triangleCount > 0 ? (float)transformedVertexCount / triangleCount : 0.f; }
+
+            /** Average transformed to vertex ratio, i.e. transformed vertices per unique vertex. The optimum is 1.0.
+            */
+            float getATVR() const { return vertexCount > 0 ? (float)transformedVertexCount / vertexCount : 0.f; }
+
+            VertexCacheStats& operator+=(const VertexCacheStats& other)
+            {
+                transformedVertexCount += other.transformedVertexCount;
+                triangleCount += other.triangleCount;
+                vertexCount += other.vertexCount;
+                return *this;
+            }
+        };
+
+        /** Simulate a FIFO post-transform vertex cache and compute the cache statistics for an index buffer.
+            \param[in] indices Triangle list indices.
+            \param[in] vertexCount Number of vertices. All indices must be smaller than this.
+            \param[in] cacheSize Number of entries in the simulated cache.
+            \return Cache statistics.
+        */
+        static VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize = kDefaultCacheSize);
+
+        /** Reorder the triangles to improve the post-transform vertex cache hit rate.
+            This implements Tom Forsyth's "Linear-Speed Vertex Cache Optimisation" algorithm, which is not tuned for a specific cache size.
+            The vertices of each triangle are kept in the same order, so the winding is unchanged.
+            \param[in,out] indices Triangle list indices.
+            \param[in] vertexCount Number of vertices. All indices must be smaller than this.
+        */
+        static void optimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertexCount);
+
+        /** Compute a vertex remapping that stores the vertices in the order they are first referenced by the indices, and update the indices accordingly.
+            Vertices that are not referenced are placed last in their original order, so the remapping is always a permutation.
+            \param[in,out] indices Triangle list indices.
+            \param[in] vertexCount Number of vertices. All indices must be smaller than this.
+            \return Remapping table where element i is the new location of vertex i.
+        */
+        static std::vector<uint32_t> optimizeVertexFetch(std::vector<uint32_t>& indices, uint32_t vertexCount);
+
+        /** Reorder vertex data according to a remapping table returned by optimizeVertexFetch().
+            \param[in,out] vertices Vertex data.
+            \param[in] remap Remapping table where element i is the new location of vertex i.
+        */
+        template<typename T>
+        static void remapVertices(std::vector<T>& vertices, const std::vector<uint32_t>& remap)
+        {
+            assert(vertices.size() == remap.size());
+            std::vector<T> remapped(vertices.size());
+            for (size_t i = 0; i < vertices.size(); i++) remapped[remap[i]] = vertices[i];
+            vertices = std::move(remapped);
+        }
+
+        /** A simplified level of detail of a triangle mesh.
+        */
+        struct SimplifiedMesh
+        {
+            std::vector<uint32_t> indices;  ///< Triangle list indices. These reference the vertices of the source mesh.
+            float error = 0.f;              ///< Upper bound on the distance from each remaining vertex to the planes of the source triangles and seams it replaces.
+        };
+
+        /** Generate a chain of simplified versions of a triangle mesh using quadric error metrics.
+            Triangles are removed by collapsing edges onto one of their vertices, so the simplified meshes reference a subset of the
+            source vertices and can share the vertex buffer with the source mesh. Vertices with the same position but different
+            attributes (normal or texture coordinate seams) are collapsed together and only along the seam, so seams are preserved.
+            Vertices on open borders only collapse along the border, and vertices with non-manifold edges are never collapsed.
+            \param[in] indices Triangle list indices.
+            \param[in] positions Vertex positions. All indices must be smaller than the number of positions.
+            \param[in] targetTriangleCounts Target triangle count of each level, in decreasing order.
+            \param[in] maxError Maximum error of the simplified meshes in the units of the positions.
+            \return Simplified meshes in order of decreasing detail. If a target cannot be reached within the maximum error, the last
+                returned level has more triangles than its target and the remaining levels are omitted. A level is only returned
+                if it has fewer triangles than the previous one.
+        */
+        static std::vector<SimplifiedMesh> simplify(const std::vector<uint32_t>& indices, const std::vector<float3>& positions, const std::vector<uint32_t>& targetTriangleCounts, float maxError);
+
+        /** Find a rigid transform (rotation and translation) that maps the vertices of one mesh onto the vertices of another mesh.
+            The vertices are matched by index. Positions, normals and tangents must match within a small tolerance relative to the mesh size,
+            texture coordinates and tangent signs must match exactly. Reflections and scaling are not considered rigid.
+            \param[in] src Source vertices.
+            \param[in] dst Destination vertices.
+            \param[out] transform Transform from the source to the destination mesh space.
+            \return True if the meshes are identical up to a rigid transform, false otherwise.
+        */
+        static bool findRigidTransform(const std::vector<StaticVertexData>& src, const std::vector<StaticVertexData>& dst, glm::mat4& transform);
+    };
+}
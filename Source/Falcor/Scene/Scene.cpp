@@ -31,21 +31,20 @@
 #include "Raytracing/RtProgramVars.h"
 #include <sstream>
 #include <numeric>
+#include <tuple>
+#include "glm/gtx/transform.hpp"
 
 namespace Falcor
 {
     static_assert(sizeof(MeshDesc) % 16 == 0, "MeshDesc size should be a multiple of 16");
     static_assert(sizeof(PackedStaticVertexData) % 16 == 0, "PackedStaticVertexData size should be a multiple of 16");
+    static_assert(sizeof(CompressedStaticVertexData) == 24, "CompressedStaticVertexData size should be 24B");
     static_assert(sizeof(PackedMeshInstanceData) % 16 == 0, "PackedMeshInstanceData size should be a multiple of 16");
     static_assert(sizeof(ProceduralPrimitiveData) % 16 == 0, "ProceduralPrimitiveData size should be a multiple of 16");
     static_assert(PackedMeshInstanceData::kMatrixBits + PackedMeshInstanceData::kMeshBits + PackedMeshInstanceData::kFlagsBits + PackedMeshInstanceData::kMaterialBits <= 64);
 
     namespace
     {
-        // Large scenes are split into multiple BLAS groups in order to reduce build memory usage.
-        // The target is max 0.5GB intermediate memory per BLAS group. Note that this is not a strict limit.
-        const size_t kMaxBLASBuildMemory = 1ull << 29;
-
         const std::string kParameterBlockName = "gScene";
         const std::string kMeshBufferName = "meshes";
         const std::string kMeshInstanceBufferName = "meshInstances";
@@ -89,6 +88,46 @@ namespace Falcor
         {
             return glm::determinant((glm::mat3)m) < 0.f;
         }
+
+        // Changed mesh instances closer than this are uploaded as a single range.
+        const uint32_t kMaxInstanceRangeGap = 64;
+
+        // Updates the mesh instance flags that depend on the instance transform. Returns true if the flags changed.
+        bool updateMeshInstanceFlags(MeshInstanceData& inst, const glm::mat4& transform, bool isObjectFrontFaceCW)
+        {
+            uint32_t prevFlags = inst.flags;
+
+            bool isTransformFlipped = doesTransformFlip(transform);
+            bool isWorldFrontFaceCW = isObjectFrontFaceCW ^ isTransformFlipped;
+
+            if (isTransformFlipped) inst.flags |= (uint32_t)MeshInstanceFlags::TransformFlipped;
+            else inst.flags &= ~(uint32_t)MeshInstanceFlags::TransformFlipped;
+
+            if (isObjectFrontFaceCW) inst.flags |= (uint32_t)MeshInstanceFlags::IsObjectFrontFaceCW;
+            else inst.flags &= ~(uint32_t)MeshInstanceFlags::IsObjectFrontFaceCW;
+
+            if (isWorldFrontFaceCW) inst.flags |= (uint32_t)MeshInstanceFlags::IsWorldFrontFaceCW;
+            else inst.flags &= ~(uint32_t)MeshInstanceFlags::IsWorldFrontFaceCW;
+
+            return inst.flags != prevFlags;
+        }
+
+        // Groups the instance IDs by the scene graph node transforming them. The instances of node i are instanceIDs[offsets[i]] to instanceIDs[offsets[i + 1] - 1].
+        template<typename InstanceData>
+        void groupInstancesByNode(const std::vector<InstanceData>& instances, size_t nodeCount, std::vector<uint32_t>& offsets, std::vector<uint32_t>& instanceIDs)
+        {
+            offsets.assign(nodeCount + 1, 0);
+            for (const auto& inst : instances)
+            {
+                assert(inst.globalMatrixID < nodeCount);
+                offsets[inst.globalMatrixID + 1]++;
+            }
+            for (size_t i = 0; i < nodeCount; i++) offsets[i + 1] += offsets[i];
+
+            std::vector<uint32_t> next(offsets.begin(), offsets.end() - 1);
+            instanceIDs.resize(instances.size());
+            for (uint32_t i = 0; i < (uint32_t)instances.size(); i++) instanceIDs[next[instances[i].globalMatrixID]++] = i;
+        }
     }
 
     const FileDialogFilterVec& Scene::getFileExtensionFilters()
@@ -120,6 +159,7 @@ namespace Falcor
         defines.add("SCENE_HAS_INDEXED_VERTICES", hasIndexBuffer() ? "1" : "0");
         defines.add("SCENE_HAS_16BIT_INDICES", mHas16BitIndices ? "1" : "0");
         defines.add("SCENE_HAS_32BIT_INDICES", mHas32BitIndices ? "1" : "0");
+        defines.add("SCENE_HAS_COMPRESSED_VERTICES", mHasCompressedVertices ? "1" : "0");
         defines.add(mHitInfo.getDefines());
         return defines;
     }
@@ -140,15 +180,39 @@ namespace Falcor
     {
         PROFILE("rasterizeScene");
 
+        if (is_set(flags, RenderFlags::NoFrustumCulling))
+        {
+            rasterizeDrawArgs(pContext, pState, pVars, nullptr, flags);
+        }
+        else
+        {
+            updateCameraDrawList(getCamera().get());
+            rasterizeDrawArgs(pContext, pState, pVars, &mCameraDrawList, flags);
+        }
+    }
+
+    void Scene::rasterize(RenderContext* pContext, GraphicsState* pState, GraphicsVars* pVars, const CulledDrawList& drawList, RenderFlags flags)
+    {
+        PROFILE("rasterizeScene");
+
+        rasterizeDrawArgs(pContext, pState, pVars, &drawList, flags);
+    }
+
+    void Scene::rasterizeDrawArgs(RenderContext* pContext, GraphicsState* pState, GraphicsVars* pVars, const CulledDrawList* pDrawList, RenderFlags flags)
+    {
         pVars->setParameterBlock("gScene", mpSceneBlock);
 
         bool overrideRS = !is_set(flags, RenderFlags::UserRasterizerState);
         auto pCurrentRS = pState->getRasterizerState();
         bool isIndexed = hasIndexBuffer();
 
-        for (const auto& draw : mDrawArgs)
+        assert(!pDrawList || pDrawList->mpBuffers.size() == mDrawArgs.size());
+        for (size_t i = 0; i < mDrawArgs.size(); i++)
         {
-            assert(draw.count > 0);
+            const auto& draw = mDrawArgs[i];
+            uint32_t drawCount = pDrawList ? pDrawList->mCounts[i] : draw.count;
+            Buffer* pDrawBuffer = pDrawList ? pDrawList->mpBuffers[i].get() : draw.pBuffer.get();
+            if (drawCount == 0) continue;
 
             // Set state.
             pState->setVao(draw.ibFormat == ResourceFormat::R16Uint ? mpVao16Bit : mpVao);
@@ -162,11 +226,11 @@ namespace Falcor
             // Draw the primitives.
             if (isIndexed)
             {
-                pContext->drawIndexedIndirect(pState, pVars, draw.count, draw.pBuffer.get(), 0, nullptr, 0);
+                pContext->drawIndexedIndirect(pState, pVars, drawCount, pDrawBuffer, 0, nullptr, 0);
             }
             else
             {
-                pContext->drawIndirect(pState, pVars, draw.count, draw.pBuffer.get(), 0, nullptr, 0);
+                pContext->drawIndirect(pState, pVars, drawCount, pDrawBuffer, 0, nullptr, 0);
             }
         }
 
@@ -299,63 +363,138 @@ namespace Falcor
         getCamera()->setShaderData(mpSceneBlock[kCamera]);
     }
 
-    void Scene::updateBounds()
+    void Scene::BoundsTree::init(uint32_t leafCount)
     {
-        const auto& globalMatrices = mpAnimationController->getGlobalMatrices();
+        leafOffset = 1;
+        while (leafOffset < leafCount) leafOffset <<= 1;
+        nodes.assign(2 * (size_t)leafOffset, AABB());
+        dirtyNodes.clear();
+    }
+
+    void Scene::BoundsTree::setLeaf(uint32_t leafIndex, const AABB& bounds)
+    {
+        uint32_t node = leafOffset + leafIndex;
+        assert(node < nodes.size());
+        nodes[node] = bounds;
+        if (node > 1) dirtyNodes.push_back(node >> 1);
+    }
 
-        mSceneBB = AABB();
-        for (const auto& inst : mMeshInstanceData)
+    void Scene::BoundsTree::refit()
+    {
+        // All leaves are on the same level, so the dirty nodes are refitted one level at a time from the bottom up.
+        // The list stays sorted when replacing each node by its parent, so duplicates are adjacent.
+        std::sort(dirtyNodes.begin(), dirtyNodes.end());
+        while (!dirtyNodes.empty() && dirtyNodes[0] > 0)
         {
-            const AABB& meshBB = mMeshBBs[inst.meshID];
-            const glm::mat4& transform = globalMatrices[inst.globalMatrixID];
-            mSceneBB |= meshBB.transform(transform);
+            dirtyNodes.erase(std::unique(dirtyNodes.begin(), dirtyNodes.end()), dirtyNodes.end());
+            for (auto& node : dirtyNodes)
+            {
+                nodes[node] = nodes[2 * node] | nodes[2 * node + 1];
+                node >>= 1;
+            }
         }
+        dirtyNodes.clear();
+    }
 
-        for (const auto& aabb : mCustomPrimitiveAABBs)
+    void Scene::initNodeInstances()
+    {
+        const size_t nodeCount = mSceneGraph.size();
+        groupInstancesByNode(mMeshInstanceData, nodeCount, mNodeMeshInstanceOffsets, mNodeMeshInstances);
+        groupInstancesByNode(mCurveInstanceData, nodeCount, mNodeCurveInstanceOffsets, mNodeCurveInstances);
+
+        // Create a bounds tree leaf for each node with geometry.
+        mNodeBoundsLeaf.assign(nodeCount, kInvalidNode);
+        mBoundsLeafNodes.clear();
+        for (uint32_t nodeID = 0; nodeID < (uint32_t)nodeCount; nodeID++)
         {
-            mSceneBB |= aabb;
+            bool hasMeshes = mNodeMeshInstanceOffsets[nodeID + 1] > mNodeMeshInstanceOffsets[nodeID];
+            bool hasCurves = mNodeCurveInstanceOffsets[nodeID + 1] > mNodeCurveInstanceOffsets[nodeID];
+            if (hasMeshes || hasCurves)
+            {
+                mNodeBoundsLeaf[nodeID] = (uint32_t)mBoundsLeafNodes.size();
+                mBoundsLeafNodes.push_back(nodeID);
+            }
         }
+        mBoundsTree.init((uint32_t)mBoundsLeafNodes.size());
+        mMeshInstanceBBs.resize(mMeshInstanceData.size());
 
-        for (const auto& inst : mCurveInstanceData)
+        // The bounds of skinned instances are the transformed bind pose bounds, which don't contain the deformed mesh.
+        mDynamicMeshInstances.clear();
+        for (uint32_t instanceID = 0; instanceID < (uint32_t)mMeshInstanceData.size(); instanceID++)
         {
-            const AABB& curveBB = mCurveBBs[inst.curveID];
-            const glm::mat4& transform = globalMatrices[inst.globalMatrixID];
-            mSceneBB |= curveBB.transform(transform);
+            if (mMeshHasDynamicData[mMeshInstanceData[instanceID].meshID]) mDynamicMeshInstances.push_back(instanceID);
         }
+    }
 
-        for (const auto& volume : mVolumes)
+    void Scene::updateChangedMatrixIDs()
+    {
+        mChangedMatrixIDs.clear();
+        for (const auto& range : mpAnimationController->getChangedMatrixRanges())
         {
-            mSceneBB |= volume->getBounds();
+            for (uint32_t matrixID = range.first; matrixID < range.second; matrixID++)
+            {
+                if (mpAnimationController->isMatrixChanged(matrixID)) mChangedMatrixIDs.push_back(matrixID);
+            }
         }
     }
 
-    void Scene::updateMeshInstances(bool forceUpdate)
+    void Scene::updateBounds(bool forceUpdate)
     {
-        bool dataChanged = false;
         const auto& globalMatrices = mpAnimationController->getGlobalMatrices();
 
-        for (auto& inst : mMeshInstanceData)
+        auto updateLeaf = [&](uint32_t leafIndex)
         {
-            uint32_t prevFlags = inst.flags;
+            uint32_t nodeID = mBoundsLeafNodes[leafIndex];
+            const glm::mat4& transform = globalMatrices[nodeID];
 
-            const glm::mat4& transform = globalMatrices[inst.globalMatrixID];
-            bool isTransformFlipped = doesTransformFlip(transform);
-            bool isObjectFrontFaceCW = getMesh(inst.meshID).isFrontFaceCW();
-            bool isWorldFrontFaceCW = isObjectFrontFaceCW ^ isTransformFlipped;
+            AABB nodeBB;
+            for (uint32_t i = mNodeMeshInstanceOffsets[nodeID]; i < mNodeMeshInstanceOffsets[nodeID + 1]; i++)
+            {
+                uint32_t instanceID = mNodeMeshInstances[i];
+                mMeshInstanceBBs[instanceID] = mMeshBBs[mMeshInstanceData[instanceID].meshID].transform(transform);
+                nodeBB |= mMeshInstanceBBs[instanceID];
+            }
+            for (uint32_t i = mNodeCurveInstanceOffsets[nodeID]; i < mNodeCurveInstanceOffsets[nodeID + 1]; i++)
+            {
+                const auto& inst = mCurveInstanceData[mNodeCurveInstances[i]];
+                nodeBB |= mCurveBBs[inst.curveID].transform(transform);
+            }
+            mBoundsTree.setLeaf(leafIndex, nodeBB);
+        };
 
-            if (isTransformFlipped) inst.flags |= (uint32_t)MeshInstanceFlags::TransformFlipped;
-            else inst.flags &= ~(uint32_t)MeshInstanceFlags::TransformFlipped;
+        if (forceUpdate)
+        {
+            for (uint32_t leafIndex = 0; leafIndex < (uint32_t)mBoundsLeafNodes.size(); leafIndex++) updateLeaf(leafIndex);
 
-            if (isObjectFrontFaceCW) inst.flags |= (uint32_t)MeshInstanceFlags::IsObjectFrontFaceCW;
-            else inst.flags &= ~(uint32_t)MeshInstanceFlags::IsObjectFrontFaceCW;
+            mCustomPrimitiveBB = AABB();
+            for (const auto& aabb : mCustomPrimitiveAABBs)
+            {
+                mCustomPrimitiveBB |= aabb;
+            }
+        }
+        else
+        {
+            for (uint32_t matrixID : mChangedMatrixIDs)
+            {
+                uint32_t leafIndex = mNodeBoundsLeaf[matrixID];
+                if (leafIndex != kInvalidNode) updateLeaf(leafIndex);
+            }
+        }
 
-            if (isWorldFrontFaceCW) inst.flags |= (uint32_t)MeshInstanceFlags::IsWorldFrontFaceCW;
-            else inst.flags &= ~(uint32_t)MeshInstanceFlags::IsWorldFrontFaceCW;
+        mBoundsTree.refit();
+        mSceneBB = mBoundsTree.getBounds() | mCustomPrimitiveBB;
 
-            dataChanged |= (inst.flags != prevFlags);
+        for (const auto& volume : mVolumes)
+        {
+            mSceneBB |= volume->getBounds();
         }
+    }
 
-        if (forceUpdate || dataChanged)
+    void Scene::updateMeshInstances(bool forceUpdate)
+    {
+        const auto& globalMatrices = mpAnimationController->getGlobalMatrices();
+
+        if (forceUpdate)
         {
             // Make sure the scene data fits in the packed format.
             size_t maxMatrices = 1 << PackedMeshInstanceData::kMatrixBits;
@@ -382,12 +521,45 @@ namespace Falcor
 
             for (size_t i = 0; i < mMeshInstanceData.size(); i++)
             {
-                mPackedMeshInstanceData[i].pack(mMeshInstanceData[i]);
+                auto& inst = mMeshInstanceData[i];
+                updateMeshInstanceFlags(inst, globalMatrices[inst.globalMatrixID], getMesh(inst.meshID).isFrontFaceCW());
+                mPackedMeshInstanceData[i].pack(inst);
             }
 
             size_t byteSize = sizeof(PackedMeshInstanceData) * mPackedMeshInstanceData.size();
             assert(mpMeshInstancesBuffer && mpMeshInstancesBuffer->getSize() == byteSize);
             mpMeshInstancesBuffer->setBlob(mPackedMeshInstanceData.data(), 0, byteSize);
+            return;
+        }
+
+        // Only instances transformed by a changed matrix can change. Repack the ones whose flags changed.
+        mChangedMeshInstanceIDs.clear();
+        for (uint32_t matrixID : mChangedMatrixIDs)
+        {
+            for (uint32_t i = mNodeMeshInstanceOffsets[matrixID]; i < mNodeMeshInstanceOffsets[matrixID + 1]; i++)
+            {
+                uint32_t instanceID = mNodeMeshInstances[i];
+                auto& inst = mMeshInstanceData[instanceID];
+                if (updateMeshInstanceFlags(inst, globalMatrices[matrixID], getMesh(inst.meshID).isFrontFaceCW()))
+                {
+                    mPackedMeshInstanceData[instanceID].pack(inst);
+                    mChangedMeshInstanceIDs.push_back(instanceID);
+                }
+            }
+        }
+
+        // Upload the changed ranges, merging instances that are close together.
+        std::sort(mChangedMeshInstanceIDs.begin(), mChangedMeshInstanceIDs.end());
+        size_t rangeStart = 0;
+        for (size_t i = 1; i <= mChangedMeshInstanceIDs.size(); i++)
+        {
+            if (i == mChangedMeshInstanceIDs.size() || mChangedMeshInstanceIDs[i] - mChangedMeshInstanceIDs[i - 1] > kMaxInstanceRangeGap)
+            {
+                uint32_t first = mChangedMeshInstanceIDs[rangeStart];
+                uint32_t count = mChangedMeshInstanceIDs[i - 1] + 1 - first;
+                mpMeshInstancesBuffer->setBlob(&mPackedMeshInstanceData[first], sizeof(PackedMeshInstanceData) * first, sizeof(PackedMeshInstanceData) * count);
+                rangeStart = i;
+            }
         }
     }
 
@@ -420,12 +592,14 @@ namespace Falcor
         mHitInfo.init(*this);
         initResources();
         mpAnimationController->animate(gpDevice->getRenderContext(), 0); // Requires Scene block to exist
+        initNodeInstances();
         updateMeshInstances(true);
 
         updateCurveInstances(true);
         updateProceduralPrimitives(true);
 
-        updateBounds();
+        updateBounds(true);
+        mInstanceBVH.build(mMeshInstanceBBs);
         createDrawList();
         if (mCameras.size() == 0)
         {
@@ -485,11 +659,20 @@ namespace Falcor
         s.instancedVertexCount = 0;
         s.instancedTriangleCount = 0;
 
+        s.meshLodCount = 0;
+        s.meshLodTriangleCount = 0;
+
         for (uint32_t meshID = 0; meshID < getMeshCount(); meshID++)
         {
             const auto& mesh = getMesh(meshID);
             s.uniqueVertexCount += mesh.vertexCount;
             s.uniqueTriangleCount += mesh.getTriangleCount();
+
+            for (uint32_t lod = 0; lod < getMeshLodCount(meshID); lod++)
+            {
+                s.meshLodCount++;
+                s.meshLodTriangleCount += getMeshLod(meshID, lod).indexCount / 3;
+            }
         }
         for (uint32_t instanceID = 0; instanceID < getMeshInstanceCount(); instanceID++)
         {
@@ -518,6 +701,23 @@ namespace Falcor
             s.instancedCurveSegmentCount += curve.getSegmentCount();
         }
 
+        // Calculate the cost of the partitioning of the static meshes into BLASes.
+        // This only considers static mesh groups, as they are pre-transformed to a common space.
+        std::vector<std::pair<AABB, uint64_t>> staticGroups;
+        for (const auto& meshGroup : mMeshGroups)
+        {
+            if (!meshGroup.isStatic) continue;
+            AABB bounds;
+            uint64_t triangleCount = 0;
+            for (uint32_t meshID : meshGroup.meshList)
+            {
+                bounds.include(mMeshBBs[meshID]);
+                triangleCount += mMeshDesc[meshID].getTriangleCount();
+            }
+            staticGroups.push_back({ bounds, triangleCount });
+        }
+        std::tie(s.blasPartitionSAHCost, s.blasPartitionOverlap) = calculateBlasPartitionCost(std::move(staticGroups));
+
         // Calculate memory usage.
         const auto& pIB = mpVao->getIndexBuffer();
         const auto& pVB = mpVao->getVertexBuffer(kStaticDataBufferIndex);
@@ -550,8 +750,7 @@ namespace Falcor
         s.geometryMemoryInBytes += pDrawID ? pDrawID->getSize() : 0;
         for (const auto& draw : mDrawArgs)
         {
-            assert(draw.pBuffer);
-            s.geometryMemoryInBytes += draw.pBuffer->getSize();
+            s.geometryMemoryInBytes += draw.pBuffer ? draw.pBuffer->getSize() : 0;
         }
         s.geometryMemoryInBytes += mpCurvesBuffer ? mpCurvesBuffer->getSize() : 0;
         s.geometryMemoryInBytes += mpCurveInstancesBuffer ? mpCurveInstancesBuffer->getSize() : 0;
@@ -559,6 +758,42 @@ namespace Falcor
         s.animationMemoryInBytes += getAnimationController()->getMemoryUsageInBytes();
     }
 
+    std::pair<double, double> Scene::calculateBlasPartitionCost(std::vector<std::pair<AABB, uint64_t>> groups)
+    {
+        double sahCost = 0.0;
+        double overlap = 0.0;
+
+        AABB totalBounds;
+        uint64_t totalTriangleCount = 0;
+        for (const auto& [bounds, triangleCount] : groups)
+        {
+            totalBounds.include(bounds);
+            totalTriangleCount += triangleCount;
+        }
+
+        const double totalArea = totalBounds.valid() ? totalBounds.area() : 0.0;
+        if (totalArea > 0.0 && totalTriangleCount > 0)
+        {
+            for (const auto& [bounds, triangleCount] : groups) sahCost += bounds.area() * triangleCount;
+            sahCost /= totalArea * totalTriangleCount;
+
+            // Sweep along x to only test groups whose bounds overlap in x.
+            std::sort(groups.begin(), groups.end(), [](const auto& a, const auto& b) { return a.first.minPoint.x < b.first.minPoint.x; });
+            for (size_t i = 0; i < groups.size(); i++)
+            {
+                for (size_t j = i + 1; j < groups.size() && groups[j].first.minPoint.x <= groups[i].first.maxPoint.x; j++)
+                {
+                    AABB overlapBounds = groups[i].first;
+                    overlapBounds.intersection(groups[j].first);
+                    if (overlapBounds.valid()) overlap += overlapBounds.area();
+                }
+            }
+            overlap /= totalArea;
+        }
+
+        return { sahCost, overlap };
+    }
+
     void Scene::updateMaterialStats()
     {
         auto& s = mSceneStats;
@@ -604,7 +839,9 @@ namespace Falcor
             s.blasMemoryInBytes += blas.blasByteSize;
         }
         if (mpBlasScratch) s.blasScratchMemoryInBytes += mpBlasScratch->getSize();
+        s.blasBuildPeakMemoryInBytes = mBlasBuildPeakMemory;
         if (mpBlasStaticWorldMatrices) s.blasScratchMemoryInBytes += mpBlasStaticWorldMatrices->getSize();
+        if (mpBlasVertexDecodeMatrices) s.blasScratchMemoryInBytes += mpBlasVertexDecodeMatrices->getSize();
     }
 
     void Scene::updateRaytracingTLASStats()
@@ -880,14 +1117,17 @@ namespace Falcor
     Scene::UpdateFlags Scene::update(RenderContext* pContext, double currentTime)
     {
         mUpdates = UpdateFlags::None;
+        mChangedMatrixIDs.clear();
         if (mpAnimationController->animate(pContext, currentTime))
         {
             mUpdates |= UpdateFlags::SceneGraphChanged;
-            for (const auto& inst : mMeshInstanceData)
+            updateChangedMatrixIDs();
+            for (uint32_t matrixID : mChangedMatrixIDs)
             {
-                if (mpAnimationController->isMatrixChanged(inst.globalMatrixID))
+                if (mNodeMeshInstanceOffsets[matrixID + 1] > mNodeMeshInstanceOffsets[matrixID])
                 {
                     mUpdates |= UpdateFlags::MeshesMoved;
+                    break;
                 }
             }
         }
@@ -902,6 +1142,18 @@ namespace Falcor
         {
             mTlasCache.clear();
             updateMeshInstances(false);
+            updateDrawList();
+        }
+
+        if (is_set(mUpdates, UpdateFlags::SceneGraphChanged | UpdateFlags::VolumesMoved | UpdateFlags::VolumeBoundsChanged))
+        {
+            updateBounds(false);
+        }
+
+        if (is_set(mUpdates, UpdateFlags::MeshesMoved))
+        {
+            mInstanceBVH.refit(mMeshInstanceBBs);
+            mCameraDrawListDirty = true;
         }
 
         // If a transform in the scene changed, update BLASes with skinned meshes
@@ -1087,6 +1339,8 @@ namespace Falcor
                 << "  Unique vertex count: " << s.uniqueVertexCount << std::endl
                 << "  Instanced triangle count: " << s.instancedTriangleCount << std::endl
                 << "  Instanced vertex count: " << s.instancedVertexCount << std::endl
+                << "  Mesh LOD count: " << s.meshLodCount << std::endl
+                << "  Mesh LOD triangle count: " << s.meshLodTriangleCount << std::endl
                 << "  Index  buffer memory: " << formatByteSize(s.indexMemoryInBytes) << std::endl
                 << "  Vertex buffer memory: " << formatByteSize(s.vertexMemoryInBytes) << std::endl
                 << "  Geometry data memory: " << formatByteSize(s.geometryMemoryInBytes) << std::endl
@@ -1108,11 +1362,36 @@ namespace Falcor
                 << "  BLAS count (compacted): " << s.blasCompactedCount << std::endl
                 << "  BLAS memory (final): " << formatByteSize(s.blasMemoryInBytes) << std::endl
                 << "  BLAS memory (scratch): " << formatByteSize(s.blasScratchMemoryInBytes) << std::endl
+                << "  BLAS build peak memory (planned): " << formatByteSize(s.blasBuildPeakMemoryInBytes) << std::endl
+                << "  BLAS partition SAH cost: " << s.blasPartitionSAHCost << std::endl
+                << "  BLAS partition overlap: " << s.blasPartitionOverlap << std::endl
                 << "  TLAS count: " << s.tlasCount << std::endl
                 << "  TLAS memory (final): " << formatByteSize(s.tlasMemoryInBytes) << std::endl
                 << "  TLAS memory (scratch): " << formatByteSize(s.tlasScratchMemoryInBytes) << std::endl
                 << std::endl;
 
+            // Culling stats.
+            const auto& c = mCullingStats;
+            oss << "Frustum culling stats:" << std::endl
+                << "  Visible instance count: " << c.visibleInstanceCount << " / " << c.instanceCount << std::endl
+                << "  BVH node tests: " << c.nodeTestCount << std::endl
+                << "  Bounding box tests: " << c.boxTestCount << std::endl
+                << "  Culling updates: " << c.updateCount << std::endl
+                << "  Culling time: " << std::fixed << std::setprecision(3) << c.cullTime << " ms" << std::endl
+                << std::defaultfloat << std::endl;
+
+            // Draw list stats.
+            const auto& d = mDrawListStats;
+            oss << "Draw list stats:" << std::endl;
+            for (const auto& bucket : d.buckets)
+            {
+                std::string ibFormat = bucket.ibFormat == ResourceFormat::R16Uint ? "16-bit" : bucket.ibFormat == ResourceFormat::R32Uint ? "32-bit" : "non-indexed";
+                oss << "  " << ibFormat << (bucket.ccw ? " CCW: " : " CW: ") << bucket.drawCount << " draws, " << bucket.materialCount << " materials" << std::endl;
+            }
+            oss << "  Winding updates: " << d.updateCount << std::endl
+                << "  Draws moved in last update: " << d.movedDrawCount << std::endl
+                << std::endl;
+
             // Material stats.
             oss << "Materials stats:" << std::endl
                 << "  Material count: " << s.materialCount << std::endl
@@ -1309,6 +1588,22 @@ namespace Falcor
         mCurrentViewpoint = index;
     }
 
+    Scene::MeshLod Scene::selectMeshLod(uint32_t meshID, float maxError) const
+    {
+        const auto& mesh = getMesh(meshID);
+        MeshLod selected = { mesh.ibOffset, mesh.indexCount, 0.f };
+
+        // The errors increase with the level, so the coarsest level within the bound is the last one.
+        for (uint32_t lod = 0; lod < getMeshLodCount(meshID); lod++)
+        {
+            const auto& meshLod = getMeshLod(meshID, lod);
+            if (meshLod.error > maxError) break;
+            selected = meshLod;
+        }
+
+        return selected;
+    }
+
     Material::SharedPtr Scene::getMaterialByName(const std::string& name) const
     {
         for (const auto& m : mMaterials)
@@ -1352,22 +1647,23 @@ namespace Falcor
         mBlasUpdateMode = mode;
     }
 
+    void Scene::setBlasBuildMemoryBudget(uint64_t budgetInBytes)
+    {
+        if (budgetInBytes != mBlasBuildMemoryBudget) mRebuildBlas = true;
+        mBlasBuildMemoryBudget = budgetInBytes;
+    }
+
     void Scene::createDrawList()
     {
         assert(mDrawArgs.empty());
-        auto pMatricesBuffer = mpSceneBlock->getBuffer("worldMatrices");
-        const glm::mat4* matrices = (glm::mat4*)pMatricesBuffer->map(Buffer::MapType::Read); // #SCENEV2 This will cause the pipeline to flush and sync, but it's probably not too bad as this only happens once
+        const auto& globalMatrices = mpAnimationController->getGlobalMatrices();
 
-        // Helper to create the draw-indirect buffer.
-        auto createDrawBuffer = [this](const auto& drawMeshes, bool ccw, ResourceFormat ibFormat = ResourceFormat::Unknown)
+        // Create a draw argument list per state bucket, ordered by index format and then by winding. See getDrawArgsIndex().
+        auto addDrawArgs = [this](ResourceFormat ibFormat)
         {
-            if (drawMeshes.size() > 0)
+            for (bool ccw : { true, false })
             {
                 DrawArgs draw;
-                draw.pBuffer = Buffer::create(sizeof(drawMeshes[0]) * drawMeshes.size(), Resource::BindFlags::IndirectArg, Buffer::CpuAccess::None, drawMeshes.data());
-                draw.pBuffer->setName("Scene draw buffer");
-                assert(drawMeshes.size() <= std::numeric_limits<uint32_t>::max());
-                draw.count = (uint32_t)drawMeshes.size();
                 draw.ccw = ccw;
                 draw.ibFormat = ibFormat;
                 mDrawArgs.push_back(draw);
@@ -1376,60 +1672,247 @@ namespace Falcor
 
         if (hasIndexBuffer())
         {
-            std::vector<D3D12_DRAW_INDEXED_ARGUMENTS> drawClockwiseMeshes[2], drawCounterClockwiseMeshes[2];
+            addDrawArgs(ResourceFormat::R16Uint);
+            addDrawArgs(ResourceFormat::R32Uint);
+        }
+        else
+        {
+            addDrawArgs(ResourceFormat::Unknown);
+        }
 
-            uint32_t instanceID = 0;
-            for (const auto& instance : mMeshInstanceData)
-            {
-                const auto& mesh = mMeshDesc[instance.meshID];
-                const auto& transform = matrices[instance.globalMatrixID];
-                bool use16Bit = mesh.use16BitIndices();
+        // Assign the mesh instances to the buckets using the host side transforms, so the GPU matrices don't have to be read back.
+        mMeshInstanceDrawArgs.resize(mMeshInstanceData.size());
+        for (uint32_t instanceID = 0; instanceID < (uint32_t)mMeshInstanceData.size(); instanceID++)
+        {
+            const auto& instance = mMeshInstanceData[instanceID];
+            uint32_t drawArgsIndex = getDrawArgsIndex(instance, globalMatrices[instance.globalMatrixID]);
+            mMeshInstanceDrawArgs[instanceID] = (uint8_t)drawArgsIndex;
+            mDrawArgs[drawArgsIndex].instanceIDs.push_back(instanceID);
+        }
 
-                D3D12_DRAW_INDEXED_ARGUMENTS draw;
-                draw.IndexCountPerInstance = mesh.indexCount;
-                draw.InstanceCount = 1;
-                draw.StartIndexLocation = mesh.ibOffset * (use16Bit ? 2 : 1);
-                draw.BaseVertexLocation = mesh.vbOffset;
-                draw.StartInstanceLocation = instanceID++;
+        auto drawOrder = [this](uint32_t a, uint32_t b) { return compareDrawOrder(a, b); };
+        for (uint32_t drawArgsIndex = 0; drawArgsIndex < (uint32_t)mDrawArgs.size(); drawArgsIndex++)
+        {
+            auto& instanceIDs = mDrawArgs[drawArgsIndex].instanceIDs;
+            std::sort(instanceIDs.begin(), instanceIDs.end(), drawOrder);
+            updateDrawArgs(drawArgsIndex);
+        }
+
+        updateDrawListStats();
+    }
+
+    void Scene::updateDrawList()
+    {
+        // Only the mesh instances whose flags changed in updateMeshInstances() can have changed winding.
+        const auto& globalMatrices = mpAnimationController->getGlobalMatrices();
+        mMovedDrawInstanceIDs.clear();
+        uint32_t dirtyDrawArgsMask = 0;
+
+        for (uint32_t instanceID : mChangedMeshInstanceIDs)
+        {
+            const auto& instance = mMeshInstanceData[instanceID];
+            uint32_t drawArgsIndex = getDrawArgsIndex(instance, globalMatrices[instance.globalMatrixID]);
+            uint32_t prevDrawArgsIndex = mMeshInstanceDrawArgs[instanceID];
+            if (drawArgsIndex == prevDrawArgsIndex) continue;
+
+            mMeshInstanceDrawArgs[instanceID] = (uint8_t)drawArgsIndex;
+            mMovedDrawInstanceIDs.push_back(instanceID);
+            dirtyDrawArgsMask |= (1u << prevDrawArgsIndex) | (1u << drawArgsIndex);
+        }
+
+        if (mMovedDrawInstanceIDs.empty()) return;
+
+        // Rebuild only the lists that lost or gained draws. The lists stay sorted by removing the instances that left and merging in the instances that arrived.
+        auto drawOrder = [this](uint32_t a, uint32_t b) { return compareDrawOrder(a, b); };
+        std::sort(mMovedDrawInstanceIDs.begin(), mMovedDrawInstanceIDs.end(), drawOrder);
+
+        for (uint32_t drawArgsIndex = 0; drawArgsIndex < (uint32_t)mDrawArgs.size(); drawArgsIndex++)
+        {
+            if ((dirtyDrawArgsMask & (1u << drawArgsIndex)) == 0) continue;
+
+            auto& instanceIDs = mDrawArgs[drawArgsIndex].instanceIDs;
+            instanceIDs.erase(std::remove_if(instanceIDs.begin(), instanceIDs.end(), [&](uint32_t instanceID) { return mMeshInstanceDrawArgs[instanceID] != drawArgsIndex; }), instanceIDs.end());
 
-                int i = use16Bit ? 0 : 1;
-                (doesTransformFlip(transform)) ? drawClockwiseMeshes[i].push_back(draw) : drawCounterClockwiseMeshes[i].push_back(draw);
+            size_t keptCount = instanceIDs.size();
+            for (uint32_t instanceID : mMovedDrawInstanceIDs)
+            {
+                if (mMeshInstanceDrawArgs[instanceID] == drawArgsIndex) instanceIDs.push_back(instanceID);
             }
+            std::inplace_merge(instanceIDs.begin(), instanceIDs.begin() + keptCount, instanceIDs.end(), drawOrder);
 
-            createDrawBuffer(drawClockwiseMeshes[0], false, ResourceFormat::R16Uint);
-            createDrawBuffer(drawClockwiseMeshes[1], false, ResourceFormat::R32Uint);
-            createDrawBuffer(drawCounterClockwiseMeshes[0], true, ResourceFormat::R16Uint);
-            createDrawBuffer(drawCounterClockwiseMeshes[1], true, ResourceFormat::R32Uint);
+            updateDrawArgs(drawArgsIndex);
         }
-        else
+
+        mDrawListStats.updateCount++;
+        mDrawListStats.movedDrawCount = (uint32_t)mMovedDrawInstanceIDs.size();
+        updateDrawListStats();
+    }
+
+    void Scene::updateDrawArgs(uint32_t drawArgsIndex)
+    {
+        auto& draw = mDrawArgs[drawArgsIndex];
+        assert(draw.instanceIDs.size() <= std::numeric_limits<uint32_t>::max());
+        draw.count = (uint32_t)draw.instanceIDs.size();
+        draw.materialCount = 0;
+        draw.indexedDraws.clear();
+        draw.draws.clear();
+
+        for (uint32_t i = 0; i < draw.count; i++)
         {
-            std::vector<D3D12_DRAW_ARGUMENTS> drawClockwiseMeshes, drawCounterClockwiseMeshes;
+            uint32_t instanceID = draw.instanceIDs[i];
+            const auto& instance = mMeshInstanceData[instanceID];
+            const auto& mesh = mMeshDesc[instance.meshID];
+
+            // The draws are sorted by material, so each material starts a new run.
+            if (i == 0 || instance.materialID != mMeshInstanceData[draw.instanceIDs[i - 1]].materialID) draw.materialCount++;
 
-            uint32_t instanceID = 0;
-            for (const auto& instance : mMeshInstanceData)
+            if (draw.ibFormat != ResourceFormat::Unknown)
+            {
+                bool use16Bit = mesh.use16BitIndices();
+                assert(use16Bit == (draw.ibFormat == ResourceFormat::R16Uint));
+
+                D3D12_DRAW_INDEXED_ARGUMENTS args;
+                args.IndexCountPerInstance = mesh.indexCount;
+                args.InstanceCount = 1;
+                args.StartIndexLocation = mesh.ibOffset * (use16Bit ? 2 : 1);
+                args.BaseVertexLocation = mesh.vbOffset;
+                args.StartInstanceLocation = instanceID;
+                draw.indexedDraws.push_back(args);
+            }
+            else
             {
-                const auto& mesh = mMeshDesc[instance.meshID];
-                const auto& transform = matrices[instance.globalMatrixID];
                 assert(mesh.indexCount == 0);
 
-                D3D12_DRAW_ARGUMENTS draw;
-                draw.VertexCountPerInstance = mesh.vertexCount;
-                draw.InstanceCount = 1;
-                draw.StartVertexLocation = mesh.vbOffset;
-                draw.StartInstanceLocation = instanceID++;
+                D3D12_DRAW_ARGUMENTS args;
+                args.VertexCountPerInstance = mesh.vertexCount;
+                args.InstanceCount = 1;
+                args.StartVertexLocation = mesh.vbOffset;
+                args.StartInstanceLocation = instanceID;
+                draw.draws.push_back(args);
+            }
+        }
+
+        if (draw.count == 0) return;
+
+        // Upload the draws. The buffer is only reallocated if the list grew beyond it.
+        bool isIndexed = draw.ibFormat != ResourceFormat::Unknown;
+        const void* pData = isIndexed ? (const void*)draw.indexedDraws.data() : (const void*)draw.draws.data();
+        size_t byteSize = (isIndexed ? sizeof(D3D12_DRAW_INDEXED_ARGUMENTS) : sizeof(D3D12_DRAW_ARGUMENTS)) * draw.count;
+        if (!draw.pBuffer || draw.pBuffer->getSize() < byteSize)
+        {
+            draw.pBuffer = Buffer::create(byteSize, Resource::BindFlags::IndirectArg, Buffer::CpuAccess::None, pData);
+            draw.pBuffer->setName("Scene draw buffer");
+        }
+        else
+        {
+            draw.pBuffer->setBlob(pData, 0, byteSize);
+        }
+    }
+
+    uint32_t Scene::getDrawArgsIndex(const MeshInstanceData& instance, const glm::mat4& transform) const
+    {
+        // Counterclockwise lists come first, the 32-bit index lists follow the 16-bit ones. See createDrawList().
+        uint32_t index = doesTransformFlip(transform) ? 1 : 0;
+        if (hasIndexBuffer() && !mMeshDesc[instance.meshID].use16BitIndices()) index += 2;
+        return index;
+    }
+
+    bool Scene::compareDrawOrder(uint32_t instanceA, uint32_t instanceB) const
+    {
+        const auto& a = mMeshInstanceData[instanceA];
+        const auto& b = mMeshInstanceData[instanceB];
+        return std::tie(a.materialID, a.meshID, instanceA) < std::tie(b.materialID, b.meshID, instanceB);
+    }
+
+    void Scene::updateDrawListStats()
+    {
+        mDrawListStats.buckets.resize(mDrawArgs.size());
+        for (size_t i = 0; i < mDrawArgs.size(); i++)
+        {
+            const auto& draw = mDrawArgs[i];
+            auto& bucket = mDrawListStats.buckets[i];
+            bucket.ibFormat = draw.ibFormat;
+            bucket.ccw = draw.ccw;
+            bucket.drawCount = draw.count;
+            bucket.materialCount = draw.materialCount;
+        }
+    }
+
+    InstanceBVH::CullStats Scene::cullDrawList(const InstanceBVH::Frustum& frustum, CulledDrawList& drawList)
+    {
+        PROFILE("cullDrawList");
+
+        auto cullStats = mInstanceBVH.cull(frustum, mMeshInstanceVisible);
 
-                (doesTransformFlip(transform)) ? drawClockwiseMeshes.push_back(draw) : drawCounterClockwiseMeshes.push_back(draw);
+        // Skinned instances can be deformed outside of their bounds, so they are always drawn.
+        for (uint32_t instanceID : mDynamicMeshInstances)
+        {
+            if (!mMeshInstanceVisible[instanceID]) cullStats.visibleCount++;
+            mMeshInstanceVisible[instanceID] = 1;
+        }
+
+        // Compact the draws to the visible instances. The instance ID is the start instance of the draw.
+        auto compactDraws = [this](const auto& draws, auto& culledDraws)
+        {
+            culledDraws.clear();
+            for (const auto& draw : draws)
+            {
+                if (mMeshInstanceVisible[draw.StartInstanceLocation]) culledDraws.push_back(draw);
             }
+            return (uint32_t)culledDraws.size();
+        };
+
+        drawList.mpBuffers.resize(mDrawArgs.size());
+        drawList.mCounts.resize(mDrawArgs.size());
+        drawList.mDrawCount = 0;
+
+        for (size_t i = 0; i < mDrawArgs.size(); i++)
+        {
+            const auto& draw = mDrawArgs[i];
+            bool isIndexed = draw.ibFormat != ResourceFormat::Unknown;
+            uint32_t count = isIndexed ? compactDraws(draw.indexedDraws, mCulledIndexedDraws) : compactDraws(draw.draws, mCulledDraws);
+            drawList.mCounts[i] = count;
+            drawList.mDrawCount += count;
+            if (count == 0) continue;
 
-            createDrawBuffer(drawClockwiseMeshes, false);
-            createDrawBuffer(drawCounterClockwiseMeshes, true);
+            // Size the buffer for all draws of the list, as the lists change when mesh instances change winding.
+            size_t stride = isIndexed ? sizeof(D3D12_DRAW_INDEXED_ARGUMENTS) : sizeof(D3D12_DRAW_ARGUMENTS);
+            auto& pBuffer = drawList.mpBuffers[i];
+            if (!pBuffer || pBuffer->getSize() < stride * count)
+            {
+                pBuffer = Buffer::create(stride * draw.count, Resource::BindFlags::IndirectArg, Buffer::CpuAccess::None);
+                pBuffer->setName("Scene culled draw buffer");
+            }
+            pBuffer->setBlob(isIndexed ? (const void*)mCulledIndexedDraws.data() : (const void*)mCulledDraws.data(), 0, stride * count);
         }
+
+        return cullStats;
+    }
+
+    void Scene::updateCameraDrawList(const Camera* pCamera)
+    {
+        const glm::mat4& viewProjMat = pCamera->getViewProjMatrix();
+        if (!mCameraDrawListDirty && viewProjMat == mCameraDrawListViewProjMat) return;
+
+        auto startTime = CpuTimer::getCurrentTimePoint();
+        auto cullStats = cullDrawList(InstanceBVH::Frustum::fromViewProjMatrix(viewProjMat), mCameraDrawList);
+
+        mCameraDrawListViewProjMat = viewProjMat;
+        mCameraDrawListDirty = false;
+
+        mCullingStats.instanceCount = getMeshInstanceCount();
+        mCullingStats.visibleInstanceCount = cullStats.visibleCount;
+        mCullingStats.nodeTestCount = cullStats.nodeTestCount;
+        mCullingStats.boxTestCount = cullStats.boxTestCount;
+        mCullingStats.updateCount++;
+        mCullingStats.cullTime = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
     }
 
     void Scene::initGeomDesc(RenderContext* pContext)
     {
         assert(mBlasData.empty());
         assert(!mpBlasStaticWorldMatrices);
+        assert(!mpBlasVertexDecodeMatrices);
 
         const VertexBufferLayout::SharedConstPtr& pVbLayout = mpVao->getVertexLayout()->getBufferLayout(kStaticDataBufferIndex);
         const Buffer::SharedPtr& pVb = mpVao->getVertexBuffer(kStaticDataBufferIndex);
@@ -1459,6 +1942,39 @@ namespace Falcor
             return mpBlasStaticWorldMatrices;
         };
 
+        auto getVertexDecodeMatricesBuffer = [&]()
+        {
+            // Compressed positions are stored as snorm16 relative to the mesh bounds, which the BLAS build reads natively.
+            // We let the BLAS build apply the decode transform (and the world transform for static meshes) per geometry.
+            // Like above, the matrices are stored transposed and created once since the mesh bounds and static transforms can't change.
+            if (!mpBlasVertexDecodeMatrices)
+            {
+                std::vector<glm::mat4> transposedMatrices(mMeshDesc.size());
+                for (const auto& meshGroup : mMeshGroups)
+                {
+                    for (uint32_t meshID : meshGroup.meshList)
+                    {
+                        const MeshDesc& mesh = mMeshDesc[meshID];
+                        glm::mat4 m = glm::translate(mesh.positionOffset) * glm::scale(mesh.positionScale);
+                        if (meshGroup.isStatic)
+                        {
+                            uint32_t instanceID = mMeshIdToInstanceIds[meshID][0];
+                            m = globalMatrices[mMeshInstanceData[instanceID].globalMatrixID] * m;
+                        }
+                        transposedMatrices[meshID] = glm::transpose(m);
+                    }
+                }
+
+                uint32_t float4Count = (uint32_t)transposedMatrices.size() * 4;
+                mpBlasVertexDecodeMatrices = Buffer::createStructured(sizeof(float4), float4Count, Resource::BindFlags::ShaderResource, Buffer::CpuAccess::None, transposedMatrices.data(), false);
+                mpBlasVertexDecodeMatrices->setName("Scene::mpBlasVertexDecodeMatrices");
+
+                // Transition the resource to non-pixel shader state as expected by DXR.
+                pContext->resourceBarrier(mpBlasVertexDecodeMatrices.get(), Resource::State::NonPixelShader);
+            }
+            return mpBlasVertexDecodeMatrices;
+        };
+
         assert(mMeshGroups.size() > 0);
         uint32_t totalBlasCount = (uint32_t)mMeshGroups.size() + (mpRtAABBBuffer ? 1 : 0); // If there are custom primitives, they are all placed in one more BLAS
         mBlasData.resize(totalBlasCount);
@@ -1483,7 +1999,12 @@ namespace Falcor
                 desc.Type = D3D12_RAYTRACING_GEOMETRY_TYPE_TRIANGLES;
                 desc.Triangles.Transform3x4 = 0; // The default is no transform
 
-                if (isStatic)
+                if (mHasCompressedVertices)
+                {
+                    // Compressed positions always need the decode transform, which includes the world transform for static meshes.
+                    desc.Triangles.Transform3x4 = getVertexDecodeMatricesBuffer()->getGpuAddress() + meshID * 64ull;
+                }
+                else if (isStatic)
                 {
                     // Static meshes will be pre-transformed when building the BLAS.
                     // Lookup the matrix ID here. If it is an identity matrix, no action is needed.
@@ -1508,7 +2029,8 @@ namespace Falcor
                 desc.Triangles.VertexBuffer.StartAddress = pVb->getGpuAddress() + (mesh.vbOffset * pVbLayout->getStride());
                 desc.Triangles.VertexBuffer.StrideInBytes = pVbLayout->getStride();
                 desc.Triangles.VertexCount = mesh.vertexCount;
-                desc.Triangles.VertexFormat = getDxgiFormat(pVbLayout->getElementFormat(0));
+                // The compressed position is 3x snorm16 followed by 16 bits of padding. The fourth component is ignored by the BLAS build.
+                desc.Triangles.VertexFormat = mHasCompressedVertices ? DXGI_FORMAT_R16G16B16A16_SNORM : getDxgiFormat(pVbLayout->getElementFormat(0));
 
                 // Set index data
                 if (pIb)
@@ -1630,33 +2152,39 @@ namespace Falcor
     void Scene::computeBlasGroups()
     {
         mBlasGroups.clear();
-        uint64_t groupSize = 0;
 
-        for (uint32_t blasId = 0; blasId < mBlasData.size(); blasId++)
+        // Large scenes are split into multiple BLAS groups in order to reduce build memory usage.
+        // The groups share the result and scratch buffers, so the planner packs them to fit the largest result plus the largest scratch into the budget.
+        std::vector<BlasBuildPlanner::BlasSize> blasSizes(mBlasData.size());
+        for (size_t blasId = 0; blasId < mBlasData.size(); blasId++)
         {
-            auto& blas = mBlasData[blasId];
-            size_t blasSize = blas.resultByteSize + blas.scratchByteSize;
+            blasSizes[blasId].resultByteSize = mBlasData[blasId].resultByteSize;
+            blasSizes[blasId].scratchByteSize = mBlasData[blasId].scratchByteSize;
+        }
 
-            // Start new BLAS group on first iteration or if group size would exceed the target.
-            if (groupSize == 0 || groupSize + blasSize > kMaxBLASBuildMemory)
-            {
-                mBlasGroups.push_back({});
-                groupSize = 0;
-            }
+        BlasBuildPlanner::Plan plan = BlasBuildPlanner::plan(blasSizes, mBlasBuildMemoryBudget);
+        mBlasBuildPeakMemory = plan.peakByteSize;
+        if (plan.peakByteSize > mBlasBuildMemoryBudget)
+        {
+            logWarning("BLAS build needs " + formatByteSize(plan.peakByteSize) + " for the largest BLAS, which exceeds the build memory budget of " + formatByteSize(mBlasBuildMemoryBudget) + ".");
+        }
 
-            // Add BLAS to current group.
-            assert(mBlasGroups.size() > 0);
-            auto& group = mBlasGroups.back();
-            group.blasIndices.push_back(blasId);
-            blas.blasGroupIndex = (uint32_t)mBlasGroups.size() - 1;
+        mBlasGroups.resize(plan.groups.size());
+        for (size_t blasGroupIndex = 0; blasGroupIndex < plan.groups.size(); blasGroupIndex++)
+        {
+            auto& group = mBlasGroups[blasGroupIndex];
+            group.blasIndices = std::move(plan.groups[blasGroupIndex].blasIndices);
 
             // Update data offsets and sizes.
-            blas.resultByteOffset = group.resultByteSize;
-            blas.scratchByteOffset = group.scratchByteSize;
-            group.resultByteSize += blas.resultByteSize;
-            group.scratchByteSize += blas.scratchByteSize;
-
-            groupSize += blasSize;
+            for (uint32_t blasId : group.blasIndices)
+            {
+                auto& blas = mBlasData[blasId];
+                blas.blasGroupIndex = (uint32_t)blasGroupIndex;
+                blas.resultByteOffset = group.resultByteSize;
+                blas.scratchByteOffset = group.scratchByteSize;
+                group.resultByteSize += blas.resultByteSize;
+                group.scratchByteSize += blas.scratchByteSize;
+            }
         }
 
         // Validation that all offsets and sizes are correct.
@@ -1734,7 +2262,7 @@ namespace Falcor
             preparePrebuildInfo(pContext);
             computeBlasGroups();
 
-            logInfo("BLAS build split into " + std::to_string(mBlasGroups.size()) + " groups");
+            logInfo("BLAS build split into " + std::to_string(mBlasGroups.size()) + " groups, planned peak memory " + formatByteSize(mBlasBuildPeakMemory) + " (budget " + formatByteSize(mBlasBuildMemoryBudget) + ")");
 
             // Compute the required maximum size of the result and scratch buffers.
             uint64_t resultByteSize = 0;
@@ -2387,6 +2915,8 @@ namespace Falcor
         d["uniqueVertexCount"] = uniqueVertexCount;
         d["instancedTriangleCount"] = instancedTriangleCount;
         d["instancedVertexCount"] = instancedVertexCount;
+        d["meshLodCount"] = meshLodCount;
+        d["meshLodTriangleCount"] = meshLodTriangleCount;
         d["indexMemoryInBytes"] = indexMemoryInBytes;
         d["vertexMemoryInBytes"] = vertexMemoryInBytes;
         d["geometryMemoryInBytes"] = geometryMemoryInBytes;
@@ -2414,6 +2944,9 @@ namespace Falcor
         d["blasCompactedCount"] = blasCompactedCount;
         d["blasMemoryInBytes"] = blasMemoryInBytes;
         d["blasScratchMemoryInBytes"] = blasScratchMemoryInBytes;
+        d["blasBuildPeakMemoryInBytes"] = blasBuildPeakMemoryInBytes;
+        d["blasPartitionSAHCost"] = blasPartitionSAHCost;
+        d["blasPartitionOverlap"] = blasPartitionOverlap;
         d["tlasCount"] = tlasCount;
         d["tlasMemoryInBytes"] = tlasMemoryInBytes;
         d["tlasScratchMemoryInBytes"] = tlasScratchMemoryInBytes;
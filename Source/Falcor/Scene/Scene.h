@@ -40,6 +40,8 @@
 #include "Experimental/Scene/Lights/EnvMap.h"
 #include "SceneTypes.slang"
 #include "HitInfo.h"
+#include "InstanceBVH.h"
+#include "BlasBuildPlanner.h"
 
 // Indicating the implementation of curve back-face culling is in anyhit shaders or intersection shaders.
 // Currently, the performance numbers on BabyCheetah scene with 20 indirect bounces are 77ms (with anyhit) and 73ms (without anyhit).
@@ -134,6 +136,8 @@ namespace Falcor
             UserRasterizerState         = 0x1,      ///< Use the rasterizer state currently bound to `pState`. If this flag is not set, the default rasterizer state will be used.
                                                     ///< Note that we need to change the rasterizer state during rendering because some meshes have a negative scale factor, and hence the triangles will have a different winding order.
                                                     ///< If such meshes exist, overriding the state may result in incorrect rendering output
+            NoFrustumCulling            = 0x2,      ///< Draw all mesh instances. If this flag is not set, instances outside the view frustum of the selected camera are culled on the CPU.
+                                                    ///< Set this flag when rendering from a different viewpoint than the selected camera.
         };
 
         /** Flags indicating if and what was updated in the scene
@@ -178,6 +182,16 @@ namespace Falcor
             SixDOF
         };
 
+        /** Simplified level of detail of a mesh (see SceneBuilder::Flags::GenerateMeshLods).
+            The levels share the vertices of the mesh and use the same index format, so a level is drawn by replacing the index range of the mesh.
+        */
+        struct MeshLod
+        {
+            uint32_t ibOffset = 0;      ///< Offset into global index buffer, in the same units as MeshDesc::ibOffset.
+            uint32_t indexCount = 0;    ///< Index count.
+            float error = 0.f;          ///< Upper bound on the geometric error in the space of the mesh's vertex data.
+        };
+
         /** Statistics.
         */
         struct SceneStats
@@ -187,6 +201,8 @@ namespace Falcor
             uint64_t uniqueVertexCount = 0;             ///< Number of unique vertices. A vertex can be referenced by multiple triangles/instances.
             uint64_t instancedTriangleCount = 0;        ///< Number of instanced triangles. This is the total number of rendered triangles.
             uint64_t instancedVertexCount = 0;          ///< Number of instanced vertices. This is the total number of vertices in the rendered triangles.
+            uint64_t meshLodCount = 0;                  ///< Number of simplified mesh levels of detail.
+            uint64_t meshLodTriangleCount = 0;          ///< Number of triangles in the simplified mesh levels of detail.
             uint64_t indexMemoryInBytes = 0;            ///< Total memory in bytes used by the index buffer.
             uint64_t vertexMemoryInBytes = 0;           ///< Total memory in bytes used by the vertex buffer.
             uint64_t geometryMemoryInBytes = 0;         ///< Total memory in bytes used by the geometry data (meshes, curves, instances).
@@ -214,6 +230,9 @@ namespace Falcor
             uint64_t blasCompactedCount = 0;            ///< Number of compacted BLASes.
             uint64_t blasMemoryInBytes = 0;             ///< Total memory in bytes used by the BLASes.
             uint64_t blasScratchMemoryInBytes = 0;      ///< Additional memory in bytes kept around for BLAS updates etc.
+            uint64_t blasBuildPeakMemoryInBytes = 0;    ///< Planned peak memory in bytes of the intermediate result and scratch buffers during the BLAS build.
+            double blasPartitionSAHCost = 0.0;          ///< SAH cost of the partitioning of the static meshes into BLASes, relative to a single BLAS. Lower is better.
+            double blasPartitionOverlap = 0.0;          ///< Total surface area of the pairwise overlaps between the static BLASes, relative to the surface area of all static meshes. Lower is better.
             uint64_t tlasCount = 0;                     ///< Number of TLASes.
             uint64_t tlasMemoryInBytes = 0;             ///< Total memory in bytes used by the TLASes.
             uint64_t tlasScratchMemoryInBytes = 0;      ///< Additional memory in bytes kept around for TLAS updates etc.
@@ -257,6 +276,47 @@ namespace Falcor
 
         const SceneStats& getSceneStats() const { return mSceneStats; }
 
+        /** Calculate the cost of a partitioning of geometry into BLASes (see SceneStats::blasPartitionSAHCost and SceneStats::blasPartitionOverlap).
+            \param[in] groups Bounding box and triangle count of each BLAS. The bounding boxes must be in a common space.
+            \return Pair of the SAH cost and the overlap, both relative to a single BLAS containing all geometry.
+        */
+        static std::pair<double, double> calculateBlasPartitionCost(std::vector<std::pair<AABB, uint64_t>> groups);
+
+        /** Camera frustum culling statistics of the last culling update in rasterize().
+        */
+        struct CullingStats
+        {
+            uint32_t instanceCount = 0;         ///< Number of mesh instances.
+            uint32_t visibleInstanceCount = 0;  ///< Number of mesh instances inside the view frustum.
+            uint32_t nodeTestCount = 0;         ///< Number of instance BVH nodes tested against the frustum.
+            uint32_t boxTestCount = 0;          ///< Number of instance bounding boxes tested against the frustum.
+            uint32_t updateCount = 0;           ///< Number of culling updates since the scene was loaded. The culled draws are reused while the camera and geometry are unchanged.
+            double cullTime = 0.0;              ///< Time in ms for culling and compacting the draw arguments.
+        };
+
+        const CullingStats& getCullingStats() const { return mCullingStats; }
+
+        /** Rasterization draw list statistics.
+            The draws are grouped into buckets by index format and winding, so each bucket needs a single VAO and rasterizer state.
+            Within a bucket, the draws are sorted by material and then by mesh.
+        */
+        struct DrawListStats
+        {
+            struct Bucket
+            {
+                ResourceFormat ibFormat = ResourceFormat::Unknown;  ///< Index buffer format, or ResourceFormat::Unknown for non-indexed draws.
+                bool ccw = true;                                    ///< True if counterclockwise triangle winding.
+                uint32_t drawCount = 0;                             ///< Number of draws in the bucket.
+                uint32_t materialCount = 0;                         ///< Number of distinct materials used by the draws in the bucket.
+            };
+
+            std::vector<Bucket> buckets;        ///< Buckets in draw order. Empty buckets are included.
+            uint32_t updateCount = 0;           ///< Number of draw list updates because mesh instances changed winding.
+            uint32_t movedDrawCount = 0;        ///< Number of draws moved to another bucket in the last update.
+        };
+
+        const DrawListStats& getDrawListStats() const { return mDrawListStats; }
+
         /** Get the render settings.
         */
         const RenderSettings& getRenderSettings() const { return mRenderSettings; }
@@ -374,6 +434,25 @@ namespace Falcor
         */
         const MeshDesc& getMesh(uint32_t meshID) const { return mMeshDesc[meshID]; }
 
+        /** Get the number of simplified levels of detail of a mesh. This does not include the mesh itself.
+        */
+        uint32_t getMeshLodCount(uint32_t meshID) const { return mMeshLods.empty() ? 0 : (uint32_t)mMeshLods[meshID].size(); }
+
+        /** Get a simplified level of detail of a mesh. Levels are in order of decreasing detail.
+            \param[in] meshID Mesh ID.
+            \param[in] lod Level index in [0, getMeshLodCount(meshID)).
+        */
+        const MeshLod& getMeshLod(uint32_t meshID, uint32_t lod) const { return mMeshLods[meshID][lod]; }
+
+        /** Select the coarsest level of detail of a mesh with an error within the given bound.
+            A raster pass can compute the bound from a screen-space error tolerance, e.g. for a perspective camera and a mesh instance
+            with uniform scale s at distance d: maxError = pixelTolerance * 2 * d * tan(fovY / 2) / (viewportHeight * s).
+            \param[in] meshID Mesh ID.
+            \param[in] maxError Maximum geometric error in the space of the mesh's vertex data.
+            \return The index range to draw. This is the range of the mesh itself if no level is within the bound.
+        */
+        MeshLod selectMeshLod(uint32_t meshID, float maxError) const;
+
         /** Get the number of mesh instances.
         */
         uint32_t getMeshInstanceCount() const { return (uint32_t)mMeshInstanceData.size(); }
@@ -484,6 +563,16 @@ namespace Falcor
         */
         UpdateMode getBlasUpdateMode() { return mBlasUpdateMode; }
 
+        /** Set the memory budget for building the BLASes when raytracing.
+            The BLASes are built in groups whose intermediate result and scratch memory fit the budget. The default is 512 MB.
+            If the largest BLAS needs more memory than the budget, that amount is used instead. Changing the budget rebuilds the BLASes.
+        */
+        void setBlasBuildMemoryBudget(uint64_t budgetInBytes);
+
+        /** Get the memory budget for building the BLASes.
+        */
+        uint64_t getBlasBuildMemoryBudget() const { return mBlasBuildMemoryBudget; }
+
         /** Update the scene. Call this once per frame to update the camera location, animations, etc.
             \param pContext
             \param currentTime The current time in seconds
@@ -499,6 +588,35 @@ namespace Falcor
         */
         void rasterize(RenderContext* pContext, GraphicsState* pState, GraphicsVars* pVars, RenderFlags flags = RenderFlags::None);
 
+        /** Draw arguments compacted to the mesh instances that passed a culling test. Updated by cullDrawList() and rendered by rasterize().
+        */
+        class CulledDrawList
+        {
+        public:
+            /** Get the number of draws, i.e. the number of mesh instances that passed the test.
+            */
+            uint32_t getDrawCount() const { return mDrawCount; }
+
+        private:
+            friend class Scene;
+            std::vector<Buffer::SharedPtr> mpBuffers;   ///< Draw-indirect buffer per draw argument list of the scene.
+            std::vector<uint32_t> mCounts;              ///< Number of draws per buffer.
+            uint32_t mDrawCount = 0;                    ///< Total number of draws.
+        };
+
+        /** Cull the mesh instances against a frustum and compact the draw arguments to the instances that are not entirely outside of it.
+            Instances of meshes with dynamic (skinned) vertices are never culled, as their deformed bounds are not known on the CPU.
+            \param[in] frustum Frustum to test the world space mesh instance bounds against.
+            \param[in,out] drawList Draw list to update. The buffers are allocated on first use.
+            \return Statistics of the query.
+        */
+        InstanceBVH::CullStats cullDrawList(const InstanceBVH::Frustum& frustum, CulledDrawList& drawList);
+
+        /** Render the mesh instances of a culled draw list using the rasterizer.
+            The RenderFlags::NoFrustumCulling flag is ignored, only the instances in the draw list are drawn.
+        */
+        void rasterize(RenderContext* pContext, GraphicsState* pState, GraphicsVars* pVars, const CulledDrawList& drawList, RenderFlags flags = RenderFlags::None);
+
         /** Render the scene using raytracing.
         */
         void raytrace(RenderContext* pContext, RtProgram* pProgram, const std::shared_ptr<RtProgramVars>& pVars, uint3 dispatchDims);
@@ -638,11 +756,21 @@ namespace Falcor
         */
         void uploadSelectedCamera();
 
+        /** Create the mapping from scene graph nodes to the mesh and curve instances they transform, and the bounds tree over these nodes.
+        */
+        void initNodeInstances();
+
+        /** Collect the IDs of the matrices changed in the last animation update into mChangedMatrixIDs.
+        */
+        void updateChangedMatrixIDs();
+
         /** Update the scene's global bounding box.
+            \param[in] forceUpdate Recompute the bounds of all nodes. Otherwise only the nodes in mChangedMatrixIDs are refitted.
         */
-        void updateBounds();
+        void updateBounds(bool forceUpdate);
 
         /** Update mesh instances.
+            \param[in] forceUpdate Repack and upload all instances. Otherwise only the instances of the nodes in mChangedMatrixIDs are updated, and only the instances whose flags changed are uploaded.
         */
         void updateMeshInstances(bool forceUpdate);
 
@@ -662,6 +790,34 @@ namespace Falcor
         */
         void createDrawList();
 
+        /** Move the mesh instances whose winding changed to their new draw argument lists.
+            Must be called after updateMeshInstances(), only instances in mChangedMeshInstanceIDs are checked.
+        */
+        void updateDrawList();
+
+        /** Regenerate and upload the draw arguments of a list in mDrawArgs from its sorted mesh instances.
+        */
+        void updateDrawArgs(uint32_t drawArgsIndex);
+
+        /** Get the index into mDrawArgs of the list drawing a mesh instance.
+        */
+        uint32_t getDrawArgsIndex(const MeshInstanceData& instance, const glm::mat4& transform) const;
+
+        /** Order of the draws within a draw argument list. Returns true if mesh instance A is drawn before B.
+        */
+        bool compareDrawOrder(uint32_t instanceA, uint32_t instanceB) const;
+
+        void updateDrawListStats();
+
+        /** Cull the mesh instances against the view frustum of a camera and update mCameraDrawList.
+            Does nothing if the camera and the mesh instance transforms are unchanged since the last call.
+        */
+        void updateCameraDrawList(const Camera* pCamera);
+
+        /** Draw the scene's draw arguments, or a culled subset of them if a draw list is given.
+        */
+        void rasterizeDrawArgs(RenderContext* pContext, GraphicsState* pState, GraphicsVars* pVars, const CulledDrawList* pDrawList, RenderFlags flags);
+
         /** Initialize geometry descs for each BLAS.
         */
         void initGeomDesc(RenderContext* pContext);
@@ -670,7 +826,7 @@ namespace Falcor
         */
         void preparePrebuildInfo(RenderContext* pContext);
 
-        /** Compute BLAS groups.
+        /** Compute BLAS groups that fit the build memory budget.
         */
         void computeBlasGroups();
 
@@ -723,10 +879,14 @@ namespace Falcor
 
         struct DrawArgs
         {
-            Buffer::SharedPtr pBuffer;      ///< Buffer holding the draw-indirect arguments.
+            Buffer::SharedPtr pBuffer;      ///< Buffer holding the draw-indirect arguments. Null until the list has draws.
             uint32_t count = 0;             ///< Number of draws.
+            uint32_t materialCount = 0;     ///< Number of distinct materials used by the draws.
             bool ccw = true;                ///< True if counterclockwise triangle winding.
             ResourceFormat ibFormat = ResourceFormat::Unknown;  ///< Index buffer format.
+            std::vector<uint32_t> instanceIDs;  ///< Mesh instances drawn, sorted by compareDrawOrder().
+            std::vector<D3D12_DRAW_INDEXED_ARGUMENTS> indexedDraws; ///< CPU copy of pBuffer for indexed draws.
+            std::vector<D3D12_DRAW_ARGUMENTS> draws;                ///< CPU copy of pBuffer for non-indexed draws.
         };
 
         static const uint32_t kInvalidNode = -1;
@@ -741,6 +901,22 @@ namespace Falcor
             glm::mat4 localToBindSpace;     ///< Local to bind space transformation.
         };
 
+        /** Refittable bounding box hierarchy over the world space bounds of the scene graph nodes that have geometry.
+            The tree is a complete binary tree stored in an array. Node 1 is the root, the children of node i are 2i and 2i+1, and the leaves start at leafOffset.
+            Changing a leaf only refits its ancestors, so the cost of an update is proportional to the number of changed leaves.
+        */
+        struct BoundsTree
+        {
+            std::vector<AABB> nodes;            ///< Bounds per tree node. Index 0 is unused.
+            std::vector<uint32_t> dirtyNodes;   ///< Inner nodes to refit, collected by setLeaf().
+            uint32_t leafOffset = 1;            ///< Index of the first leaf.
+
+            void init(uint32_t leafCount);
+            void setLeaf(uint32_t leafIndex, const AABB& bounds);
+            void refit();
+            const AABB& getBounds() const { return nodes[1]; }
+        };
+
         /** Represents a group of meshes.
             The meshes are geometries in the same ray tracing bottom-level acceleration structure (BLAS).
         */
@@ -752,7 +928,22 @@ namespace Falcor
 
         Vao::SharedPtr mpVao;                                       ///< Vertex array object for the global vertex/index buffers.
         Vao::SharedPtr mpVao16Bit;                                  ///< VAO for drawing meshes with 16-bit vertex indices.
-        std::vector<DrawArgs> mDrawArgs;                            ///< List of draw arguments for rasterizing the scene.
+        std::vector<DrawArgs> mDrawArgs;                            ///< List of draw arguments for rasterizing the scene, one per index format and winding.
+        std::vector<uint8_t> mMeshInstanceDrawArgs;                 ///< Index into mDrawArgs per mesh instance.
+        std::vector<uint32_t> mMovedDrawInstanceIDs;                ///< Scratch list of mesh instances that changed draw argument list.
+        DrawListStats mDrawListStats;
+
+        // Frustum culling
+        InstanceBVH mInstanceBVH;                                   ///< Hierarchy over the world space mesh instance bounds.
+        std::vector<AABB> mMeshInstanceBBs;                         ///< World space bounding box per mesh instance. Updated by updateBounds().
+        std::vector<uint8_t> mMeshInstanceVisible;                  ///< Flag per mesh instance, 1 if the instance passed the last frustum culling.
+        std::vector<uint32_t> mDynamicMeshInstances;                ///< Mesh instances of meshes with dynamic (skinned) vertices. These are never culled.
+        std::vector<D3D12_DRAW_INDEXED_ARGUMENTS> mCulledIndexedDraws; ///< Scratch list of compacted indexed draws.
+        std::vector<D3D12_DRAW_ARGUMENTS> mCulledDraws;             ///< Scratch list of compacted non-indexed draws.
+        CulledDrawList mCameraDrawList;                             ///< Draws of the mesh instances inside the view frustum of the selected camera.
+        glm::mat4 mCameraDrawListViewProjMat;                       ///< View-projection matrix mCameraDrawList was culled with.
+        bool mCameraDrawListDirty = true;                           ///< True if mCameraDrawList is out of date because mesh instances moved.
+        CullingStats mCullingStats;
 
         Vao::SharedPtr mpCurveVao;                                  ///< Vertex array object for the global curve vertex/index buffers.
 
@@ -765,8 +956,21 @@ namespace Falcor
         std::vector<CurveInstanceData> mCurveInstanceData;          ///< Curve instance data.
         std::vector<MeshGroup> mMeshGroups;                         ///< Groups of meshes. Each group maps to a BLAS for ray tracing.
         std::vector<std::string> mMeshNames;                        ///< Mesh names, indxed by mesh ID
+        std::vector<std::vector<MeshLod>> mMeshLods;                ///< Simplified levels of detail, indexed by mesh ID. Empty if no levels were generated.
         std::vector<Node> mSceneGraph;                              ///< For each index i, the array element indicates the parent node. Indices are in relation to mLocalToWorldMatrices.
 
+        // Incremental updates of transformed geometry
+        std::vector<uint32_t> mNodeMeshInstanceOffsets;             ///< Offsets into mNodeMeshInstances per scene graph node, plus one past the end.
+        std::vector<uint32_t> mNodeMeshInstances;                   ///< Mesh instance IDs grouped by scene graph node.
+        std::vector<uint32_t> mNodeCurveInstanceOffsets;            ///< Offsets into mNodeCurveInstances per scene graph node, plus one past the end.
+        std::vector<uint32_t> mNodeCurveInstances;                  ///< Curve instance IDs grouped by scene graph node.
+        std::vector<uint32_t> mNodeBoundsLeaf;                      ///< Leaf in mBoundsTree per scene graph node, or kInvalidNode if the node has no geometry.
+        std::vector<uint32_t> mBoundsLeafNodes;                     ///< Scene graph node per leaf in mBoundsTree.
+        BoundsTree mBoundsTree;                                     ///< Bounds of the mesh and curve instances, per scene graph node.
+        AABB mCustomPrimitiveBB;                                    ///< Union of the custom primitive AABBs. These are static.
+        std::vector<uint32_t> mChangedMatrixIDs;                    ///< IDs of the matrices changed in the last animation update.
+        std::vector<uint32_t> mChangedMeshInstanceIDs;              ///< Scratch list of mesh instances whose flags changed.
+
         /** The following array and buffer records the AABBs of all procedural primitives, including custom primitives, curves, etc.
             There is an implicit type conversion from D3D12_RAYTRACING_AABB to AABB (defined in Utils.Math.AABB).
             It is fine because both structs have the same data layout.
@@ -776,6 +980,7 @@ namespace Falcor
 
         bool mHas16BitIndices = false;                              ///< True if any meshes use 16-bit indices.
         bool mHas32BitIndices = false;                              ///< True if any meshes use 32-bit indices.
+        bool mHasCompressedVertices = false;                        ///< True if the static vertex data uses the CompressedStaticVertexData format.
 
         // Materials
         std::vector<Material::SharedPtr> mMaterials;                ///< Bound to parameter block.
@@ -843,6 +1048,8 @@ namespace Falcor
         // Raytracing Data
         UpdateMode mTlasUpdateMode = UpdateMode::Rebuild;   ///< How the TLAS should be updated when there are changes in the scene.
         UpdateMode mBlasUpdateMode = UpdateMode::Refit;     ///< How the BLAS should be updated when there are changes to meshes.
+        uint64_t mBlasBuildMemoryBudget = BlasBuildPlanner::kDefaultMemoryBudget;  ///< Maximum peak memory of the intermediate buffers during the BLAS build.
+        uint64_t mBlasBuildPeakMemory = 0;                  ///< Planned peak memory of the last BLAS build.
 
         std::vector<D3D12_RAYTRACING_INSTANCE_DESC> mInstanceDescs; ///< Shared between TLAS builds to avoid reallocating CPU memory.
 
@@ -900,6 +1107,7 @@ namespace Falcor
         std::vector<BlasGroup> mBlasGroups;                 ///< BLAS group data.
         Buffer::SharedPtr mpBlasScratch;                    ///< Scratch buffer used for BLAS builds.
         Buffer::SharedPtr mpBlasStaticWorldMatrices;        ///< Object-to-world transform matrices in row-major format. Only valid for static meshes.
+        Buffer::SharedPtr mpBlasVertexDecodeMatrices;       ///< Per-mesh transform matrices in row-major format that decode compressed positions (and transform static meshes to world space).
         bool mRebuildBlas = true;                           ///< Flag to indicate BLASes need to be rebuilt.
         bool mHasSkinnedMesh = false;                       ///< Whether the scene has a skinned mesh at all.
 
@@ -28,10 +28,14 @@
 #include "stdafx.h"
 #include "SceneBuilder.h"
 #include "Importer.h"
+#include "SceneCache.h"
 #include "Utils/Math/MathConstants.slangh"
 #include "Utils/Timing/TimeReport.h"
+#include "Utils/Threading.h"
 #include <mikktspace.h>
+#include <immintrin.h>
 #include <filesystem>
+#include <numeric>
 
 namespace Falcor
 {
@@ -41,10 +45,103 @@ namespace Falcor
         // The target is max 16M triangles per BLAS (= approx 0.5GB post-compaction). Note that this is not a strict limit.
         const size_t kMaxTrianglesPerBLAS = 1ull << 24;
 
-        // Texture coordinates for textured emissive materials are quantized for performance reasons.
+        // Parameters for the binned SAH partitioning of mesh groups (see splitMeshGroupSAH()).
+        const uint32_t kSAHBinCount = 32;
+        const float kSAHOverlapPenalty = 2.f;       // Cost of the overlap region between the two sides relative to their SAH cost, as rays in the overlap traverse both BLASes.
+        const size_t kSAHMinSplitFraction = 16;     // Splits with less than 1/16 of the triangles on either side are only used if there is no other option.
+
+        // Parameters for the mesh LOD generation (see generateMeshLods()).
+        const uint32_t kMeshLodCount = 4;               // Maximum number of simplified levels per mesh.
+        const float kMeshLodTriangleRatio = 0.5f;       // Target triangle count of each level relative to the previous level.
+        const uint32_t kMeshLodMinTriangles = 64;       // Meshes with fewer triangles are not simplified, and levels stop at this size.
+        const float kMeshLodMaxRelativeError = 0.05f;   // Maximum error relative to the diagonal of the mesh bounds.
+        const float kMeshLodMinReduction = 0.8f;        // A level must have fewer than this fraction of the triangles of the previous level.
+
+        // Texture coordinates for textured emissive materials, and for all materials with compressed vertices, are quantized.
         // We'll log a warning if the maximum quantization error exceeds this value.
         const float kMaxTexelError = 0.5f;
 
+        // Static mesh vertices are pre-transformed and bounded in tasks of this many vertices.
+        const uint32_t kVerticesPerTask = 1u << 16;
+
+        static_assert(offsetof(StaticVertexData, position) == 0 && offsetof(StaticVertexData, normal) == 12 && offsetof(StaticVertexData, tangent) == 24,
+            "StaticVertexData layout does not match the SSE vertex transform");
+
+        __m128 normalizeSSE(__m128 v)
+        {
+            __m128 m = _mm_mul_ps(v, v);
+            __m128 d = _mm_add_ps(_mm_add_ps(_mm_shuffle_ps(m, m, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 1, 1, 1))), _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 2, 2, 2)));
+            return _mm_div_ps(v, _mm_sqrt_ps(d));
+        }
+
+        /** Multiply the xyz components of v by the 3 columns c0-c2, and add c3.
+        */
+        __m128 transformSSE(__m128 v, __m128 c0, __m128 c1, __m128 c2, __m128 c3)
+        {
+            __m128 r = _mm_add_ps(_mm_mul_ps(c0, _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0))), c3);
+            r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1))));
+            return _mm_add_ps(r, _mm_mul_ps(c2, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2))));
+        }
+
+        AABB toAABB(__m128 minPoint, __m128 maxPoint)
+        {
+            float4 minP, maxP;
+            _mm_storeu_ps(&minP.x, minPoint);
+            _mm_storeu_ps(&maxP.x, maxPoint);
+            AABB bb;
+            bb.minPoint = minP.xyz;
+            bb.maxPoint = maxP.xyz;
+            return bb;
+        }
+
+        /** Calculate the bounding box of the vertex positions.
+            The position loads read one float past the position, which is part of the normal and ignored.
+        */
+        AABB calculateBoundingBoxSSE(const StaticVertexData* pBegin, const StaticVertexData* pEnd)
+        {
+            __m128 minPoint = _mm_set1_ps(std::numeric_limits<float>::infinity());
+            __m128 maxPoint = _mm_set1_ps(-std::numeric_limits<float>::infinity());
+            for (const StaticVertexData* v = pBegin; v < pEnd; v++)
+            {
+                // The operand order matches glm::min/max, which skip NaN positions.
+                __m128 p = _mm_loadu_ps(&v->position.x);
+                minPoint = _mm_min_ps(p, minPoint);
+                maxPoint = _mm_max_ps(p, maxPoint);
+            }
+            return toAABB(minPoint, maxPoint);
+        }
+
+        /** Transform the vertices in place and calculate the bounding box of the transformed positions.
+            Positions are transformed by the matrix, normals by its inverse transpose and tangents by its upper 3x3 part.
+            Normals and tangents are renormalized. The tangent sign (w) is left unchanged.
+        */
+        AABB transformVerticesSSE(StaticVertexData* pBegin, StaticVertexData* pEnd, const glm::mat4& transform)
+        {
+            const glm::mat4 invTranspose = glm::transpose(glm::inverse(transform));
+            const __m128 t0 = _mm_loadu_ps(&transform[0].x), t1 = _mm_loadu_ps(&transform[1].x), t2 = _mm_loadu_ps(&transform[2].x), t3 = _mm_loadu_ps(&transform[3].x);
+            const __m128 n0 = _mm_loadu_ps(&invTranspose[0].x), n1 = _mm_loadu_ps(&invTranspose[1].x), n2 = _mm_loadu_ps(&invTranspose[2].x);
+            const __m128 zero = _mm_setzero_ps();
+
+            __m128 minPoint = _mm_set1_ps(std::numeric_limits<float>::infinity());
+            __m128 maxPoint = _mm_set1_ps(-std::numeric_limits<float>::infinity());
+            for (StaticVertexData* v = pBegin; v < pEnd; v++)
+            {
+                __m128 p = transformSSE(_mm_loadu_ps(&v->position.x), t0, t1, t2, t3);
+                __m128 n = normalizeSSE(transformSSE(_mm_loadu_ps(&v->normal.x), n0, n1, n2, zero));
+                __m128 t = normalizeSSE(transformSSE(_mm_loadu_ps(&v->tangent.x), t0, t1, t2, zero));
+                minPoint = _mm_min_ps(p, minPoint);
+                maxPoint = _mm_max_ps(p, maxPoint);
+
+                // The stores are 4-wide and overwrite the first component of the following attribute, which is stored next.
+                const float tangentSign = v->tangent.w;
+                _mm_storeu_ps(&v->position.x, p);
+                _mm_storeu_ps(&v->normal.x, n);
+                _mm_storeu_ps(&v->tangent.x, t);
+                v->tangent.w = tangentSign;
+            }
+            return toAABB(minPoint, maxPoint);
+        }
+
         int largestAxis(const float3& v)
         {
             if (v.x >= v.y && v.x >= v.z) return 0;
@@ -122,7 +219,10 @@ namespace Falcor
             if (isZero(v.normal) || isZero(v.tangent.xyz())) zeroCount++;
         }
 
-        bool compareVertices(const SceneBuilder::Mesh::Vertex& lhs, const SceneBuilder::Mesh::Vertex& rhs, float threshold = 1e-6f)
+        // Vertex attributes (other than position) that differ by less than this threshold are considered identical when merging vertices.
+        const float kVertexMergeThreshold = 1e-6f;
+
+        bool compareVertices(const SceneBuilder::Mesh::Vertex& lhs, const SceneBuilder::Mesh::Vertex& rhs, float threshold = kVertexMergeThreshold)
         {
             using namespace glm;
             if (lhs.position != rhs.position) return false; // Position need to be exact to avoid cracks
@@ -135,6 +235,64 @@ namespace Falcor
             return true;
         }
 
+        /** Hash function for vertex merging.
+            Positions, tangent sign and bone IDs are hashed exactly as they need to match exactly.
+            The remaining attributes are quantized to the merge threshold so that identical vertices produce the same hash.
+            Vertices with non-finite attributes are only hashed by their original index.
+        */
+        uint32_t hashVertex(const SceneBuilder::Mesh::Vertex& v, uint32_t origIndex)
+        {
+            // Murmur3 style mixing of 32-bit words.
+            uint32_t h = 0x9747b28c;
+            auto mix = [&h](uint32_t k)
+            {
+                k *= 0xcc9e2d51; k = (k << 15) | (k >> 17); k *= 0x1b873593;
+                h ^= k; h = (h << 13) | (h >> 19); h = h * 5 + 0xe6546b64;
+            };
+            auto finalize = [&h]()
+            {
+                h ^= h >> 16; h *= 0x85ebca6b; h ^= h >> 13; h *= 0xc2b2ae35; h ^= h >> 16;
+                return h;
+            };
+
+            mix(origIndex);
+
+            const float* attribs[] = { &v.position.x, &v.normal.x, &v.tangent.x, &v.texCrd.x, &v.boneWeights.x };
+            const size_t counts[] = { 3, 3, 4, 2, 4 };
+            for (size_t i = 0; i < 5; i++)
+            {
+                for (size_t j = 0; j < counts[i]; j++)
+                {
+                    if (!std::isfinite(attribs[i][j])) return finalize();
+                }
+            }
+
+            auto floatBits = [](float x) { uint32_t u; std::memcpy(&u, &x, sizeof(u)); return u; };
+
+            // Exact attributes. Map -0 to +0 as they compare equal.
+            auto exactBits = [&floatBits](float x) { return x == 0.f ? 0u : floatBits(x); };
+            mix(exactBits(v.position.x));
+            mix(exactBits(v.position.y));
+            mix(exactBits(v.position.z));
+            mix(exactBits(v.tangent.w));
+            for (uint32_t i = 0; i < 4; i++) mix(v.boneIDs[i]);
+
+            // Quantized attributes.
+            auto quantize = [&mix, &floatBits](float x)
+            {
+                const double scale = 1.0 / kVertexMergeThreshold;
+                int64_t q = std::abs(x) < 1e12f ? (int64_t)std::floor((double)x * scale) : (int64_t)floatBits(x);
+                mix((uint32_t)q);
+                mix((uint32_t)(q >> 32));
+            };
+            for (uint32_t i = 0; i < 3; i++) quantize(v.normal[i]);
+            for (uint32_t i = 0; i < 3; i++) quantize(v.tangent[i]);
+            for (uint32_t i = 0; i < 2; i++) quantize(v.texCrd[i]);
+            for (uint32_t i = 0; i < 4; i++) quantize(v.boneWeights[i]);
+
+            return finalize();
+        }
+
         std::vector<uint32_t> compact16BitIndices(const std::vector<uint32_t>& indices)
         {
             if (indices.empty()) return {};
@@ -165,11 +323,84 @@ namespace Falcor
 
     bool SceneBuilder::import(const std::string& filename, const InstanceMatrices& instances, const Dictionary& dict)
     {
-        bool success = Importer::import(filename, *this, instances, dict);
+        invalidateSceneCache();
+
+        // The scene cache holds the complete post-processed builder state.
+        // It can only be used when importing a scene file into an empty builder.
+        bool isEmpty = mMeshes.empty() && mCurves.empty() && mSceneGraph.empty() && mMaterials.empty() && mLights.empty() && mCameras.empty();
+        std::string fullpath;
+        if (mImportDepth == 0 && is_set(mFlags, Flags::UseCache) && isEmpty && SceneCache::isSupportedFile(filename) && findFileInDataDirectories(filename, fullpath))
+        {
+            mSceneCacheKey = SceneCache::computeKey(fullpath, mFlags, instances, dict);
+            if (mSceneCacheKey && !is_set(mFlags, Flags::RebuildCache) && SceneCache::readCache(*this, *mSceneCacheKey))
+            {
+                mSceneCacheKey.reset();
+                mCachedImport = ImportArgs{ filename, instances, dict };
+                mFilename = filename;
+                return true;
+            }
+        }
+
+        bool success = importFile(filename, instances, dict);
         mFilename = filename;
         return success;
     }
 
+    void SceneBuilder::addDependentFile(const std::string& fullpath)
+    {
+        if (std::find(mDependentFiles.begin(), mDependentFiles.end(), fullpath) == mDependentFiles.end()) mDependentFiles.push_back(fullpath);
+    }
+
+    bool SceneBuilder::importFile(const std::string& filename, const InstanceMatrices& instances, const Dictionary& dict)
+    {
+        mImportDepth++;
+        bool success = false;
+        try
+        {
+            success = Importer::import(filename, *this, instances, dict);
+        }
+        catch (...)
+        {
+            mImportDepth--;
+            throw;
+        }
+        mImportDepth--;
+        return success;
+    }
+
+    void SceneBuilder::invalidateSceneCache()
+    {
+        // Content added by the importer is covered by the cache key.
+        if (mImportDepth > 0) return;
+
+        mSceneCacheKey.reset();
+
+        if (mpSceneCacheFile)
+        {
+            // The post-processed state can't be combined with new content. Discard it and run the importer instead,
+            // so that all content is post-processed together in getScene().
+            assert(mCachedImport);
+            ImportArgs args = std::move(*mCachedImport);
+            mCachedImport.reset();
+            logInfo("Content added to a scene loaded from the scene cache. Importing '" + args.filename + "' again.");
+
+            mpSceneCacheFile.reset();
+            mBuffersView = {};
+            mMeshes.clear();
+            mMeshGroups.clear();
+            mSceneGraph.clear();
+            mMaterials.clear();
+            mLights.clear();
+            mCameras.clear();
+            mpSelectedCamera = nullptr;
+            mAnimations.clear();
+
+            if (!importFile(args.filename, args.instances, args.dict))
+            {
+                throw std::runtime_error("SceneBuilder: Failed to import '" + args.filename + "' again after loading it from the scene cache.");
+            }
+        }
+    }
 
     Scene::SharedPtr SceneBuilder::getScene()
     {
@@ -178,35 +409,61 @@ namespace Falcor
         // Finish loading textures. This blocks until all textures are loaded and assigned.
         mpMaterialTextureLoader.reset();
 
-        // If no meshes were added, we create a dummy mesh to keep the scene generation working.
-        // Scenes with no meshes can be useful for example when using volumes in isolation.
-        if (mMeshes.empty())
+        TimeReport timeReport;
+
+        // Scenes loaded from the scene cache are already post-processed.
+        if (!mpSceneCacheFile)
         {
-            logWarning("Scene contains no meshes. Creating a dummy mesh.");
-            // Add a dummy (degenerate) mesh.
-            auto dummyMesh = TriangleMesh::createDummy();
-            auto dummyMaterial = Material::create("Dummy");
-            auto meshID = addTriangleMesh(dummyMesh, dummyMaterial);
-            Node dummyNode = { "Dummy", glm::identity<glm::mat4>(), glm::identity<glm::mat4>() };
-            auto nodeID = addNode(dummyNode);
-            addMeshInstance(nodeID, meshID);
-        }
+            // The post-processing adds meshes and nodes, which doesn't invalidate the scene cache key.
+            auto sceneCacheKey = mSceneCacheKey;
 
-        // Post-process the scene data.
-        TimeReport timeReport;
+            // If no meshes were added, we create a dummy mesh to keep the scene generation working.
+            // Scenes with no meshes can be useful for example when using volumes in isolation.
+            if (mMeshes.empty())
+            {
+                logWarning("Scene contains no meshes. Creating a dummy mesh.");
+                // Add a dummy (degenerate) mesh.
+                auto dummyMesh = TriangleMesh::createDummy();
+                auto dummyMaterial = Material::create("Dummy");
+                auto meshID = addTriangleMesh(dummyMesh, dummyMaterial);
+                Node dummyNode = { "Dummy", glm::identity<glm::mat4>(), glm::identity<glm::mat4>() };
+                auto nodeID = addNode(dummyNode);
+                addMeshInstance(nodeID, meshID);
+            }
 
-        removeUnusedMeshes();
-        pretransformStaticMeshes();
-        calculateMeshBoundingBoxes();
-        createMeshGroups();
-        optimizeGeometry();
-        createGlobalBuffers();
-        createCurveGlobalBuffers();
-        removeDuplicateMaterials();
-        collectVolumeGrids();
-        quantizeTexCoords();
+            // Post-process the scene data.
+            removeUnusedMeshes();
+            if (is_set(mFlags, Flags::DeduplicateMeshes | Flags::DeduplicateMeshesRigid)) deduplicateMeshes();
+            pretransformStaticMeshesAndCalculateBounds();
+            createMeshGroups();
+            optimizeGeometry();
+            timeReport.measure("Post processing meshes");
+
+            if (is_set(mFlags, Flags::OptimizeVertexCache))
+            {
+                auto [before, after] = optimizeVertexCache();
+                std::ostringstream oss;
+                oss << std::fixed << std::setprecision(3) << "Optimizing vertex cache (ACMR " << before.getACMR() << " -> " << after.getACMR() << ", ATVR " << before.getATVR() << " -> " << after.getATVR() << ")";
+                timeReport.measure(oss.str());
+            }
 
-        timeReport.measure("Post processing meshes");
+            if (is_set(mFlags, Flags::GenerateMeshLods))
+            {
+                auto [lodCount, lodTriangleCount] = generateMeshLods();
+                timeReport.measure("Generating mesh LODs (" + std::to_string(lodCount) + " levels, " + std::to_string(lodTriangleCount) + " triangles)");
+            }
+
+            createGlobalBuffers();
+            createCurveGlobalBuffers();
+            removeDuplicateMaterials();
+            collectVolumeGrids();
+            quantizeTexCoords();
+
+            mBuffersView = { mBuffersData.indexData, mBuffersData.staticData, mBuffersData.dynamicData };
+            mSceneCacheKey = sceneCacheKey;
+
+            timeReport.measure("Creating global buffers");
+        }
 
         // Create the scene object and assign resources.
         mpScene = Scene::create();
@@ -240,12 +497,32 @@ namespace Falcor
 
         createRaytracingAABBData();
 
-        mpScene->mpAnimationController = AnimationController::create(mpScene.get(), mBuffersData.staticData, mBuffersData.dynamicData, mAnimations);
+        // The compressed vertex buffer is already initialized and has no skinned vertices, so the static data is not passed on in that case.
+        auto staticData = mpScene->mHasCompressedVertices ? ArrayView<PackedStaticVertexData>() : mBuffersView.staticData;
+        mpScene->mpAnimationController = AnimationController::create(mpScene.get(), staticData, mBuffersView.dynamicData, mAnimations);
 
         // Finalize the scene object. This is where the final setup is done.
         mpScene->finalize();
 
         timeReport.measure("Creating resources");
+
+        if (mSceneCacheKey)
+        {
+            try
+            {
+                SceneCache::writeCache(*this, *mSceneCacheKey);
+                timeReport.measure("Writing scene cache");
+            }
+            catch (const std::exception& e)
+            {
+                logWarning("Failed to write scene cache. " + std::string(e.what()));
+            }
+        }
+
+        // The GPU buffers have been created, release the cache file mapping.
+        mpSceneCacheFile.reset();
+        mBuffersView = {};
+
         timeReport.printToLog();
 
         return mpScene;
@@ -258,33 +535,105 @@ namespace Falcor
         return addProcessedMesh(processMesh(mesh));
     }
 
-    uint32_t SceneBuilder::addTriangleMesh(const TriangleMesh::SharedPtr& pTriangleMesh, const Material::SharedPtr& pMaterial)
+    std::vector<uint32_t> SceneBuilder::addMeshes(const std::vector<Mesh>& meshes)
+    {
+        TimeReport timeReport;
+
+        // Pre-process meshes in parallel. Each task also records its own duration
+        // so that we can report the total CPU time spent versus the elapsed time.
+        std::vector<ProcessedMesh> processedMeshes(meshes.size());
+        std::vector<double> durations(meshes.size(), 0.0);
+        auto processingStartTime = CpuTimer::getCurrentTimePoint();
+        Threading::parallelFor(0, meshes.size(), [&](size_t i)
+        {
+            auto startTime = CpuTimer::getCurrentTimePoint();
+            processedMeshes[i] = processMesh(meshes[i]);
+            durations[i] = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint()) * 1e-3;
+        }, 1);
+        double processingTime = CpuTimer::calcDuration(processingStartTime, CpuTimer::getCurrentTimePoint()) * 1e-3;
+        timeReport.measure("Processing meshes");
+
+        // Add meshes to the scene.
+        // We retain a deterministic order of the meshes in the global scene buffer by adding
+        // them sequentially after being processed in parallel.
+        std::vector<uint32_t> meshIDs;
+        meshIDs.reserve(meshes.size());
+        for (auto& mesh : processedMeshes)
+        {
+            meshIDs.push_back(addProcessedMesh(mesh));
+        }
+        timeReport.measure("Adding meshes");
+        timeReport.printToLog();
+
+        // The speedup only covers the parallel processing stage, not the serial commit of the meshes.
+        double cpuTime = std::accumulate(durations.begin(), durations.end(), 0.0);
+        logInfo("Processed " + std::to_string(meshes.size()) + " meshes using " + std::to_string(cpuTime) + " s of CPU time in " + std::to_string(processingTime) + " s (" + std::to_string(cpuTime / std::max(processingTime, 1e-9)) + "x parallel speedup)");
+
+        return meshIDs;
+    }
+
+    namespace
     {
-        Mesh mesh;
+        /** Mesh description with storage for the vertex attributes of a triangle mesh.
+        */
+        struct TriangleMeshDesc
+        {
+            std::vector<float3> positions;
+            std::vector<float3> normals;
+            std::vector<float2> texCoords;
+            SceneBuilder::Mesh mesh;
+
+            TriangleMeshDesc(const TriangleMesh::SharedPtr& pTriangleMesh, const Material::SharedPtr& pMaterial)
+            {
+                const auto& indices = pTriangleMesh->getIndices();
+                const auto& vertices = pTriangleMesh->getVertices();
+
+                mesh.name = pTriangleMesh->getName();
+                mesh.faceCount = (uint32_t)(indices.size() / 3);
+                mesh.vertexCount = (uint32_t)vertices.size();
+                mesh.indexCount = (uint32_t)indices.size();
+                mesh.pIndices = indices.data();
+                mesh.topology = Vao::Topology::TriangleList;
+                mesh.pMaterial = pMaterial;
+
+                positions.resize(vertices.size());
+                normals.resize(vertices.size());
+                texCoords.resize(vertices.size());
+                std::transform(vertices.begin(), vertices.end(), positions.begin(), [] (const auto& v) { return v.position; });
+                std::transform(vertices.begin(), vertices.end(), normals.begin(), [] (const auto& v) { return v.normal; });
+                std::transform(vertices.begin(), vertices.end(), texCoords.begin(), [] (const auto& v) { return v.texCoord; });
+
+                mesh.positions = { positions.data(), SceneBuilder::Mesh::AttributeFrequency::Vertex };
+                mesh.normals = { normals.data(), SceneBuilder::Mesh::AttributeFrequency::Vertex };
+                mesh.texCrds = { texCoords.data(), SceneBuilder::Mesh::AttributeFrequency::Vertex };
+            }
+
+            TriangleMeshDesc(const TriangleMeshDesc&) = delete;
+            TriangleMeshDesc& operator=(const TriangleMeshDesc&) = delete;
+        };
+    }
 
-        const auto& indices = pTriangleMesh->getIndices();
-        const auto& vertices = pTriangleMesh->getVertices();
+    uint32_t SceneBuilder::addTriangleMesh(const TriangleMesh::SharedPtr& pTriangleMesh, const Material::SharedPtr& pMaterial)
+    {
+        TriangleMeshDesc desc(pTriangleMesh, pMaterial);
+        return addMesh(desc.mesh);
+    }
 
-        mesh.name = pTriangleMesh->getName();
-        mesh.faceCount = (uint32_t)(indices.size() / 3);
-        mesh.vertexCount = (uint32_t)vertices.size();
-        mesh.indexCount = (uint32_t)indices.size();
-        mesh.pIndices = indices.data();
-        mesh.topology = Vao::Topology::TriangleList;
-        mesh.pMaterial = pMaterial;
+    std::vector<uint32_t> SceneBuilder::addTriangleMeshes(const std::vector<TriangleMesh::SharedPtr>& triangleMeshes, const std::vector<Material::SharedPtr>& materials)
+    {
+        if (triangleMeshes.size() != materials.size()) throw std::runtime_error("SceneBuilder::addTriangleMeshes() - Triangle mesh and material lists must have the same size");
 
-        std::vector<float3> positions(vertices.size());
-        std::vector<float3> normals(vertices.size());
-        std::vector<float2> texCoords(vertices.size());
-        std::transform(vertices.begin(), vertices.end(), positions.begin(), [] (const auto& v) { return v.position; });
-        std::transform(vertices.begin(), vertices.end(), normals.begin(), [] (const auto& v) { return v.normal; });
-        std::transform(vertices.begin(), vertices.end(), texCoords.begin(), [] (const auto& v) { return v.texCoord; });
+        std::vector<std::unique_ptr<TriangleMeshDesc>> descs(triangleMeshes.size());
+        Threading::parallelFor(0, triangleMeshes.size(), [&](size_t i)
+        {
+            descs[i] = std::make_unique<TriangleMeshDesc>(triangleMeshes[i], materials[i]);
+        });
 
-        mesh.positions = { positions.data(), SceneBuilder::Mesh::AttributeFrequency::Vertex };
-        mesh.normals = { normals.data(), SceneBuilder::Mesh::AttributeFrequency::Vertex };
-        mesh.texCrds = { texCoords.data(), SceneBuilder::Mesh::AttributeFrequency::Vertex };
+        std::vector<Mesh> meshes;
+        meshes.reserve(descs.size());
+        for (const auto& pDesc : descs) meshes.push_back(pDesc->mesh);
 
-        return addMesh(mesh);
+        return addMeshes(meshes);
     }
 
     SceneBuilder::ProcessedMesh SceneBuilder::processMesh(const Mesh& mesh_) const
@@ -380,53 +729,128 @@ namespace Falcor
         }
 
         // Build new vertex/index buffers by merging identical vertices.
-        // The search is based on the topology defined by the original index buffer.
-        //
-        // A linked-list of vertices is built for each original vertex index.
-        // We iterate over all vertices and first check if a vertex is identical to any of the other vertices
-        // using the same original vertex index. If not, a new vertex is inserted and added to the list.
-        // The 'heads' array point to the first vertex in each list, and each vertex has an associated next-pointer.
-        // This ensures that adding to the linked lists do not require any dynamic memory allocation.
-        //
+        // The search is based on the topology defined by the original index buffer,
+        // i.e., only vertices that share the same original vertex index are merged.
         const uint32_t invalidIndex = 0xffffffff;
-        std::vector<std::pair<Mesh::Vertex, uint32_t>> vertices;
+        std::vector<Mesh::Vertex> vertices;
         vertices.reserve(mesh.vertexCount);
         std::vector<uint32_t> indices(mesh.indexCount);
-        std::vector<uint32_t> heads(mesh.vertexCount, invalidIndex);
 
-        for (uint32_t face = 0; face < mesh.faceCount; face++)
+        if (!is_set(mFlags, Flags::HashVertexMerging))
         {
-            for (uint32_t vert = 0; vert < 3; vert++)
+            // A linked-list of vertices is built for each original vertex index.
+            // We iterate over all vertices and first check if a vertex is identical to any of the other vertices
+            // using the same original vertex index. If not, a new vertex is inserted and added to the list.
+            // The 'heads' array point to the first vertex in each list, and each vertex has an associated next-pointer.
+            // This ensures that adding to the linked lists do not require any dynamic memory allocation.
+            std::vector<uint32_t> heads(mesh.vertexCount, invalidIndex);
+            std::vector<uint32_t> next;
+            next.reserve(mesh.vertexCount);
+
+            for (uint32_t face = 0; face < mesh.faceCount; face++)
             {
-                const Mesh::Vertex v = mesh.getVertex(face, vert);
-                const uint32_t origIndex = mesh.pIndices[face * 3 + vert];
+                for (uint32_t vert = 0; vert < 3; vert++)
+                {
+                    const Mesh::Vertex v = mesh.getVertex(face, vert);
+                    const uint32_t origIndex = mesh.pIndices[face * 3 + vert];
 
-                // Iterate over vertex list to check if it already exists.
-                assert(origIndex < heads.size());
-                uint32_t index = heads[origIndex];
-                bool found = false;
+                    // Iterate over vertex list to check if it already exists.
+                    assert(origIndex < heads.size());
+                    uint32_t index = heads[origIndex];
+                    bool found = false;
 
-                while (index != invalidIndex)
-                {
-                    if (compareVertices(v, vertices[index].first))
+                    while (index != invalidIndex)
                     {
-                        found = true;
-                        break;
+                        if (compareVertices(v, vertices[index]))
+                        {
+                            found = true;
+                            break;
+                        }
+                        index = next[index];
                     }
-                    index = vertices[index].second;
+
+                    // Insert new vertex if we couldn't find it.
+                    if (!found)
+                    {
+                        assert(vertices.size() < std::numeric_limits<uint32_t>::max());
+                        index = (uint32_t)vertices.size();
+                        vertices.push_back(v);
+                        next.push_back(heads[origIndex]);
+                        heads[origIndex] = index;
+                    }
+
+                    // Store new vertex index.
+                    indices[face * 3 + vert] = index;
                 }
+            }
+        }
+        else
+        {
+            // An open-addressing hash table with linear probing maps vertex hashes to vertex indices.
+            // The hash of each vertex and its original vertex index are stored alongside the vertex to avoid recomputing them on lookups.
+            // Candidates with a matching hash are verified with the same comparison as above, so hash collisions never merge distinct vertices.
+            // Vertices with exactly equal attributes always get the same hash, which makes the result identical to the linked-list search in that case.
+            std::vector<uint32_t> vertexHashes;
+            std::vector<uint32_t> vertexOrigIndices;
+            vertexHashes.reserve(mesh.vertexCount);
+            vertexOrigIndices.reserve(mesh.vertexCount);
+
+            size_t tableSize = 16;
+            while (tableSize < 2 * (size_t)mesh.vertexCount) tableSize *= 2;
+            std::vector<uint32_t> table(tableSize, invalidIndex);
+            uint32_t tableMask = (uint32_t)table.size() - 1;
+
+            auto insert = [&](uint32_t hash, uint32_t index)
+            {
+                uint32_t slot = hash & tableMask;
+                while (table[slot] != invalidIndex) slot = (slot + 1) & tableMask;
+                table[slot] = index;
+            };
 
-                // Insert new vertex if we couldn't find it.
-                if (!found)
+            for (uint32_t face = 0; face < mesh.faceCount; face++)
+            {
+                for (uint32_t vert = 0; vert < 3; vert++)
                 {
-                    assert(vertices.size() < std::numeric_limits<uint32_t>::max());
-                    index = (uint32_t)vertices.size();
-                    vertices.push_back({ v, heads[origIndex] });
-                    heads[origIndex] = index;
-                }
+                    const Mesh::Vertex v = mesh.getVertex(face, vert);
+                    const uint32_t origIndex = mesh.pIndices[face * 3 + vert];
+                    const uint32_t hash = hashVertex(v, origIndex);
+
+                    // Probe the table until we find a matching vertex or an empty slot.
+                    uint32_t slot = hash & tableMask;
+                    uint32_t index = invalidIndex;
+                    while (table[slot] != invalidIndex)
+                    {
+                        uint32_t candidate = table[slot];
+                        if (vertexHashes[candidate] == hash && vertexOrigIndices[candidate] == origIndex && compareVertices(v, vertices[candidate]))
+                        {
+                            index = candidate;
+                            break;
+                        }
+                        slot = (slot + 1) & tableMask;
+                    }
+
+                    // Insert new vertex if we couldn't find it.
+                    if (index == invalidIndex)
+                    {
+                        assert(vertices.size() < std::numeric_limits<uint32_t>::max());
+                        index = (uint32_t)vertices.size();
+                        vertices.push_back(v);
+                        vertexHashes.push_back(hash);
+                        vertexOrigIndices.push_back(origIndex);
+                        table[slot] = index;
+
+                        // Grow the table to keep the load factor below 0.5.
+                        if (2 * vertices.size() > table.size())
+                        {
+                            table.assign(table.size() * 2, invalidIndex);
+                            tableMask = (uint32_t)table.size() - 1;
+                            for (uint32_t i = 0; i < (uint32_t)vertices.size(); i++) insert(vertexHashes[i], i);
+                        }
+                    }
 
-                // Store new vertex index.
-                indices[face * 3 + vert] = index;
+                    // Store new vertex index.
+                    indices[face * 3 + vert] = index;
+                }
             }
         }
 
@@ -442,7 +866,7 @@ namespace Falcor
         size_t zeroCount = 0;
         for (const auto& v : vertices)
         {
-            validateVertex(v.first, invalidCount, zeroCount);
+            validateVertex(v, invalidCount, zeroCount);
         }
         if (invalidCount > 0) logWarning("The mesh '" + mesh.name + "' has inf/nan vertex attributes at " + std::to_string(invalidCount) + " vertices. Please fix the asset.");
         if (zeroCount > 0) logWarning("The mesh '" + mesh.name + "' has zero-length normals/tangents at " + std::to_string(zeroCount) + " vertices. Please fix the asset.");
@@ -469,7 +893,7 @@ namespace Falcor
         {
             uint32_t index = isIndexed ? i : indices[i];
             assert(index < vertices.size());
-            const Mesh::Vertex& v = vertices[index].first;
+            const Mesh::Vertex& v = vertices[index];
 
             StaticVertexData s;
             s.position = v.position;
@@ -494,6 +918,8 @@ namespace Falcor
 
     uint32_t SceneBuilder::addProcessedMesh(const ProcessedMesh& mesh)
     {
+        invalidateSceneCache();
+
         const bool isIndexed = !is_set(mFlags, Flags::NonIndexedVertices);
 
         MeshSpec spec;
@@ -535,6 +961,8 @@ namespace Falcor
 
     void SceneBuilder::addCustomPrimitive(uint32_t typeID, const AABB& aabb)
     {
+        invalidateSceneCache();
+
         uint32_t instanceIdx = 0;
         auto it = mProceduralPrimInstanceCount.find(typeID);
         if (it != mProceduralPrimInstanceCount.end())
@@ -624,6 +1052,8 @@ namespace Falcor
 
     uint32_t SceneBuilder::addProcessedCurve(const ProcessedCurve& curve)
     {
+        invalidateSceneCache();
+
         CurveSpec spec;
 
         // Add the curve to the scene.
@@ -653,6 +1083,7 @@ namespace Falcor
 
     uint32_t SceneBuilder::addMaterial(const Material::SharedPtr& pMaterial)
     {
+        invalidateSceneCache();
         assert(pMaterial);
 
         // Reuse previously added materials
@@ -677,7 +1108,7 @@ namespace Falcor
 
     void SceneBuilder::loadMaterialTexture(const Material::SharedPtr& pMaterial, Material::TextureSlot slot, const std::string& filename)
     {
-        if (!mpMaterialTextureLoader) mpMaterialTextureLoader.reset(new MaterialTextureLoader(!is_set(mFlags, Flags::AssumeLinearSpaceTextures)));
+        if (!mpMaterialTextureLoader) mpMaterialTextureLoader.reset(new MaterialTextureLoader(!is_set(mFlags, Flags::AssumeLinearSpaceTextures), is_set(mFlags, Flags::CompressTextures)));
         mpMaterialTextureLoader->loadTexture(pMaterial, slot, filename);
     }
 
@@ -694,6 +1125,7 @@ namespace Falcor
 
     uint32_t SceneBuilder::addVolume(const Volume::SharedPtr& pVolume)
     {
+        invalidateSceneCache();
         assert(pVolume);
 
         mVolumes.push_back(pVolume);
@@ -705,6 +1137,7 @@ namespace Falcor
 
     uint32_t SceneBuilder::addLight(const Light::SharedPtr& pLight)
     {
+        invalidateSceneCache();
         assert(pLight);
         mLights.push_back(pLight);
         assert(mLights.size() <= std::numeric_limits<uint32_t>::max());
@@ -715,6 +1148,7 @@ namespace Falcor
 
     uint32_t SceneBuilder::addCamera(const Camera::SharedPtr& pCamera)
     {
+        invalidateSceneCache();
         assert(pCamera);
         mCameras.push_back(pCamera);
         assert(mCameras.size() <= std::numeric_limits<uint32_t>::max());
@@ -731,6 +1165,7 @@ namespace Falcor
 
     void SceneBuilder::addAnimation(const Animation::SharedPtr& pAnimation)
     {
+        invalidateSceneCache();
         mAnimations.push_back(pAnimation);
     }
 
@@ -760,6 +1195,7 @@ namespace Falcor
 
     uint32_t SceneBuilder::addNode(const Node& node)
     {
+        invalidateSceneCache();
         assert(node.parent == kInvalidNode || node.parent < mSceneGraph.size());
 
         assert(mSceneGraph.size() <= std::numeric_limits<uint32_t>::max());
@@ -771,6 +1207,7 @@ namespace Falcor
 
     void SceneBuilder::addMeshInstance(uint32_t nodeID, uint32_t meshID)
     {
+        invalidateSceneCache();
         if (nodeID >= mSceneGraph.size()) throw std::runtime_error("SceneBuilder::addMeshInstance() - nodeID " + std::to_string(nodeID) + " is out of range");
         if (meshID >= mMeshes.size()) throw std::runtime_error("SceneBuilder::addMeshInstance() - meshID " + std::to_string(meshID) + " is out of range");
 
@@ -780,6 +1217,7 @@ namespace Falcor
 
     void SceneBuilder::addCurveInstance(uint32_t nodeID, uint32_t curveID)
     {
+        invalidateSceneCache();
         if (nodeID >= mSceneGraph.size()) throw std::runtime_error("SceneBuilder::addCurveInstance() - nodeID " + std::to_string(nodeID) + " is out of range");
         if (curveID >= mCurves.size()) throw std::runtime_error("SceneBuilder::addCurveInstance() - curveID " + std::to_string(curveID) + " is out of range");
 
@@ -805,6 +1243,7 @@ namespace Falcor
 
     void SceneBuilder::setNodeInterpolationMode(uint32_t nodeID, Animation::InterpolationMode interpolationMode, bool enableWarping)
     {
+        invalidateSceneCache();
         assert(nodeID < mSceneGraph.size());
 
         while (nodeID != kInvalidNode)
@@ -842,51 +1281,200 @@ namespace Falcor
         if (unusedCount > 0)
         {
             logWarning("Scene has " + std::to_string(unusedCount) + " unused meshes that will be removed.");
+            compactMeshList();
+        }
+    }
+
+    void SceneBuilder::compactMeshList()
+    {
+        // Remove all meshes that are not referenced by any scene graph nodes and update the mesh IDs.
+
+        const size_t meshCount = mMeshes.size();
+        MeshList meshes;
+        meshes.reserve(meshCount);
 
-            const size_t meshCount = mMeshes.size();
-            MeshList meshes;
-            meshes.reserve(meshCount);
+        for (uint32_t meshID = 0; meshID < (uint32_t)meshCount; meshID++)
+        {
+            auto& mesh = mMeshes[meshID];
+            if (mesh.instances.empty()) continue; // Skip unused meshes
 
-            for (uint32_t meshID = 0; meshID < (uint32_t)meshCount; meshID++)
+            // Get new mesh ID.
+            const uint32_t newMeshID = (uint32_t)meshes.size();
+
+            // Update scene graph nodes meshIDs.
+            for (const auto nodeID : mesh.instances)
             {
-                auto& mesh = mMeshes[meshID];
-                if (mesh.instances.empty()) continue; // Skip unused meshes
+                assert(nodeID < mSceneGraph.size());
+                auto& node = mSceneGraph[nodeID];
+                std::replace(node.meshes.begin(), node.meshes.end(), meshID, newMeshID);
+            }
 
-                // Get new mesh ID.
-                const uint32_t newMeshID = (uint32_t)meshes.size();
+            meshes.push_back(std::move(mesh));
+        }
+
+        mMeshes = std::move(meshes);
 
-                // Update scene graph nodes meshIDs.
-                for (const auto nodeID : mesh.instances)
+        // Validate scene graph.
+        for (const auto& node : mSceneGraph)
+        {
+            for (uint32_t meshID : node.meshes) assert(meshID < mMeshes.size());
+        }
+    }
+
+    void SceneBuilder::deduplicateMeshes()
+    {
+        // This function finds meshes with identical geometry and material and replaces the copies by instances of a single mesh.
+        // Meshes are bucketed by a hash of their geometry and each candidate is verified against the unique meshes in its bucket.
+        // With DeduplicateMeshesRigid, the hash excludes positions, normals and tangents, and a candidate matches a unique mesh
+        // if a rigid transform maps the unique mesh onto it. The copies are then instanced through a new child node holding the transform.
+        // Skinned meshes are not deduplicated as their dynamic vertex data is unique per instance.
+
+        const bool rigid = is_set(mFlags, Flags::DeduplicateMeshesRigid);
+
+        // Compute content hashes in parallel.
+        std::vector<uint64_t> hashes(mMeshes.size());
+        Threading::parallelFor(0, mMeshes.size(), [&](size_t meshID)
+        {
+            const auto& mesh = mMeshes[meshID];
+
+            // FNV-1a style hashing of 32-bit words.
+            uint64_t h = 0xcbf29ce484222325ull;
+            auto mix = [&h](uint32_t k) { h = (h ^ k) * 0x100000001b3ull; };
+            auto floatBits = [](float x) { uint32_t u; std::memcpy(&u, &x, sizeof(u)); return u; };
+
+            mix((uint32_t)mesh.topology);
+            mix(mesh.indexCount);
+            mix(mesh.vertexCount);
+            mix((mesh.use16BitIndices ? 1 : 0) | (mesh.isFrontFaceCW ? 2 : 0));
+            for (uint32_t index : mesh.indexData) mix(index);
+            for (const auto& v : mesh.staticData)
+            {
+                mix(floatBits(v.texCrd.x));
+                mix(floatBits(v.texCrd.y));
+                mix(floatBits(v.tangent.w));
+                if (!rigid)
                 {
-                    assert(nodeID < mSceneGraph.size());
-                    auto& node = mSceneGraph[nodeID];
-                    std::replace(node.meshes.begin(), node.meshes.end(), meshID, newMeshID);
+                    for (uint32_t i = 0; i < 3; i++) mix(floatBits(v.position[i]));
+                    for (uint32_t i = 0; i < 3; i++) mix(floatBits(v.normal[i]));
+                    for (uint32_t i = 0; i < 3; i++) mix(floatBits(v.tangent[i]));
                 }
+            }
+            hashes[meshID] = h;
+        });
+
+        // Duplicate materials are only removed later in removeDuplicateMaterials(), so compare the material properties here.
+        auto isSameMaterial = [this](uint32_t lhs, uint32_t rhs)
+        {
+            return lhs == rhs || (!is_set(mFlags, Flags::DontMergeMaterials) && *mMaterials[lhs] == *mMaterials[rhs]);
+        };
+
+        std::unordered_map<uint64_t, std::vector<uint32_t>> uniqueMeshes;
+        size_t duplicateCount = 0;
+        size_t savedBytes = 0;
+
+        for (uint32_t meshID = 0; meshID < (uint32_t)mMeshes.size(); meshID++)
+        {
+            auto& mesh = mMeshes[meshID];
+            if (mesh.hasDynamicData) continue;
+
+            auto& candidates = uniqueMeshes[hashes[meshID]];
+            std::optional<uint32_t> uniqueID;
+            glm::mat4 transform;
+            for (uint32_t candidateID : candidates)
+            {
+                const auto& candidate = mMeshes[candidateID];
+                if (candidate.topology != mesh.topology || candidate.isFrontFaceCW != mesh.isFrontFaceCW || candidate.indexCount != mesh.indexCount ||
+                    candidate.use16BitIndices != mesh.use16BitIndices || candidate.indexData != mesh.indexData || !isSameMaterial(candidate.materialId, mesh.materialId)) continue;
 
-                meshes.push_back(std::move(mesh));
+                bool isMatch = rigid ? MeshOptimizer::findRigidTransform(candidate.staticData, mesh.staticData, transform) :
+                    candidate.staticData.size() == mesh.staticData.size() &&
+                    std::memcmp(candidate.staticData.data(), mesh.staticData.data(), mesh.staticData.size() * sizeof(StaticVertexData)) == 0;
+
+                if (isMatch)
+                {
+                    uniqueID = candidateID;
+                    break;
+                }
             }
 
-            mMeshes = std::move(meshes);
+            if (!uniqueID)
+            {
+                candidates.push_back(meshID);
+                continue;
+            }
 
-            // Validate scene graph.
-            assert(mMeshes.size() == meshCount - unusedCount);
-            for (const auto& node : mSceneGraph)
+            // Replace the mesh by instances of the unique mesh. The nodes are collected first as adding nodes invalidates references.
+            const std::vector<uint32_t> nodeIDs = std::move(mesh.instances);
+            mesh.instances.clear();
+            const bool isIdentity = !rigid || transform == glm::identity<glm::mat4>();
+
+            for (uint32_t nodeID : nodeIDs)
             {
-                for (uint32_t meshID : node.meshes) assert(meshID < mMeshes.size());
+                auto& nodeMeshes = mSceneGraph[nodeID].meshes;
+                auto it = std::find(nodeMeshes.begin(), nodeMeshes.end(), meshID);
+                assert(it != nodeMeshes.end());
+                nodeMeshes.erase(it);
+
+                uint32_t instanceNodeID = nodeID;
+                if (!isIdentity)
+                {
+                    // The transform maps the unique mesh into the object space of the removed mesh.
+                    instanceNodeID = addNode(Node{ mesh.name, transform, glm::identity<glm::mat4>(), nodeID });
+                }
+                mSceneGraph[instanceNodeID].meshes.push_back(*uniqueID);
+                mMeshes[*uniqueID].instances.push_back(instanceNodeID);
             }
+
+            duplicateCount++;
+            savedBytes += mesh.indexData.size() * sizeof(uint32_t) + mesh.staticData.size() * sizeof(PackedStaticVertexData);
+        }
+
+        if (duplicateCount > 0)
+        {
+            compactMeshList();
+            logInfo("Deduplicated " + std::to_string(duplicateCount) + " meshes into instances, saving " + formatByteSize(savedBytes) + " of vertex and index data.");
         }
     }
 
-    void SceneBuilder::pretransformStaticMeshes()
+    void SceneBuilder::pretransformStaticMeshesAndCalculateBounds()
     {
         // Add an identity transform node.
         uint32_t identityNodeID = addNode(Node{ "Identity", glm::identity<glm::mat4>(), glm::identity<glm::mat4>() });
-        auto& identityNode = mSceneGraph[identityNodeID];
 
+        // Object->world transforms of the scene graph nodes, computed on demand so that shared parent chains are only walked once.
+        std::vector<glm::mat4> globalTransforms(mSceneGraph.size());
+        std::vector<bool> hasGlobalTransform(mSceneGraph.size(), false);
+        std::vector<uint32_t> nodeStack;
+
+        auto getGlobalTransform = [&](uint32_t nodeID) -> const glm::mat4&
+        {
+            assert(nodeID != kInvalidNode);
+            for (uint32_t id = nodeID; id != kInvalidNode && !hasGlobalTransform[id]; id = mSceneGraph[id].parent)
+            {
+                assert(id < mSceneGraph.size());
+                nodeStack.push_back(id);
+            }
+            while (!nodeStack.empty())
+            {
+                uint32_t id = nodeStack.back();
+                nodeStack.pop_back();
+                uint32_t parentID = mSceneGraph[id].parent;
+                globalTransforms[id] = parentID != kInvalidNode ? globalTransforms[parentID] * mSceneGraph[id].transform : mSceneGraph[id].transform;
+                hasGlobalTransform[id] = true;
+            }
+            return globalTransforms[nodeID];
+        };
+
+        // Find the static meshes and link them to the identity node. This modifies the scene graph and runs serially.
+        // The vertex transforms are collected and applied in parallel below.
+        std::vector<const glm::mat4*> meshTransforms(mMeshes.size(), nullptr);
         size_t transformedMeshCount = 0;
+
         for (uint32_t meshID = 0; meshID < (uint32_t)mMeshes.size(); meshID++)
         {
             auto& mesh = mMeshes[meshID];
+            assert(!mesh.staticData.empty());
+            assert((size_t)mesh.vertexCount == mesh.staticData.size());
 
             // Skip instanced/animated/skinned meshes.
             assert(!mesh.instances.empty());
@@ -896,41 +1484,18 @@ namespace Falcor
             mesh.isStatic = true;
 
             // Compute the object->world transform for the node.
-            auto nodeID = mesh.instances[0];
-            assert(nodeID != kInvalidNode);
-
-            glm::mat4 transform = glm::identity<glm::mat4>();
-            while (nodeID != kInvalidNode)
-            {
-                assert(nodeID < mSceneGraph.size());
-                transform = mSceneGraph[nodeID].transform * transform;
-
-                nodeID = mSceneGraph[nodeID].parent;
-            }
+            const glm::mat4& transform = getGlobalTransform(mesh.instances[0]);
 
             // Flip triangle winding if the transform flips the coordinate system handedness (negative determinant).
             bool flippedWinding = glm::determinant((glm::mat3)transform) < 0.f;
             if (flippedWinding) mesh.isFrontFaceCW = !mesh.isFrontFaceCW;
 
             // Transform vertices to world space if not already identity transform.
+            // TODO: We should flip the sign of v.tangent.w if flippedWinding is true.
+            // Leaving that out for now for consistency with the shader code that needs the same fix.
             if (transform != glm::identity<glm::mat4>())
             {
-                assert(!mesh.staticData.empty());
-                assert((size_t)mesh.vertexCount == mesh.staticData.size());
-
-                glm::mat3 invTranspose3x3 = (glm::mat3)glm::transpose(glm::inverse(transform));
-                glm::mat3 transform3x3 = (glm::mat3)transform;
-
-                for (auto& v : mesh.staticData)
-                {
-                    float4 p = transform * float4(v.position, 1.f);
-                    v.position = p.xyz;
-                    v.normal = glm::normalize(invTranspose3x3 * v.normal);
-                    v.tangent.xyz = glm::normalize(transform3x3 * v.tangent.xyz);
-                    // TODO: We should flip the sign of v.tangent.w if flippedWinding is true.
-                    // Leaving that out for now for consistency with the shader code that needs the same fix.
-                }
-
+                meshTransforms[meshID] = &transform;
                 transformedMeshCount++;
             }
 
@@ -943,28 +1508,51 @@ namespace Falcor
             prevNode.meshes.erase(it);
 
             // Link mesh to the identity transform node.
-            identityNode.meshes.push_back(meshID);
+            mSceneGraph[identityNodeID].meshes.push_back(meshID);
             mesh.instances[0] = identityNodeID;
         }
 
-        logDebug("Pre-transformed " + std::to_string(transformedMeshCount) + " static meshes to world space");
-    }
+        // Split the meshes into tasks of at most kVerticesPerTask vertices so that large meshes are spread over multiple threads.
+        struct Task
+        {
+            uint32_t meshID;
+            uint32_t firstVertex;
+            uint32_t lastVertex;
+            AABB boundingBox;
+        };
 
-    void SceneBuilder::calculateMeshBoundingBoxes()
-    {
-        for (auto& mesh : mMeshes)
+        std::vector<Task> tasks;
+        for (uint32_t meshID = 0; meshID < (uint32_t)mMeshes.size(); meshID++)
         {
-            assert(!mesh.staticData.empty());
-            assert((size_t)mesh.vertexCount == mesh.staticData.size());
+            const uint32_t vertexCount = (uint32_t)mMeshes[meshID].staticData.size();
+            for (uint32_t first = 0; first < vertexCount; first += std::min(kVerticesPerTask, vertexCount - first))
+            {
+                tasks.push_back({ meshID, first, first + std::min(kVerticesPerTask, vertexCount - first) });
+            }
+        }
+
+        // Transform the vertices of the static meshes and compute the bounding boxes of all meshes in the same sweep.
+        Threading::parallelFor(0, tasks.size(), [&](size_t taskID)
+        {
+            auto& task = tasks[taskID];
+            auto& mesh = mMeshes[task.meshID];
+            StaticVertexData* pBegin = mesh.staticData.data() + task.firstVertex;
+            StaticVertexData* pEnd = mesh.staticData.data() + task.lastVertex;
 
-            AABB meshBB;
-            for (auto& v : mesh.staticData)
+            if (const glm::mat4* pTransform = meshTransforms[task.meshID])
+            {
+                task.boundingBox = transformVerticesSSE(pBegin, pEnd, *pTransform);
+            }
+            else
             {
-                meshBB.include(v.position);
+                task.boundingBox = calculateBoundingBoxSSE(pBegin, pEnd);
             }
+        });
 
-            mesh.boundingBox = meshBB;
-        }
+        for (auto& mesh : mMeshes) mesh.boundingBox = AABB();
+        for (const auto& task : tasks) mMeshes[task.meshID].boundingBox.include(task.boundingBox);
+
+        logDebug("Pre-transformed " + std::to_string(transformedMeshCount) + " static meshes to world space");
     }
 
     void SceneBuilder::createMeshGroups()
@@ -1176,7 +1764,41 @@ namespace Falcor
     void SceneBuilder::splitNonIndexedMesh(const MeshSpec& mesh, MeshSpec& leftMesh, MeshSpec& rightMesh, const int axis, const float pos)
     {
         assert(mesh.indexCount == 0 && mesh.indexData.empty());
-        throw std::exception("SceneBuilder::splitNonIndexedMesh() not implemented");
+
+        // Iterate over the triangles.
+        const size_t triangleCount = mesh.getTriangleCount();
+        for (size_t i = 0; i < triangleCount * 3; i += 3)
+        {
+            // Compute the centroid and add the triangle to the left or right side.
+            float centroid = 0.f;
+            for (size_t j = 0; j < 3; j++)
+            {
+                centroid += mesh.staticData[i + j].position[axis];
+            }
+            centroid /= 3.f;
+
+            MeshSpec& dstMesh = centroid < pos ? leftMesh : rightMesh;
+            dstMesh.staticData.insert(dstMesh.staticData.end(), mesh.staticData.begin() + i, mesh.staticData.begin() + i + 3);
+        }
+
+        auto finalizeMesh = [](MeshSpec& m)
+        {
+            m.indexCount = 0;
+            m.vertexCount = (uint32_t)m.staticData.size();
+            m.staticVertexCount = m.vertexCount;
+
+            m.boundingBox = AABB();
+            for (auto& v : m.staticData) m.boundingBox.include(v.position);
+        };
+
+        finalizeMesh(leftMesh);
+        finalizeMesh(rightMesh);
+    }
+
+    bool SceneBuilder::canSplitMesh(uint32_t meshID) const
+    {
+        const auto& mesh = mMeshes[meshID];
+        return mesh.dynamicVertexCount == 0 && mesh.dynamicData.empty() && mesh.topology == Vao::Topology::TriangleList;
     }
 
     size_t SceneBuilder::countTriangles(const MeshGroup& meshGroup) const
@@ -1199,7 +1821,7 @@ namespace Falcor
         return bb;
     }
 
-    bool SceneBuilder::needsSplit(const MeshGroup& meshGroup, size_t& triangleCount) const
+    bool SceneBuilder::needsSplit(const MeshGroup& meshGroup, size_t& triangleCount, bool allowMeshSplit) const
     {
         assert(!meshGroup.meshList.empty());
         triangleCount = countTriangles(meshGroup);
@@ -1210,15 +1832,16 @@ namespace Falcor
         }
         else if (meshGroup.meshList.size() == 1)
         {
-            // Issue warning if single mesh exceeds the triangle count limit.
-            // TODO: Implement mesh splitting to handle this case.
+            // A single mesh that exceeds the triangle count limit can be split if the strategy supports it.
+            if (allowMeshSplit && canSplitMesh(meshGroup.meshList[0])) return true;
+
+            // Otherwise issue warning.
             const auto& mesh = mMeshes[meshGroup.meshList[0]];
             assert(mesh.getTriangleCount() == triangleCount);
             logWarning("Mesh '" + mesh.name + "' has " + std::to_string(triangleCount) + " triangles, expect extraneous GPU memory usage.");
 
             return false;
         }
-        assert(meshGroup.meshList.size() > 1);
         assert(triangleCount > kMaxTrianglesPerBLAS);
 
         return true;
@@ -1361,6 +1984,203 @@ namespace Falcor
         return leftList;
     }
 
+    SceneBuilder::MeshGroupList SceneBuilder::splitMeshGroupSAH(MeshGroup& meshGroup)
+    {
+        // This function recursively partitions a mesh group using a binned surface area heuristic (SAH).
+        // Meshes are binned by the centroid of their bounding box. Large meshes are binned by triangle centroids instead,
+        // and are split into two halves at the chosen plane, similar to splitMeshGroupMidpointMeshes().
+        // The cost of a split is the SAH cost of the two sides plus a penalty for the overlap between them,
+        // as rays in the overlap region have to traverse both BLASes.
+
+        // Early out if splitting is not needed or possible.
+        // A group with a single mesh over the limit is only split if the group is static (see needsSplit()).
+        size_t triangleCount = 0;
+        if (!needsSplit(meshGroup, triangleCount, meshGroup.isStatic)) return MeshGroupList{ std::move(meshGroup) };
+
+        // Large meshes are split if the group is static or has more than one mesh. This matches the check above, so a non-static
+        // single mesh is never split. Meshes that can't be split (see canSplitMesh()) are binned like small meshes.
+        const std::vector<uint32_t>& meshList = meshGroup.meshList;
+        const bool allowMeshSplit = meshGroup.isStatic || meshList.size() > 1;
+
+        // Classify the meshes. Large meshes are those that don't fit in a single bin on average.
+        std::vector<bool> isLarge(meshList.size());
+        std::vector<uint32_t> largeMeshes;
+        for (size_t i = 0; i < meshList.size(); i++)
+        {
+            const uint32_t meshID = meshList[i];
+            isLarge[i] = allowMeshSplit && canSplitMesh(meshID) && mMeshes[meshID].getTriangleCount() > triangleCount / kSAHBinCount;
+            if (isLarge[i]) largeMeshes.push_back(meshID);
+        }
+
+        // Compute the centroid bounds. The bounding box of a large mesh contains all its triangle centroids.
+        AABB centroidBounds;
+        for (size_t i = 0; i < meshList.size(); i++)
+        {
+            const AABB& bb = mMeshes[meshList[i]].boundingBox;
+            if (isLarge[i]) centroidBounds.include(bb);
+            else centroidBounds.include(bb.center());
+        }
+
+        const float3 extent = centroidBounds.extent();
+        float3 binScale;
+        for (int axis = 0; axis < 3; axis++) binScale[axis] = extent[axis] > 0.f ? kSAHBinCount / extent[axis] : 0.f;
+
+        auto getBin = [&](float centroid, int axis)
+        {
+            int bin = (int)((centroid - centroidBounds.minPoint[axis]) * binScale[axis]);
+            return (uint32_t)std::clamp(bin, 0, (int)kSAHBinCount - 1);
+        };
+
+        // Bin the meshes and the triangles of large meshes along all three axes.
+        struct SAHBin
+        {
+            AABB bounds;
+            size_t triangleCount = 0;
+        };
+        using SAHBins = std::array<std::array<SAHBin, kSAHBinCount>, 3>;
+
+        SAHBins bins;
+        for (size_t i = 0; i < meshList.size(); i++)
+        {
+            if (isLarge[i]) continue;
+            const auto& mesh = mMeshes[meshList[i]];
+            const float3 centroid = mesh.boundingBox.center();
+            for (int axis = 0; axis < 3; axis++)
+            {
+                auto& bin = bins[axis][getBin(centroid[axis], axis)];
+                bin.bounds.include(mesh.boundingBox);
+                bin.triangleCount += mesh.getTriangleCount();
+            }
+        }
+
+        std::vector<SAHBins> largeMeshBins(largeMeshes.size());
+        Threading::parallelFor(0, largeMeshes.size(), [&](size_t i)
+        {
+            const auto& mesh = mMeshes[largeMeshes[i]];
+            auto& meshBins = largeMeshBins[i];
+            for (uint32_t triangle = 0; triangle < mesh.getTriangleCount(); triangle++)
+            {
+                float3 p[3];
+                for (uint32_t j = 0; j < 3; j++)
+                {
+                    uint32_t vtxIndex = mesh.indexCount > 0 ? mesh.getIndex(triangle * 3 + j) : triangle * 3 + j;
+                    p[j] = mesh.staticData[vtxIndex].position;
+                }
+
+                // Compute the centroid the same way as splitIndexedMesh()/splitNonIndexedMesh().
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    float centroid = (p[0][axis] + p[1][axis] + p[2][axis]) / 3.f;
+                    auto& bin = meshBins[axis][getBin(centroid, axis)];
+                    for (uint32_t j = 0; j < 3; j++) bin.bounds.include(p[j]);
+                    bin.triangleCount++;
+                }
+            }
+        });
+
+        for (const auto& meshBins : largeMeshBins)
+        {
+            for (int axis = 0; axis < 3; axis++)
+            {
+                for (uint32_t b = 0; b < kSAHBinCount; b++)
+                {
+                    bins[axis][b].bounds.include(meshBins[axis][b].bounds);
+                    bins[axis][b].triangleCount += meshBins[axis][b].triangleCount;
+                }
+            }
+        }
+
+        // Evaluate the cost of splitting between each pair of bins.
+        // Splits that leave a small fraction of the triangles on one side are only used as a fallback, to avoid creating many small groups.
+        struct Split
+        {
+            float cost = std::numeric_limits<float>::infinity();
+            int axis = -1;
+            uint32_t bin = 0;
+        };
+        Split bestSplit, bestUnbalancedSplit;
+
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (binScale[axis] == 0.f) continue;
+
+            std::array<SAHBin, kSAHBinCount> right;
+            right[kSAHBinCount - 1] = bins[axis][kSAHBinCount - 1];
+            for (uint32_t b = kSAHBinCount - 1; b > 0; b--)
+            {
+                right[b - 1] = right[b];
+                right[b - 1].bounds.include(bins[axis][b - 1].bounds);
+                right[b - 1].triangleCount += bins[axis][b - 1].triangleCount;
+            }
+
+            SAHBin left;
+            for (uint32_t b = 1; b < kSAHBinCount; b++)
+            {
+                left.bounds.include(bins[axis][b - 1].bounds);
+                left.triangleCount += bins[axis][b - 1].triangleCount;
+                if (left.triangleCount == 0 || right[b].triangleCount == 0) continue;
+
+                AABB overlap = left.bounds;
+                overlap.intersection(right[b].bounds);
+                float overlapArea = overlap.valid() ? overlap.area() : 0.f;
+
+                float cost = left.bounds.area() * left.triangleCount + right[b].bounds.area() * right[b].triangleCount
+                    + kSAHOverlapPenalty * overlapArea * (left.triangleCount + right[b].triangleCount);
+
+                bool balanced = std::min(left.triangleCount, right[b].triangleCount) >= triangleCount / kSAHMinSplitFraction;
+                Split& split = balanced ? bestSplit : bestUnbalancedSplit;
+                if (cost < split.cost) split = { cost, axis, b };
+            }
+        }
+
+        if (bestSplit.axis < 0) bestSplit = bestUnbalancedSplit;
+
+        // If there is no valid split, fall back on splitting at the median mesh.
+        if (bestSplit.axis < 0)
+        {
+            return meshList.size() > 1 ? splitMeshGroupMedian(meshGroup) : MeshGroupList{ std::move(meshGroup) };
+        }
+
+        // Partition the meshes. Large meshes are split at the plane between the bins.
+        const int axis = bestSplit.axis;
+        const float pos = centroidBounds.minPoint[axis] + bestSplit.bin / binScale[axis];
+        std::vector<uint32_t> leftMeshes, rightMeshes;
+
+        for (size_t i = 0; i < meshList.size(); i++)
+        {
+            const uint32_t meshID = meshList[i];
+            if (isLarge[i])
+            {
+                auto result = splitMesh(meshID, axis, pos);
+                if (auto leftMeshID = result.first) leftMeshes.push_back(*leftMeshID);
+                if (auto rightMeshID = result.second) rightMeshes.push_back(*rightMeshID);
+            }
+            else
+            {
+                bool isLeft = getBin(mMeshes[meshID].boundingBox.center()[axis], axis) < bestSplit.bin;
+                (isLeft ? leftMeshes : rightMeshes).push_back(meshID);
+            }
+        }
+
+        // If either side contains all meshes, do not split further.
+        if (leftMeshes.empty() || rightMeshes.empty()) return MeshGroupList{ std::move(meshGroup) };
+
+        // Recursively split the left and right mesh groups.
+        MeshGroup leftGroup{ std::move(leftMeshes), meshGroup.isStatic };
+        MeshGroup rightGroup{ std::move(rightMeshes), meshGroup.isStatic };
+
+        MeshGroupList leftList = splitMeshGroupSAH(leftGroup);
+        MeshGroupList rightList = splitMeshGroupSAH(rightGroup);
+
+        // Move elements into a single list and return.
+        leftList.insert(
+            leftList.end(),
+            std::make_move_iterator(rightList.begin()),
+            std::make_move_iterator(rightList.end()));
+
+        return leftList;
+    }
+
     void SceneBuilder::optimizeGeometry()
     {
         // This function optimizes the geometry for raytracing performance and memory usage.
@@ -1380,7 +2200,7 @@ namespace Falcor
         {
             //auto groups = splitMeshGroupSimple(meshGroup);
             //auto groups = splitMeshGroupMedian(meshGroup);
-            auto groups = splitMeshGroupMidpointMeshes(meshGroup);
+            auto groups = is_set(mFlags, Flags::RTSplitGroupsSAH) ? splitMeshGroupSAH(meshGroup) : splitMeshGroupMidpointMeshes(meshGroup);
 
             if (groups.size() > 1) logWarning("SceneBuilder::optimizeGeometry() performance warning - Mesh group was split into " + std::to_string(groups.size()) + " groups");
 
@@ -1393,6 +2213,110 @@ namespace Falcor
         mMeshGroups = std::move(optimizedGroups);
     }
 
+    std::pair<MeshOptimizer::VertexCacheStats, MeshOptimizer::VertexCacheStats> SceneBuilder::optimizeVertexCache()
+    {
+        // This function reorders the triangles of each indexed triangle mesh for post-transform vertex cache efficiency,
+        // followed by reordering the vertices into the order they are first referenced to improve vertex fetch locality.
+        // Non-indexed meshes are left unchanged as they cannot benefit from the vertex cache.
+        if (is_set(mFlags, Flags::NonIndexedVertices)) return {};
+
+        std::vector<MeshOptimizer::VertexCacheStats> statsBefore(mMeshes.size());
+        std::vector<MeshOptimizer::VertexCacheStats> statsAfter(mMeshes.size());
+
+        Threading::parallelFor(0, mMeshes.size(), [&](size_t meshID)
+        {
+            auto& mesh = mMeshes[meshID];
+            if (mesh.topology != Vao::Topology::TriangleList || mesh.indexCount == 0) return;
+
+            std::vector<uint32_t> indices(mesh.indexCount);
+            for (uint32_t i = 0; i < mesh.indexCount; i++) indices[i] = mesh.getIndex(i);
+
+            statsBefore[meshID] = MeshOptimizer::analyzeVertexCache(indices, mesh.staticVertexCount);
+            MeshOptimizer::optimizeVertexCache(indices, mesh.staticVertexCount);
+            auto remap = MeshOptimizer::optimizeVertexFetch(indices, mesh.staticVertexCount);
+            statsAfter[meshID] = MeshOptimizer::analyzeVertexCache(indices, mesh.staticVertexCount);
+
+            MeshOptimizer::remapVertices(mesh.staticData, remap);
+            if (!mesh.dynamicData.empty())
+            {
+                // The dynamic vertices are parallel to the static vertices and reference them by their local index.
+                MeshOptimizer::remapVertices(mesh.dynamicData, remap);
+                for (auto& v : mesh.dynamicData) v.staticIndex = remap[v.staticIndex];
+            }
+
+            mesh.indexData = mesh.use16BitIndices ? compact16BitIndices(indices) : std::move(indices);
+        });
+
+        MeshOptimizer::VertexCacheStats before, after;
+        for (size_t i = 0; i < mMeshes.size(); i++)
+        {
+            before += statsBefore[i];
+            after += statsAfter[i];
+        }
+        return { before, after };
+    }
+
+    std::pair<size_t, size_t> SceneBuilder::generateMeshLods()
+    {
+        // This function generates a chain of simplified index buffers for each indexed triangle mesh.
+        // The levels reference the mesh's own vertices, so no vertex data is added. The error is measured in the
+        // space of the vertex data, which is world space for static meshes that have been pre-transformed.
+        if (is_set(mFlags, Flags::NonIndexedVertices)) return {};
+
+        Threading::parallelFor(0, mMeshes.size(), [&](size_t meshID)
+        {
+            auto& mesh = mMeshes[meshID];
+            mesh.lods.clear();
+            if (mesh.topology != Vao::Topology::TriangleList || mesh.indexCount == 0) return;
+
+            const uint32_t triangleCount = mesh.getTriangleCount();
+            if (triangleCount < 2 * kMeshLodMinTriangles) return;
+
+            std::vector<uint32_t> indices(mesh.indexCount);
+            for (uint32_t i = 0; i < mesh.indexCount; i++) indices[i] = mesh.getIndex(i);
+
+            std::vector<float3> positions(mesh.staticData.size());
+            for (size_t i = 0; i < positions.size(); i++) positions[i] = mesh.staticData[i].position;
+
+            std::vector<uint32_t> targets;
+            float target = (float)triangleCount;
+            for (uint32_t i = 0; i < kMeshLodCount; i++)
+            {
+                target *= kMeshLodTriangleRatio;
+                if (target < (float)kMeshLodMinTriangles) break;
+                targets.push_back((uint32_t)target);
+            }
+
+            float maxError = glm::length(mesh.boundingBox.extent()) * kMeshLodMaxRelativeError;
+            auto levels = MeshOptimizer::simplify(indices, positions, targets, maxError);
+
+            size_t prevIndexCount = indices.size();
+            for (auto& level : levels)
+            {
+                // Skip the levels that barely reduce the triangle count, as they cost memory without saving much work.
+                if ((float)level.indices.size() >= (float)prevIndexCount * kMeshLodMinReduction) break;
+                prevIndexCount = level.indices.size();
+
+                if (is_set(mFlags, Flags::OptimizeVertexCache)) MeshOptimizer::optimizeVertexCache(level.indices, (uint32_t)positions.size());
+
+                MeshSpec::LodSpec lod;
+                lod.indexCount = (uint32_t)level.indices.size();
+                lod.error = level.error;
+                lod.indexData = mesh.use16BitIndices ? compact16BitIndices(level.indices) : std::move(level.indices);
+                mesh.lods.push_back(std::move(lod));
+            }
+        });
+
+        size_t lodCount = 0;
+        size_t lodTriangleCount = 0;
+        for (const auto& mesh : mMeshes)
+        {
+            lodCount += mesh.lods.size();
+            for (const auto& lod : mesh.lods) lodTriangleCount += lod.indexCount / 3;
+        }
+        return { lodCount, lodTriangleCount };
+    }
+
     void SceneBuilder::createGlobalBuffers()
     {
         assert(mBuffersData.indexData.empty());
@@ -1409,6 +2333,7 @@ namespace Falcor
         for (const auto& mesh : mMeshes)
         {
             totalIndexDataCount += mesh.indexData.size();
+            for (const auto& lod : mesh.lods) totalIndexDataCount += lod.indexData.size();
             totalStaticVertexCount += mesh.staticData.size();
             totalDynamicVertexCount += mesh.dynamicData.size();
         }
@@ -1439,16 +2364,26 @@ namespace Falcor
             {
                 mesh.indexOffset = (uint32_t)mBuffersData.indexData.size();
                 mBuffersData.indexData.insert(mBuffersData.indexData.end(), mesh.indexData.begin(), mesh.indexData.end());
+
+                // The LOD indices follow the indices of the mesh.
+                for (auto& lod : mesh.lods)
+                {
+                    lod.indexOffset = (uint32_t)mBuffersData.indexData.size();
+                    mBuffersData.indexData.insert(mBuffersData.indexData.end(), lod.indexData.begin(), lod.indexData.end());
+                    lod.indexData.clear();
+                }
             }
 
             if (!mesh.dynamicData.empty())
             {
                 mBuffersData.dynamicData.insert(mBuffersData.dynamicData.end(), mesh.dynamicData.begin(), mesh.dynamicData.end());
 
-                // Patch vertex index references.
+                // Patch vertex index references and set the global matrix of the mesh instance.
+                assert(mesh.instances.size() == 1);
                 for (uint32_t i = 0; i < mesh.dynamicData.size(); ++i)
                 {
                     mBuffersData.dynamicData[mesh.dynamicVertexOffset + i].staticIndex += mesh.staticVertexOffset;
+                    mBuffersData.dynamicData[mesh.dynamicVertexOffset + i].globalMatrixID = mesh.instances[0];
                 }
             }
 
@@ -1507,19 +2442,23 @@ namespace Falcor
         std::vector<uint32_t> idMap(mMaterials.size());
 
         // Find unique set of materials.
+        // The materials are bucketed by a hash of their properties, so each material is only compared against the unique materials with the same hash.
+        std::unordered_map<size_t, std::vector<uint32_t>> uniqueMaterialsByHash;
         for (uint32_t id = 0; id < mMaterials.size(); ++id)
         {
             const auto& pMaterial = mMaterials[id];
-            auto it = std::find_if(uniqueMaterials.begin(), uniqueMaterials.end(), [&pMaterial] (const auto& m) { return *m == *pMaterial; });
-            if (it == uniqueMaterials.end())
+            auto& bucket = uniqueMaterialsByHash[pMaterial->getHash()];
+            auto it = std::find_if(bucket.begin(), bucket.end(), [&](uint32_t uniqueID) { return *uniqueMaterials[uniqueID] == *pMaterial; });
+            if (it == bucket.end())
             {
                 idMap[id] = (uint32_t)uniqueMaterials.size();
+                bucket.push_back(idMap[id]);
                 uniqueMaterials.push_back(pMaterial);
             }
             else
             {
-                logInfo("Removing duplicate material '" + pMaterial->getName() + "' (duplicate of '" + (*it)->getName() + "')");
-                idMap[id] = (uint32_t)std::distance(uniqueMaterials.begin(), it);
+                logInfo("Removing duplicate material '" + pMaterial->getName() + "' (duplicate of '" + uniqueMaterials[*it]->getName() + "')");
+                idMap[id] = *it;
             }
         }
 
@@ -1554,50 +2493,68 @@ namespace Falcor
     {
         // Match texture coordinate quantization for textured emissives to format of PackedEmissiveTriangle.
         // This is to avoid mismatch when sampling and evaluating emissive triangles.
-        // Note that non-emissive meshes are unmodified and use full precision texcoords.
+        // With compressed vertices, the texture coordinates of the other meshes are stored either in fp16 or as 16-bit unorms
+        // relative to their bounds. We use fp16 unless its quantization error exceeds the threshold and the unorms are more precise.
+        // Otherwise, non-emissive meshes are unmodified and use full precision texcoords.
+        const bool compressed = is_set(mFlags, Flags::CompressVertexData) && mBuffersData.dynamicData.empty();
+
         for (auto& mesh : mMeshes)
         {
             const auto& pMaterial = mMaterials[mesh.materialId];
-            if (pMaterial->getEmissiveTexture() != nullptr)
+            const bool isEmissive = pMaterial->getEmissiveTexture() != nullptr;
+            if (!isEmissive && !compressed) continue;
+
+            // Quantize texture coordinates to fp16. Also track the bounds and max error.
+            float2 minTexCrd = float2(std::numeric_limits<float>::infinity());
+            float2 maxTexCrd = float2(-std::numeric_limits<float>::infinity());
+            float2 maxError = float2(0);
+
+            for (uint32_t i = 0; i < mesh.staticVertexCount; ++i)
             {
-                // Quantize texture coordinates to fp16. Also track the bounds and max error.
-                float2 minTexCrd = float2(std::numeric_limits<float>::infinity());
-                float2 maxTexCrd = float2(-std::numeric_limits<float>::infinity());
-                float2 maxError = float2(0);
+                auto& v = mBuffersData.staticData[mesh.staticVertexOffset + i];
+                float2 texCrd = v.texCrd;
+                minTexCrd = min(minTexCrd, texCrd);
+                maxTexCrd = max(maxTexCrd, texCrd);
+                float2 quantizedTexCrd = f16tof32(f32tof16(texCrd));
+                if (isEmissive) v.texCrd = quantizedTexCrd;
+                maxError = max(maxError, abs(quantizedTexCrd - texCrd));
+            }
+            if (mesh.staticVertexCount == 0) continue;
 
-                for (uint32_t i = 0; i < mesh.staticVertexCount; ++i)
-                {
-                    auto& v = mBuffersData.staticData[mesh.staticVertexOffset + i];
-                    float2 texCrd = v.texCrd;
-                    minTexCrd = min(minTexCrd, texCrd);
-                    maxTexCrd = max(maxTexCrd, texCrd);
-                    v.texCrd = f16tof32(f32tof16(texCrd));
-                    maxError = max(maxError, abs(v.texCrd - texCrd));
-                }
+            // Compute maximum quantization error in texels.
+            // The texcoords are used for all texture channels so taking the maximum dimensions.
+            uint2 maxTexDim = pMaterial->getMaxTextureDimensions();
+            float2 maxAbsCrd = max(abs(minTexCrd), abs(maxTexCrd));
+            const bool isHalfRange = maxAbsCrd.x <= HLF_MAX && maxAbsCrd.y <= HLF_MAX;
+            float maxTexelError = isHalfRange ? std::max(maxError.x * maxTexDim.x, maxError.y * maxTexDim.y) : std::numeric_limits<float>::infinity();
 
-                // Issue warning if quantization errors are too large.
-                float2 maxAbsCrd = max(abs(minTexCrd), abs(maxTexCrd));
-                if (maxAbsCrd.x > HLF_MAX || maxAbsCrd.y > HLF_MAX)
+            if (!isEmissive && maxTexelError > kMaxTexelError && glm::all(glm::isfinite(minTexCrd)) && glm::all(glm::isfinite(maxTexCrd)))
+            {
+                // The unorms are rounded to the nearest of 65536 steps over the coordinate range.
+                float2 unormError = (maxTexCrd - minTexCrd) * (0.5f / 65535.f);
+                float unormTexelError = std::max(unormError.x * maxTexDim.x, unormError.y * maxTexDim.y);
+                if (unormTexelError < maxTexelError)
                 {
-                    logWarning("Texture coordinates for emissive textured mesh '" + mesh.name + "' are outside the representable range, expect rendering errors.");
+                    mesh.useUnormTexCrd = true;
+                    mesh.texCrdOffset = minTexCrd;
+                    mesh.texCrdScale = maxTexCrd - minTexCrd;
+                    maxTexelError = unormTexelError;
                 }
-                else
-                {
-                    // Compute maximum quantization error in texels.
-                    // The texcoords are used for all texture channels so taking the maximum dimensions.
-                    uint2 maxTexDim = pMaterial->getMaxTextureDimensions();
-                    maxError *= maxTexDim;
-                    float maxTexelError = std::max(maxError.x, maxError.y);
+            }
 
-                    if (maxTexelError > kMaxTexelError)
-                    {
-                        std::ostringstream oss;
-                        oss << "Texture coordinates for emissive textured mesh '" << mesh.name << "' have a large quantization error of " << maxTexelError << " texels. "
-                            << "The coordinate range is [" << minTexCrd.x << ", " << maxTexCrd.x << "] x [" << minTexCrd.y << ", " << maxTexCrd.y << "] for maximum texture dimensions ("
-                            << maxTexDim.x << ", " << maxTexDim.y << ").";
-                        logWarning(oss.str());
-                    }
-                }
+            // Issue warning if quantization errors are too large.
+            const std::string meshType = isEmissive ? "emissive textured mesh" : "compressed mesh";
+            if (!isHalfRange && !mesh.useUnormTexCrd)
+            {
+                logWarning("Texture coordinates for " + meshType + " '" + mesh.name + "' are outside the representable range, expect rendering errors.");
+            }
+            else if (maxTexelError > kMaxTexelError)
+            {
+                std::ostringstream oss;
+                oss << "Texture coordinates for " << meshType << " '" << mesh.name << "' have a large quantization error of " << maxTexelError << " texels. "
+                    << "The coordinate range is [" << minTexCrd.x << ", " << maxTexCrd.x << "] x [" << minTexCrd.y << ", " << maxTexCrd.y << "] for maximum texture dimensions ("
+                    << maxTexDim.x << ", " << maxTexDim.y << ").";
+                logWarning(oss.str());
             }
         }
     }
@@ -1607,7 +2564,7 @@ namespace Falcor
         for (auto& mesh : mMeshes) assert(mesh.topology == mMeshes[0].topology);
 
         // Create the index buffer.
-        size_t ibSize = sizeof(uint32_t) * mBuffersData.indexData.size();
+        size_t ibSize = sizeof(uint32_t) * mBuffersView.indexData.size();
         if (ibSize > std::numeric_limits<uint32_t>::max())
         {
             throw std::exception("Index buffer size exceeds 4GB");
@@ -1617,19 +2574,38 @@ namespace Falcor
         if (ibSize > 0)
         {
             ResourceBindFlags ibBindFlags = Resource::BindFlags::Index | ResourceBindFlags::ShaderResource;
-            pIB = Buffer::create(ibSize, ibBindFlags, Buffer::CpuAccess::None, mBuffersData.indexData.data());
+            pIB = Buffer::create(ibSize, ibBindFlags, Buffer::CpuAccess::None, mBuffersView.indexData.data());
         }
 
         // Create the vertex data structured buffer.
-        const size_t vertexCount = (uint32_t)mBuffersData.staticData.size();
-        size_t staticVbSize = sizeof(PackedStaticVertexData) * vertexCount;
+        // The uncompressed buffer is initialized by the AnimationController. Compressed vertex data is created and uploaded here.
+        const bool compressed = mpScene->mHasCompressedVertices;
+        const size_t vertexStride = compressed ? sizeof(CompressedStaticVertexData) : sizeof(PackedStaticVertexData);
+        const size_t vertexCount = (uint32_t)mBuffersView.staticData.size();
+        size_t staticVbSize = vertexStride * vertexCount;
         if (staticVbSize > std::numeric_limits<uint32_t>::max())
         {
             throw std::exception("Vertex buffer size exceeds 4GB");
         }
 
+        std::vector<CompressedStaticVertexData> compressedData;
+        if (compressed)
+        {
+            compressedData.resize(vertexCount);
+            Threading::parallelFor(0, mMeshes.size(), [&](size_t meshID)
+            {
+                const auto& mesh = mMeshes[meshID];
+                const auto& meshDesc = mpScene->mMeshDesc[meshID];
+                for (uint32_t i = mesh.staticVertexOffset; i < mesh.staticVertexOffset + mesh.staticVertexCount; i++)
+                {
+                    compressedData[i].pack(mBuffersView.staticData[i], meshDesc);
+                }
+            });
+            logInfo("Compressed static vertex data from " + formatByteSize(sizeof(PackedStaticVertexData) * vertexCount) + " to " + formatByteSize(staticVbSize) + ".");
+        }
+
         ResourceBindFlags vbBindFlags = ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess | ResourceBindFlags::Vertex;
-        Buffer::SharedPtr pStaticBuffer = Buffer::createStructured(sizeof(PackedStaticVertexData), (uint32_t)vertexCount, vbBindFlags, Buffer::CpuAccess::None, nullptr, false);
+        Buffer::SharedPtr pStaticBuffer = Buffer::createStructured((uint32_t)vertexStride, (uint32_t)vertexCount, vbBindFlags, Buffer::CpuAccess::None, compressed ? compressedData.data() : nullptr, false);
 
         Vao::BufferVec pVBs(Scene::kVertexBufferCount);
         pVBs[Scene::kStaticDataBufferIndex] = pStaticBuffer;
@@ -1661,11 +2637,20 @@ namespace Falcor
         // The layout only initializes the vertex data and draw ID layout. The skinning data doesn't get passed into the vertex shader.
         VertexLayout::SharedPtr pLayout = VertexLayout::create();
 
-        // Add the packed static vertex data layout.
+        // Add the packed or compressed static vertex data layout.
         VertexBufferLayout::SharedPtr pStaticLayout = VertexBufferLayout::create();
-        pStaticLayout->addElement(VERTEX_POSITION_NAME, offsetof(PackedStaticVertexData, position), ResourceFormat::RGB32Float, 1, VERTEX_POSITION_LOC);
-        pStaticLayout->addElement(VERTEX_PACKED_NORMAL_TANGENT_NAME, offsetof(PackedStaticVertexData, packedNormalTangent), ResourceFormat::RGB32Float, 1, VERTEX_PACKED_NORMAL_TANGENT_LOC);
-        pStaticLayout->addElement(VERTEX_TEXCOORD_NAME, offsetof(PackedStaticVertexData, texCrd), ResourceFormat::RG32Float, 1, VERTEX_TEXCOORD_LOC);
+        if (compressed)
+        {
+            pStaticLayout->addElement(VERTEX_POSITION_NAME, offsetof(CompressedStaticVertexData, packedPosition), ResourceFormat::RG32Uint, 1, VERTEX_POSITION_LOC);
+            pStaticLayout->addElement(VERTEX_PACKED_NORMAL_TANGENT_NAME, offsetof(CompressedStaticVertexData, packedNormalTangent), ResourceFormat::RGB32Uint, 1, VERTEX_PACKED_NORMAL_TANGENT_LOC);
+            pStaticLayout->addElement(VERTEX_TEXCOORD_NAME, offsetof(CompressedStaticVertexData, packedTexCrd), ResourceFormat::R32Uint, 1, VERTEX_TEXCOORD_LOC);
+        }
+        else
+        {
+            pStaticLayout->addElement(VERTEX_POSITION_NAME, offsetof(PackedStaticVertexData, position), ResourceFormat::RGB32Float, 1, VERTEX_POSITION_LOC);
+            pStaticLayout->addElement(VERTEX_PACKED_NORMAL_TANGENT_NAME, offsetof(PackedStaticVertexData, packedNormalTangent), ResourceFormat::RGB32Float, 1, VERTEX_PACKED_NORMAL_TANGENT_LOC);
+            pStaticLayout->addElement(VERTEX_TEXCOORD_NAME, offsetof(PackedStaticVertexData, texCrd), ResourceFormat::RG32Float, 1, VERTEX_TEXCOORD_LOC);
+        }
         pLayout->addBufferLayout(Scene::kStaticDataBufferIndex, pStaticLayout);
 
         // Add the draw ID layout.
@@ -1696,6 +2681,13 @@ namespace Falcor
         mpScene->mMeshHasDynamicData.resize(mMeshes.size());
         size_t drawCount = 0;
 
+        // Compressed vertices are only supported for static vertex data, as the skinning pass operates on PackedStaticVertexData.
+        if (is_set(mFlags, Flags::CompressVertexData))
+        {
+            if (mBuffersView.dynamicData.empty()) mpScene->mHasCompressedVertices = true;
+            else logWarning("Vertex data compression is not supported for scenes with skinned meshes. Using uncompressed vertex data.");
+        }
+
         // Setup all mesh data.
         for (uint32_t meshID = 0; meshID < mMeshes.size(); meshID++)
         {
@@ -1708,6 +2700,12 @@ namespace Falcor
             meshData[meshID].dynamicVbOffset = mesh.hasDynamicData ? mesh.dynamicVertexOffset : 0;
             assert(mesh.dynamicVertexCount == 0 || mesh.dynamicVertexCount == mesh.staticVertexCount);
 
+            if (!mesh.lods.empty())
+            {
+                if (mpScene->mMeshLods.empty()) mpScene->mMeshLods.resize(mMeshes.size());
+                for (const auto& lod : mesh.lods) mpScene->mMeshLods[meshID].push_back({ lod.indexOffset, lod.indexCount, lod.error });
+            }
+
             mpScene->mMeshNames.push_back(mesh.name);
 
             uint32_t meshFlags = 0;
@@ -1723,10 +2721,25 @@ namespace Falcor
             {
                 assert(mesh.instances.size() == 1);
                 mpScene->mMeshHasDynamicData[meshID] = true;
+            }
+        }
+
+        // Setup the decode parameters for compressed vertices.
+        // Positions are stored relative to the mesh bounds. The texture coordinate format was chosen in quantizeTexCoords().
+        if (mpScene->mHasCompressedVertices)
+        {
+            for (uint32_t meshID = 0; meshID < (uint32_t)mMeshes.size(); meshID++)
+            {
+                const auto& mesh = mMeshes[meshID];
+                auto& meshDesc = meshData[meshID];
+                meshDesc.positionOffset = mesh.boundingBox.center();
+                meshDesc.positionScale = mesh.boundingBox.extent() * 0.5f;
 
-                for (uint32_t i = 0; i < mesh.vertexCount; i++)
+                if (mesh.useUnormTexCrd)
                 {
-                    mBuffersData.dynamicData[mesh.dynamicVertexOffset + i].globalMatrixID = (uint32_t)mesh.instances[0];
+                    meshDesc.flags |= (uint32_t)MeshFlags::UseUnormTexCrd;
+                    meshDesc.texCrdOffset = mesh.texCrdOffset;
+                    meshDesc.texCrdScale = mesh.texCrdScale;
                 }
             }
         }
@@ -2006,6 +3019,16 @@ namespace Falcor
         flags.value("Force32BitIndices", SceneBuilder::Flags::Force32BitIndices);
         flags.value("RTDontMergeStatic", SceneBuilder::Flags::RTDontMergeStatic);
         flags.value("RTDontMergeDynamic", SceneBuilder::Flags::RTDontMergeDynamic);
+        flags.value("HashVertexMerging", SceneBuilder::Flags::HashVertexMerging);
+        flags.value("UseCache", SceneBuilder::Flags::UseCache);
+        flags.value("RebuildCache", SceneBuilder::Flags::RebuildCache);
+        flags.value("OptimizeVertexCache", SceneBuilder::Flags::OptimizeVertexCache);
+        flags.value("DeduplicateMeshes", SceneBuilder::Flags::DeduplicateMeshes);
+        flags.value("DeduplicateMeshesRigid", SceneBuilder::Flags::DeduplicateMeshesRigid);
+        flags.value("CompressVertexData", SceneBuilder::Flags::CompressVertexData);
+        flags.value("RTSplitGroupsSAH", SceneBuilder::Flags::RTSplitGroupsSAH);
+        flags.value("CompressTextures", SceneBuilder::Flags::CompressTextures);
+        flags.value("GenerateMeshLods", SceneBuilder::Flags::GenerateMeshLods);
         ScriptBindings::addEnumBinaryOperators(flags);
 
         pybind11::class_<SceneBuilder, SceneBuilder::SharedPtr> sceneBuilder(m, "SceneBuilder");
@@ -2028,6 +3051,7 @@ namespace Falcor
             return pSceneBuilder->import(filename, instanceMatrices, Dictionary(dict));
         }, "filename"_a, "dict"_a = pybind11::dict(), "instances"_a = std::vector<Transform>());
         sceneBuilder.def("addTriangleMesh", &SceneBuilder::addTriangleMesh, "triangleMesh"_a, "material"_a);
+        sceneBuilder.def("addTriangleMeshes", &SceneBuilder::addTriangleMeshes, "triangleMeshes"_a, "materials"_a);
         sceneBuilder.def("addMaterial", &SceneBuilder::addMaterial, "material"_a);
         sceneBuilder.def("getMaterial", &SceneBuilder::getMaterial, "name"_a);
         sceneBuilder.def("loadMaterialTexture", &SceneBuilder::loadMaterialTexture, "material"_a, "slot"_a, "filename"_a);
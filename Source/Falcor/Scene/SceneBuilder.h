@@ -28,8 +28,12 @@
 #pragma once
 #include "Scene.h"
 #include "Transform.h"
+#include "MeshOptimizer.h"
 #include "TriangleMesh.h"
 #include "Material/MaterialTextureLoader.h"
+#include "Core/Platform/MemoryMappedFile.h"
+#include "Utils/ArrayView.h"
+#include "Utils/CryptoUtils.h"
 #include "VertexAttrib.slangh"
 
 namespace Falcor
@@ -61,6 +65,16 @@ namespace Falcor
             Force32BitIndices           = 0x80,   ///< Force 32-bit indices for all meshes. By default, 16-bit indices are used for small meshes.
             RTDontMergeStatic           = 0x100,  ///< For raytracing, don't merge all static meshes into single pre-transformed BLAS.
             RTDontMergeDynamic          = 0x200,  ///< For raytracing, don't merge all dynamic meshes with identical transforms into single BLAS.
+            HashVertexMerging           = 0x400,  ///< Merge identical vertices using a hash table keyed on the quantized vertex attributes. This is faster for meshes with many split vertices, but vertices that differ by less than the merge threshold may not be merged.
+            UseCache                    = 0x800,  ///< Enable the scene cache. The post-processed scene is stored in a binary cache file keyed by the scene file contents and build flags, and loaded from it on subsequent imports without running the importer.
+            RebuildCache                = 0x1000, ///< Rebuild the scene cache. The scene is imported from the source file and the cache file is overwritten. Only applies when UseCache is set.
+            OptimizeVertexCache         = 0x2000, ///< Reorder the triangles of indexed meshes for post-transform vertex cache efficiency, and the vertices into the order they are first used. This improves rasterization performance at the cost of longer scene build times.
+            DeduplicateMeshes           = 0x4000, ///< Find meshes with identical geometry and material and replace the copies by instances of a single mesh. This reduces memory usage for scenes that store the same mesh many times.
+            DeduplicateMeshesRigid      = 0x8000, ///< Like DeduplicateMeshes, but also detect meshes that are identical up to a rigid transform (rotation and translation). The transform is added as a new scene graph node.
+            CompressVertexData          = 0x10000, ///< Store static vertex data in a compressed 24B format (16-bit positions relative to the mesh bounds, 16-bit texture coordinates). Not supported for scenes with skinned meshes.
+            RTSplitGroupsSAH            = 0x20000, ///< For raytracing, partition mesh groups that exceed the BLAS triangle limit using a binned SAH with a penalty for overlap between BLASes. By default, groups are split at the spatial midpoint.
+            CompressTextures            = 0x40000, ///< Load material textures from block compressed DDS files with a full mip chain. The files are created on the CPU and stored in a texture cache, and are reused as long as they are newer than the source images.
+            GenerateMeshLods            = 0x80000, ///< Generate a chain of simplified index buffers for each indexed mesh using quadric error metrics. The levels share the vertices of the mesh and are available through Scene::getMeshLod().
 
             Default = None
         };
@@ -267,6 +281,13 @@ namespace Falcor
         */
         bool import(const std::string& filename, const InstanceMatrices& instances = InstanceMatrices(), const Dictionary& dict = Dictionary());
 
+        /** Add a file that the imported scene depends on.
+            Importers call this for all files they read besides the scene file itself (material libraries, geometry buffers etc.),
+            so that the scene cache can detect changes to them.
+            \param[in] fullpath Full path of the file.
+        */
+        void addDependentFile(const std::string& fullpath);
+
         /** Get the scene. Make sure to add all the objects before calling this function
             \return nullptr if something went wrong, otherwise a new Scene object
         */
@@ -297,6 +318,15 @@ namespace Falcor
         */
         uint32_t addMesh(const Mesh& mesh);
 
+        /** Add a batch of meshes.
+            The meshes are pre-processed in parallel and then added in the order they are given,
+            so the resulting mesh IDs are deterministic.
+            Throws an exception if something went wrong.
+            \param meshes The meshes to add.
+            \return The IDs of the meshes in the scene, in the same order as the input.
+        */
+        std::vector<uint32_t> addMeshes(const std::vector<Mesh>& meshes);
+
         /** Add a triangle mesh.
             \param The triangle mesh to add.
             \param pMaterial The material to use for the mesh.
@@ -304,6 +334,13 @@ namespace Falcor
         */
         uint32_t addTriangleMesh(const TriangleMesh::SharedPtr& pTriangleMesh, const Material::SharedPtr& pMaterial);
 
+        /** Add a batch of triangle meshes. The meshes are pre-processed in parallel, see addMeshes().
+            \param triangleMeshes The triangle meshes to add.
+            \param materials The materials to use for the meshes. Must have the same size as the triangle mesh list.
+            \return The IDs of the meshes in the scene, in the same order as the input.
+        */
+        std::vector<uint32_t> addTriangleMeshes(const std::vector<TriangleMesh::SharedPtr>& triangleMeshes, const std::vector<Material::SharedPtr>& materials);
+
         /** Pre-process a mesh into the data format that is used in the global scene buffers.
             Throws an exception if something went wrong.
             \param mesh The mesh to pre-process.
@@ -415,7 +452,7 @@ namespace Falcor
         /** Set the environment map.
             \param[in] pEnvMap Environment map. Can be nullptr.
         */
-        void setEnvMap(EnvMap::SharedPtr pEnvMap) { mpEnvMap = pEnvMap; }
+        void setEnvMap(EnvMap::SharedPtr pEnvMap) { invalidateSceneCache(); mpEnvMap = pEnvMap; }
 
         // Cameras
 
@@ -490,6 +527,9 @@ namespace Falcor
         void setNodeInterpolationMode(uint32_t nodeID, Animation::InterpolationMode interpolationMode, bool enableWarping);
 
     private:
+        friend class SceneCache;
+        friend class SceneBuilderTest;
+
         SceneBuilder(Flags buildFlags);
 
         struct InternalNode : Node
@@ -517,9 +557,24 @@ namespace Falcor
             bool hasDynamicData = false;        ///< True if mesh has dynamic vertices.
             bool isStatic = false;              ///< True if mesh is non-instanced and static (not dynamic or animated).
             bool isFrontFaceCW = false;         ///< Indicate whether front-facing side has clockwise winding in object space.
+            bool useUnormTexCrd = false;        ///< True if compressed texture coordinates are stored as 16-bit unorms. This is calculated in quantizeTexCoords().
+            float2 texCrdOffset = float2(0.f);  ///< Minimum texture coordinate. Only used with useUnormTexCrd.
+            float2 texCrdScale = float2(0.f);   ///< Texture coordinate range. Only used with useUnormTexCrd.
             AABB boundingBox;                   ///< Mesh bounding-box in object space.
             std::vector<uint32_t> instances;    ///< Node IDs of all instances of this mesh.
 
+            /** Simplified level of detail of the mesh. The indices reference the vertices of the mesh and use the same index format.
+            */
+            struct LodSpec
+            {
+                uint32_t indexOffset = 0;       ///< Offset into the shared 'indexData' array. This is calculated in createGlobalBuffers().
+                uint32_t indexCount = 0;        ///< Number of indices.
+                float error = 0.f;              ///< Upper bound on the geometric error in object space (see MeshOptimizer::simplify()).
+                std::vector<uint32_t> indexData;
+            };
+
+            std::vector<LodSpec> lods;          ///< Simplified levels of detail in order of decreasing detail. Only generated with Flags::GenerateMeshLods.
+
             // Pre-processed vertex data.
             std::vector<uint32_t> indexData;    ///< Vertex indices in either 32-bit or 16-bit format packed tightly, or empty if non-indexed.
             std::vector<StaticVertexData> staticData;
@@ -565,6 +620,15 @@ namespace Falcor
             std::vector<DynamicVertexData> dynamicData;     ///< Additional vertex attributes for dynamic (skinned) meshes.
         } mBuffersData;
 
+        // View of the global geometry buffers used for creating the GPU resources.
+        // This references either mBuffersData or the memory mapped scene cache.
+        struct BuffersView
+        {
+            ArrayView<uint32_t> indexData;
+            ArrayView<PackedStaticVertexData> staticData;
+            ArrayView<DynamicVertexData> dynamicData;
+        } mBuffersView;
+
         struct CurveBuffersData
         {
             std::vector<uint32_t> indexData;                ///< Vertex indices for all curves in 32-bit.
@@ -607,6 +671,31 @@ namespace Falcor
         std::vector<Animation::SharedPtr> mAnimations;
         float mCameraSpeed = 1.0f;
 
+        struct ImportArgs
+        {
+            std::string filename;
+            InstanceMatrices instances;
+            Dictionary dict;
+        };
+
+        MemoryMappedFile::UniquePtr mpSceneCacheFile;   ///< Scene cache file the scene was loaded from. Kept mapped until the scene is created.
+        std::optional<ImportArgs> mCachedImport;        ///< Arguments of the import that was loaded from the scene cache. Used for importing again if more content is added.
+        std::optional<SHA1::MD> mSceneCacheKey;         ///< Key for writing the scene cache once the scene is created.
+        std::vector<std::string> mDependentFiles;       ///< Files the imported scene depends on besides the scene file itself.
+        uint32_t mImportDepth = 0;                      ///< Number of imports in progress.
+
+        // Scene cache helpers
+
+        /** Run the importer for a file, bypassing the scene cache.
+        */
+        bool importFile(const std::string& filename, const InstanceMatrices& instances, const Dictionary& dict);
+
+        /** Called before content is added to the builder.
+            Content added outside of an import is not covered by the scene cache key, so the scene is not written to the cache.
+            If the builder holds post-processed state restored from the cache, the scene is imported again without the cache.
+        */
+        void invalidateSceneCache();
+
         // Mesh helpers
 
         /** Split a mesh by the given axis-aligned splitting plane.
@@ -616,21 +705,26 @@ namespace Falcor
 
         void splitIndexedMesh(const MeshSpec& mesh, MeshSpec& leftMesh, MeshSpec& rightMesh, const int axis, const float pos);
         void splitNonIndexedMesh(const MeshSpec& mesh, MeshSpec& leftMesh, MeshSpec& rightMesh, const int axis, const float pos);
+        bool canSplitMesh(uint32_t meshID) const;
 
         // Mesh group helpers
         size_t countTriangles(const MeshGroup& meshGroup) const;
         AABB calculateBoundingBox(const MeshGroup& meshGroup) const;
-        bool needsSplit(const MeshGroup& meshGroup, size_t& triangleCount) const;
+        bool needsSplit(const MeshGroup& meshGroup, size_t& triangleCount, bool allowMeshSplit = false) const;
         MeshGroupList splitMeshGroupSimple(MeshGroup& meshGroup) const;
         MeshGroupList splitMeshGroupMedian(MeshGroup& meshGroup) const;
         MeshGroupList splitMeshGroupMidpointMeshes(MeshGroup& meshGroup);
+        MeshGroupList splitMeshGroupSAH(MeshGroup& meshGroup);
 
         // Post processing
         void removeUnusedMeshes();
-        void pretransformStaticMeshes();
-        void calculateMeshBoundingBoxes();
+        void deduplicateMeshes();
+        void compactMeshList();
+        void pretransformStaticMeshesAndCalculateBounds();
         void createMeshGroups();
         void optimizeGeometry();
+        std::pair<MeshOptimizer::VertexCacheStats, MeshOptimizer::VertexCacheStats> optimizeVertexCache();
+        std::pair<size_t, size_t> generateMeshLods();
         void createGlobalBuffers();
         void createCurveGlobalBuffers();
         void removeDuplicateMaterials();
@@ -0,0 +1,662 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "SceneCache.h"
+#include <filesystem>
+#include <fstream>
+
+namespace Falcor
+{
+    namespace
+    {
+        const uint32_t kMagic = 0x43435346; // 'FSCC'
+        const uint32_t kVersion = 5;
+
+        // Alignment of array data in the cache file. The file is mapped at a page boundary,
+        // so this guarantees that the arrays can be used in place.
+        const size_t kArrayAlignment = 16;
+
+        // Scene description formats that build the scene from other scene files and script logic.
+        // Their importers don't report the files they depend on.
+        const std::vector<std::string> kUnsupportedExtensions = { "pyscene", "fscene" };
+
+        // Build flags that only control the caching and don't affect the scene content.
+        const SceneBuilder::Flags kCacheFlags = SceneBuilder::Flags::UseCache | SceneBuilder::Flags::RebuildCache;
+
+        struct Header
+        {
+            uint32_t magic = kMagic;
+            uint32_t version = kVersion;
+            SceneCache::Key key;
+        };
+
+        std::optional<SHA1::MD> hashFile(const std::string& fullpath)
+        {
+            auto pFile = MemoryMappedFile::open(fullpath);
+            if (!pFile) return {};
+
+            SHA1 sha1;
+            sha1.update((uint64_t)pFile->getSize());
+            sha1.update(pFile->getData(), pFile->getSize());
+            return sha1.final();
+        }
+
+        std::string getCacheDirectory()
+        {
+            std::string dir = getAppDataDirectory();
+            if (dir.empty()) dir = getExecutableDirectory();
+            return dir + "/Falcor/SceneCache";
+        }
+
+        class CacheWriter
+        {
+        public:
+            CacheWriter(std::ostream& stream) : mStream(stream) {}
+
+            void write(const void* pData, size_t size)
+            {
+                mStream.write(reinterpret_cast<const char*>(pData), size);
+                mOffset += size;
+            }
+
+            template<typename T>
+            void write(const T& value)
+            {
+                static_assert(std::is_trivially_copyable_v<T>, "Value must be trivially copyable");
+                write(&value, sizeof(T));
+            }
+
+            void writeString(const std::string& str)
+            {
+                write((uint64_t)str.size());
+                write(str.data(), str.size());
+            }
+
+            template<typename T>
+            void writeArray(ArrayView<T> array)
+            {
+                static_assert(std::is_trivially_copyable_v<T>, "Array elements must be trivially copyable");
+                write((uint64_t)array.size());
+                align();
+                write(array.data(), array.size() * sizeof(T));
+            }
+
+            template<typename T>
+            void writeVector(const std::vector<T>& v) { writeArray(ArrayView<T>(v)); }
+
+        private:
+            void align()
+            {
+                static const uint8_t kZeros[kArrayAlignment] = {};
+                size_t padding = (kArrayAlignment - mOffset % kArrayAlignment) % kArrayAlignment;
+                write(kZeros, padding);
+            }
+
+            std::ostream& mStream;
+            size_t mOffset = 0;
+        };
+
+        class CacheReader
+        {
+        public:
+            CacheReader(const void* pData, size_t size) : mpData(reinterpret_cast<const uint8_t*>(pData)), mSize(size) {}
+
+            void read(void* pData, size_t size)
+            {
+                std::memcpy(pData, advance(size), size);
+            }
+
+            template<typename T>
+            T read()
+            {
+                static_assert(std::is_trivially_copyable_v<T>, "Value must be trivially copyable");
+                T value;
+                read(&value, sizeof(T));
+                return value;
+            }
+
+            std::string readString()
+            {
+                size_t size = readSize(1);
+                return std::string(reinterpret_cast<const char*>(advance(size)), size);
+            }
+
+            /** Read an array without copying. The returned view points into the mapped file.
+            */
+            template<typename T>
+            ArrayView<T> readArray()
+            {
+                size_t count = readSize(sizeof(T));
+                align();
+                return ArrayView<T>(reinterpret_cast<const T*>(advance(count * sizeof(T))), count);
+            }
+
+            template<typename T>
+            std::vector<T> readVector()
+            {
+                ArrayView<T> array = readArray<T>();
+                return std::vector<T>(array.begin(), array.end());
+            }
+
+        private:
+            const uint8_t* advance(size_t size)
+            {
+                if (size > mSize - mOffset) throw std::runtime_error("Unexpected end of file");
+                const uint8_t* ptr = mpData + mOffset;
+                mOffset += size;
+                return ptr;
+            }
+
+            size_t readSize(size_t elementSize)
+            {
+                uint64_t count = read<uint64_t>();
+                if (count > (mSize - mOffset) / elementSize) throw std::runtime_error("Invalid array size");
+                return (size_t)count;
+            }
+
+            void align()
+            {
+                advance((kArrayAlignment - mOffset % kArrayAlignment) % kArrayAlignment);
+            }
+
+            const uint8_t* mpData;
+            size_t mSize;
+            size_t mOffset = 0;
+        };
+
+        void writeAnimatable(CacheWriter& writer, const Animatable& animatable)
+        {
+            writer.write(animatable.hasAnimation());
+            writer.write(animatable.isAnimated());
+            writer.write(animatable.getNodeID());
+        }
+
+        void readAnimatable(CacheReader& reader, Animatable& animatable)
+        {
+            animatable.setHasAnimation(reader.read<bool>());
+            animatable.setIsAnimated(reader.read<bool>());
+            animatable.setNodeID(reader.read<uint32_t>());
+        }
+    }
+
+    bool SceneCache::isSupportedFile(const std::string& filename)
+    {
+        std::string ext = getExtensionFromFile(filename);
+        return std::find(kUnsupportedExtensions.begin(), kUnsupportedExtensions.end(), ext) == kUnsupportedExtensions.end();
+    }
+
+    std::optional<SceneCache::Key> SceneCache::computeKey(const std::string& fullpath, SceneBuilder::Flags flags, const SceneBuilder::InstanceMatrices& instances, const Dictionary& dict)
+    {
+        auto fileHash = hashFile(fullpath);
+        if (!fileHash) return {};
+
+        SHA1 sha1;
+        sha1.update(kVersion);
+
+        // Hash the sizes of the serialized structs to invalidate the cache when their layout changes.
+        sha1.update(sizeof(PackedStaticVertexData));
+        sha1.update(sizeof(DynamicVertexData));
+        sha1.update(sizeof(MaterialData));
+        sha1.update(sizeof(LightData));
+        sha1.update(sizeof(CameraData));
+
+        sha1.update(flags & ~kCacheFlags);
+        sha1.update((uint64_t)instances.size());
+        for (const auto& m : instances) sha1.update(m);
+        sha1.update(dict.toString());
+
+        sha1.update(*fileHash);
+
+        return sha1.final();
+    }
+
+    std::string SceneCache::getCacheFilename(const Key& key)
+    {
+        return getCacheDirectory() + "/" + SHA1::toString(key) + ".bin";
+    }
+
+    void SceneCache::writeCache(const SceneBuilder& builder, const Key& key)
+    {
+        if (!builder.mCurves.empty() || !builder.mCustomPrimitiveAABBs.empty() || !builder.mVolumes.empty() || !builder.mGrids.empty() || builder.mpEnvMap)
+        {
+            throw std::runtime_error("Scenes with curves, custom primitives, volumes or environment maps can't be cached.");
+        }
+
+        // Write to a temporary file first and rename it when done. This avoids leaving partially written cache files behind.
+        std::string filename = getCacheFilename(key);
+        writeFileAtomic(filename, [&](std::ostream& stream)
+        {
+            CacheWriter writer(stream);
+
+            Header header;
+            header.key = key;
+            writer.write(header);
+
+            // Dependent files.
+            writer.write((uint64_t)builder.mDependentFiles.size());
+            for (const auto& dependentFile : builder.mDependentFiles)
+            {
+                auto fileHash = hashFile(dependentFile);
+                if (!fileHash) throw std::runtime_error("Failed to read dependent file '" + dependentFile + "'.");
+                writer.writeString(dependentFile);
+                writer.write(*fileHash);
+            }
+
+            // Geometry buffers.
+            writer.writeArray(builder.mBuffersView.indexData);
+            writer.writeArray(builder.mBuffersView.staticData);
+            writer.writeArray(builder.mBuffersView.dynamicData);
+
+            // Meshes.
+            writer.write((uint64_t)builder.mMeshes.size());
+            for (const auto& mesh : builder.mMeshes)
+            {
+                writer.writeString(mesh.name);
+                writer.write(mesh.topology);
+                writer.write(mesh.materialId);
+                writer.write(mesh.staticVertexOffset);
+                writer.write(mesh.staticVertexCount);
+                writer.write(mesh.dynamicVertexOffset);
+                writer.write(mesh.dynamicVertexCount);
+                writer.write(mesh.indexOffset);
+                writer.write(mesh.indexCount);
+                writer.write(mesh.vertexCount);
+                writer.write(mesh.use16BitIndices);
+                writer.write(mesh.hasDynamicData);
+                writer.write(mesh.isStatic);
+                writer.write(mesh.isFrontFaceCW);
+                writer.write(mesh.useUnormTexCrd);
+                writer.write(mesh.texCrdOffset);
+                writer.write(mesh.texCrdScale);
+                writer.write(mesh.boundingBox);
+                writer.writeVector(mesh.instances);
+
+                writer.write((uint64_t)mesh.lods.size());
+                for (const auto& lod : mesh.lods)
+                {
+                    writer.write(lod.indexOffset);
+                    writer.write(lod.indexCount);
+                    writer.write(lod.error);
+                }
+            }
+
+            // Mesh groups.
+            writer.write((uint64_t)builder.mMeshGroups.size());
+            for (const auto& meshGroup : builder.mMeshGroups)
+            {
+                writer.writeVector(meshGroup.meshList);
+                writer.write(meshGroup.isStatic);
+            }
+
+            // Scene graph.
+            writer.write((uint64_t)builder.mSceneGraph.size());
+            for (const auto& node : builder.mSceneGraph)
+            {
+                writer.writeString(node.name);
+                writer.write(node.transform);
+                writer.write(node.localToBindPose);
+                writer.write(node.parent);
+                writer.writeVector(node.children);
+                writer.writeVector(node.meshes);
+                writer.writeVector(node.curves);
+            }
+
+            // Materials. Textures are stored by their source filename and loaded again when reading the cache.
+            writer.write((uint64_t)builder.mMaterials.size());
+            for (const auto& pMaterial : builder.mMaterials)
+            {
+                writer.writeString(pMaterial->mName);
+                writer.write(pMaterial->mData);
+                writer.write(pMaterial->mOcclusionMapEnabled);
+                const Transform& texTransform = pMaterial->getTextureTransform();
+                writer.write(texTransform.getTranslation());
+                writer.write(texTransform.getScaling());
+                writer.write(texTransform.getRotation());
+
+                for (uint32_t slot = 0; slot < (uint32_t)Material::TextureSlot::Count; slot++)
+                {
+                    auto pTexture = pMaterial->getTexture((Material::TextureSlot)slot);
+                    std::string textureFilename = pTexture ? pTexture->getSourceFilename() : "";
+                    if (pTexture && textureFilename.empty())
+                    {
+                        throw std::runtime_error("Material '" + pMaterial->getName() + "' uses a texture that was not loaded from a file.");
+                    }
+                    writer.writeString(textureFilename);
+                }
+            }
+
+            // Lights.
+            writer.write((uint64_t)builder.mLights.size());
+            for (const auto& pLight : builder.mLights)
+            {
+                writer.write(pLight->getType());
+                writer.writeString(pLight->getName());
+                writer.write(pLight->mData);
+                writer.write(pLight->isActive());
+                writeAnimatable(writer, *pLight);
+
+                switch (pLight->getType())
+                {
+                case LightType::Distant:
+                    writer.write(std::static_pointer_cast<DistantLight>(pLight)->getAngle());
+                    break;
+                case LightType::Rect:
+                case LightType::Disc:
+                case LightType::Sphere:
+                {
+                    auto pAreaLight = std::static_pointer_cast<AnalyticAreaLight>(pLight);
+                    writer.write(pAreaLight->getScaling());
+                    writer.write(pAreaLight->getTransformMatrix());
+                    break;
+                }
+                default:
+                    break;
+                }
+            }
+
+            // Cameras.
+            writer.write((uint64_t)builder.mCameras.size());
+            for (const auto& pCamera : builder.mCameras)
+            {
+                writer.writeString(pCamera->getName());
+                writer.write(pCamera->getData());
+                writer.write(pCamera->mPreserveHeight);
+                writeAnimatable(writer, *pCamera);
+            }
+            auto selectedCamera = std::find(builder.mCameras.begin(), builder.mCameras.end(), builder.mpSelectedCamera);
+            writer.write((uint32_t)std::distance(builder.mCameras.begin(), selectedCamera));
+            writer.write(builder.mCameraSpeed);
+
+            // Animations.
+            writer.write((uint64_t)builder.mAnimations.size());
+            for (const auto& pAnimation : builder.mAnimations)
+            {
+                writer.writeString(pAnimation->getName());
+                writer.write(pAnimation->getNodeID());
+                writer.write(pAnimation->getDuration());
+                writer.write(pAnimation->getPreInfinityBehavior());
+                writer.write(pAnimation->getPostInfinityBehavior());
+                writer.write(pAnimation->getInterpolationMode());
+                writer.write(pAnimation->isWarpingEnabled());
+                writer.writeVector(pAnimation->mKeyframeData.times);
+                writer.writeVector(pAnimation->mKeyframeData.translations);
+                writer.writeVector(pAnimation->mKeyframeData.scalings);
+                writer.writeVector(pAnimation->mKeyframeData.rotations);
+            }
+
+            writer.write(builder.mRenderSettings);
+        });
+
+        logInfo("Wrote scene cache '" + filename + "'.");
+    }
+
+    bool SceneCache::readCache(SceneBuilder& builder, const Key& key)
+    {
+        std::string filename = getCacheFilename(key);
+        if (!doesFileExist(filename)) return false;
+
+        auto pFile = MemoryMappedFile::open(filename);
+        if (!pFile)
+        {
+            logWarning("Failed to open scene cache '" + filename + "'.");
+            return false;
+        }
+
+        SceneBuilder::BuffersView buffersView;
+        SceneBuilder::MeshList meshes;
+        SceneBuilder::MeshGroupList meshGroups;
+        SceneBuilder::SceneGraph sceneGraph;
+        SceneBuilder::MaterialList materials;
+        std::vector<std::array<std::string, (size_t)Material::TextureSlot::Count>> textureFilenames;
+        SceneBuilder::LightList lights;
+        SceneBuilder::CameraList cameras;
+        Camera::SharedPtr pSelectedCamera;
+        float cameraSpeed;
+        SceneBuilder::AnimationList animations;
+        Scene::RenderSettings renderSettings;
+
+        try
+        {
+            CacheReader reader(pFile->getData(), pFile->getSize());
+
+            auto header = reader.read<Header>();
+            if (header.magic != kMagic || header.version != kVersion || header.key != key)
+            {
+                throw std::runtime_error("Invalid header");
+            }
+
+            // Dependent files. A changed file is not an error, the scene just needs to be imported again.
+            auto dependentFileCount = reader.read<uint64_t>();
+            for (uint64_t i = 0; i < dependentFileCount; i++)
+            {
+                auto dependentFile = reader.readString();
+                auto fileHash = reader.read<SHA1::MD>();
+                if (hashFile(dependentFile) != fileHash)
+                {
+                    logInfo("Scene cache '" + filename + "' is out of date, '" + dependentFile + "' has changed.");
+                    return false;
+                }
+            }
+
+            // Geometry buffers.
+            buffersView.indexData = reader.readArray<uint32_t>();
+            buffersView.staticData = reader.readArray<PackedStaticVertexData>();
+            buffersView.dynamicData = reader.readArray<DynamicVertexData>();
+
+            // Meshes.
+            meshes.resize(reader.read<uint64_t>());
+            for (auto& mesh : meshes)
+            {
+                mesh.name = reader.readString();
+                mesh.topology = reader.read<Vao::Topology>();
+                mesh.materialId = reader.read<uint32_t>();
+                mesh.staticVertexOffset = reader.read<uint32_t>();
+                mesh.staticVertexCount = reader.read<uint32_t>();
+                mesh.dynamicVertexOffset = reader.read<uint32_t>();
+                mesh.dynamicVertexCount = reader.read<uint32_t>();
+                mesh.indexOffset = reader.read<uint32_t>();
+                mesh.indexCount = reader.read<uint32_t>();
+                mesh.vertexCount = reader.read<uint32_t>();
+                mesh.use16BitIndices = reader.read<bool>();
+                mesh.hasDynamicData = reader.read<bool>();
+                mesh.isStatic = reader.read<bool>();
+                mesh.isFrontFaceCW = reader.read<bool>();
+                mesh.useUnormTexCrd = reader.read<bool>();
+                mesh.texCrdOffset = reader.read<float2>();
+                mesh.texCrdScale = reader.read<float2>();
+                mesh.boundingBox = reader.read<AABB>();
+                mesh.instances = reader.readVector<uint32_t>();
+
+                mesh.lods.resize(reader.read<uint64_t>());
+                for (auto& lod : mesh.lods)
+                {
+                    lod.indexOffset = reader.read<uint32_t>();
+                    lod.indexCount = reader.read<uint32_t>();
+                    lod.error = reader.read<float>();
+                }
+            }
+
+            // Mesh groups.
+            meshGroups.resize(reader.read<uint64_t>());
+            for (auto& meshGroup : meshGroups)
+            {
+                meshGroup.meshList = reader.readVector<uint32_t>();
+                meshGroup.isStatic = reader.read<bool>();
+            }
+
+            // Scene graph.
+            sceneGraph.resize(reader.read<uint64_t>());
+            for (auto& node : sceneGraph)
+            {
+                node.name = reader.readString();
+                node.transform = reader.read<glm::mat4>();
+                node.localToBindPose = reader.read<glm::mat4>();
+                node.parent = reader.read<uint32_t>();
+                node.children = reader.readVector<uint32_t>();
+                node.meshes = reader.readVector<uint32_t>();
+                node.curves = reader.readVector<uint32_t>();
+            }
+
+            // Materials.
+            materials.resize(reader.read<uint64_t>());
+            textureFilenames.resize(materials.size());
+            for (size_t i = 0; i < materials.size(); i++)
+            {
+                auto pMaterial = Material::create(reader.readString());
+                pMaterial->mData = reader.read<MaterialData>();
+                pMaterial->mOcclusionMapEnabled = reader.read<bool>();
+                Transform texTransform;
+                texTransform.setTranslation(reader.read<float3>());
+                texTransform.setScaling(reader.read<float3>());
+                texTransform.setRotation(reader.read<glm::quat>());
+                pMaterial->setTextureTransform(texTransform);
+
+                for (auto& textureFilename : textureFilenames[i]) textureFilename = reader.readString();
+                materials[i] = pMaterial;
+            }
+
+            // Lights.
+            lights.resize(reader.read<uint64_t>());
+            for (auto& pLight : lights)
+            {
+                auto type = reader.read<LightType>();
+                auto name = reader.readString();
+                auto data = reader.read<LightData>();
+                bool active = reader.read<bool>();
+
+                switch (type)
+                {
+                case LightType::Point:
+                    pLight = PointLight::create(name);
+                    break;
+                case LightType::Directional:
+                    pLight = DirectionalLight::create(name);
+                    break;
+                case LightType::Distant:
+                    pLight = DistantLight::create(name);
+                    break;
+                case LightType::Rect:
+                    pLight = RectLight::create(name);
+                    break;
+                case LightType::Disc:
+                    pLight = DiscLight::create(name);
+                    break;
+                case LightType::Sphere:
+                    pLight = SphereLight::create(name);
+                    break;
+                default:
+                    throw std::runtime_error("Invalid light type");
+                }
+
+                readAnimatable(reader, *pLight);
+
+                if (type == LightType::Distant)
+                {
+                    std::static_pointer_cast<DistantLight>(pLight)->setAngle(reader.read<float>());
+                }
+                else if (type == LightType::Rect || type == LightType::Disc || type == LightType::Sphere)
+                {
+                    auto pAreaLight = std::static_pointer_cast<AnalyticAreaLight>(pLight);
+                    pAreaLight->setScaling(reader.read<float3>());
+                    pAreaLight->setTransformMatrix(reader.read<glm::mat4>());
+                }
+
+                // Restore the light data last so that it matches the cached state exactly.
+                pLight->mData = data;
+                pLight->mPrevData = data;
+                pLight->setActive(active);
+            }
+
+            // Cameras.
+            cameras.resize(reader.read<uint64_t>());
+            for (auto& pCamera : cameras)
+            {
+                pCamera = Camera::create(reader.readString());
+                pCamera->mData = reader.read<CameraData>();
+                pCamera->mPreserveHeight = reader.read<bool>();
+                pCamera->mDirty = true;
+                readAnimatable(reader, *pCamera);
+            }
+            uint32_t selectedCamera = reader.read<uint32_t>();
+            if (selectedCamera < cameras.size()) pSelectedCamera = cameras[selectedCamera];
+            cameraSpeed = reader.read<float>();
+
+            // Animations.
+            animations.resize(reader.read<uint64_t>());
+            for (auto& pAnimation : animations)
+            {
+                auto name = reader.readString();
+                auto nodeID = reader.read<uint32_t>();
+                auto duration = reader.read<double>();
+                pAnimation = Animation::create(name, nodeID, duration);
+                pAnimation->setPreInfinityBehavior(reader.read<Animation::Behavior>());
+                pAnimation->setPostInfinityBehavior(reader.read<Animation::Behavior>());
+                pAnimation->setInterpolationMode(reader.read<Animation::InterpolationMode>());
+                pAnimation->setEnableWarping(reader.read<bool>());
+                auto& keyframeData = pAnimation->mKeyframeData;
+                keyframeData.times = reader.readVector<double>();
+                keyframeData.translations = reader.readVector<float4>();
+                keyframeData.scalings = reader.readVector<float4>();
+                keyframeData.rotations = reader.readVector<float4>();
+            }
+
+            renderSettings = reader.read<Scene::RenderSettings>();
+        }
+        catch (const std::exception& e)
+        {
+            logWarning("Failed to read scene cache '" + filename + "'. " + e.what());
+            return false;
+        }
+
+        // Commit the cached state to the builder.
+        builder.mBuffersView = buffersView;
+        builder.mMeshes = std::move(meshes);
+        builder.mMeshGroups = std::move(meshGroups);
+        builder.mSceneGraph = std::move(sceneGraph);
+        builder.mMaterials = std::move(materials);
+        builder.mLights = std::move(lights);
+        builder.mCameras = std::move(cameras);
+        builder.mpSelectedCamera = pSelectedCamera;
+        builder.mCameraSpeed = cameraSpeed;
+        builder.mAnimations = std::move(animations);
+        builder.mRenderSettings = renderSettings;
+        builder.mpSceneCacheFile = std::move(pFile);
+
+        for (size_t i = 0; i < builder.mMaterials.size(); i++)
+        {
+            for (uint32_t slot = 0; slot < (uint32_t)Material::TextureSlot::Count; slot++)
+            {
+                const auto& textureFilename = textureFilenames[i][slot];
+                if (!textureFilename.empty()) builder.loadMaterialTexture(builder.mMaterials[i], (Material::TextureSlot)slot, textureFilename);
+            }
+        }
+
+        logInfo("Loaded scene cache '" + filename + "'.");
+        return true;
+    }
+}
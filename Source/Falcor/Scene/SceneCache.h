@@ -0,0 +1,89 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "SceneBuilder.h"
+#include "Utils/CryptoUtils.h"
+#include <optional>
+
+namespace Falcor
+{
+    /** Helper class for reading and writing the binary scene cache.
+
+        The scene cache stores the post-processed state of a SceneBuilder, i.e. the global
+        geometry buffers, mesh specs, mesh groups, scene graph, materials (with texture filenames),
+        lights, cameras and animations. Loading a scene from the cache skips both the importer
+        and the post-processing done in SceneBuilder::getScene(). The geometry buffers are
+        memory mapped and passed directly to the GPU buffer creation without copying.
+
+        Cache files are keyed by a hash of the scene file contents, the build flags, the
+        instance matrices and the importer dictionary. Files referenced by the scene file are
+        only known after running the importer (see SceneBuilder::addDependentFile()). Their
+        paths and content hashes are stored in the cache file and checked when reading it.
+    */
+    class dlldecl SceneCache
+    {
+    public:
+        using Key = SHA1::MD;
+
+        /** Check if a scene file can be cached.
+            \param[in] filename Scene filename.
+            \return Returns true if the scene file can be cached.
+        */
+        static bool isSupportedFile(const std::string& filename);
+
+        /** Compute the cache key for a scene.
+            \param[in] fullpath Full path of the scene file.
+            \param[in] flags Scene builder flags.
+            \param[in] instances Instance matrices passed to the importer.
+            \param[in] dict Dictionary passed to the importer.
+            \return Returns the cache key, or an empty optional if the scene file could not be read.
+        */
+        static std::optional<Key> computeKey(const std::string& fullpath, SceneBuilder::Flags flags, const SceneBuilder::InstanceMatrices& instances, const Dictionary& dict);
+
+        /** Get the filename of the cache file for a given key.
+        */
+        static std::string getCacheFilename(const Key& key);
+
+        /** Write the post-processed state of a scene builder to the cache.
+            This throws an exception if the scene can't be cached or writing the cache file failed.
+            \param[in] builder Scene builder. This must be called after the scene has been created.
+            \param[in] key Cache key.
+        */
+        static void writeCache(const SceneBuilder& builder, const Key& key);
+
+        /** Read the post-processed state of a scene builder from the cache.
+            The builder must be empty. On success, the builder keeps the cache file mapped
+            until the scene has been created. Material textures are requested through the
+            builder's texture loader.
+            \param[in] builder Scene builder.
+            \param[in] key Cache key.
+            \return Returns true if the scene was loaded from the cache, false if no valid cache exists or a dependent file has changed.
+        */
+        static bool readCache(SceneBuilder& builder, const Key& key);
+    };
+}
@@ -27,103 +27,325 @@
  **************************************************************************/
 #include "stdafx.h"
 #include "AsyncTextureLoader.h"
+#include "Utils/Image/ImageIO.h"
+#include <filesystem>
+#include <fstream>
 
 namespace Falcor
 {
     namespace
     {
         constexpr size_t kUploadsPerFlush = 16; ///< Number of texture uploads before issuing a flush (to keep upload heap from growing).
+        constexpr uint64_t kDefaultMemoryBudget = 1ull << 30;
+
+        struct GlobalState
+        {
+            std::mutex mutex;
+            uint64_t defaultMemoryBudget = kDefaultMemoryBudget;
+            AsyncTextureLoader::Stats stats;
+        };
+
+        GlobalState& getGlobalState()
+        {
+            static GlobalState state;
+            return state;
+        }
+
+        double calcSeconds(CpuTimer::TimePoint start, CpuTimer::TimePoint end)
+        {
+            return CpuTimer::calcDuration(start, end) * 1e-3;
+        }
+
+        bool readFile(const std::string& path, std::vector<uint8_t>& data)
+        {
+            std::ifstream file(path, std::ios::binary | std::ios::ate);
+            if (!file) return false;
+            data.resize((size_t)file.tellg());
+            file.seekg(0);
+            return (bool)file.read(reinterpret_cast<char*>(data.data()), data.size());
+        }
     }
 
-    AsyncTextureLoader::AsyncTextureLoader(size_t threadCount)
+    void AsyncTextureLoader::Stats::add(const Stats& other)
     {
-        runWorkers(threadCount);
+        requestCount += other.requestCount;
+        failedCount += other.failedCount;
+        decodedBytes += other.decodedBytes;
+        peakInFlightBytes = std::max(peakInFlightBytes, other.peakInFlightBytes);
+        flushCount += other.flushCount;
+        queueTime += other.queueTime;
+        decodeTime += other.decodeTime;
+        uploadWaitTime += other.uploadWaitTime;
+        uploadTime += other.uploadTime;
+    }
+
+    pybind11::dict AsyncTextureLoader::Stats::toPython() const
+    {
+        pybind11::dict d;
+        d["requestCount"] = requestCount;
+        d["failedCount"] = failedCount;
+        d["decodedBytes"] = decodedBytes;
+        d["peakInFlightBytes"] = peakInFlightBytes;
+        d["flushCount"] = flushCount;
+        d["queueTime"] = queueTime;
+        d["decodeTime"] = decodeTime;
+        d["uploadWaitTime"] = uploadWaitTime;
+        d["uploadTime"] = uploadTime;
+        return d;
+    }
+
+    AsyncTextureLoader::AsyncTextureLoader(size_t maxDecodeTasks, uint64_t memoryBudget)
+        : mMaxDecodeTasks(std::max(maxDecodeTasks, (size_t)1))
+        , mMemoryBudget(memoryBudget)
+    {
+        mUploadThread = std::thread([this] () { runUploadThread(); });
     }
 
     AsyncTextureLoader::~AsyncTextureLoader()
     {
-        terminateWorkers();
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondition.wait(lock, [&] () { return mPendingCount == 0 && mActiveDecodeTasks == 0; });
+            mTerminate = true;
+        }
+
+        mCondition.notify_all();
+        mUploadThread.join();
 
         gpDevice->flushAndSync();
+
+        auto& state = getGlobalState();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.stats.add(mStats);
+    }
+
+    std::future<Texture::SharedPtr> AsyncTextureLoader::loadFromFile(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Resource::BindFlags bindFlags, uint64_t priority)
+    {
+        auto pRequest = std::make_shared<Request>();
+        pRequest->filename = filename;
+        pRequest->generateMipLevels = generateMipLevels;
+        pRequest->loadAsSrgb = loadAsSrgb;
+        pRequest->bindFlags = bindFlags;
+        pRequest->priority = priority;
+        pRequest->requestTime = CpuTimer::getCurrentTimePoint();
+        auto future = pRequest->promise.get_future();
+
+        if (findFileInDataDirectories(filename, pRequest->fullpath) == false)
+        {
+            logWarning("Error when loading image file. Can't find image file '" + filename + "'");
+            pRequest->promise.set_value(nullptr);
+
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStats.requestCount++;
+            mStats.failedCount++;
+            return future;
+        }
+
+        std::error_code ec;
+        pRequest->fileSize = std::filesystem::file_size(pRequest->fullpath, ec);
+        if (ec) pRequest->fileSize = 0;
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        pRequest->sequence = mNextSequence++;
+        mDecodeQueue.push(pRequest);
+        mPendingCount++;
+        mStats.requestCount++;
+        scheduleDecodes();
+        return future;
     }
 
-    std::future<Texture::SharedPtr> AsyncTextureLoader::loadFromFile(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Resource::BindFlags bindFlags)
+    AsyncTextureLoader::Stats AsyncTextureLoader::getStats()
     {
         std::lock_guard<std::mutex> lock(mMutex);
-        mRequestQueue.push(Request{filename, generateMipLevels, loadAsSrgb, bindFlags});
-        mCondition.notify_one();
-        return mRequestQueue.back().promise.get_future();
+        return mStats;
+    }
+
+    void AsyncTextureLoader::setDefaultMemoryBudget(uint64_t memoryBudget)
+    {
+        auto& state = getGlobalState();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.defaultMemoryBudget = memoryBudget;
+    }
+
+    uint64_t AsyncTextureLoader::getDefaultMemoryBudget()
+    {
+        auto& state = getGlobalState();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        return state.defaultMemoryBudget;
+    }
+
+    AsyncTextureLoader::Stats AsyncTextureLoader::getGlobalStats()
+    {
+        auto& state = getGlobalState();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        return state.stats;
+    }
+
+    void AsyncTextureLoader::resetGlobalStats()
+    {
+        auto& state = getGlobalState();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.stats = {};
     }
 
-    void AsyncTextureLoader::runWorkers(size_t threadCount)
+    void AsyncTextureLoader::scheduleDecodes()
     {
-        // Create a barrier to synchronize worker threads before issuing a global flush.
-        auto barrier = std::make_shared<Barrier>(threadCount, [&] () {
-            gpDevice->flushAndSync();
-            mFlushPending = false;
-            mUploadCounter = 0;
-        });
+        // Must be called with mMutex locked.
+        while (!mDecodeQueue.empty() && mActiveDecodeTasks < mMaxDecodeTasks)
+        {
+            // Stay within the memory budget, but always allow one image in flight so that images larger than the budget can be loaded.
+            bool idle = mInFlightBytes == 0 && mActiveDecodeTasks == 0;
+            if (!idle && mInFlightBytes + mDecodeQueue.top()->fileSize > mMemoryBudget) break;
+
+            RequestPtr pRequest = mDecodeQueue.top();
+            mDecodeQueue.pop();
+
+            // Reserve the file size until the decoded size is known.
+            mInFlightBytes += pRequest->fileSize;
+            mActiveDecodeTasks++;
+
+            Threading::dispatchTask([this, pRequest] ()
+            {
+                auto startTime = CpuTimer::getCurrentTimePoint();
+                decode(*pRequest);
+                auto endTime = CpuTimer::getCurrentTimePoint();
+
+                std::lock_guard<std::mutex> lock(mMutex);
+                mStats.queueTime += calcSeconds(pRequest->requestTime, startTime);
+                mStats.decodeTime += calcSeconds(startTime, endTime);
+                mStats.decodedBytes += pRequest->decodedSize;
+
+                mInFlightBytes = mInFlightBytes - pRequest->fileSize + pRequest->decodedSize;
+                mStats.peakInFlightBytes = std::max(mStats.peakInFlightBytes, mInFlightBytes);
+
+                pRequest->decodeEndTime = endTime;
+                mUploadQueue.push(pRequest);
+                mActiveDecodeTasks--;
+
+                scheduleDecodes();
+                mCondition.notify_all();
+            });
+        }
+    }
 
-        // Start worker threads.
-        for (size_t i = 0; i < threadCount; ++i)
+    void AsyncTextureLoader::decode(Request& request)
+    {
+        try
         {
-            mThreads.emplace_back([&, barrier] () {
-                while (true)
+            if (hasSuffix(request.fullpath, ".dds"))
+            {
+                // DDS files are stored in the final texture format, so decoding is reading the file.
+                if (!readFile(request.fullpath, request.ddsData))
                 {
-                    // Wait on condition until more work is ready.
-                    std::unique_lock<std::mutex> lock(mMutex);
-                    mCondition.wait(lock, [&] () { return mTerminate || !mRequestQueue.empty() || mFlushPending; });
-
-                    // Sync thread if a flush is pending.
-                    if (mFlushPending)
-                    {
-                        lock.unlock();
-                        barrier->wait();
-                        mCondition.notify_one();
-                        continue;
-                    }
-
-                    // Terminate thread unless there is more work to do.
-                    if (mTerminate && mRequestQueue.empty() && !mFlushPending) break;
-
-                    // Go back waiting if queue is currently empty.
-                    if (mRequestQueue.empty()) continue;
-
-                    // Pop next loading request from queue.
-                    auto request = std::move(mRequestQueue.front());
-                    mRequestQueue.pop();
-
-                    lock.unlock();
-
-                    // Load the textures (this part is running in parallel).
-                    Texture::SharedPtr pTexture = Texture::createFromFile(request.filename, request.generateMipLevels, request.loadAsSrgb, request.bindFlags);
-                    request.promise.set_value(pTexture);
-
-                    lock.lock();
-
-                    // Issue a global flush if necessary.
-                    // TODO: It would be better to check the size of the upload heap instead.
-                    if (!mTerminate && ++mUploadCounter >= kUploadsPerFlush)
-                    {
-                        mFlushPending = true;
-                        mCondition.notify_all();
-                    }
-
-                    mCondition.notify_one();
+                    throw std::exception(("Failed to read file: " + request.fullpath).c_str());
                 }
-            });
+                request.decodedSize = request.ddsData.size();
+            }
+            else
+            {
+                request.pBitmap = Bitmap::createFromFile(request.fullpath, true);
+                if (request.pBitmap) request.decodedSize = request.pBitmap->getSize();
+            }
+        }
+        catch (const std::exception& e)
+        {
+            logWarning("Error when loading image file '" + request.filename + "': " + e.what());
+            request.pBitmap = nullptr;
+            request.ddsData = {};
+            request.decodedSize = 0;
         }
     }
 
-    void AsyncTextureLoader::terminateWorkers()
+    Texture::SharedPtr AsyncTextureLoader::upload(const Request& request)
     {
+        Texture::SharedPtr pTex;
+        try
         {
-            std::lock_guard<std::mutex> lock(mMutex);
-            mTerminate = true;
+            if (!request.ddsData.empty())
+            {
+                pTex = ImageIO::loadTextureFromDDSMemory(request.ddsData.data(), request.ddsData.size(), request.fullpath, request.loadAsSrgb);
+            }
+            else if (request.pBitmap)
+            {
+                const auto& bitmap = *request.pBitmap;
+                ResourceFormat texFormat = request.loadAsSrgb ? linearToSrgbFormat(bitmap.getFormat()) : bitmap.getFormat();
+                pTex = Texture::create2D(bitmap.getWidth(), bitmap.getHeight(), texFormat, 1, request.generateMipLevels ? Texture::kMaxPossible : 1, bitmap.getData(), request.bindFlags);
+            }
+        }
+        catch (const std::exception& e)
+        {
+            logWarning("Error when loading image file '" + request.filename + "': " + e.what());
+            pTex = nullptr;
         }
 
-        mCondition.notify_all();
+        if (pTex != nullptr)
+        {
+            pTex->setSourceFilename(request.fullpath);
+        }
+
+        return pTex;
+    }
+
+    void AsyncTextureLoader::runUploadThread()
+    {
+        uint32_t uploadCounter = 0;
+
+        while (true)
+        {
+            // Wait on condition until more work is ready.
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondition.wait(lock, [&] () { return mTerminate || !mUploadQueue.empty(); });
+
+            // Terminate thread unless there is more work to do.
+            if (mUploadQueue.empty()) break;
+
+            RequestPtr pRequest = mUploadQueue.top();
+            mUploadQueue.pop();
+
+            lock.unlock();
 
-        for (auto& thread : mThreads) thread.join();
+            // Upload the texture. This is the only thread issuing uploads, so no synchronization is needed before a flush.
+            auto startTime = CpuTimer::getCurrentTimePoint();
+            Texture::SharedPtr pTexture = upload(*pRequest);
+
+            // Issue a global flush if necessary.
+            // TODO: It would be better to check the size of the upload heap instead.
+            bool flush = ++uploadCounter >= kUploadsPerFlush;
+            if (flush)
+            {
+                gpDevice->flushAndSync();
+                uploadCounter = 0;
+            }
+            auto endTime = CpuTimer::getCurrentTimePoint();
+
+            // Release the decoded image before completing the request.
+            pRequest->pBitmap = nullptr;
+            pRequest->ddsData = {};
+
+            lock.lock();
+
+            mStats.uploadWaitTime += calcSeconds(pRequest->decodeEndTime, startTime);
+            mStats.uploadTime += calcSeconds(startTime, endTime);
+            if (flush) mStats.flushCount++;
+            if (!pTexture) mStats.failedCount++;
+
+            mInFlightBytes -= pRequest->decodedSize;
+            mPendingCount--;
+
+            scheduleDecodes();
+            mCondition.notify_all();
+
+            // Complete the request after updating the statistics, so they include all textures the caller has received.
+            lock.unlock();
+            pRequest->promise.set_value(pTexture);
+        }
+    }
+
+    SCRIPT_BINDING(AsyncTextureLoader)
+    {
+        pybind11::class_<AsyncTextureLoader> asyncTextureLoader(m, "AsyncTextureLoader");
+        asyncTextureLoader.def_property_static("memoryBudget", [](pybind11::object) { return AsyncTextureLoader::getDefaultMemoryBudget(); }, [](pybind11::object, uint64_t memoryBudget) { AsyncTextureLoader::setDefaultMemoryBudget(memoryBudget); });
+        asyncTextureLoader.def_property_readonly_static("stats", [](pybind11::object) { return AsyncTextureLoader::getGlobalStats().toPython(); });
+        asyncTextureLoader.def_static("resetStats", &AsyncTextureLoader::resetGlobalStats);
     }
 }
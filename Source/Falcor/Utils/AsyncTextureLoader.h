@@ -31,15 +31,49 @@
 
 namespace Falcor
 {
-    /** Utility class to load textures asynchronously using multiple worker threads.
+    /** Utility class to load textures asynchronously.
+
+        Loading is split into two stages:
+        - Decode: The image file is read and decoded on the CPU. Decode tasks run on the
+          shared worker thread pool (see `Threading`), so they are load balanced with other
+          parallel work.
+        - Upload: The decoded image is uploaded to a new texture on the GPU. Uploads are issued
+          by a single upload thread, which also issues a flush every few uploads to keep the
+          upload heap from growing.
+
+        Pending requests are decoded in order of decreasing priority, and in request order for
+        equal priorities. The total size of the images in flight (being decoded or waiting for
+        upload) is limited by a memory budget. A decode is only started if the file size fits
+        in the remaining budget, or if nothing else is in flight, so a single image larger than
+        the budget can still be loaded. The budget is a soft limit, as the decoded size of an
+        image is only known after decoding it.
     */
     class dlldecl AsyncTextureLoader
     {
     public:
+        /** Loading statistics. Times are summed over all textures, in seconds.
+        */
+        struct Stats
+        {
+            uint64_t requestCount = 0;          ///< Number of requested textures.
+            uint64_t failedCount = 0;           ///< Number of textures that failed to load.
+            uint64_t decodedBytes = 0;          ///< Total size of the decoded images.
+            uint64_t peakInFlightBytes = 0;     ///< Peak total size of the decoded images waiting for upload.
+            uint64_t flushCount = 0;            ///< Number of flushes issued by the upload thread.
+            double queueTime = 0.0;             ///< Time between requesting a texture and the start of its decode.
+            double decodeTime = 0.0;            ///< Time spent reading and decoding the image files.
+            double uploadWaitTime = 0.0;        ///< Time decoded images spent waiting for upload.
+            double uploadTime = 0.0;            ///< Time spent creating and uploading the textures, including flushes.
+
+            void add(const Stats& other);
+            pybind11::dict toPython() const;
+        };
+
         /** Constructor.
-            \param[in] threadCount Number of worker threads.
+            \param[in] maxDecodeTasks Maximum number of images decoded in parallel.
+            \param[in] memoryBudget Maximum total size in bytes of the decoded images waiting for upload.
         */
-        AsyncTextureLoader(size_t threadCount = std::thread::hardware_concurrency());
+        AsyncTextureLoader(size_t maxDecodeTasks = Threading::getLogicalThreadCount(), uint64_t memoryBudget = getDefaultMemoryBudget());
 
         /** Destructor.
             Blocks until all textures are loaded.
@@ -51,29 +85,76 @@ namespace Falcor
             \param[in] generateMipLevels Whether the mip-chain should be generated.
             \param[in] loadAsSrgb Load the texture using sRGB format. Only valid for 3 or 4 component textures.
             \param[in] bindFlags The bind flags to create the texture with.
+            \param[in] priority Loading priority. Requests with higher priority are loaded first.
             \return A future to a new texture, or nullptr if the texture failed to load.
         */
-        std::future<Texture::SharedPtr> loadFromFile(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Resource::BindFlags bindFlags = Resource::BindFlags::ShaderResource);
+        std::future<Texture::SharedPtr> loadFromFile(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Resource::BindFlags bindFlags = Resource::BindFlags::ShaderResource, uint64_t priority = 0);
 
-    private:
-        void runWorkers(size_t threadCount);
-        void terminateWorkers();
+        /** Get the statistics of this loader.
+        */
+        Stats getStats();
+
+        /** Set the memory budget used by loaders created with the default budget. The default is 1 GB.
+        */
+        static void setDefaultMemoryBudget(uint64_t memoryBudget);
+        static uint64_t getDefaultMemoryBudget();
 
+        /** Get the statistics accumulated over all loaders destroyed since startup or the last call to resetGlobalStats().
+        */
+        static Stats getGlobalStats();
+        static void resetGlobalStats();
+
+    private:
         struct Request
         {
             std::string filename;
             bool generateMipLevels;
             bool loadAsSrgb;
             Resource::BindFlags bindFlags;
+            uint64_t priority;
+            uint64_t sequence;                  ///< Request order, used to break ties between equal priorities.
+            CpuTimer::TimePoint requestTime;
             std::promise<Texture::SharedPtr> promise;
+
+            std::string fullpath;
+            uint64_t fileSize;                  ///< Size of the image file, reserved from the memory budget while decoding.
+
+            // Decoded image. Either a bitmap, or the raw contents of a DDS file.
+            Bitmap::UniqueConstPtr pBitmap;
+            std::vector<uint8_t> ddsData;
+            uint64_t decodedSize = 0;
+            CpuTimer::TimePoint decodeEndTime;
         };
 
-        std::queue<Request> mRequestQueue;      ///< Texture loading request queue.
-        std::condition_variable mCondition;     ///< Condition variable for workers to wait on.
+        using RequestPtr = std::shared_ptr<Request>;
+
+        struct RequestOrder
+        {
+            bool operator()(const RequestPtr& a, const RequestPtr& b) const
+            {
+                return a->priority != b->priority ? a->priority < b->priority : a->sequence > b->sequence;
+            }
+        };
+
+        using RequestQueue = std::priority_queue<RequestPtr, std::vector<RequestPtr>, RequestOrder>;
+
+        void scheduleDecodes();
+        void decode(Request& request);
+        Texture::SharedPtr upload(const Request& request);
+        void runUploadThread();
+
+        RequestQueue mDecodeQueue;              ///< Requests waiting to be decoded.
+        RequestQueue mUploadQueue;              ///< Decoded requests waiting to be uploaded.
+        std::condition_variable mCondition;     ///< Condition variable for the upload thread and the destructor to wait on.
         std::mutex mMutex;                      ///< Mutex for synchronizing access to shared resources.
-        std::vector<std::thread> mThreads;      ///< Worker threads.
-        bool mTerminate = false;                ///< Flag to terminate worker threads.
-        bool mFlushPending = false;             ///< Flag to indicate a flush is pending.
-        uint32_t mUploadCounter = 0;            ///< Counter to issue a flush every few uploads.
+        std::thread mUploadThread;              ///< Upload thread.
+        size_t mMaxDecodeTasks;                 ///< Maximum number of decode tasks running in parallel.
+        uint64_t mMemoryBudget;                 ///< Maximum total size of the in-flight decoded images.
+        size_t mActiveDecodeTasks = 0;          ///< Number of decode tasks currently running.
+        size_t mPendingCount = 0;               ///< Number of requests that are not yet completed.
+        uint64_t mInFlightBytes = 0;            ///< Total size of the decoded (or currently decoding) images that are not yet uploaded.
+        uint64_t mNextSequence = 0;             ///< Sequence number of the next request.
+        bool mTerminate = false;                ///< Flag to terminate the upload thread.
+        Stats mStats;
     };
 }
@@ -0,0 +1,189 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "CryptoUtils.h"
+
+namespace Falcor
+{
+    namespace
+    {
+        uint32_t rol32(uint32_t x, uint32_t shift)
+        {
+            return (x << shift) | (x >> (32 - shift));
+        }
+    }
+
+    SHA1::SHA1()
+        : mIndex(0)
+        , mBits(0)
+    {
+        mState[0] = 0x67452301;
+        mState[1] = 0xefcdab89;
+        mState[2] = 0x98badcfe;
+        mState[3] = 0x10325476;
+        mState[4] = 0xc3d2e1f0;
+    }
+
+    void SHA1::update(uint8_t value)
+    {
+        addByte(value);
+        mBits += 8;
+    }
+
+    void SHA1::update(const void* pData, size_t len)
+    {
+        const uint8_t* ptr = reinterpret_cast<const uint8_t*>(pData);
+        mBits += (uint64_t)len * 8;
+
+        // Fill up a partially filled block first.
+        while (len > 0 && mIndex != 0)
+        {
+            addByte(*ptr++);
+            len--;
+        }
+
+        // Process full blocks directly from the input.
+        while (len >= 64)
+        {
+            processBlock(ptr);
+            ptr += 64;
+            len -= 64;
+        }
+
+        while (len > 0)
+        {
+            addByte(*ptr++);
+            len--;
+        }
+    }
+
+    SHA1::MD SHA1::final()
+    {
+        // Finalize with 0x80, some zero padding and the length in bits.
+        uint64_t bits = mBits;
+        addByte(0x80);
+        while (mIndex % 64 != 56) addByte(0);
+        for (int i = 7; i >= 0; --i) addByte((uint8_t)(bits >> (i * 8)));
+
+        MD md;
+        for (int i = 0; i < 5; i++)
+        {
+            for (int j = 3; j >= 0; j--)
+            {
+                md[i * 4 + j] = (mState[i] >> ((3 - j) * 8)) & 0xff;
+            }
+        }
+        return md;
+    }
+
+    SHA1::MD SHA1::compute(const void* pData, size_t len)
+    {
+        SHA1 sha1;
+        sha1.update(pData, len);
+        return sha1.final();
+    }
+
+    std::string SHA1::toString(const MD& md)
+    {
+        static const char kHex[] = "0123456789abcdef";
+        std::string str(md.size() * 2, '0');
+        for (size_t i = 0; i < md.size(); i++)
+        {
+            str[i * 2] = kHex[md[i] >> 4];
+            str[i * 2 + 1] = kHex[md[i] & 0xf];
+        }
+        return str;
+    }
+
+    void SHA1::addByte(uint8_t x)
+    {
+        mBuf[mIndex++] = x;
+        if (mIndex >= 64)
+        {
+            processBlock(mBuf);
+            mIndex = 0;
+        }
+    }
+
+    void SHA1::processBlock(const uint8_t* ptr)
+    {
+        uint32_t w[80];
+        for (int i = 0; i < 16; i++)
+        {
+            w[i] = (uint32_t(ptr[i * 4]) << 24) | (uint32_t(ptr[i * 4 + 1]) << 16) | (uint32_t(ptr[i * 4 + 2]) << 8) | uint32_t(ptr[i * 4 + 3]);
+        }
+        for (int i = 16; i < 80; i++)
+        {
+            w[i] = rol32(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+
+        uint32_t a = mState[0];
+        uint32_t b = mState[1];
+        uint32_t c = mState[2];
+        uint32_t d = mState[3];
+        uint32_t e = mState[4];
+
+        for (int i = 0; i < 80; i++)
+        {
+            uint32_t f, k;
+            if (i < 20)
+            {
+                f = (b & c) | (~b & d);
+                k = 0x5a827999;
+            }
+            else if (i < 40)
+            {
+                f = b ^ c ^ d;
+                k = 0x6ed9eba1;
+            }
+            else if (i < 60)
+            {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8f1bbcdc;
+            }
+            else
+            {
+                f = b ^ c ^ d;
+                k = 0xca62c1d6;
+            }
+
+            uint32_t temp = rol32(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rol32(b, 30);
+            b = a;
+            a = temp;
+        }
+
+        mState[0] += a;
+        mState[1] += b;
+        mState[2] += c;
+        mState[3] += d;
+        mState[4] += e;
+    }
+}
@@ -29,6 +29,8 @@
 #include "Bitmap.h"
 #include "Core/API/Texture.h"
 #include "Utils/StringUtils.h"
+#include "Utils/Threading.h"
+#include "PixelConversion.h"
 
 #include <FreeImage.h>
 
@@ -58,94 +60,132 @@ namespace Falcor
         return isHalfFormat || isLargeIntFormat;
     }
 
-    /** Converts half float image to RGBA float image.
+    /** Returns true if the format has 32-bit float channels.
     */
-    static std::vector<float> convertHalfToRGBA32Float(uint32_t width, uint32_t height, uint32_t channelCount, const void* pData)
+    static bool isFloat32Format(ResourceFormat format)
     {
-        std::vector<float> newData(width * height * 4u, 0.f);
-        const glm::detail::hdata* pSrc = reinterpret_cast<const glm::detail::hdata*>(pData);
-        float* pDst = newData.data();
+        return getFormatType(format) == FormatType::Float && getNumChannelBits(format, 0) == 32 && !isDepthFormat(format);
+    }
+
+    /** Returns true if the format is a 8/16-bit unorm format that can be converted to RGBA float.
+        BGRA formats are excluded, as the channels would need to be swizzled.
+    */
+    static bool isUnormConvertibleToRGBA32Float(ResourceFormat format)
+    {
+        if (getFormatType(format) != FormatType::Unorm || format == ResourceFormat::BGRA8Unorm || format == ResourceFormat::BGRX8Unorm) return false;
 
-        for (uint32_t i = 0; i < width * height; ++i)
+        uint32_t channelBits = getNumChannelBits(format, 0);
+        if (channelBits != 8 && channelBits != 16) return false;
+        for (uint32_t c = 1; c < getFormatChannelCount(format); c++)
         {
-            for (uint32_t c = 0; c < channelCount; ++c)
-            {
-                *pDst++ = glm::detail::toFloat32(*pSrc++);
-            }
-            pDst += (4 - channelCount);
+            if (getNumChannelBits(format, c) != channelBits) return false;
         }
-
-        return newData;
+        return true;
     }
 
-    /** Converts integer image to RGBA float image.
+    /** Converts integer values to float.
         Unsigned integers are normalized to [0,1], signed integers to [-1,1].
     */
     template<typename SrcT>
-    static std::vector<float> convertIntToRGBA32Float(uint32_t width, uint32_t height, uint32_t channelCount, const void* pData)
+    static void convertIntToFloat(const SrcT* pSrc, float* pDst, size_t count)
     {
-        std::vector<float> newData(width * height * 4u, 0.f);
-        const SrcT* pSrc = reinterpret_cast<const SrcT*>(pData);
-        float* pDst = newData.data();
-
-        for (uint32_t i = 0; i < width * height; ++i)
+        for (size_t i = 0; i < count; ++i)
         {
-            for (uint32_t c = 0; c < channelCount; ++c)
-            {
-                *pDst++ = float(*pSrc++) / float(std::numeric_limits<SrcT>::max());
-            }
-            pDst += (4 - channelCount);
+            pDst[i] = float(pSrc[i]) / float(std::numeric_limits<SrcT>::max());
         }
-
-        return newData;
     }
 
     /** Converts an image of the given format to an RGBA float image.
+        The rows are converted in parallel.
     */
     static std::vector<float> convertToRGBA32Float(ResourceFormat format, uint32_t width, uint32_t height, const void* pData)
     {
-        assert(isConvertibleToRGBA32Float(format));
+        assert(isConvertibleToRGBA32Float(format) || isUnormConvertibleToRGBA32Float(format) || isFloat32Format(format));
 
         FormatType type = getFormatType(format);
         uint32_t channelCount = getFormatChannelCount(format);
         uint32_t channelBits = getNumChannelBits(format, 0);
 
-        std::vector<float> floatData;
-
-        if (type == FormatType::Float && channelBits == 16)
+        // Converts a row of width * channelCount values.
+        std::function<void(const void*, float*, size_t)> convertRow;
+        if (type == FormatType::Float && channelBits == 32)
+        {
+            convertRow = [](const void* pSrc, float* pDst, size_t count) { std::memcpy(pDst, pSrc, count * sizeof(float)); };
+        }
+        else if (type == FormatType::Float && channelBits == 16)
         {
-            floatData = convertHalfToRGBA32Float(width, height, channelCount, pData);
+            convertRow = [](const void* pSrc, float* pDst, size_t count) { PixelConversion::halfToFloat((const uint16_t*)pSrc, pDst, count); };
         }
-        else if (type == FormatType::Uint && channelBits == 16)
+        else if ((type == FormatType::Uint || type == FormatType::Unorm) && channelBits == 16)
         {
-            floatData = convertIntToRGBA32Float<uint16_t>(width, height, channelCount, pData);
+            convertRow = [](const void* pSrc, float* pDst, size_t count) { PixelConversion::unormToFloat((const uint16_t*)pSrc, pDst, count); };
+        }
+        else if (type == FormatType::Unorm && channelBits == 8)
+        {
+            convertRow = [](const void* pSrc, float* pDst, size_t count) { PixelConversion::unormToFloat((const uint8_t*)pSrc, pDst, count); };
         }
         else if (type == FormatType::Uint && channelBits == 32)
         {
-            floatData = convertIntToRGBA32Float<uint32_t>(width, height, channelCount, pData);
+            convertRow = [](const void* pSrc, float* pDst, size_t count) { convertIntToFloat((const uint32_t*)pSrc, pDst, count); };
         }
         else if (type == FormatType::Sint && channelBits == 16)
         {
-            floatData = convertIntToRGBA32Float<int16_t>(width, height, channelCount, pData);
+            convertRow = [](const void* pSrc, float* pDst, size_t count) { convertIntToFloat((const int16_t*)pSrc, pDst, count); };
         }
         else if (type == FormatType::Sint && channelBits == 32)
         {
-            floatData = convertIntToRGBA32Float<int32_t>(width, height, channelCount, pData);
+            convertRow = [](const void* pSrc, float* pDst, size_t count) { convertIntToFloat((const int32_t*)pSrc, pDst, count); };
         }
         else
         {
             should_not_get_here();
         }
 
-        // Default alpha channel to 1.
-        if (channelCount < 4)
+        std::vector<float> floatData(width * height * 4u, 0.f);
+        const size_t srcRowSize = (size_t)width * channelCount * channelBits / 8;
+
+        Threading::parallelForRange(0, height, [&](size_t first, size_t last)
         {
-            for (uint32_t i = 0; i < width * height; ++i) floatData[i * 4 + 3] = 1.f;
-        }
+            // Images with less than four channels are converted to a temporary row and expanded.
+            std::vector<float> rowData(channelCount < 4 ? width * channelCount : 0);
+
+            for (size_t y = first; y < last; y++)
+            {
+                const uint8_t* pSrc = reinterpret_cast<const uint8_t*>(pData) + y * srcRowSize;
+                float* pDst = floatData.data() + y * width * 4;
+
+                if (channelCount == 4)
+                {
+                    convertRow(pSrc, pDst, width * 4);
+                    continue;
+                }
+
+                convertRow(pSrc, rowData.data(), rowData.size());
+                for (uint32_t x = 0; x < width; x++)
+                {
+                    for (uint32_t c = 0; c < channelCount; c++) pDst[x * 4 + c] = rowData[x * channelCount + c];
+                    // Default alpha channel to 1.
+                    pDst[x * 4 + 3] = 1.f;
+                }
+            }
+        });
 
         return floatData;
     }
 
+    /** Converts an RGBA float image to an RGBA 8-bit unorm image with ordered dithering.
+        The rows are converted in parallel.
+    */
+    static std::vector<uint8_t> convertRGBA32FloatToRGBA8(uint32_t width, uint32_t height, const float* pData)
+    {
+        std::vector<uint8_t> newData(width * height * 4u);
+        Threading::parallelFor(0, height, [&](size_t y)
+        {
+            PixelConversion::floatToUnorm8Dithered(pData + y * width * 4, newData.data() + y * width * 4, width, (uint32_t)y);
+        });
+        return newData;
+    }
+
     /** Converts 96bpp to 128bpp RGBA without clamping.
         Note that we can't use FreeImage_ConvertToRGBAF() as it clamps to [0,1].
     */
@@ -473,26 +513,10 @@ namespace Falcor
         FIBITMAP* pImage = nullptr;
         uint32_t bytesPerPixel = getFormatBytesPerBlock(resourceFormat);
 
-        // TODO: Replace this code for swapping channels. Can't use freeimage masks b/c they only care about 16 bpp images.
-        if (resourceFormat == ResourceFormat::RGBA8Unorm || resourceFormat == ResourceFormat::RGBA8Snorm || resourceFormat == ResourceFormat::RGBA8UnormSrgb)
-        {
-            for (uint32_t a = 0; a < width*height; a++)
-            {
-                uint32_t* pPixel = (uint32_t*)pData;
-                pPixel += a;
-                uint8_t* ch = (uint8_t*)pPixel;
-                std::swap(ch[0], ch[2]);
-                if (is_set(exportFlags, ExportFlags::ExportAlpha) == false)
-                {
-                    ch[3] = 0xff;
-                }
-            }
-        }
-
         if (fileFormat == Bitmap::FileFormat::PfmFile || fileFormat == Bitmap::FileFormat::ExrFile)
         {
             std::vector<float> floatData;
-            if (isConvertibleToRGBA32Float(resourceFormat))
+            if (isConvertibleToRGBA32Float(resourceFormat) || isUnormConvertibleToRGBA32Float(resourceFormat))
             {
                 floatData = convertToRGBA32Float(resourceFormat, width, height, pData);
                 pData = floatData.data();
@@ -501,7 +525,7 @@ namespace Falcor
             }
             else if (bytesPerPixel != 16 && bytesPerPixel != 12)
             {
-                logError("Bitmap::saveImage supports only 32-bit/channel RGB/RGBA or 16-bit RGBA images as PFM/EXR files.");
+                logError("Bitmap::saveImage supports only 32-bit/channel RGB/RGBA, 16-bit or 8/16-bit unorm images as PFM/EXR files.");
                 return;
             }
 
@@ -567,6 +591,39 @@ namespace Falcor
         }
         else
         {
+            // Quantize float, half and large integer formats to 8 bits per channel using dithering.
+            std::vector<float> floatData;
+            std::vector<uint8_t> ldrData;
+            if (isFloat32Format(resourceFormat) || isConvertibleToRGBA32Float(resourceFormat))
+            {
+                const float* pFloatData = reinterpret_cast<const float*>(pData);
+                if (resourceFormat != ResourceFormat::RGBA32Float)
+                {
+                    floatData = convertToRGBA32Float(resourceFormat, width, height, pData);
+                    pFloatData = floatData.data();
+                }
+                ldrData = convertRGBA32FloatToRGBA8(width, height, pFloatData);
+                pData = ldrData.data();
+                resourceFormat = ResourceFormat::RGBA8Unorm;
+                bytesPerPixel = 4;
+            }
+
+            // TODO: Replace this code for swapping channels. Can't use freeimage masks b/c they only care about 16 bpp images.
+            if (resourceFormat == ResourceFormat::RGBA8Unorm || resourceFormat == ResourceFormat::RGBA8Snorm || resourceFormat == ResourceFormat::RGBA8UnormSrgb)
+            {
+                for (uint32_t a = 0; a < width*height; a++)
+                {
+                    uint32_t* pPixel = (uint32_t*)pData;
+                    pPixel += a;
+                    uint8_t* ch = (uint8_t*)pPixel;
+                    std::swap(ch[0], ch[2]);
+                    if (is_set(exportFlags, ExportFlags::ExportAlpha) == false)
+                    {
+                        ch[3] = 0xff;
+                    }
+                }
+            }
+
             FIBITMAP* pTemp = FreeImage_ConvertFromRawBits((BYTE*)pData, width, height, bytesPerPixel * width, bytesPerPixel * 8, FI_RGBA_RED_MASK, FI_RGBA_GREEN_MASK, FI_RGBA_BLUE_MASK, isTopDown);
             if (is_set(exportFlags, ExportFlags::ExportAlpha) == false || fileFormat == Bitmap::FileFormat::JpegFile)
             {
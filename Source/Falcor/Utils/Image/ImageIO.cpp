@@ -76,6 +76,18 @@ namespace Falcor
             ApiImage image;
         };
 
+        void initImportData(ImportData& data, bool loadAsSrgb)
+        {
+            const auto& meta = data.image.scratchImage.GetMetadata();
+            ResourceFormat format = getResourceFormat(meta.format);
+            data.format = loadAsSrgb ? linearToSrgbFormat(format) : format;
+            data.width = (uint32_t)meta.width;
+            data.height = (uint32_t)meta.height;
+            data.depth = (uint32_t)meta.depth;
+            data.arraySize = (uint32_t)meta.arraySize;
+            data.mipLevels = (uint32_t)meta.mipLevels;
+        }
+
         ImportData loadDDS(const std::string& filename, bool loadAsSrgb)
         {
             assert(hasSuffix(filename, ".dds", false));
@@ -92,18 +104,59 @@ namespace Falcor
                 throw std::exception(("Failed to load file: " + filename).c_str());
             }
 
-            const auto& meta = data.image.scratchImage.GetMetadata();
-            ResourceFormat format = getResourceFormat(meta.format);
-            data.format = loadAsSrgb ? linearToSrgbFormat(format) : format;
-            data.width = (uint32_t)meta.width;
-            data.height = (uint32_t)meta.height;
-            data.depth = (uint32_t)meta.depth;
-            data.arraySize = (uint32_t)meta.arraySize;
-            data.mipLevels = (uint32_t)meta.mipLevels;
+            initImportData(data, loadAsSrgb);
+            return data;
+        }
 
+        ImportData loadDDSFromMemory(const void* pData, size_t size, const std::string& fullpath, bool loadAsSrgb)
+        {
+            ImportData data;
+            data.fullpath = fullpath;
+
+            DirectX::DDS_FLAGS flags = DirectX::DDS_FLAGS_NONE;
+            if (FAILED(DirectX::LoadFromDDSMemory(pData, size, flags, nullptr, data.image.scratchImage)))
+            {
+                throw std::exception(("Failed to load file: " + fullpath).c_str());
+            }
+
+            initImportData(data, loadAsSrgb);
             return data;
         }
 
+        Texture::SharedPtr createTexture(const ImportData& data)
+        {
+            const auto& scratchImage = data.image.scratchImage;
+            const auto& meta = scratchImage.GetMetadata();
+
+            Texture::SharedPtr pTex;
+            switch (meta.dimension)
+            {
+            case DirectX::TEX_DIMENSION_TEXTURE1D:
+                pTex = Texture::create1D(data.width, data.format, data.arraySize, data.mipLevels, scratchImage.GetPixels());
+                break;
+            case DirectX::TEX_DIMENSION_TEXTURE2D:
+                if (meta.IsCubemap())
+                {
+                    pTex = Texture::createCube(data.width, data.height, data.format, data.arraySize / 6, data.mipLevels, scratchImage.GetPixels());
+                }
+                else
+                {
+                    pTex = Texture::create2D(data.width, data.height, data.format, data.arraySize, data.mipLevels, scratchImage.GetPixels());
+                }
+                break;
+            case DirectX::TEX_DIMENSION_TEXTURE3D:
+                pTex = Texture::create3D(data.width, data.height, data.depth, data.format, data.mipLevels, scratchImage.GetPixels());
+                break;
+            }
+
+            if (pTex != nullptr)
+            {
+                pTex->setSourceFilename(data.fullpath);
+            }
+
+            return pTex;
+        }
+
         void validateSavePath(const std::string& filename)
         {
             if (std::filesystem::path(filename).is_absolute() == false)
@@ -192,15 +245,51 @@ namespace Falcor
             }
         }
 
-        /** Saves image data to a DDS file. Optionally compresses image.
+        void generateMips(ApiImage& image)
+        {
+            if (isCompressedFormat(getResourceFormat(image.getFormat())))
+            {
+                throw std::exception("Can't generate mips for a compressed image.");
+            }
+
+            // The default filter is a box filter for power-of-two sizes. Don't use WIC, as it requires COM to be initialized on the calling thread.
+            const DirectX::TEX_FILTER_FLAGS filter = DirectX::TEX_FILTER_DEFAULT | DirectX::TEX_FILTER_FORCE_NON_WIC;
+
+            HRESULT result = S_OK;
+            DirectX::ScratchImage mipChain;
+            if (image.isSingleImage())
+            {
+                result = DirectX::GenerateMipMaps(image.image, filter, 0, mipChain);
+                image.image = {};
+            }
+            else
+            {
+                const auto& scratchImage = image.scratchImage;
+                result = DirectX::GenerateMipMaps(scratchImage.GetImages(), scratchImage.GetImageCount(), scratchImage.GetMetadata(), filter, 0, mipChain);
+            }
+
+            if (FAILED(result))
+            {
+                throw std::exception("Failed to generate mips.");
+            }
+
+            image.scratchImage = std::move(mipChain);
+        }
+
+        /** Saves image data to a DDS file. Optionally generates mips and compresses image.
         */
-        void exportDDS(const std::string& filename, ApiImage& image, ImageIO::CompressionMode mode)
+        void exportDDS(const std::string& filename, ApiImage& image, ImageIO::CompressionMode mode, bool mips = false)
         {
             validateSavePath(filename);
 
-            // Compress
+            // Generate mips and compress
             try
             {
+                if (mips)
+                {
+                    generateMips(image);
+                }
+
                 if (mode != ImageIO::CompressionMode::None)
                 {
                     compress(image, mode);
@@ -250,41 +339,15 @@ namespace Falcor
 
     Texture::SharedPtr ImageIO::loadTextureFromDDS(const std::string& filename, bool loadAsSrgb)
     {
-        ImportData data = loadDDS(filename, loadAsSrgb);
-
-        const auto& scratchImage = data.image.scratchImage;
-        const auto& meta = scratchImage.GetMetadata();
-
-        Texture::SharedPtr pTex;
-        switch (meta.dimension)
-        {
-        case DirectX::TEX_DIMENSION_TEXTURE1D:
-            pTex = Texture::create1D(data.width, data.format, data.arraySize, data.mipLevels, scratchImage.GetPixels());
-            break;
-        case DirectX::TEX_DIMENSION_TEXTURE2D:
-            if (meta.IsCubemap())
-            {
-                pTex = Texture::createCube(data.width, data.height, data.format, data.arraySize / 6, data.mipLevels, scratchImage.GetPixels());
-            }
-            else
-            {
-                pTex = Texture::create2D(data.width, data.height, data.format, data.arraySize, data.mipLevels, scratchImage.GetPixels());
-            }
-            break;
-        case DirectX::TEX_DIMENSION_TEXTURE3D:
-            pTex = Texture::create3D(data.width, data.height, data.depth, data.format, data.mipLevels, scratchImage.GetPixels());
-            break;
-        }
-
-        if (pTex != nullptr)
-        {
-            pTex->setSourceFilename(data.fullpath);
-        }
+        return createTexture(loadDDS(filename, loadAsSrgb));
+    }
 
-        return pTex;
+    Texture::SharedPtr ImageIO::loadTextureFromDDSMemory(const void* pData, size_t size, const std::string& fullpath, bool loadAsSrgb)
+    {
+        return createTexture(loadDDSFromMemory(pData, size, fullpath, loadAsSrgb));
     }
 
-    void ImageIO::saveToDDS(const std::string& filename, const Bitmap& bitmap, CompressionMode mode)
+    void ImageIO::saveToDDS(const std::string& filename, const Bitmap& bitmap, CompressionMode mode, bool generateMips)
     {
         ApiImage image;
         image.image.width = bitmap.getWidth();
@@ -294,7 +357,13 @@ namespace Falcor
         image.image.slicePitch = bitmap.getSize();
         image.image.pixels = bitmap.getData();
 
-        exportDDS(filename, image, mode);
+        exportDDS(filename, image, mode, generateMips);
+    }
+
+    void ImageIO::saveToDDS(const std::string& filename, const Bitmap::UniqueConstPtr& pBitmap, CompressionMode mode, bool generateMips)
+    {
+        assert(pBitmap);
+        saveToDDS(filename, *pBitmap, mode, generateMips);
     }
 
     void ImageIO::saveToDDS(CopyContext* pContext, const std::string& filename, const Texture::SharedPtr& pTexture, CompressionMode mode)
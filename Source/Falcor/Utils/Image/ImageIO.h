@@ -91,14 +91,25 @@ namespace Falcor
         */
         static Texture::SharedPtr loadTextureFromDDS(const std::string& filename, bool loadAsSrgb);
 
+        /** Load a DDS file that has already been read into memory to a Texture.
+            Throws an exception if there is a loading error.
+            \param[in] pData Contents of the DDS file.
+            \param[in] size Size of the DDS file in bytes.
+            \param[in] fullpath Full path of the file. This is used as the texture's source filename.
+            \param[in] loadAsSrgb If true, convert the image format property to a corresponding sRGB format if available. Image data is not changed.
+            \return Texture object containing image data.
+        */
+        static Texture::SharedPtr loadTextureFromDDSMemory(const void* pData, size_t size, const std::string& fullpath, bool loadAsSrgb);
+
         /** Saves a bitmap to a DDS file.
             Throws an exception of filename is invalid or image cannot be saved.
             \param[in] filename Filename to save to.
             \param[in] bitmap Bitmap object to save.
             \param[in] mode Block compression mode. By default, will save data as-is and will not decompress if already compressed.
+            \param[in] generateMips If true, a full mip chain is generated on the CPU before compression. Filtering is done in linear space for sRGB formats.
         */
-        static void saveToDDS(const std::string& filename, const Bitmap& bitmap, CompressionMode mode = CompressionMode::None);
-        static void saveToDDS(const std::string& filename, const Bitmap::UniqueConstPtr& pBitmap, CompressionMode mode = CompressionMode::None);
+        static void saveToDDS(const std::string& filename, const Bitmap& bitmap, CompressionMode mode = CompressionMode::None, bool generateMips = false);
+        static void saveToDDS(const std::string& filename, const Bitmap::UniqueConstPtr& pBitmap, CompressionMode mode = CompressionMode::None, bool generateMips = false);
 
         /** Saves a Texture to a DDS file. All mips and array images are saved.
             Throws an exception of filename is invalid or image cannot be saved.
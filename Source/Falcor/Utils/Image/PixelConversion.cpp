@@ -0,0 +1,212 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "PixelConversion.h"
+#include <immintrin.h>
+
+namespace Falcor
+{
+    namespace
+    {
+        // Thresholds of the 4x4 Bayer matrix for ordered dithering, in (0,1).
+        const float kDitherThresholds[4][4] =
+        {
+            { 0.5f / 16.f,  8.5f / 16.f,  2.5f / 16.f, 10.5f / 16.f },
+            { 12.5f / 16.f, 4.5f / 16.f, 14.5f / 16.f,  6.5f / 16.f },
+            { 3.5f / 16.f, 11.5f / 16.f,  1.5f / 16.f,  9.5f / 16.f },
+            { 15.5f / 16.f, 7.5f / 16.f, 13.5f / 16.f,  5.5f / 16.f },
+        };
+
+        bool useSIMD(bool allowSIMD)
+        {
+            static const bool kSupported = isCpuFeatureSupported(CpuFeature::AVX2) && isCpuFeatureSupported(CpuFeature::F16C);
+            return allowSIMD && kSupported;
+        }
+
+        float halfToFloatScalar(uint16_t h)
+        {
+            uint32_t sign = uint32_t(h & 0x8000) << 16;
+            uint32_t exponent = (h >> 10) & 0x1f;
+            uint32_t mantissa = h & 0x3ff;
+            uint32_t bits;
+
+            if (exponent == 0x1f)
+            {
+                // Inf or NaN. NaNs get the quiet bit set, as with the F16C instructions.
+                bits = sign | 0x7f800000 | (mantissa << 13) | (mantissa != 0 ? 0x400000 : 0);
+            }
+            else if (exponent == 0)
+            {
+                if (mantissa == 0)
+                {
+                    bits = sign;
+                }
+                else
+                {
+                    // Denormals are representable as normalized floats.
+                    exponent = 113;
+                    while ((mantissa & 0x400) == 0)
+                    {
+                        mantissa <<= 1;
+                        exponent--;
+                    }
+                    bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+                }
+            }
+            else
+            {
+                bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+            }
+
+            float value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+
+        template<typename T>
+        float unormToFloatScalar(T value)
+        {
+            return float(value) / float(std::numeric_limits<T>::max());
+        }
+
+        uint8_t floatToUnorm8Scalar(float value, float threshold)
+        {
+            // Same operations as the AVX2 version. std::max(0.f, NaN) returns 0.
+            float v = value * 255.f + threshold;
+            v = std::min(std::max(0.f, v), 255.f);
+            return (uint8_t)(int)v;
+        }
+
+        target_avx2 void halfToFloatAVX2(const uint16_t* pSrc, float* pDst, size_t count)
+        {
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8)
+            {
+                __m128i h = _mm_loadu_si128((const __m128i*)(pSrc + i));
+                _mm256_storeu_ps(pDst + i, _mm256_cvtph_ps(h));
+            }
+            for (; i < count; i++) pDst[i] = halfToFloatScalar(pSrc[i]);
+        }
+
+        target_avx2 void unorm8ToFloatAVX2(const uint8_t* pSrc, float* pDst, size_t count)
+        {
+            const __m256 scale = _mm256_set1_ps(255.f);
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8)
+            {
+                __m256i v = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(pSrc + i)));
+                _mm256_storeu_ps(pDst + i, _mm256_div_ps(_mm256_cvtepi32_ps(v), scale));
+            }
+            for (; i < count; i++) pDst[i] = unormToFloatScalar(pSrc[i]);
+        }
+
+        target_avx2 void unorm16ToFloatAVX2(const uint16_t* pSrc, float* pDst, size_t count)
+        {
+            const __m256 scale = _mm256_set1_ps(65535.f);
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8)
+            {
+                __m256i v = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(pSrc + i)));
+                _mm256_storeu_ps(pDst + i, _mm256_div_ps(_mm256_cvtepi32_ps(v), scale));
+            }
+            for (; i < count; i++) pDst[i] = unormToFloatScalar(pSrc[i]);
+        }
+
+        target_avx2 void floatToUnorm8DitheredAVX2(const float* pSrc, uint8_t* pDst, uint32_t width, uint32_t row)
+        {
+            // Thresholds for four consecutive pixels, replicated for the four channels.
+            // Two pixels are processed per iteration, starting at an even pixel index.
+            float thresholds[16];
+            for (uint32_t i = 0; i < 16; i++) thresholds[i] = kDitherThresholds[row & 3][i / 4];
+
+            const __m256 scale = _mm256_set1_ps(255.f);
+            const __m256 zero = _mm256_setzero_ps();
+            uint32_t x = 0;
+            for (; x + 2 <= width; x += 2)
+            {
+                __m256 v = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(pSrc + x * 4), scale), _mm256_loadu_ps(thresholds + (x & 3) * 4));
+                // Returns the second operand for NaNs, which matches the scalar version.
+                v = _mm256_min_ps(_mm256_max_ps(v, zero), scale);
+                __m256i i = _mm256_cvttps_epi32(v);
+                __m128i w = _mm_packus_epi32(_mm256_castsi256_si128(i), _mm256_extracti128_si256(i, 1));
+                _mm_storel_epi64((__m128i*)(pDst + x * 4), _mm_packus_epi16(w, w));
+            }
+            for (; x < width; x++)
+            {
+                for (uint32_t c = 0; c < 4; c++) pDst[x * 4 + c] = floatToUnorm8Scalar(pSrc[x * 4 + c], kDitherThresholds[row & 3][x & 3]);
+            }
+        }
+    }
+
+    void PixelConversion::halfToFloat(const uint16_t* pSrc, float* pDst, size_t count, bool allowSIMD)
+    {
+        if (useSIMD(allowSIMD))
+        {
+            halfToFloatAVX2(pSrc, pDst, count);
+            return;
+        }
+
+        for (size_t i = 0; i < count; i++) pDst[i] = halfToFloatScalar(pSrc[i]);
+    }
+
+    void PixelConversion::unormToFloat(const uint8_t* pSrc, float* pDst, size_t count, bool allowSIMD)
+    {
+        if (useSIMD(allowSIMD))
+        {
+            unorm8ToFloatAVX2(pSrc, pDst, count);
+            return;
+        }
+
+        for (size_t i = 0; i < count; i++) pDst[i] = unormToFloatScalar(pSrc[i]);
+    }
+
+    void PixelConversion::unormToFloat(const uint16_t* pSrc, float* pDst, size_t count, bool allowSIMD)
+    {
+        if (useSIMD(allowSIMD))
+        {
+            unorm16ToFloatAVX2(pSrc, pDst, count);
+            return;
+        }
+
+        for (size_t i = 0; i < count; i++) pDst[i] = unormToFloatScalar(pSrc[i]);
+    }
+
+    void PixelConversion::floatToUnorm8Dithered(const float* pSrc, uint8_t* pDst, uint32_t width, uint32_t row, bool allowSIMD)
+    {
+        if (useSIMD(allowSIMD))
+        {
+            floatToUnorm8DitheredAVX2(pSrc, pDst, width, row);
+            return;
+        }
+
+        for (uint32_t x = 0; x < width; x++)
+        {
+            for (uint32_t c = 0; c < 4; c++) pDst[x * 4 + c] = floatToUnorm8Scalar(pSrc[x * 4 + c], kDitherThresholds[row & 3][x & 3]);
+        }
+    }
+}
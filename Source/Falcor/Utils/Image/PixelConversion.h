@@ -0,0 +1,74 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+
+namespace Falcor
+{
+    /** Conversion of pixel data between formats.
+        The functions use AVX2/F16C kernels if supported by the CPU, and a scalar fallback producing identical results otherwise.
+    */
+    class dlldecl PixelConversion
+    {
+    public:
+        /** Convert half floats to floats.
+            NaNs are converted to quiet NaNs, like the F16C instructions do.
+            \param[in] pSrc Source values.
+            \param[out] pDst Destination values.
+            \param[in] count Number of values.
+            \param[in] allowSIMD If false, the scalar implementation is used.
+        */
+        static void halfToFloat(const uint16_t* pSrc, float* pDst, size_t count, bool allowSIMD = true);
+
+        /** Convert 8-bit unorm values to floats in [0,1].
+            \param[in] pSrc Source values.
+            \param[out] pDst Destination values.
+            \param[in] count Number of values.
+            \param[in] allowSIMD If false, the scalar implementation is used.
+        */
+        static void unormToFloat(const uint8_t* pSrc, float* pDst, size_t count, bool allowSIMD = true);
+
+        /** Convert 16-bit unorm values to floats in [0,1].
+            \param[in] pSrc Source values.
+            \param[out] pDst Destination values.
+            \param[in] count Number of values.
+            \param[in] allowSIMD If false, the scalar implementation is used.
+        */
+        static void unormToFloat(const uint16_t* pSrc, float* pDst, size_t count, bool allowSIMD = true);
+
+        /** Convert a row of RGBA float pixels to RGBA 8-bit unorm pixels using ordered dithering.
+            The values are clamped to [0,1] without any color space conversion. NaNs are converted to zero.
+            A 4x4 Bayer matrix is used for dithering, so the row index is needed to select the thresholds.
+            \param[in] pSrc Source pixels, 4 floats per pixel.
+            \param[out] pDst Destination pixels, 4 bytes per pixel.
+            \param[in] width Number of pixels in the row.
+            \param[in] row Row index in the image.
+            \param[in] allowSIMD If false, the scalar implementation is used.
+        */
+        static void floatToUnorm8Dithered(const float* pSrc, uint8_t* pDst, uint32_t width, uint32_t row, bool allowSIMD = true);
+    };
+}
@@ -0,0 +1,178 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "stdafx.h"
+#include "TexturePreprocessor.h"
+#include "Utils/CryptoUtils.h"
+#include <filesystem>
+
+namespace Falcor
+{
+    namespace
+    {
+        // Bump the version when the conversion or the choice of formats changes to invalidate existing files.
+        const uint32_t kVersion = 1;
+
+        const uint32_t kBlockSize = 4;
+
+        std::string getCacheDirectory()
+        {
+            std::string dir = getAppDataDirectory();
+            if (dir.empty()) dir = getExecutableDirectory();
+            return dir + "/Falcor/TextureCache";
+        }
+
+        template<typename T>
+        bool hasAlphaOtherThan(const Bitmap& bitmap, T one)
+        {
+            for (uint32_t y = 0; y < bitmap.getHeight(); y++)
+            {
+                const T* pRow = reinterpret_cast<const T*>(bitmap.getData() + (size_t)y * bitmap.getRowPitch());
+                for (uint32_t x = 0; x < bitmap.getWidth(); x++)
+                {
+                    if (pRow[4 * x + 3] != one) return true;
+                }
+            }
+            return false;
+        }
+    }
+
+    ImageIO::CompressionMode TexturePreprocessor::getCompressionMode(Usage usage, ResourceFormat format, uint32_t width, uint32_t height, bool hasAlpha, bool srgb, bool allowBC7)
+    {
+        using CompressionMode = ImageIO::CompressionMode;
+
+        // The size of the top level of a block compressed texture must be a multiple of the block size.
+        if (width % kBlockSize != 0 || height % kBlockSize != 0) return CompressionMode::None;
+        if (isCompressedFormat(format)) return CompressionMode::None;
+
+        uint32_t channelCount = getFormatChannelCount(format);
+
+        // Float images are only compressed if they hold color data. BC6H doesn't store alpha.
+        if (getFormatType(format) == FormatType::Float)
+        {
+            return (usage == Usage::Color && channelCount >= 3 && !hasAlpha) ? CompressionMode::BC6 : CompressionMode::None;
+        }
+
+        // Keep the number of channels of one and two channel images, so that they are sampled the same way.
+        if (channelCount == 1) return CompressionMode::BC4;
+        if (channelCount == 2) return CompressionMode::BC5;
+
+        switch (usage)
+        {
+        case Usage::Color:
+            if (hasAlpha) return allowBC7 ? CompressionMode::BC7 : CompressionMode::BC3;
+            return CompressionMode::BC1;
+        case Usage::PackedData:
+            if (allowBC7) return CompressionMode::BC7;
+            return hasAlpha ? CompressionMode::BC3 : CompressionMode::BC1;
+        case Usage::Normal:
+            return CompressionMode::BC5;
+        case Usage::Scalar:
+            // BC4 has no sRGB variant.
+            return srgb ? CompressionMode::BC1 : CompressionMode::BC4;
+        default:
+            should_not_get_here();
+            return CompressionMode::None;
+        }
+    }
+
+    bool TexturePreprocessor::hasNonOpaqueAlpha(const Bitmap& bitmap)
+    {
+        switch (bitmap.getFormat())
+        {
+        case ResourceFormat::RGBA8Unorm:
+        case ResourceFormat::RGBA8UnormSrgb:
+        case ResourceFormat::BGRA8Unorm:
+        case ResourceFormat::BGRA8UnormSrgb:
+            return hasAlphaOtherThan<uint8_t>(bitmap, 0xff);
+        case ResourceFormat::RGBA16Float:
+            return hasAlphaOtherThan<uint16_t>(bitmap, 0x3c00);
+        case ResourceFormat::RGBA32Float:
+            return hasAlphaOtherThan<float>(bitmap, 1.f);
+        default:
+            return false;
+        }
+    }
+
+    std::string TexturePreprocessor::getCacheFilename(const std::string& fullPath, const std::string& variant)
+    {
+        SHA1 sha1;
+        sha1.update(kVersion);
+        sha1.update(fullPath);
+        sha1.update(uint8_t(0));
+        sha1.update(variant);
+
+        std::string stem = std::filesystem::path(fullPath).stem().string();
+        return getCacheDirectory() + "/" + stem + "-" + SHA1::toString(sha1.final()) + ".dds";
+    }
+
+    bool TexturePreprocessor::isCacheValid(const std::string& fullPath, const std::string& cacheFilename)
+    {
+        std::error_code ec;
+        auto cacheTime = std::filesystem::last_write_time(cacheFilename, ec);
+        if (ec) return false;
+        auto sourceTime = std::filesystem::last_write_time(fullPath, ec);
+        if (ec) return false;
+        return cacheTime >= sourceTime;
+    }
+
+    void TexturePreprocessor::convert(const Bitmap& bitmap, ImageIO::CompressionMode mode, bool srgb, const std::string& filename)
+    {
+        ResourceFormat format = bitmap.getFormat();
+        const uint8_t* pData = bitmap.getData();
+
+        // There are no three channel 16-bit float DXGI formats. Expand to four channels.
+        std::vector<uint16_t> expandedData;
+        if (format == ResourceFormat::RGB16Float)
+        {
+            expandedData.resize((size_t)bitmap.getWidth() * bitmap.getHeight() * 4);
+            for (uint32_t y = 0; y < bitmap.getHeight(); y++)
+            {
+                const uint16_t* pSrc = reinterpret_cast<const uint16_t*>(bitmap.getData() + (size_t)y * bitmap.getRowPitch());
+                uint16_t* pDst = expandedData.data() + (size_t)y * bitmap.getWidth() * 4;
+                for (uint32_t x = 0; x < bitmap.getWidth(); x++)
+                {
+                    pDst[4 * x + 0] = pSrc[3 * x + 0];
+                    pDst[4 * x + 1] = pSrc[3 * x + 1];
+                    pDst[4 * x + 2] = pSrc[3 * x + 2];
+                    pDst[4 * x + 3] = 0x3c00; // 1.0
+                }
+            }
+            format = ResourceFormat::RGBA16Float;
+            pData = reinterpret_cast<const uint8_t*>(expandedData.data());
+        }
+
+        // Tag the data as sRGB, so that the mips are filtered in linear space and the compressed format is sRGB.
+        if (srgb) format = linearToSrgbFormat(format);
+
+        Bitmap::UniqueConstPtr pConverted;
+        if (format != bitmap.getFormat()) pConverted = Bitmap::create(bitmap.getWidth(), bitmap.getHeight(), format, pData);
+        const Bitmap& source = pConverted ? *pConverted : bitmap;
+
+        writeFileAtomic(filename, [&](const std::string& tempFilename) { ImageIO::saveToDDS(tempFilename, source, mode, true); });
+    }
+}
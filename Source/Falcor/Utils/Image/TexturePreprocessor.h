@@ -0,0 +1,96 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Utils/Image/Bitmap.h"
+#include "Utils/Image/ImageIO.h"
+
+namespace Falcor
+{
+    /** Offline texture preprocessing.
+
+        Converts source images (PNG, JPG, EXR, ...) to block compressed DDS files with a full
+        mip chain. The mips are generated and compressed on the CPU, so converted textures can be
+        uploaded directly without any GPU post-processing. Converted files are stored in a cache
+        directory and are reused as long as they are newer than the source image.
+
+        The conversion of a single image is single threaded. Clients are expected to convert
+        multiple images in parallel.
+    */
+    class dlldecl TexturePreprocessor
+    {
+    public:
+        /** How the texture data is used. Determines the block compression format.
+        */
+        enum class Usage
+        {
+            Color,      ///< Color data like base color or emissive. Float images are stored as BC6H.
+            PackedData, ///< Multiple independent channels packed into one texture, e.g. occlusion/roughness/metallic. Stored with the highest quality format.
+            Normal,     ///< Tangent space normal map. Only the x and y components are stored (BC5); the z component is reconstructed when shading.
+            Scalar,     ///< Single channel data like occlusion or displacement.
+        };
+
+        /** Choose the block compression format for an image.
+            Returns CompressionMode::None if the image should not be compressed, e.g. because its size is not a multiple
+            of the block size, or because the image holds float data that can't be represented by any of the formats.
+            \param[in] usage How the texture data is used.
+            \param[in] format Format of the source image.
+            \param[in] width Width of the source image.
+            \param[in] height Height of the source image.
+            \param[in] hasAlpha True if the alpha channel is used and holds non-opaque values.
+            \param[in] srgb True if the texture is loaded as sRGB.
+            \param[in] allowBC7 If false, BC1 and BC3 are used instead of BC7. BC7 has better quality but is much slower to compress.
+            \return The compression mode.
+        */
+        static ImageIO::CompressionMode getCompressionMode(Usage usage, ResourceFormat format, uint32_t width, uint32_t height, bool hasAlpha, bool srgb, bool allowBC7 = true);
+
+        /** Check if a bitmap has an alpha channel with values other than one.
+        */
+        static bool hasNonOpaqueAlpha(const Bitmap& bitmap);
+
+        /** Get the filename of the converted texture for a source image.
+            \param[in] fullPath Full path of the source image.
+            \param[in] variant String identifying how the texture is converted, e.g. the usage and color space.
+            \return Full path of the converted DDS file in the cache directory.
+        */
+        static std::string getCacheFilename(const std::string& fullPath, const std::string& variant);
+
+        /** Check if a converted texture exists and is newer than its source image.
+        */
+        static bool isCacheValid(const std::string& fullPath, const std::string& cacheFilename);
+
+        /** Generate mips for an image, compress it and write it to a DDS file.
+            The file is written to a temporary location first and renamed when done.
+            Throws an exception if the conversion fails.
+            \param[in] bitmap Source image.
+            \param[in] mode Block compression mode.
+            \param[in] srgb If true, the image is interpreted as sRGB data. Mips are filtered in linear space and the DDS file uses an sRGB format.
+            \param[in] filename Full path of the DDS file to write.
+        */
+        static void convert(const Bitmap& bitmap, ImageIO::CompressionMode mode, bool srgb, const std::string& filename);
+    };
+}
@@ -27,69 +27,285 @@
  **************************************************************************/
 #include "stdafx.h"
 #include "Threading.h"
+#include <deque>
 
 namespace Falcor
 {
+    struct Threading::Task::State
+    {
+        std::atomic<bool> done{ false };
+        std::exception_ptr exception;
+    };
+
     namespace
     {
+        /** Task deque owned by a single worker thread.
+            The owner pushes and pops at the back, other threads steal from the front.
+        */
+        struct WorkerQueue
+        {
+            std::mutex mutex;
+            std::deque<std::function<void()>> tasks;
+        };
+
         struct ThreadingData
         {
-            bool initialized = false;
+            std::atomic<bool> initialized{ false };
+            std::mutex startMutex;                              ///< Serializes start() and shutdown().
             std::vector<std::thread> threads;
-            uint32_t current;
+            std::vector<std::unique_ptr<WorkerQueue>> queues;   ///< One queue per worker thread.
+            std::atomic<bool> stop{ false };
+            std::atomic<uint64_t> pendingTasks{ 0 };            ///< Number of dispatched tasks that have not completed yet.
+            std::atomic<uint32_t> nextQueue{ 0 };               ///< Round-robin queue index for tasks dispatched from non-worker threads.
+
+            // Wake-up signaling. The epoch is bumped whenever a task is dispatched or completed.
+            std::atomic<uint64_t> epoch{ 0 };
+            std::atomic<uint32_t> sleepers{ 0 };
+            std::mutex mutex;
+            std::condition_variable cv;
         } gData;
+
+        /** Index of the worker thread executing the current code, or -1 for non-worker threads.
+        */
+        thread_local int32_t tWorkerIndex = -1;
+
+        void signal()
+        {
+            gData.epoch.fetch_add(1);
+            if (gData.sleepers.load() > 0)
+            {
+                // Acquire the mutex to make sure a thread about to sleep either sees the new epoch or receives the notification.
+                { std::lock_guard<std::mutex> lock(gData.mutex); }
+                gData.cv.notify_all();
+            }
+        }
+
+        void waitForSignal(uint64_t epoch)
+        {
+            gData.sleepers.fetch_add(1);
+            {
+                std::unique_lock<std::mutex> lock(gData.mutex);
+                gData.cv.wait(lock, [epoch]() { return gData.epoch.load() != epoch || gData.stop.load(); });
+            }
+            gData.sleepers.fetch_sub(1);
+        }
+
+        void pushTask(std::function<void()>&& task)
+        {
+            uint32_t queueCount = (uint32_t)gData.queues.size();
+            uint32_t index = tWorkerIndex >= 0 ? (uint32_t)tWorkerIndex : gData.nextQueue.fetch_add(1) % queueCount;
+            gData.pendingTasks.fetch_add(1);
+            {
+                WorkerQueue& queue = *gData.queues[index];
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                queue.tasks.push_back(std::move(task));
+            }
+            signal();
+        }
+
+        bool popTask(std::function<void()>& task)
+        {
+            uint32_t queueCount = (uint32_t)gData.queues.size();
+            if (queueCount == 0) return false;
+
+            // Pop from the back of our own queue first.
+            if (tWorkerIndex >= 0)
+            {
+                WorkerQueue& queue = *gData.queues[tWorkerIndex];
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                if (!queue.tasks.empty())
+                {
+                    task = std::move(queue.tasks.back());
+                    queue.tasks.pop_back();
+                    return true;
+                }
+            }
+
+            // Steal from the front of the other queues.
+            uint32_t first = tWorkerIndex >= 0 ? (uint32_t)tWorkerIndex + 1 : gData.nextQueue.load();
+            for (uint32_t i = 0; i < queueCount; i++)
+            {
+                uint32_t index = (first + i) % queueCount;
+                if ((int32_t)index == tWorkerIndex) continue;
+                WorkerQueue& queue = *gData.queues[index];
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                if (!queue.tasks.empty())
+                {
+                    task = std::move(queue.tasks.front());
+                    queue.tasks.pop_front();
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        /** Executes a single pending task if there is one.
+            \return True if a task was executed.
+        */
+        bool runPendingTask()
+        {
+            std::function<void()> task;
+            if (!popTask(task)) return false;
+            task();
+            gData.pendingTasks.fetch_sub(1);
+            signal();
+            return true;
+        }
+
+        /** Executes pending tasks until the predicate is satisfied, sleeping when there is nothing to do.
+        */
+        template<typename Pred>
+        void helpUntil(Pred isDone)
+        {
+            while (!isDone())
+            {
+                uint64_t epoch = gData.epoch.load();
+                if (runPendingTask()) continue;
+                if (isDone()) break;
+                waitForSignal(epoch);
+            }
+        }
+
+        void workerThread(uint32_t index)
+        {
+            tWorkerIndex = (int32_t)index;
+            while (true)
+            {
+                uint64_t epoch = gData.epoch.load();
+                if (runPendingTask()) continue;
+                if (gData.stop.load()) break;
+                waitForSignal(epoch);
+            }
+            tWorkerIndex = -1;
+        }
     }
 
     void Threading::start(uint32_t threadCount)
     {
+        std::lock_guard<std::mutex> lock(gData.startMutex);
         if (gData.initialized) return;
 
-        gData.threads.resize(threadCount);
+        threadCount = std::max(1u, threadCount);
+        gData.stop = false;
+        gData.queues.resize(threadCount);
+        for (auto& pQueue : gData.queues) pQueue = std::make_unique<WorkerQueue>();
+        gData.threads.reserve(threadCount);
+        for (uint32_t i = 0; i < threadCount; i++) gData.threads.emplace_back(workerThread, i);
         gData.initialized = true;
     }
 
     void Threading::shutdown()
     {
-        for (auto& t : gData.threads)
-        {
-            if (t.joinable()) t.join();
-        }
+        std::lock_guard<std::mutex> lock(gData.startMutex);
+        if (!gData.initialized) return;
+
+        finish();
 
+        gData.stop = true;
+        signal();
+        for (auto& t : gData.threads) t.join();
+
+        gData.threads.clear();
+        gData.queues.clear();
         gData.initialized = false;
     }
 
+    uint32_t Threading::getThreadCount()
+    {
+        return gData.initialized ? (uint32_t)gData.threads.size() : 0;
+    }
+
     Threading::Task Threading::dispatchTask(const std::function<void(void)>& func)
     {
-        assert(gData.initialized);
+        if (!gData.initialized) start();
 
-        std::thread& t = gData.threads[gData.current];
-        if (t.joinable()) t.join();
-        t = std::thread(func);
-        gData.current = (gData.current + 1) % gData.threads.size();
+        auto pState = std::make_shared<Task::State>();
+        pushTask([func, pState]()
+        {
+            try
+            {
+                func();
+            }
+            catch (...)
+            {
+                pState->exception = std::current_exception();
+            }
+            pState->done.store(true);
+        });
 
-        return Task();
+        return Task(pState);
     }
 
-    void Threading::finish()
+    void Threading::parallelForRange(size_t begin, size_t end, const std::function<void(size_t, size_t)>& func, size_t grainSize)
     {
-        for (auto& t : gData.threads)
+        if (begin >= end) return;
+        if (!gData.initialized) start();
+
+        const size_t count = end - begin;
+        const size_t threadCount = getThreadCount();
+        if (grainSize == 0) grainSize = std::max<size_t>(1, count / (8 * (threadCount + 1)));
+        const size_t chunkCount = (count + grainSize - 1) / grainSize;
+
+        if (chunkCount == 1)
         {
-            if (t.joinable()) t.join();
+            func(begin, end);
+            return;
         }
+
+        // Chunks are handed out dynamically to the calling thread and a set of helper tasks.
+        std::atomic<size_t> nextChunk{ 0 };
+        std::atomic<bool> failed{ false };
+        std::exception_ptr exception;
+        std::mutex exceptionMutex;
+
+        auto processChunks = [&]()
+        {
+            while (true)
+            {
+                size_t chunk = nextChunk.fetch_add(1);
+                if (chunk >= chunkCount || failed.load()) break;
+                size_t first = begin + chunk * grainSize;
+                size_t last = std::min(end, first + grainSize);
+                try
+                {
+                    func(first, last);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(exceptionMutex);
+                    if (!exception) exception = std::current_exception();
+                    failed = true;
+                }
+            }
+        };
+
+        std::vector<Task> helpers;
+        size_t helperCount = std::min(threadCount, chunkCount - 1);
+        helpers.reserve(helperCount);
+        for (size_t i = 0; i < helperCount; i++) helpers.push_back(dispatchTask(processChunks));
+
+        processChunks();
+        for (const auto& task : helpers) task.finish();
+
+        if (exception) std::rethrow_exception(exception);
     }
 
-    Threading::Task::Task()
+    void Threading::finish()
     {
+        if (!gData.initialized) return;
+        helpUntil([]() { return gData.pendingTasks.load() == 0; });
     }
 
-    bool Threading::Task::isRunning()
+    bool Threading::Task::isRunning() const
     {
-        logError("Threading::Task::isRunning() not implemented");
-        return true;
+        return mpState && !mpState->done.load();
     }
 
-    void Threading::Task::finish()
+    void Threading::Task::finish() const
     {
-        logError("Threading::Task::finish() not implemented");
+        if (!mpState) return;
+        helpUntil([this]() { return mpState->done.load(); });
+        if (mpState->exception) std::rethrow_exception(mpState->exception);
     }
 }
@@ -26,58 +26,108 @@
  # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  **************************************************************************/
 #pragma once
+#include <algorithm>
+#include <atomic>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
 
 namespace Falcor
 {
+    /** Global work-stealing thread pool.
+
+        Each worker thread owns a task deque. Workers pop tasks from the back of their own deque (LIFO)
+        and steal from the front of other workers' deques (FIFO) when they run out of work.
+        Tasks dispatched from a worker thread are pushed onto that worker's deque, so tasks can freely
+        spawn and wait on nested tasks. A thread waiting on a task executes other pending tasks
+        while it waits, which avoids deadlocks when all workers are blocked in nested waits.
+    */
     class dlldecl Threading
     {
     public:
-        const static uint32_t kDefaultThreadCount = 16;
-
-        /** Handle to a dispatched task
-
-            TODO: Implementation
+        /** Handle to a dispatched task.
+            Handles are cheap to copy. A default constructed handle refers to no task and is never running.
         */
-        class Task
+        class dlldecl Task
         {
         public:
+            Task() = default;
+
             /** Check if task is still executing
             */
-            bool isRunning();
+            bool isRunning() const;
 
-            /** Wait for task to finish executing
+            /** Wait for task to finish executing.
+                The calling thread helps executing pending tasks while waiting.
+                If the task threw an exception, it is rethrown here.
             */
-            void finish();
+            void finish() const;
 
         private:
-            Task();
+            struct State;
+            Task(const std::shared_ptr<State>& pState) : mpState(pState) {}
+            std::shared_ptr<State> mpState;
             friend class Threading;
         };
 
-        /** Initializes the global thread pool
-            \param[in] threadCount Number of threads in the pool
+        /** Initializes the global thread pool. Does nothing if the pool is already running.
+            \param[in] threadCount Number of worker threads in the pool. Defaults to the number of logical cores.
         */
-        static void start(uint32_t threadCount = kDefaultThreadCount);
+        static void start(uint32_t threadCount = getLogicalThreadCount());
 
-        /** Waits for all currently executing threads to finish
+        /** Waits for all dispatched tasks to finish.
+            The calling thread helps executing pending tasks while waiting.
+            Must not be called from within a task.
         */
         static void finish();
 
-        /** Waits for all currently executing threads to finish and shuts down the thread pool
+        /** Waits for all dispatched tasks to finish and shuts down the thread pool
         */
         static void shutdown();
 
         /** Returns the maximum number of concurrent threads supported by the hardware
         */
-        static uint32_t getLogicalThreadCount() { return std::thread::hardware_concurrency(); }
+        static uint32_t getLogicalThreadCount() { return std::max(1u, std::thread::hardware_concurrency()); }
+
+        /** Returns the number of worker threads in the pool, or 0 if the pool is not running.
+        */
+        static uint32_t getThreadCount();
 
         /** Starts a task on an available thread.
+            The pool is started with the default thread count if it's not already running.
             \return Handle to the task
         */
         static Task dispatchTask(const std::function<void(void)>& func);
+
+        /** Executes a function over the index range [begin, end) in parallel.
+            The range is split into chunks of at least grainSize indices which are processed by the worker threads
+            and the calling thread. The call returns when the whole range has been processed.
+            This function may be called from within a task.
+            If any invocation throws, the first exception is rethrown after all chunks are done.
+            \param[in] begin First index.
+            \param[in] end One past the last index.
+            \param[in] func Function called with a subrange [first, last) of indices.
+            \param[in] grainSize Minimum number of indices per chunk. If 0, a grain size is chosen automatically.
+        */
+        static void parallelForRange(size_t begin, size_t end, const std::function<void(size_t, size_t)>& func, size_t grainSize = 0);
+
+        /** Executes a function for each index in [begin, end) in parallel. See parallelForRange().
+            \param[in] begin First index.
+            \param[in] end One past the last index.
+            \param[in] func Function called with a single index.
+            \param[in] grainSize Minimum number of indices per chunk. If 0, a grain size is chosen automatically.
+        */
+        template<typename Func>
+        static void parallelFor(size_t begin, size_t end, Func func, size_t grainSize = 0)
+        {
+            parallelForRange(begin, end, [&func](size_t first, size_t last)
+            {
+                for (size_t i = first; i < last; i++) func(i);
+            }, grainSize);
+        }
     };
 
     /** Simple thread barrier class.
@@ -109,6 +109,7 @@ namespace
     const std::string kShadowPassfile = "RenderPasses/CSM/ShadowPass.slang";
     const std::string kVisibilityPassFile = "RenderPasses/CSM/VisibilityPass.ps.slang";
     const std::string kSdsmReadbackLatency = "kSdsmReadbackLatency";
+    const std::string kPerCascadeDraws = "_PER_CASCADE_DRAWS";
 }
 
 #if 0
@@ -289,6 +290,7 @@ void CSM::createShadowPassResources()
     defines.add("TEST_ALPHA");
     defines.add("_CASCADE_COUNT", std::to_string(mCsmData.cascadeCount));
     defines.add("_ALPHA_CHANNEL", "a");
+    if (mCullMeshes) defines.add(kPerCascadeDraws);
     ResourceFormat colorFormat = ResourceFormat::Unknown;
     switch ((CsmFilter)mCsmData.filterMode)
     {
@@ -501,6 +503,20 @@ void getCascadeCropParams(const float3 crd[8], const glm::mat4& lightVP, float4&
     offset.w = 0;
 }
 
+// Returns the transform from world space to the clip space of a cascade. This matches the transform in the shadow pass geometry shader.
+static glm::mat4 getCascadeMatrix(const glm::mat4& globalMat, const float4& cascadeScale, const float4& cascadeOffset)
+{
+    glm::mat4 scaleMat = glm::mat4(1.f);
+    scaleMat[0][0] = cascadeScale.x;
+    scaleMat[1][1] = cascadeScale.y;
+    scaleMat[2][2] = cascadeScale.z;
+
+    // The offset is added after the perspective divide of the world space position, i.e. independent of the clip space w.
+    glm::mat4 cascadeMat = scaleMat * globalMat;
+    cascadeMat[3] += float4(float3(cascadeOffset), 0.f);
+    return cascadeMat;
+}
+
 void CSM::partitionCascades(const Camera* pCamera, const float2& distanceRange)
 {
     struct
@@ -616,7 +632,30 @@ void CSM::renderScene(RenderContext* pCtx)
 
     pCB->setBlob(&mCsmData, 0, sizeof(mCsmData));
     mpLightCamera->setProjectionMatrix(mCsmData.globalMat);
-    mpScene->rasterize(pCtx, mShadowPass.pState.get(), mShadowPass.pVars.get());
+
+    if (!mCullMeshes)
+    {
+        // Draw all cascades at once. The shadow map is rendered from the light, so don't cull against the camera frustum.
+        mCascadeCullingStats.clear();
+        mpScene->rasterize(pCtx, mShadowPass.pState.get(), mShadowPass.pVars.get(), Scene::RenderFlags::NoFrustumCulling);
+        return;
+    }
+
+    // Draw each cascade with the casters inside its light frustum, extruded toward the light.
+    mCascadeDrawLists.resize(mCsmData.cascadeCount);
+    mCascadeCullingStats.resize(mCsmData.cascadeCount);
+    for (uint32_t c = 0; c < mCsmData.cascadeCount; c++)
+    {
+        glm::mat4 cascadeMat = getCascadeMatrix(mCsmData.globalMat, mCsmData.cascadeScale[c], mCsmData.cascadeOffset[c]);
+        mpScene->cullDrawList(InstanceBVH::Frustum::fromShadowViewProjMatrix(cascadeMat), mCascadeDrawLists[c]);
+
+        auto& stats = mCascadeCullingStats[c];
+        stats.drawCount = mCascadeDrawLists[c].getDrawCount();
+        stats.culledCount = mpScene->getMeshInstanceCount() - stats.drawCount;
+
+        pCB["gCascadeIndex"] = c;
+        mpScene->rasterize(pCtx, mShadowPass.pState.get(), mShadowPass.pVars.get(), mCascadeDrawLists[c]);
+    }
     //        mpCsmSceneRenderer->renderScene(pCtx, mShadowPass.pState.get(), mShadowPass.pVars.get(), mpLightCamera.get());
 }
 
@@ -812,6 +851,25 @@ void CSM::setScene(RenderContext* pRenderContext, const Scene::SharedPtr& pScene
         mDepthPass.pVars = GraphicsVars::create(mDepthPass.pProgram->getReflector());
 
         mShadowPass.pProgram->addDefines(mpScene->getSceneDefines());
+    }
+    else
+    {
+        mDepthPass.pVars = nullptr;
+    }
+    createShadowPassVars();
+
+    //         mpCsmSceneRenderer = CsmSceneRenderer::create(pScene, alphaMapCB, alphaMap, alphaSampler);
+    //         mpCsmSceneRenderer->toggleMeshCulling(mCullMeshes);
+    //         setLight(pScene && pScene->getLightCount() ? pScene->getLight(0) : nullptr);
+}
+
+void CSM::createShadowPassVars()
+{
+    mCascadeDrawLists.clear();
+    mCascadeCullingStats.clear();
+
+    if (mpScene)
+    {
         mShadowPass.pVars = GraphicsVars::create(mShadowPass.pProgram->getReflector());
 
         const auto& pReflector = mShadowPass.pVars->getReflection();
@@ -820,14 +878,9 @@ void CSM::setScene(RenderContext* pRenderContext, const Scene::SharedPtr& pScene
     }
     else
     {
-        mDepthPass.pVars = nullptr;
         mShadowPass.pVars = nullptr;
         mPerLightCbLoc = {};
     }
-
-    //         mpCsmSceneRenderer = CsmSceneRenderer::create(pScene, alphaMapCB, alphaMap, alphaSampler);
-    //         mpCsmSceneRenderer->toggleMeshCulling(mCullMeshes);
-    //         setLight(pScene && pScene->getLightCount() ? pScene->getLight(0) : nullptr);
 }
 
 void CSM::renderUI(Gui::Widgets& widget)
@@ -855,6 +908,20 @@ void CSM::renderUI(Gui::Widgets& widget)
 
     // Mesh culling
     if (widget.checkbox("Cull Meshes", mCullMeshes)) toggleMeshCulling(mCullMeshes);
+    widget.tooltip("Draw each cascade separately with only the shadow casters inside the cascade's light frustum, extruded toward the light.", true);
+    if (!mCascadeCullingStats.empty())
+    {
+        if (auto cullingGroup = widget.group("Caster Culling Stats"))
+        {
+            std::string text;
+            for (size_t c = 0; c < mCascadeCullingStats.size(); c++)
+            {
+                const auto& stats = mCascadeCullingStats[c];
+                text += "Cascade " + std::to_string(c) + ": " + std::to_string(stats.drawCount) + " drawn, " + std::to_string(stats.culledCount) + " culled\n";
+            }
+            cullingGroup.text(text);
+        }
+    }
 
     //Filter mode
     uint32_t filterIndex = static_cast<uint32_t>(mCsmData.filterMode);
@@ -1018,4 +1085,9 @@ void CSM::resizeShadowMap(const uint2& smDims)
 void CSM::toggleMeshCulling(bool enabled)
 {
     mCullMeshes = enabled;
+
+    // Switching between per-cascade draws and a single draw for all cascades changes the shadow program, so the vars are recreated.
+    if (enabled) mShadowPass.pProgram->addDefine(kPerCascadeDraws);
+    else mShadowPass.pProgram->removeDefine(kPerCascadeDraws);
+    createShadowPassVars();
 }
@@ -59,6 +59,18 @@ public:
 
     void toggleMeshCulling(bool enabled);
 
+    /** Shadow caster culling statistics of a cascade.
+    */
+    struct CascadeCullingStats
+    {
+        uint32_t drawCount = 0;     ///< Number of mesh instances drawn into the cascade.
+        uint32_t culledCount = 0;   ///< Number of mesh instances culled.
+    };
+
+    /** Get the shadow caster culling statistics per cascade of the last frame. Empty if mesh culling is disabled.
+    */
+    const std::vector<CascadeCullingStats>& getCascadeCullingStats() const { return mCascadeCullingStats; }
+
     // Scripting functions
     void setCascadeCount(uint32_t cascadeCount);
     void setMapSize(const uint2& size) { resizeShadowMap(size); }
@@ -103,6 +115,7 @@ private:
 
     void createDepthPassResources();
     void createShadowPassResources();
+    void createShadowPassVars();
     void createVisibilityPassResources();
 
     // Set shadow map generation parameters into a program.
@@ -182,6 +195,8 @@ private:
 
     CsmData mCsmData;
     bool mCullMeshes = true;
+    std::vector<Scene::CulledDrawList> mCascadeDrawLists;       ///< Shadow casters per cascade, used if mCullMeshes is set.
+    std::vector<CascadeCullingStats> mCascadeCullingStats;
 
     /** Resize
     */
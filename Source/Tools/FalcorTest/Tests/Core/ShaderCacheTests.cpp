@@ -0,0 +1,223 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+namespace Falcor
+{
+    namespace
+    {
+        const std::string kTestDirectory = (std::filesystem::temp_directory_path() / "FalcorShaderCacheTests").string();
+
+        /** Redirects the shader cache to an empty temporary directory for the duration of a test.
+        */
+        class ScopedCacheDirectory
+        {
+        public:
+            ScopedCacheDirectory()
+                : mPrevDirectory(ShaderCache::getCacheDirectory())
+                , mPrevMaxSize(ShaderCache::getMaxSize())
+                , mPrevEnabled(ShaderCache::isEnabled())
+            {
+                ShaderCache::setCacheDirectory(kTestDirectory);
+                ShaderCache::setEnabled(true);
+                ShaderCache::clear();
+                ShaderCache::resetStats();
+            }
+
+            ~ScopedCacheDirectory()
+            {
+                ShaderCache::clear();
+                ShaderCache::setCacheDirectory(mPrevDirectory);
+                ShaderCache::setMaxSize(mPrevMaxSize);
+                ShaderCache::setEnabled(mPrevEnabled);
+            }
+
+        private:
+            std::string mPrevDirectory;
+            uint64_t mPrevMaxSize;
+            bool mPrevEnabled;
+        };
+
+        ShaderCache::Key makeKey(uint32_t i)
+        {
+            return SHA1::compute(&i, sizeof(i));
+        }
+
+        std::vector<uint8_t> makeData(uint32_t i, size_t size)
+        {
+            std::vector<uint8_t> data(size);
+            for (size_t j = 0; j < size; j++) data[j] = (uint8_t)(i * 31 + j);
+            return data;
+        }
+    }
+
+    CPU_TEST(ShaderCacheReadWrite)
+    {
+        ScopedCacheDirectory scope;
+
+        const uint32_t kEntryCount = 8;
+        const size_t kEntrySize = 1000;
+
+        for (uint32_t i = 0; i < kEntryCount; i++)
+        {
+            EXPECT(!ShaderCache::read(makeKey(i))) << "i = " << i;
+            auto data = makeData(i, kEntrySize);
+            ShaderCache::write(makeKey(i), data.data(), data.size());
+        }
+
+        for (uint32_t i = 0; i < kEntryCount; i++)
+        {
+            auto blob = ShaderCache::read(makeKey(i));
+            EXPECT(blob) << "i = " << i;
+            if (!blob) continue;
+            auto data = makeData(i, kEntrySize);
+            EXPECT_EQ(blob->getBufferSize(), data.size());
+            if (blob->getBufferSize() == data.size()) EXPECT(std::memcmp(blob->getBufferPointer(), data.data(), data.size()) == 0) << "i = " << i;
+        }
+
+        auto stats = ShaderCache::getStats();
+        EXPECT_EQ(stats.hits, (uint64_t)kEntryCount);
+        EXPECT_EQ(stats.misses, (uint64_t)kEntryCount);
+        EXPECT_EQ(stats.writes, (uint64_t)kEntryCount);
+        EXPECT_EQ(stats.evictions, 0ull);
+        EXPECT_EQ(stats.bytesRead, (uint64_t)(kEntryCount * kEntrySize));
+        EXPECT_GE(ShaderCache::getSize(), (uint64_t)(kEntryCount * kEntrySize));
+
+        // Entries must survive a reset of the in-memory state.
+        ShaderCache::setCacheDirectory(kTestDirectory);
+        EXPECT_GE(ShaderCache::getSize(), (uint64_t)(kEntryCount * kEntrySize));
+        EXPECT(ShaderCache::read(makeKey(0)));
+
+        // Disabled cache never hits.
+        ShaderCache::setEnabled(false);
+        EXPECT(!ShaderCache::read(makeKey(0)));
+        ShaderCache::setEnabled(true);
+
+        ShaderCache::clear();
+        EXPECT_EQ(ShaderCache::getSize(), 0ull);
+        EXPECT(!ShaderCache::read(makeKey(0)));
+    }
+
+    CPU_TEST(ShaderCacheEviction)
+    {
+        ScopedCacheDirectory scope;
+
+        const uint32_t kEntryCount = 16;
+        const size_t kEntrySize = 4096;
+        const uint64_t kMaxSize = 8 * kEntrySize;
+
+        ShaderCache::setMaxSize(kMaxSize);
+
+        for (uint32_t i = 0; i < kEntryCount; i++)
+        {
+            auto data = makeData(i, kEntrySize);
+            ShaderCache::write(makeKey(i), data.data(), data.size());
+
+            // Keep the first entry in use. It should never be evicted.
+            if (i > 0) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            EXPECT(ShaderCache::read(makeKey(0))) << "i = " << i;
+
+            EXPECT_LE(ShaderCache::getSize(), kMaxSize) << "i = " << i;
+        }
+
+        auto stats = ShaderCache::getStats();
+        EXPECT_GT(stats.evictions, 0ull);
+
+        // The most recently written entry is still present, the least recently used ones are gone.
+        EXPECT(ShaderCache::read(makeKey(kEntryCount - 1)));
+        EXPECT(!ShaderCache::read(makeKey(1)));
+
+        // Shrinking the cache evicts immediately.
+        ShaderCache::setMaxSize(kEntrySize + 1024);
+        EXPECT_LE(ShaderCache::getSize(), (uint64_t)(kEntrySize + 1024));
+    }
+
+    CPU_TEST(ShaderCacheFileHash)
+    {
+        std::filesystem::create_directories(kTestDirectory);
+        const std::string path = (std::filesystem::path(kTestDirectory) / "include.slang").string();
+        auto writeFile = [&path](const std::string& contents) { std::ofstream(path, std::ios::trunc) << contents; };
+
+        writeFile("int a;");
+        ShaderCache::Key hash0, hash1, hash2;
+        EXPECT(ShaderCache::getFileHash(path, hash0));
+        EXPECT(ShaderCache::getFileHash(path, hash1));
+        EXPECT(hash0 == hash1);
+
+        // Edits within the same second must change the hash, also when the size is unchanged.
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        writeFile("int b;");
+        EXPECT(ShaderCache::getFileHash(path, hash2));
+        EXPECT(hash2 != hash0);
+
+        std::filesystem::remove(path);
+        EXPECT(!ShaderCache::getFileHash(path, hash0));
+
+        // Libraries that are not found are still distinguished by name.
+        EXPECT(ShaderCache::getLibraryHash({ "missing.dll" }) == ShaderCache::getLibraryHash({ "missing.dll" }));
+        EXPECT(ShaderCache::getLibraryHash({ "missing.dll" }) != ShaderCache::getLibraryHash({ "missing2.dll" }));
+
+        std::filesystem::remove_all(kTestDirectory);
+    }
+
+    GPU_TEST(ShaderCacheProgram)
+    {
+        ScopedCacheDirectory scope;
+
+        auto compile = [&ctx]()
+        {
+            ctx.createProgram("Tests/Core/BufferTests.cs.slang", "clearBuffer", { { "TYPE", "0" } });
+            ctx.getProgram()->getActiveVersion()->getKernels(&ctx.vars());
+        };
+
+        // First compilation populates the cache.
+        compile();
+        auto stats = ShaderCache::getStats();
+        EXPECT_EQ(stats.hits, 0ull);
+        EXPECT_EQ(stats.misses, 1ull);
+        EXPECT_EQ(stats.writes, 1ull);
+
+        // A new program with identical inputs reuses the cached kernel.
+        compile();
+        stats = ShaderCache::getStats();
+        EXPECT_EQ(stats.hits, 1ull);
+        EXPECT_EQ(stats.misses, 1ull);
+
+        // Changing a global define changes the key.
+        Program::DefineList globalDefines = { { "SHADER_CACHE_TEST", "1" } };
+        Program::addGlobalDefines(globalDefines);
+        compile();
+        Program::removeGlobalDefines(globalDefines);
+        stats = ShaderCache::getStats();
+        EXPECT_EQ(stats.hits, 1ull);
+        EXPECT_EQ(stats.misses, 2ull);
+    }
+}
@@ -0,0 +1,169 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/Animation/Animation.h"
+#include "Utils/Timing/CpuTimer.h"
+#include "glm/gtc/quaternion.hpp"
+#include "glm/gtx/transform.hpp"
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        Animation::Keyframe createKeyframe(double time, std::mt19937& rng)
+        {
+            std::uniform_real_distribution<float> u(-1.f, 1.f);
+            Animation::Keyframe keyframe;
+            keyframe.time = time;
+            keyframe.translation = float3(u(rng), u(rng), u(rng)) * 10.f;
+            keyframe.scaling = float3(u(rng), u(rng), u(rng)) * 0.5f + 1.f;
+            keyframe.rotation = glm::normalize(glm::quat(u(rng), u(rng), u(rng), u(rng)));
+            return keyframe;
+        }
+
+        std::vector<Animation::SharedPtr> createAnimations(uint32_t animationCount, uint32_t keyframeCount, uint32_t seed)
+        {
+            std::mt19937 rng(seed);
+            std::vector<Animation::SharedPtr> animations(animationCount);
+            for (uint32_t i = 0; i < animationCount; i++)
+            {
+                animations[i] = Animation::create("Animation" + std::to_string(i), i, (double)keyframeCount);
+                animations[i]->setInterpolationMode(i % 2 == 0 ? Animation::InterpolationMode::Linear : Animation::InterpolationMode::Hermite);
+                animations[i]->setPostInfinityBehavior(Animation::Behavior::Cycle);
+                for (uint32_t k = 0; k < keyframeCount; k++) animations[i]->addKeyframe(createKeyframe((double)k, rng));
+            }
+            return animations;
+        }
+
+        float maxDifference(const glm::mat4& a, const glm::mat4& b)
+        {
+            float d = 0.f;
+            for (int i = 0; i < 4; i++) for (int j = 0; j < 4; j++) d = std::max(d, std::abs(a[i][j] - b[i][j]));
+            return d;
+        }
+    }
+
+    CPU_TEST(AnimationLinear)
+    {
+        std::mt19937 rng(1);
+        auto pAnimation = Animation::create("Linear", 0, 1.0);
+        Animation::Keyframe k0 = createKeyframe(0.0, rng);
+        Animation::Keyframe k1 = createKeyframe(1.0, rng);
+        pAnimation->addKeyframe(k1);
+        pAnimation->addKeyframe(k0);
+
+        for (double time : { 0.0, 0.1, 0.25, 0.5, 0.9, 1.0, 1.5 })
+        {
+            float t = (float)std::min(time, 1.0);
+            glm::mat4 T = glm::translate(glm::mix(k0.translation, k1.translation, t));
+            glm::mat4 R = glm::mat4_cast(glm::slerp(k0.rotation, k1.rotation, t));
+            glm::mat4 S = glm::scale(glm::mix(k0.scaling, k1.scaling, t));
+            glm::mat4 ref = T * R * S;
+
+            EXPECT_LE(maxDifference(pAnimation->animate(time), ref), 1e-4f) << "time = " << time;
+        }
+    }
+
+    CPU_TEST(AnimationKeyframes)
+    {
+        // Keyframes added out of order must be kept sorted, and adding a keyframe at an existing time replaces it.
+        std::mt19937 rng(4);
+        auto pAnimation = Animation::create("Animation", 0, 10.0);
+        std::vector<Animation::Keyframe> keyframes;
+        for (double time : { 5.0, 1.0, 9.0, 3.0, 7.0, 1.0 }) keyframes.push_back(createKeyframe(time, rng));
+        for (const auto& keyframe : keyframes) pAnimation->addKeyframe(keyframe);
+
+        for (double time : { 3.0, 5.0, 7.0, 9.0 })
+        {
+            EXPECT(pAnimation->doesKeyframeExists(time)) << "time = " << time;
+        }
+        EXPECT(!pAnimation->doesKeyframeExists(2.0));
+
+        for (size_t i = 1; i < keyframes.size(); i++)
+        {
+            auto keyframe = pAnimation->getKeyframe(keyframes[i].time);
+            EXPECT(keyframe.translation == keyframes[i].translation) << "time = " << keyframes[i].time;
+            EXPECT(keyframe.scaling == keyframes[i].scaling) << "time = " << keyframes[i].time;
+            EXPECT(keyframe.rotation == keyframes[i].rotation) << "time = " << keyframes[i].time;
+        }
+
+        // Evaluating at a keyframe time returns that keyframe's transform.
+        const auto& k = keyframes[3];
+        glm::mat4 ref = glm::translate(k.translation) * glm::mat4_cast(k.rotation) * glm::scale(k.scaling);
+        EXPECT_LE(maxDifference(pAnimation->animate(k.time), ref), 1e-4f);
+    }
+
+    CPU_TEST(AnimationBatch)
+    {
+        // The parallel batch evaluation must match evaluating the animations one by one.
+        auto animations = createAnimations(1000, 8, 2);
+        auto reference = createAnimations(1000, 8, 2);
+
+        for (double time : { 0.0, 0.5, 3.7, 6.2, 11.3 })
+        {
+            std::vector<glm::mat4> matrices;
+            Animation::animate(animations, time, matrices);
+            EXPECT_EQ(matrices.size(), animations.size());
+
+            for (size_t i = 0; i < reference.size(); i++)
+            {
+                EXPECT(matrices[i] == reference[i]->animate(time)) << "animation = " << i << ", time = " << time;
+            }
+        }
+    }
+
+    CPU_TEST(AnimationBenchmark, "Benchmark, enable manually")
+    {
+        const uint32_t keyframeCount = 32;
+        const uint32_t frameCount = 16;
+
+        for (uint32_t animationCount : { 1000, 10000, 100000 })
+        {
+            auto animations = createAnimations(animationCount, keyframeCount, 3);
+            std::vector<glm::mat4> matrices(animationCount);
+
+            auto startTime = CpuTimer::getCurrentTimePoint();
+            for (uint32_t frame = 0; frame < frameCount; frame++)
+            {
+                double time = frame * 0.37;
+                for (size_t i = 0; i < animations.size(); i++) matrices[i] = animations[i]->animate(time);
+            }
+            double serialTime = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint()) / frameCount;
+
+            startTime = CpuTimer::getCurrentTimePoint();
+            for (uint32_t frame = 0; frame < frameCount; frame++)
+            {
+                Animation::animate(animations, frame * 0.37, matrices);
+            }
+            double parallelTime = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint()) / frameCount;
+
+            logInfo("Animate " + std::to_string(animationCount) + " animations: serial " + std::to_string(serialTime) + " ms, parallel " + std::to_string(parallelTime) + " ms per frame");
+        }
+    }
+}
@@ -0,0 +1,197 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/BlasBuildPlanner.h"
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        const uint64_t kMB = 1ull << 20;
+
+        /** Check that a plan contains every BLAS exactly once and that the group and buffer sizes are consistent and within the budget.
+        */
+        void validatePlan(CPUUnitTestContext& ctx, const std::vector<BlasBuildPlanner::BlasSize>& blasSizes, uint64_t memoryBudget, const BlasBuildPlanner::Plan& plan)
+        {
+            uint64_t maxResultByteSize = 0;
+            uint64_t maxScratchByteSize = 0;
+            for (const auto& size : blasSizes)
+            {
+                maxResultByteSize = std::max(maxResultByteSize, size.resultByteSize);
+                maxScratchByteSize = std::max(maxScratchByteSize, size.scratchByteSize);
+            }
+
+            std::vector<uint32_t> blasCount(blasSizes.size(), 0);
+            uint64_t resultBufferByteSize = 0;
+            uint64_t scratchBufferByteSize = 0;
+
+            for (const auto& group : plan.groups)
+            {
+                EXPECT(!group.blasIndices.empty());
+                EXPECT(std::is_sorted(group.blasIndices.begin(), group.blasIndices.end()));
+
+                uint64_t resultByteSize = 0;
+                uint64_t scratchByteSize = 0;
+                for (uint32_t blasIndex : group.blasIndices)
+                {
+                    EXPECT_LT(blasIndex, blasSizes.size());
+                    if (blasIndex >= blasSizes.size()) continue;
+                    blasCount[blasIndex]++;
+                    resultByteSize += blasSizes[blasIndex].resultByteSize;
+                    scratchByteSize += blasSizes[blasIndex].scratchByteSize;
+                }
+                EXPECT_EQ(group.resultByteSize, resultByteSize);
+                EXPECT_EQ(group.scratchByteSize, scratchByteSize);
+
+                resultBufferByteSize = std::max(resultBufferByteSize, resultByteSize);
+                scratchBufferByteSize = std::max(scratchBufferByteSize, scratchByteSize);
+            }
+
+            for (uint32_t count : blasCount) EXPECT_EQ(count, 1);
+
+            EXPECT_EQ(plan.resultBufferByteSize, resultBufferByteSize);
+            EXPECT_EQ(plan.scratchBufferByteSize, scratchBufferByteSize);
+            EXPECT_EQ(plan.peakByteSize, resultBufferByteSize + scratchBufferByteSize);
+            EXPECT_LE(plan.peakByteSize, std::max(memoryBudget, maxResultByteSize + maxScratchByteSize));
+        }
+
+        /** Lower bound on the number of groups. Every group fits in the budget, so the total size needs at least this many groups.
+        */
+        size_t getMinGroupCount(const std::vector<BlasBuildPlanner::BlasSize>& blasSizes, uint64_t memoryBudget)
+        {
+            uint64_t totalByteSize = 0;
+            for (const auto& size : blasSizes) totalByteSize += size.resultByteSize + size.scratchByteSize;
+            return (size_t)((totalByteSize + memoryBudget - 1) / memoryBudget);
+        }
+
+        /** Random BLAS sizes. The scratch size is a random fraction of the result size, as for typical driver prebuild info.
+        */
+        template<typename Distribution>
+        std::vector<BlasBuildPlanner::BlasSize> createRandomBlasSizes(uint32_t count, uint32_t seed, Distribution resultByteSize)
+        {
+            std::mt19937 rng(seed);
+            std::uniform_real_distribution<double> scratchFraction(0.1, 1.0);
+
+            std::vector<BlasBuildPlanner::BlasSize> blasSizes(count);
+            for (auto& size : blasSizes)
+            {
+                size.resultByteSize = std::max((uint64_t)resultByteSize(rng), (uint64_t)256) & ~255ull;
+                size.scratchByteSize = std::max((uint64_t)(size.resultByteSize * scratchFraction(rng)), (uint64_t)256) & ~255ull;
+            }
+            return blasSizes;
+        }
+    }
+
+    CPU_TEST(BlasBuildPlannerEmpty)
+    {
+        BlasBuildPlanner::Plan plan = BlasBuildPlanner::plan({}, BlasBuildPlanner::kDefaultMemoryBudget);
+        EXPECT(plan.groups.empty());
+        EXPECT_EQ(plan.peakByteSize, 0);
+    }
+
+    CPU_TEST(BlasBuildPlannerSingleGroup)
+    {
+        std::vector<BlasBuildPlanner::BlasSize> blasSizes = createRandomBlasSizes(100, 1, std::uniform_real_distribution<double>(0.0, 1.0 * kMB));
+        BlasBuildPlanner::Plan plan = BlasBuildPlanner::plan(blasSizes, BlasBuildPlanner::kDefaultMemoryBudget);
+        validatePlan(ctx, blasSizes, BlasBuildPlanner::kDefaultMemoryBudget, plan);
+        EXPECT_EQ(plan.groups.size(), 1);
+    }
+
+    CPU_TEST(BlasBuildPlannerPairs)
+    {
+        // Pairs of BLASes that exactly fill the budget, in shuffled order. Packing in ID order needs more groups than there are pairs.
+        const uint64_t memoryBudget = 100 * kMB;
+        const uint32_t pairCount = 20;
+
+        std::vector<BlasBuildPlanner::BlasSize> blasSizes;
+        for (uint32_t i = 0; i < pairCount; i++)
+        {
+            uint64_t largeByteSize = (30 + i) * kMB;
+            uint64_t smallByteSize = 50 * kMB - largeByteSize;
+            blasSizes.push_back({ largeByteSize, largeByteSize });
+            blasSizes.push_back({ smallByteSize, smallByteSize });
+        }
+        std::shuffle(blasSizes.begin(), blasSizes.end(), std::mt19937(2));
+
+        BlasBuildPlanner::Plan plan = BlasBuildPlanner::plan(blasSizes, memoryBudget);
+        validatePlan(ctx, blasSizes, memoryBudget, plan);
+        EXPECT_EQ(plan.groups.size(), pairCount);
+        EXPECT_EQ(plan.peakByteSize, memoryBudget);
+    }
+
+    CPU_TEST(BlasBuildPlannerOversized)
+    {
+        // A BLAS larger than the budget raises the peak memory to its size and is built on its own.
+        const uint64_t memoryBudget = 64 * kMB;
+
+        std::vector<BlasBuildPlanner::BlasSize> blasSizes = createRandomBlasSizes(200, 3, std::uniform_real_distribution<double>(0.0, 4.0 * kMB));
+        blasSizes[17] = { 96 * kMB, 32 * kMB };
+
+        BlasBuildPlanner::Plan plan = BlasBuildPlanner::plan(blasSizes, memoryBudget);
+        validatePlan(ctx, blasSizes, memoryBudget, plan);
+        EXPECT_EQ(plan.peakByteSize, 128 * kMB);
+
+        for (const auto& group : plan.groups)
+        {
+            if (std::find(group.blasIndices.begin(), group.blasIndices.end(), 17) != group.blasIndices.end()) EXPECT_EQ(group.blasIndices.size(), 1);
+        }
+    }
+
+    CPU_TEST(BlasBuildPlannerDistributions)
+    {
+        const uint64_t memoryBudget = BlasBuildPlanner::kDefaultMemoryBudget;
+
+        // Many small BLASes of similar size.
+        {
+            auto blasSizes = createRandomBlasSizes(20000, 4, std::uniform_real_distribution<double>(0.0, 1.0 * kMB));
+            auto plan = BlasBuildPlanner::plan(blasSizes, memoryBudget);
+            validatePlan(ctx, blasSizes, memoryBudget, plan);
+            EXPECT_LE(plan.groups.size(), getMinGroupCount(blasSizes, memoryBudget) + 1);
+        }
+
+        // Few large BLASes mixed with many small ones.
+        {
+            auto blasSizes = createRandomBlasSizes(5000, 5, std::uniform_real_distribution<double>(0.0, 0.5 * kMB));
+            std::mt19937 rng(6);
+            std::uniform_real_distribution<double> largeByteSize(50.0 * kMB, 200.0 * kMB);
+            for (uint32_t i = 0; i < 5000; i += 250) blasSizes[i] = { (uint64_t)largeByteSize(rng) & ~255ull, (uint64_t)(0.5 * largeByteSize(rng)) & ~255ull };
+
+            auto plan = BlasBuildPlanner::plan(blasSizes, memoryBudget);
+            validatePlan(ctx, blasSizes, memoryBudget, plan);
+            EXPECT_LE(plan.groups.size(), getMinGroupCount(blasSizes, memoryBudget) + 2);
+        }
+
+        // Heavy-tailed sizes spanning several orders of magnitude.
+        {
+            auto blasSizes = createRandomBlasSizes(10000, 7, std::lognormal_distribution<double>(std::log(64.0 * 1024), 2.0));
+            auto plan = BlasBuildPlanner::plan(blasSizes, memoryBudget);
+            validatePlan(ctx, blasSizes, memoryBudget, plan);
+        }
+    }
+}
@@ -0,0 +1,175 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/InstanceBVH.h"
+#include "glm/gtx/transform.hpp"
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        /** Random boxes of varying size scattered in a cube, with some of them degenerate.
+        */
+        std::vector<AABB> createRandomBoxes(uint32_t count, uint32_t seed)
+        {
+            std::mt19937 rng(seed);
+            std::uniform_real_distribution<float> position(-100.f, 100.f);
+            std::uniform_real_distribution<float> size(0.f, 10.f);
+
+            std::vector<AABB> boxes(count);
+            for (uint32_t i = 0; i < count; i++)
+            {
+                float3 p = float3(position(rng), position(rng), position(rng));
+                float3 e = i % 16 == 0 ? float3(0.f) : float3(size(rng), size(rng), size(rng));
+                boxes[i] = AABB(p, p + e);
+            }
+            return boxes;
+        }
+
+        /** Random camera inside the cube looking in a random direction.
+        */
+        InstanceBVH::Frustum createRandomFrustum(std::mt19937& rng)
+        {
+            std::uniform_real_distribution<float> position(-100.f, 100.f);
+            std::uniform_real_distribution<float> fovY(0.2f, 1.5f);
+
+            float3 eye = float3(position(rng), position(rng), position(rng));
+            float3 target = float3(position(rng), position(rng), position(rng));
+            glm::mat4 view = glm::lookAt(eye, target, float3(0.f, 1.f, 0.f));
+            glm::mat4 proj = glm::perspective(fovY(rng), 16.f / 9.f, 0.1f, 150.f);
+            return InstanceBVH::Frustum::fromViewProjMatrix(proj * view);
+        }
+
+        void testAgainstBruteForce(CPUUnitTestContext& ctx, const InstanceBVH& bvh, const std::vector<AABB>& boxes, const InstanceBVH::Frustum& frustum)
+        {
+            std::vector<uint8_t> visible;
+            InstanceBVH::CullStats stats = bvh.cull(frustum, visible);
+            EXPECT_EQ(visible.size(), boxes.size());
+
+            uint32_t visibleCount = 0;
+            uint32_t mismatchCount = 0;
+            for (size_t i = 0; i < boxes.size(); i++)
+            {
+                bool expected = !frustum.isCulled(boxes[i]);
+                if (expected) visibleCount++;
+                if (expected != (visible[i] != 0)) mismatchCount++;
+            }
+            EXPECT_EQ(mismatchCount, 0u);
+            EXPECT_EQ(stats.visibleCount, visibleCount);
+            EXPECT_LE(stats.boxTestCount, (uint32_t)boxes.size());
+        }
+    }
+
+    CPU_TEST(InstanceBVHFrustum)
+    {
+        glm::mat4 view = glm::lookAt(float3(0.f), float3(0.f, 0.f, -1.f), float3(0.f, 1.f, 0.f));
+        glm::mat4 proj = glm::perspective(glm::radians(90.f), 1.f, 1.f, 100.f);
+        InstanceBVH::Frustum frustum = InstanceBVH::Frustum::fromViewProjMatrix(proj * view);
+
+        EXPECT(!frustum.isCulled(AABB(float3(-1.f, -1.f, -11.f), float3(1.f, 1.f, -9.f))));      // In front of the camera.
+        EXPECT(!frustum.isCulled(AABB(float3(-1.f, -1.f, -1.5f), float3(1.f, 1.f, -0.5f))));     // Straddling the near plane.
+        EXPECT(frustum.isCulled(AABB(float3(-1.f, -1.f, 9.f), float3(1.f, 1.f, 11.f))));         // Behind the camera.
+        EXPECT(frustum.isCulled(AABB(float3(-1.f, -1.f, -111.f), float3(1.f, 1.f, -101.f))));    // Beyond the far plane.
+        EXPECT(frustum.isCulled(AABB(float3(20.f, -1.f, -11.f), float3(22.f, 1.f, -9.f))));      // Right of the camera.
+        EXPECT(frustum.isCulled(AABB(float3(-1.f, 20.f, -11.f), float3(1.f, 22.f, -9.f))));      // Above the camera.
+
+        // Boxes entirely inside all planes clear the whole mask.
+        uint32_t planeMask = InstanceBVH::kAllPlanesMask;
+        EXPECT(frustum.intersects(AABB(float3(-1.f, -1.f, -11.f), float3(1.f, 1.f, -9.f)), planeMask));
+        EXPECT_EQ(planeMask, 0u);
+    }
+
+    CPU_TEST(InstanceBVHShadowCasterFrustum)
+    {
+        // Directional light shining down the negative y-axis onto a 20x20 area.
+        glm::mat4 view = glm::lookAt(float3(0.f, 100.f, 0.f), float3(0.f), float3(0.f, 0.f, 1.f));
+        glm::mat4 proj = glm::ortho(-10.f, 10.f, -10.f, 10.f, 50.f, 150.f);
+        glm::mat4 viewProj = proj * view;
+        InstanceBVH::Frustum frustum = InstanceBVH::Frustum::fromViewProjMatrix(viewProj);
+        InstanceBVH::Frustum casterFrustum = InstanceBVH::Frustum::fromShadowViewProjMatrix(viewProj);
+
+        AABB inside(float3(-1.f, -1.f, -1.f), float3(1.f, 1.f, 1.f));
+        EXPECT(!frustum.isCulled(inside));
+        EXPECT(!casterFrustum.isCulled(inside));
+
+        // Between the light and the near plane, and behind the light. These still cast shadows.
+        AABB nearLight(float3(-1.f, 60.f, -1.f), float3(1.f, 70.f, 1.f));
+        AABB behindLight(float3(-1.f, 200.f, -1.f), float3(1.f, 210.f, 1.f));
+        EXPECT(frustum.isCulled(nearLight));
+        EXPECT(frustum.isCulled(behindLight));
+        EXPECT(!casterFrustum.isCulled(nearLight));
+        EXPECT(!casterFrustum.isCulled(behindLight));
+
+        // Beyond the far plane or outside the footprint of the shadow map.
+        EXPECT(casterFrustum.isCulled(AABB(float3(-1.f, -60.f, -1.f), float3(1.f, -55.f, 1.f))));
+        EXPECT(casterFrustum.isCulled(AABB(float3(11.f, 60.f, -1.f), float3(12.f, 70.f, 1.f))));
+        EXPECT(casterFrustum.isCulled(AABB(float3(-1.f, 200.f, -12.f), float3(1.f, 210.f, -11.f))));
+
+        // Culling through the hierarchy matches the brute-force test.
+        std::vector<AABB> boxes = createRandomBoxes(5000, 11);
+        InstanceBVH bvh;
+        bvh.build(boxes);
+        testAgainstBruteForce(ctx, bvh, boxes, casterFrustum);
+    }
+
+    CPU_TEST(InstanceBVHCull)
+    {
+        // The larger counts exceed the threshold for parallel traversal.
+        std::mt19937 rng(3);
+        for (uint32_t count : { 0u, 1u, 5u, 100u, 3000u, 20000u })
+        {
+            std::vector<AABB> boxes = createRandomBoxes(count, count);
+            InstanceBVH bvh;
+            bvh.build(boxes);
+            EXPECT_EQ(bvh.getInstanceCount(), count);
+            EXPECT_LE(bvh.getNodeCount(), 2 * count);
+
+            for (uint32_t i = 0; i < 8; i++) testAgainstBruteForce(ctx, bvh, boxes, createRandomFrustum(rng));
+        }
+    }
+
+    CPU_TEST(InstanceBVHRefit)
+    {
+        std::mt19937 rng(5);
+        std::vector<AABB> boxes = createRandomBoxes(10000, 7);
+        InstanceBVH bvh;
+        bvh.build(boxes);
+
+        // Move a subset of the boxes far away and check that culling matches the new positions.
+        std::uniform_real_distribution<float> offset(-150.f, 150.f);
+        for (size_t i = 0; i < boxes.size(); i += 3)
+        {
+            float3 d = float3(offset(rng), offset(rng), offset(rng));
+            boxes[i] = AABB(boxes[i].minPoint + d, boxes[i].maxPoint + d);
+        }
+        bvh.refit(boxes);
+
+        for (uint32_t i = 0; i < 8; i++) testAgainstBruteForce(ctx, bvh, boxes, createRandomFrustum(rng));
+    }
+}
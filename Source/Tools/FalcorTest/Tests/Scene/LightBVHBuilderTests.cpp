@@ -0,0 +1,179 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Experimental/Scene/Lights/LightBVHBuilder.h"
+#include "Utils/Timing/CpuTimer.h"
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        /** Test wrapper giving access to the node building of LightBVHBuilder on synthetic triangle data.
+        */
+        class TestLightBVHBuilder : public LightBVHBuilder
+        {
+        public:
+            struct Result
+            {
+                std::vector<PackedNode> nodes;
+                std::vector<uint32_t> triangleIndices;
+                std::vector<uint64_t> triangleBitmasks;
+                double buildTime = 0.0;                     ///< Time to build the nodes in ms.
+            };
+
+            TestLightBVHBuilder(const Options& options) : LightBVHBuilder(options) {}
+
+            Result build(uint32_t triangleCount, uint32_t seed)
+            {
+                std::mt19937 rng(seed);
+                std::uniform_real_distribution<float> u(0.f, 1.f);
+
+                Result result;
+                BuildingData data(result.nodes);
+                if (getOptions().useSoALayout) data.trianglesSoA.reserve(triangleCount);
+                else data.trianglesData.reserve(triangleCount);
+                for (uint32_t i = 0; i < triangleCount; i++)
+                {
+                    // Place small triangles in a few clusters to get an unbalanced tree.
+                    float3 cluster = float3((float)(i % 7), (float)(i % 3), 0.f) * 10.f;
+                    float3 p = cluster + float3(u(rng), u(rng), u(rng)) * 5.f;
+                    float3 e = float3(u(rng), u(rng), u(rng)) * 0.1f;
+
+                    TriangleSortData tri;
+                    tri.bounds = AABB(p, p + e);
+                    tri.center = tri.bounds.center();
+                    tri.coneDirection = glm::normalize(float3(u(rng), u(rng), u(rng)) - 0.5f + float3(0.f, 0.f, 1e-3f));
+                    tri.cosConeAngle = 1.f;
+                    tri.flux = 0.1f + u(rng);
+                    tri.triangleIndex = i;
+                    if (getOptions().useSoALayout) data.trianglesSoA.push_back(tri);
+                    else data.trianglesData.push_back(tri);
+                }
+
+                auto startTime = CpuTimer::getCurrentTimePoint();
+                buildNodes(triangleCount, data);
+                result.buildTime = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+                result.triangleIndices = std::move(data.triangleIndices);
+                result.triangleBitmasks = std::move(data.triangleBitmasks);
+                return result;
+            }
+        };
+
+        bool isIdentical(const TestLightBVHBuilder::Result& a, const TestLightBVHBuilder::Result& b)
+        {
+            return a.nodes.size() == b.nodes.size() &&
+                std::memcmp(a.nodes.data(), b.nodes.data(), a.nodes.size() * sizeof(PackedNode)) == 0 &&
+                a.triangleIndices == b.triangleIndices &&
+                a.triangleBitmasks == b.triangleBitmasks;
+        }
+
+        void testBuildModes(CPUUnitTestContext& ctx, LightBVHBuilder::SplitHeuristic heuristic, bool splitAlongLargest)
+        {
+            const uint32_t kTriangleCount = 100000;
+
+            LightBVHBuilder::Options options;
+            options.splitHeuristicSelection = heuristic;
+            options.splitAlongLargest = splitAlongLargest;
+
+            // Use the serial build with AoS layout as reference.
+            options.useParallelBuild = false;
+            options.useSoALayout = false;
+            auto reference = TestLightBVHBuilder(options).build(kTriangleCount, 1);
+
+            // All triangles should be referenced exactly once.
+            std::vector<uint32_t> sortedIndices = reference.triangleIndices;
+            std::sort(sortedIndices.begin(), sortedIndices.end());
+            EXPECT_EQ(sortedIndices.size(), kTriangleCount);
+            for (uint32_t i = 0; i < sortedIndices.size(); i++)
+            {
+                if (sortedIndices[i] != i) { EXPECT_EQ(sortedIndices[i], i); break; }
+            }
+
+            // The parallel build and the SoA layout should produce the exact same BVH.
+            for (bool useParallelBuild : { false, true })
+            {
+                for (bool useSoALayout : { false, true })
+                {
+                    options.useParallelBuild = useParallelBuild;
+                    options.useSoALayout = useSoALayout;
+                    auto result = TestLightBVHBuilder(options).build(kTriangleCount, 1);
+                    EXPECT(isIdentical(reference, result)) << "useParallelBuild=" << useParallelBuild << " useSoALayout=" << useSoALayout;
+                }
+            }
+        }
+    }
+
+    CPU_TEST(LightBVHBuilderEqual)
+    {
+        testBuildModes(ctx, LightBVHBuilder::SplitHeuristic::Equal, false);
+    }
+
+    CPU_TEST(LightBVHBuilderBinnedSAH)
+    {
+        testBuildModes(ctx, LightBVHBuilder::SplitHeuristic::BinnedSAH, false);
+        testBuildModes(ctx, LightBVHBuilder::SplitHeuristic::BinnedSAH, true);
+    }
+
+    CPU_TEST(LightBVHBuilderBinnedSAOH)
+    {
+        testBuildModes(ctx, LightBVHBuilder::SplitHeuristic::BinnedSAOH, false);
+        testBuildModes(ctx, LightBVHBuilder::SplitHeuristic::BinnedSAOH, true);
+    }
+
+    CPU_TEST(LightBVHBuilderLayout)
+    {
+        // The SoA layout uses AVX2 for blocks of 8 triangles and scalar code for the remainder.
+        // Use counts around the block size to exercise both, with the default options otherwise.
+        for (uint32_t triangleCount : { 1u, 7u, 8u, 9u, 1000u, 4099u })
+        {
+            LightBVHBuilder::Options options;
+            options.useSoALayout = false;
+            auto aos = TestLightBVHBuilder(options).build(triangleCount, 2);
+            options.useSoALayout = true;
+            auto soa = TestLightBVHBuilder(options).build(triangleCount, 2);
+            EXPECT(isIdentical(aos, soa)) << "triangleCount=" << triangleCount;
+        }
+    }
+
+    CPU_TEST(LightBVHBuilderLayoutBenchmark, "Benchmark, enable manually")
+    {
+        // Compare the build time with the triangle data in AoS and SoA layout, using the default options otherwise.
+        for (uint32_t triangleCount : { 1u << 20, 1u << 22, 1u << 24 })
+        {
+            LightBVHBuilder::Options options;
+            options.useSoALayout = false;
+            auto aos = TestLightBVHBuilder(options).build(triangleCount, 2);
+            options.useSoALayout = true;
+            auto soa = TestLightBVHBuilder(options).build(triangleCount, 2);
+
+            logInfo("Light BVH build of " + std::to_string(triangleCount) + " triangles: AoS " + std::to_string(aos.buildTime) + " ms, SoA " + std::to_string(soa.buildTime) + " ms");
+            EXPECT(isIdentical(aos, soa)) << "triangleCount=" << triangleCount;
+        }
+    }
+}
@@ -0,0 +1,60 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/Material/Material.h"
+
+namespace Falcor
+{
+    CPU_TEST(MaterialHash)
+    {
+        auto pA = Material::create("A");
+        auto pB = Material::create("B");
+
+        // Materials that compare equal must have the same hash. The name is not part of the comparison.
+        EXPECT(*pA == *pB);
+        EXPECT_EQ(pA->getHash(), pB->getHash());
+
+        pA->setBaseColor(float4(0.5f, 0.25f, 1.f, 1.f));
+        pA->setIndexOfRefraction(1.33f);
+        pA->setDoubleSided(true);
+        EXPECT(!(*pA == *pB));
+        EXPECT_NE(pA->getHash(), pB->getHash());
+
+        pB->setBaseColor(float4(0.5f, 0.25f, 1.f, 1.f));
+        pB->setIndexOfRefraction(1.33f);
+        pB->setDoubleSided(true);
+        EXPECT(*pA == *pB);
+        EXPECT_EQ(pA->getHash(), pB->getHash());
+
+        // Negative and positive zero compare equal and must hash the same.
+        pA->setEmissiveColor(float3(0.f, -0.f, 0.f));
+        pB->setEmissiveColor(float3(0.f, 0.f, -0.f));
+        EXPECT(*pA == *pB);
+        EXPECT_EQ(pA->getHash(), pB->getHash());
+    }
+}
@@ -0,0 +1,85 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/Material/MaterialTextureLoader.h"
+#include <filesystem>
+
+namespace Falcor
+{
+    namespace
+    {
+        const std::string kTestDirectory = (std::filesystem::temp_directory_path() / "FalcorMaterialTextureLoaderTests").string();
+        const uint32_t kImageSize = 256;
+
+        /** Write an uncompressed test image. The image is large enough that the files are not hashed in full when compared.
+            \param[in] name Filename in the test directory.
+            \param[in] changedPixel Index of a pixel to change, or -1 to write the default image.
+            \return Full path to the image.
+        */
+        std::string writeTestImage(const std::string& name, int changedPixel = -1)
+        {
+            std::vector<uint8_t> data(kImageSize * kImageSize * 4);
+            for (size_t i = 0; i < data.size(); i++) data[i] = (uint8_t)(i * 7);
+            if (changedPixel >= 0) data[changedPixel * 4] ^= 0xff;
+
+            std::string path = (std::filesystem::path(kTestDirectory) / name).string();
+            Bitmap::saveImage(path, kImageSize, kImageSize, Bitmap::FileFormat::BmpFile, Bitmap::ExportFlags::None, ResourceFormat::RGBA8Unorm, true, data.data());
+            return path;
+        }
+    }
+
+    GPU_TEST(MaterialTextureLoaderDuplicateFiles)
+    {
+        std::filesystem::remove_all(kTestDirectory);
+        std::filesystem::create_directories(kTestDirectory);
+
+        // Two files with identical contents, and one with the same size that only differs in the middle of the image.
+        std::string path = writeTestImage("image.bmp");
+        std::string copyPath = (std::filesystem::path(kTestDirectory) / "copy.bmp").string();
+        std::filesystem::copy_file(path, copyPath);
+        std::string changedPath = writeTestImage("changed.bmp", kImageSize * kImageSize / 2);
+        EXPECT_EQ(std::filesystem::file_size(path), std::filesystem::file_size(changedPath));
+
+        std::vector<Material::SharedPtr> materials;
+        {
+            MaterialTextureLoader loader(false);
+            for (const auto& p : { path, copyPath, changedPath, path })
+            {
+                materials.push_back(Material::create("Test"));
+                loader.loadTexture(materials.back(), Material::TextureSlot::BaseColor, p);
+            }
+        }
+
+        for (const auto& pMaterial : materials) EXPECT(pMaterial->getBaseColorTexture() != nullptr);
+        EXPECT(materials[0]->getBaseColorTexture() == materials[1]->getBaseColorTexture());
+        EXPECT(materials[0]->getBaseColorTexture() == materials[3]->getBaseColorTexture());
+        EXPECT(materials[0]->getBaseColorTexture() != materials[2]->getBaseColorTexture());
+
+        std::filesystem::remove_all(kTestDirectory);
+    }
+}
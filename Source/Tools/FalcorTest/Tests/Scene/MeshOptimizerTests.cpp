@@ -0,0 +1,380 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/MeshOptimizer.h"
+#include "glm/gtc/quaternion.hpp"
+#include "glm/gtx/transform.hpp"
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        /** Regular grid of quads with the triangles in random order.
+        */
+        struct GridMesh
+        {
+            std::vector<uint32_t> indices;
+            std::vector<float3> positions;
+
+            GridMesh(uint32_t size, uint32_t seed)
+            {
+                for (uint32_t y = 0; y <= size; y++)
+                {
+                    for (uint32_t x = 0; x <= size; x++) positions.push_back(float3((float)x, (float)y, (float)((x * 7 + y * 3) % 5)));
+                }
+
+                std::vector<std::array<uint32_t, 3>> triangles;
+                for (uint32_t y = 0; y < size; y++)
+                {
+                    for (uint32_t x = 0; x < size; x++)
+                    {
+                        uint32_t v = y * (size + 1) + x;
+                        triangles.push_back({ v, v + 1, v + size + 2 });
+                        triangles.push_back({ v, v + size + 2, v + size + 1 });
+                    }
+                }
+
+                std::mt19937 rng(seed);
+                std::shuffle(triangles.begin(), triangles.end(), rng);
+                for (const auto& t : triangles) indices.insert(indices.end(), t.begin(), t.end());
+            }
+        };
+
+        /** Returns the triangles as sorted list of vertex position triples. Each triangle is rotated
+            so that its smallest vertex comes first, which keeps the winding but makes the list independent of the order of the vertices.
+        */
+        std::vector<std::array<float3, 3>> getTriangles(const std::vector<uint32_t>& indices, const std::vector<float3>& positions)
+        {
+            auto less = [](const float3& a, const float3& b) { return std::tie(a.x, a.y, a.z) < std::tie(b.x, b.y, b.z); };
+
+            std::vector<std::array<float3, 3>> triangles;
+            for (size_t i = 0; i < indices.size(); i += 3)
+            {
+                std::array<float3, 3> t = { positions[indices[i]], positions[indices[i + 1]], positions[indices[i + 2]] };
+                while (less(t[1], t[0]) || less(t[2], t[0])) std::rotate(t.begin(), t.begin() + 1, t.end());
+                triangles.push_back(t);
+            }
+
+            std::sort(triangles.begin(), triangles.end(), [&](const auto& a, const auto& b)
+            {
+                return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(), less);
+            });
+            return triangles;
+        }
+
+        std::vector<StaticVertexData> createVertices(uint32_t vertexCount, std::mt19937& rng)
+        {
+            std::uniform_real_distribution<float> u(-1.f, 1.f);
+            std::vector<StaticVertexData> vertices(vertexCount);
+            for (auto& v : vertices)
+            {
+                v.position = float3(u(rng), u(rng), u(rng)) * 10.f;
+                v.normal = glm::normalize(float3(u(rng), u(rng), u(rng)));
+                v.tangent = float4(glm::normalize(glm::cross(v.normal, float3(0.f, 0.f, 1.f))), u(rng) < 0.f ? -1.f : 1.f);
+                v.texCrd = float2(u(rng), u(rng));
+            }
+            return vertices;
+        }
+
+        std::vector<StaticVertexData> transformVertices(const std::vector<StaticVertexData>& vertices, const glm::mat4& transform)
+        {
+            std::vector<StaticVertexData> result = vertices;
+            for (auto& v : result)
+            {
+                v.position = float3(transform * float4(v.position, 1.f));
+                v.normal = glm::normalize(glm::mat3(transform) * v.normal);
+                v.tangent = float4(glm::normalize(glm::mat3(transform) * float3(v.tangent)), v.tangent.w);
+            }
+            return result;
+        }
+
+        /** Mesh with a group ID per vertex. Vertices of different groups may share positions, which creates a seam between the groups.
+        */
+        struct GroupedMesh
+        {
+            std::vector<uint32_t> indices;
+            std::vector<float3> positions;
+            std::vector<uint32_t> groups;
+
+            /** Add a grid of quads with vertices at pos(x, y) for x, y in [0, size].
+            */
+            template<typename Func>
+            void addGrid(uint32_t size, uint32_t group, Func pos)
+            {
+                uint32_t base = (uint32_t)positions.size();
+                for (uint32_t y = 0; y <= size; y++)
+                {
+                    for (uint32_t x = 0; x <= size; x++)
+                    {
+                        positions.push_back(pos(x, y));
+                        groups.push_back(group);
+                    }
+                }
+                for (uint32_t y = 0; y < size; y++)
+                {
+                    for (uint32_t x = 0; x < size; x++)
+                    {
+                        uint32_t v = base + y * (size + 1) + x;
+                        indices.insert(indices.end(), { v, v + 1, v + size + 2, v, v + size + 2, v + size + 1 });
+                    }
+                }
+            }
+
+            /** Returns true if no triangle references vertices of different groups.
+            */
+            bool isSeamPreserved(const std::vector<uint32_t>& simplified) const
+            {
+                for (size_t i = 0; i < simplified.size(); i += 3)
+                {
+                    if (groups[simplified[i]] != groups[simplified[i + 1]] || groups[simplified[i]] != groups[simplified[i + 2]]) return false;
+                }
+                return true;
+            }
+        };
+
+        /** Unit sphere made of six grids projected from the faces of a cube. Each face is a separate group, so the cube edges are seams.
+        */
+        GroupedMesh createSphere(uint32_t size)
+        {
+            GroupedMesh mesh;
+            for (uint32_t face = 0; face < 6; face++)
+            {
+                mesh.addGrid(size, face, [&](uint32_t x, uint32_t y)
+                {
+                    float u = 2.f * x / size - 1.f;
+                    float v = 2.f * y / size - 1.f;
+                    float w = face % 2 == 0 ? 1.f : -1.f;
+                    // Swap u and v on the negative faces to keep the winding outwards.
+                    if (face % 2 == 1) std::swap(u, v);
+                    float3 p = face < 2 ? float3(w, u, v) : face < 4 ? float3(v, w, u) : float3(u, v, w);
+                    return glm::normalize(p);
+                });
+            }
+            return mesh;
+        }
+
+        void testOptimize(CPUUnitTestContext& ctx, std::vector<uint32_t> indices, std::vector<float3> positions)
+        {
+            const auto triangles = getTriangles(indices, positions);
+            const uint32_t vertexCount = (uint32_t)positions.size();
+            auto statsBefore = MeshOptimizer::analyzeVertexCache(indices, vertexCount);
+
+            MeshOptimizer::optimizeVertexCache(indices, vertexCount);
+            auto statsCache = MeshOptimizer::analyzeVertexCache(indices, vertexCount);
+            EXPECT(getTriangles(indices, positions) == triangles);
+
+            auto remap = MeshOptimizer::optimizeVertexFetch(indices, vertexCount);
+            MeshOptimizer::remapVertices(positions, remap);
+            auto statsAfter = MeshOptimizer::analyzeVertexCache(indices, vertexCount);
+            EXPECT(getTriangles(indices, positions) == triangles);
+
+            // The remapping is a permutation and doesn't change the cache behavior.
+            std::vector<uint32_t> sortedRemap = remap;
+            std::sort(sortedRemap.begin(), sortedRemap.end());
+            for (uint32_t i = 0; i < vertexCount; i++) EXPECT_EQ(sortedRemap[i], i);
+            EXPECT_EQ(statsAfter.transformedVertexCount, statsCache.transformedVertexCount);
+
+            // Vertices are in first-use order.
+            uint32_t nextVertex = 0;
+            for (uint32_t index : indices)
+            {
+                EXPECT_LE(index, nextVertex);
+                if (index == nextVertex) nextVertex++;
+            }
+
+            EXPECT_EQ(statsAfter.triangleCount, statsBefore.triangleCount);
+            EXPECT_EQ(statsAfter.vertexCount, statsBefore.vertexCount);
+            EXPECT_LE(statsAfter.transformedVertexCount, statsBefore.transformedVertexCount);
+        }
+    }
+
+    CPU_TEST(MeshOptimizerStats)
+    {
+        // Two triangles sharing an edge.
+        std::vector<uint32_t> indices = { 0, 1, 2, 2, 1, 3 };
+        auto stats = MeshOptimizer::analyzeVertexCache(indices, 5);
+        EXPECT_EQ(stats.triangleCount, 2u);
+        EXPECT_EQ(stats.vertexCount, 4u);
+        EXPECT_EQ(stats.transformedVertexCount, 4u);
+        EXPECT_EQ(stats.getACMR(), 2.f);
+        EXPECT_EQ(stats.getATVR(), 1.f);
+
+        // With a cache of size 1 only consecutive repeats are hits.
+        stats = MeshOptimizer::analyzeVertexCache(indices, 5, 1);
+        EXPECT_EQ(stats.transformedVertexCount, 5u);
+    }
+
+    CPU_TEST(MeshOptimizerGrid)
+    {
+        GridMesh grid(64, 1);
+        auto statsBefore = MeshOptimizer::analyzeVertexCache(grid.indices, (uint32_t)grid.positions.size());
+
+        testOptimize(ctx, grid.indices, grid.positions);
+
+        // A regular grid should get close to the optimal ACMR of 0.5.
+        MeshOptimizer::optimizeVertexCache(grid.indices, (uint32_t)grid.positions.size());
+        auto statsAfter = MeshOptimizer::analyzeVertexCache(grid.indices, (uint32_t)grid.positions.size());
+        EXPECT_LT(statsAfter.getACMR(), 0.8f) << "ACMR " << statsBefore.getACMR() << " -> " << statsAfter.getACMR();
+        EXPECT_LT(statsAfter.getATVR(), 1.6f) << "ATVR " << statsBefore.getATVR() << " -> " << statsAfter.getATVR();
+    }
+
+    CPU_TEST(MeshOptimizerDegenerate)
+    {
+        // Mesh with degenerate triangles, duplicate triangles and unreferenced vertices.
+        GridMesh grid(8, 2);
+        grid.indices.insert(grid.indices.end(), { 3, 3, 4, 5, 5, 5, 10, 11, 12, 10, 11, 12 });
+        grid.positions.push_back(float3(-1.f));
+        grid.positions.insert(grid.positions.begin(), float3(-2.f));
+        for (auto& index : grid.indices) index++;
+
+        testOptimize(ctx, grid.indices, grid.positions);
+        testOptimize(ctx, {}, grid.positions);
+    }
+
+    CPU_TEST(MeshOptimizerRigidTransform)
+    {
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<float> u(-1.f, 1.f);
+        const auto vertices = createVertices(100, rng);
+        glm::mat4 transform;
+
+        // Identical meshes.
+        EXPECT(MeshOptimizer::findRigidTransform(vertices, vertices, transform));
+        EXPECT(transform == glm::identity<glm::mat4>());
+
+        for (uint32_t i = 0; i < 10; i++)
+        {
+            glm::mat4 rigid = glm::mat4_cast(glm::normalize(glm::quat(u(rng), u(rng), u(rng), u(rng))));
+            rigid[3] = float4(u(rng), u(rng), u(rng), 1.f) * 100.f;
+            rigid[3].w = 1.f;
+            const auto transformed = transformVertices(vertices, rigid);
+
+            EXPECT(MeshOptimizer::findRigidTransform(vertices, transformed, transform));
+            for (uint32_t j = 0; j < 4; j++)
+            {
+                for (uint32_t k = 0; k < 4; k++) EXPECT_LE(std::abs(transform[j][k] - rigid[j][k]), 1e-3f) << "i = " << i;
+            }
+
+            // Reflections and scaling are not rigid transforms.
+            EXPECT(!MeshOptimizer::findRigidTransform(vertices, transformVertices(vertices, rigid * glm::scale(float3(1.f, 1.f, -1.f))), transform));
+            EXPECT(!MeshOptimizer::findRigidTransform(vertices, transformVertices(vertices, rigid * glm::scale(float3(1.01f))), transform));
+
+            // Changed vertex attributes.
+            auto modified = transformed;
+            modified[50].position.x += 0.1f;
+            EXPECT(!MeshOptimizer::findRigidTransform(vertices, modified, transform));
+            modified = transformed;
+            modified[50].texCrd.x += 1e-6f;
+            EXPECT(!MeshOptimizer::findRigidTransform(vertices, modified, transform));
+            modified = transformed;
+            modified[50].normal = -modified[50].normal;
+            EXPECT(!MeshOptimizer::findRigidTransform(vertices, modified, transform));
+        }
+
+        // Meshes far from the origin have less precise positions, but should still match.
+        for (float offset : { 1e3f, 1e4f })
+        {
+            glm::mat4 rigid = glm::translate(float3(offset, -offset, 0.5f * offset)) * glm::rotate(1.f, glm::normalize(float3(1.f, 2.f, 3.f)));
+            const auto transformed = transformVertices(vertices, rigid);
+            EXPECT(MeshOptimizer::findRigidTransform(vertices, transformed, transform)) << "offset = " << offset;
+            EXPECT(MeshOptimizer::findRigidTransform(transformVertices(vertices, glm::translate(float3(offset))), transformed, transform)) << "offset = " << offset;
+
+            // A vertex moved by 1% of the mesh size is still a mismatch.
+            auto modified = transformed;
+            modified[50].position.x += 0.2f;
+            EXPECT(!MeshOptimizer::findRigidTransform(vertices, modified, transform)) << "offset = " << offset;
+        }
+    }
+
+    CPU_TEST(MeshOptimizerSimplifyPlanar)
+    {
+        // Two planar grids sharing the positions along their common edge, like a texture coordinate seam.
+        const uint32_t kSize = 16;
+        GroupedMesh mesh;
+        mesh.addGrid(kSize, 0, [](uint32_t x, uint32_t y) { return float3((float)x, (float)y, 0.f); });
+        mesh.addGrid(kSize, 1, [](uint32_t x, uint32_t y) { return float3((float)(x + kSize), (float)y, 0.f); });
+
+        auto levels = MeshOptimizer::simplify(mesh.indices, mesh.positions, { 256, 0 }, 1e-3f);
+        EXPECT_EQ(levels.size(), 2ull);
+        if (levels.size() != 2) return;
+
+        // Planar meshes simplify without error. The corners and seam end points are kept, which leaves two triangles per grid.
+        EXPECT_EQ(levels[0].indices.size(), 256ull * 3);
+        EXPECT_EQ(levels[1].indices.size(), 4ull * 3);
+        for (const auto& level : levels)
+        {
+            EXPECT_EQ(level.error, 0.f);
+            EXPECT(mesh.isSeamPreserved(level.indices));
+            for (uint32_t index : level.indices) EXPECT_LT(index, (uint32_t)mesh.positions.size());
+        }
+    }
+
+    CPU_TEST(MeshOptimizerSimplifySphere)
+    {
+        const GroupedMesh mesh = createSphere(16);
+        const uint32_t triangleCount = (uint32_t)mesh.indices.size() / 3;
+
+        // The error is an upper bound on the distance of the vertices to the planes of the replaced triangles.
+        // On a sphere, this also bounds the distance of the triangle centroids to the surface.
+        std::vector<uint32_t> targets = { triangleCount / 2, triangleCount / 4, triangleCount / 8 };
+        auto levels = MeshOptimizer::simplify(mesh.indices, mesh.positions, targets, 0.5f);
+        EXPECT_EQ(levels.size(), targets.size());
+
+        float prevError = 0.f;
+        for (size_t i = 0; i < levels.size(); i++)
+        {
+            const auto& level = levels[i];
+            EXPECT_LE(level.indices.size() / 3, (size_t)targets[i]);
+            EXPECT_GE(level.error, prevError);
+            EXPECT_LE(level.error, 0.5f);
+            EXPECT(mesh.isSeamPreserved(level.indices));
+            prevError = level.error;
+
+            for (size_t j = 0; j < level.indices.size(); j += 3)
+            {
+                float3 p0 = mesh.positions[level.indices[j]];
+                float3 p1 = mesh.positions[level.indices[j + 1]];
+                float3 p2 = mesh.positions[level.indices[j + 2]];
+                float3 centroid = (p0 + p1 + p2) / 3.f;
+                EXPECT_LE(1.f - glm::length(centroid), level.error);
+                EXPECT_GT(glm::dot(glm::cross(p1 - p0, p2 - p0), centroid), 0.f);
+            }
+        }
+
+        // A small error limit stops the simplification before the target is reached.
+        auto bounded = MeshOptimizer::simplify(mesh.indices, mesh.positions, { triangleCount / 8 }, 0.01f);
+        EXPECT_EQ(bounded.size(), 1ull);
+        if (bounded.size() == 1)
+        {
+            EXPECT_GT(bounded[0].indices.size() / 3, (size_t)triangleCount / 8);
+            EXPECT_LT(bounded[0].indices.size() / 3, (size_t)triangleCount);
+            EXPECT_LE(bounded[0].error, 0.01f);
+        }
+    }
+}
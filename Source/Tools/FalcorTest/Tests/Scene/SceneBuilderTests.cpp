@@ -0,0 +1,391 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/SceneBuilder.h"
+#include "Utils/Timing/CpuTimer.h"
+#include "glm/gtx/transform.hpp"
+#include <array>
+#include <random>
+#include <set>
+
+namespace Falcor
+{
+    /** Access to the private mesh splitting of SceneBuilder.
+    */
+    class SceneBuilderTest
+    {
+    public:
+        using MeshSpec = SceneBuilder::MeshSpec;
+
+        /** Create a triangle list mesh with random triangles in [0,1]^3, optionally indexed with shared vertices.
+        */
+        static MeshSpec createRandomMesh(uint32_t triangleCount, bool indexed, uint32_t seed)
+        {
+            std::mt19937 rng(seed);
+            std::uniform_real_distribution<float> u;
+            auto randomVertex = [&]()
+            {
+                StaticVertexData v = {};
+                v.position = float3(u(rng), u(rng), u(rng));
+                v.texCrd = float2(u(rng), u(rng));
+                return v;
+            };
+
+            MeshSpec mesh;
+            mesh.topology = Vao::Topology::TriangleList;
+            if (indexed)
+            {
+                const uint32_t vertexCount = std::max(3u, triangleCount);
+                for (uint32_t i = 0; i < vertexCount; i++) mesh.staticData.push_back(randomVertex());
+                std::uniform_int_distribution<uint32_t> index(0, vertexCount - 1);
+                for (uint32_t i = 0; i < triangleCount * 3; i++) mesh.indexData.push_back(index(rng));
+                mesh.indexCount = (uint32_t)mesh.indexData.size();
+            }
+            else
+            {
+                for (uint32_t i = 0; i < triangleCount * 3; i++) mesh.staticData.push_back(randomVertex());
+            }
+            mesh.vertexCount = (uint32_t)mesh.staticData.size();
+            mesh.staticVertexCount = mesh.vertexCount;
+            for (const auto& v : mesh.staticData) mesh.boundingBox.include(v.position);
+            return mesh;
+        }
+
+        /** Split a mesh. The output meshes are set up like in SceneBuilder::splitMesh().
+        */
+        static void split(SceneBuilder& builder, const MeshSpec& mesh, MeshSpec& leftMesh, MeshSpec& rightMesh, const int axis, const float pos)
+        {
+            leftMesh.topology = rightMesh.topology = mesh.topology;
+            if (mesh.indexCount > 0) builder.splitIndexedMesh(mesh, leftMesh, rightMesh, axis, pos);
+            else builder.splitNonIndexedMesh(mesh, leftMesh, rightMesh, axis, pos);
+        }
+
+        /** Get the vertices of a triangle.
+        */
+        static std::array<StaticVertexData, 3> getTriangle(const MeshSpec& mesh, uint32_t triangle)
+        {
+            std::array<StaticVertexData, 3> vertices;
+            for (uint32_t j = 0; j < 3; j++)
+            {
+                const uint32_t i = triangle * 3 + j;
+                vertices[j] = mesh.staticData[mesh.indexCount > 0 ? mesh.getIndex(i) : i];
+            }
+            return vertices;
+        }
+    };
+
+    namespace
+    {
+        /** Split a mesh and check that all triangles end up on the correct side exactly once, with valid indices and bounds.
+        */
+        void testSplitMesh(CPUUnitTestContext& ctx, SceneBuilder& builder, const SceneBuilderTest::MeshSpec& mesh, const int axis, const float pos)
+        {
+            SceneBuilderTest::MeshSpec leftMesh, rightMesh;
+            SceneBuilderTest::split(builder, mesh, leftMesh, rightMesh, axis, pos);
+
+            const uint32_t triangleCount = mesh.getTriangleCount();
+            EXPECT_EQ(leftMesh.getTriangleCount() + rightMesh.getTriangleCount(), triangleCount);
+
+            // Compare the triangles by their vertex data, as the split meshes have new indices.
+            auto triangleKey = [](const std::array<StaticVertexData, 3>& vertices)
+            {
+                return std::string(reinterpret_cast<const char*>(vertices.data()), sizeof(vertices));
+            };
+            std::multiset<std::string> expected;
+            for (uint32_t i = 0; i < triangleCount; i++) expected.insert(triangleKey(SceneBuilderTest::getTriangle(mesh, i)));
+
+            std::multiset<std::string> actual;
+            auto checkSide = [&](const SceneBuilderTest::MeshSpec& m, bool isLeft)
+            {
+                EXPECT_EQ(m.vertexCount, (uint32_t)m.staticData.size());
+                EXPECT_EQ(m.staticVertexCount, m.vertexCount);
+                if (m.vertexCount > 0) EXPECT_EQ(m.indexCount > 0, mesh.indexCount > 0);
+                if (mesh.indexCount > 0)
+                {
+                    // Indexed meshes only keep the vertices referenced by their triangles.
+                    EXPECT_LE(m.vertexCount, m.indexCount);
+                    for (uint32_t i = 0; i < m.indexCount; i++) EXPECT_LT(m.getIndex(i), m.vertexCount);
+                }
+                else
+                {
+                    EXPECT_EQ(m.vertexCount, m.getTriangleCount() * 3);
+                }
+
+                AABB bounds;
+                for (uint32_t i = 0; i < m.getTriangleCount(); i++)
+                {
+                    auto vertices = SceneBuilderTest::getTriangle(m, i);
+                    const float centroid = (vertices[0].position[axis] + vertices[1].position[axis] + vertices[2].position[axis]) / 3.f;
+                    EXPECT_EQ(centroid < pos, isLeft) << "centroid = " << centroid << ", pos = " << pos;
+                    actual.insert(triangleKey(vertices));
+                    for (const auto& v : vertices) bounds.include(v.position);
+                }
+                if (m.getTriangleCount() > 0)
+                {
+                    EXPECT(m.boundingBox == bounds);
+                }
+            };
+            checkSide(leftMesh, true);
+            checkSide(rightMesh, false);
+
+            EXPECT(actual == expected);
+        }
+    }
+
+    CPU_TEST(SceneBuilderSplitNonIndexedMesh)
+    {
+        auto pBuilder = SceneBuilder::create(SceneBuilder::Flags::None);
+        auto mesh = SceneBuilderTest::createRandomMesh(1000, false, 1);
+        for (int axis = 0; axis < 3; axis++)
+        {
+            testSplitMesh(ctx, *pBuilder, mesh, axis, 0.5f);
+            testSplitMesh(ctx, *pBuilder, mesh, axis, 0.1f);
+        }
+
+        // Splitting outside the mesh puts all triangles on one side.
+        testSplitMesh(ctx, *pBuilder, mesh, 0, -1.f);
+        testSplitMesh(ctx, *pBuilder, mesh, 0, 2.f);
+    }
+
+    CPU_TEST(SceneBuilderSplitIndexedMesh)
+    {
+        for (auto flags : { SceneBuilder::Flags::None, SceneBuilder::Flags::Force32BitIndices })
+        {
+            auto pBuilder = SceneBuilder::create(flags);
+            auto mesh = SceneBuilderTest::createRandomMesh(1000, true, 2);
+            for (int axis = 0; axis < 3; axis++)
+            {
+                testSplitMesh(ctx, *pBuilder, mesh, axis, 0.5f);
+                testSplitMesh(ctx, *pBuilder, mesh, axis, 0.9f);
+            }
+            testSplitMesh(ctx, *pBuilder, mesh, 1, -1.f);
+
+            // Split results are re-split when a group is partitioned recursively, so the halves must be valid input.
+            SceneBuilderTest::MeshSpec leftMesh, rightMesh;
+            SceneBuilderTest::split(*pBuilder, mesh, leftMesh, rightMesh, 0, 0.5f);
+            testSplitMesh(ctx, *pBuilder, leftMesh, 1, 0.5f);
+            testSplitMesh(ctx, *pBuilder, rightMesh, 2, 0.5f);
+        }
+    }
+
+    CPU_TEST(SceneBlasPartitionCost)
+    {
+        // Two clusters of unit boxes with the same triangle count.
+        const AABB a(float3(0.f), float3(1.f));
+        const AABB b(float3(10.f), float3(11.f));
+        AABB both = a;
+        both.include(b);
+        const double totalArea = both.area();
+        EXPECT_EQ(a.area(), 6.f);
+
+        // A single BLAS is the reference.
+        double cost, overlap;
+        std::tie(cost, overlap) = Scene::calculateBlasPartitionCost({ { both, 200 } });
+        EXPECT_EQ(cost, 1.0);
+        EXPECT_EQ(overlap, 0.0);
+
+        // Splitting by cluster.
+        std::tie(cost, overlap) = Scene::calculateBlasPartitionCost({ { a, 100 }, { b, 100 } });
+        EXPECT_LE(std::abs(cost - (6.0 * 100 + 6.0 * 100) / (totalArea * 200)), 1e-9);
+        EXPECT_EQ(overlap, 0.0);
+
+        // Splitting each cluster in half, so that both BLASes span the whole scene.
+        std::tie(cost, overlap) = Scene::calculateBlasPartitionCost({ { both, 100 }, { both, 100 } });
+        EXPECT_LE(std::abs(cost - 1.0), 1e-9);
+        EXPECT_LE(std::abs(overlap - 1.0), 1e-9);
+
+        // Empty partitions have no cost.
+        std::tie(cost, overlap) = Scene::calculateBlasPartitionCost({});
+        EXPECT_EQ(cost, 0.0);
+        EXPECT_EQ(overlap, 0.0);
+    }
+
+    namespace
+    {
+        /** Synthetic mesh made of triangle fans with flat face-varying normals.
+            The center vertex of each fan is split once per face, which creates long
+            chains of candidates for the vertex merging in SceneBuilder::processMesh().
+        */
+        struct FanMesh
+        {
+            std::vector<uint32_t> indices;
+            std::vector<float3> positions;
+            std::vector<float3> normals;
+            std::vector<float2> texCrds;
+            float4 tangent = float4(1.f, 0.f, 0.f, 1.f);
+            SceneBuilder::Mesh mesh;
+
+            FanMesh(uint32_t fanCount, uint32_t facesPerFan, const Material::SharedPtr& pMaterial)
+            {
+                for (uint32_t fan = 0; fan < fanCount; fan++)
+                {
+                    const uint32_t center = (uint32_t)positions.size();
+                    const float3 origin = float3((float)fan, 0.f, 0.f);
+                    positions.push_back(origin);
+                    for (uint32_t i = 0; i < facesPerFan; i++)
+                    {
+                        float phi = (float)i / facesPerFan * 2.f * (float)M_PI;
+                        positions.push_back(origin + float3(0.4f * std::cos(phi), 0.1f * (i % 3), 0.4f * std::sin(phi)));
+                    }
+
+                    for (uint32_t i = 0; i < facesPerFan; i++)
+                    {
+                        const uint32_t tri[3] = { center, center + 1 + i, center + 1 + (i + 1) % facesPerFan };
+                        const float3 n = glm::normalize(glm::cross(positions[tri[1]] - positions[tri[0]], positions[tri[2]] - positions[tri[0]]));
+                        for (uint32_t j = 0; j < 3; j++)
+                        {
+                            indices.push_back(tri[j]);
+                            normals.push_back(n);
+                            texCrds.push_back(float2(positions[tri[j]].x, positions[tri[j]].z));
+                        }
+                    }
+                }
+
+                mesh.name = "FanMesh";
+                mesh.faceCount = (uint32_t)indices.size() / 3;
+                mesh.vertexCount = (uint32_t)positions.size();
+                mesh.indexCount = (uint32_t)indices.size();
+                mesh.pIndices = indices.data();
+                mesh.topology = Vao::Topology::TriangleList;
+                mesh.pMaterial = pMaterial;
+                mesh.positions = { positions.data(), SceneBuilder::Mesh::AttributeFrequency::Vertex };
+                mesh.normals = { normals.data(), SceneBuilder::Mesh::AttributeFrequency::FaceVarying };
+                mesh.texCrds = { texCrds.data(), SceneBuilder::Mesh::AttributeFrequency::FaceVarying };
+                mesh.tangents = { &tangent, SceneBuilder::Mesh::AttributeFrequency::Constant };
+                mesh.useOriginalTangentSpace = true;
+            }
+        };
+
+        TriangleMesh::SharedPtr transformMesh(const TriangleMesh::SharedPtr& pMesh, const glm::mat4& transform)
+        {
+            TriangleMesh::VertexList vertices = pMesh->getVertices();
+            for (auto& v : vertices)
+            {
+                v.position = float3(transform * float4(v.position, 1.f));
+                v.normal = glm::normalize(glm::mat3(transform) * v.normal);
+            }
+            return TriangleMesh::create(vertices, pMesh->getIndices());
+        }
+
+        bool isIdentical(const SceneBuilder::ProcessedMesh& a, const SceneBuilder::ProcessedMesh& b)
+        {
+            if (a.indexCount != b.indexCount || a.use16BitIndices != b.use16BitIndices) return false;
+            if (a.indexData != b.indexData) return false;
+            if (a.staticData.size() != b.staticData.size()) return false;
+            return std::memcmp(a.staticData.data(), b.staticData.data(), a.staticData.size() * sizeof(StaticVertexData)) == 0;
+        }
+    }
+
+    CPU_TEST(SceneBuilderHashVertexMerging)
+    {
+        auto pMaterial = Material::create("Test");
+        FanMesh fanMesh(8, 64, pMaterial);
+
+        auto pListBuilder = SceneBuilder::create(SceneBuilder::Flags::None);
+        auto pHashBuilder = SceneBuilder::create(SceneBuilder::Flags::HashVertexMerging);
+
+        // The attributes of merged vertices are exactly equal, so both modes must produce identical buffers.
+        auto listMesh = pListBuilder->processMesh(fanMesh.mesh);
+        auto hashMesh = pHashBuilder->processMesh(fanMesh.mesh);
+        EXPECT(isIdentical(listMesh, hashMesh));
+
+        // Each face has a unique normal: the centers are split once per face and the rim vertices once per adjacent face.
+        EXPECT_EQ(listMesh.staticData.size(), 8 * 64 * 3);
+
+        // Same with 32-bit indices.
+        auto pListBuilder32 = SceneBuilder::create(SceneBuilder::Flags::Force32BitIndices);
+        auto pHashBuilder32 = SceneBuilder::create(SceneBuilder::Flags::Force32BitIndices | SceneBuilder::Flags::HashVertexMerging);
+        EXPECT(isIdentical(pListBuilder32->processMesh(fanMesh.mesh), pHashBuilder32->processMesh(fanMesh.mesh)));
+
+        // Vertices with no splits are all merged.
+        fanMesh.mesh.normals = { fanMesh.normals.data(), SceneBuilder::Mesh::AttributeFrequency::Constant };
+        fanMesh.mesh.texCrds = { fanMesh.texCrds.data(), SceneBuilder::Mesh::AttributeFrequency::Constant };
+        listMesh = pListBuilder->processMesh(fanMesh.mesh);
+        hashMesh = pHashBuilder->processMesh(fanMesh.mesh);
+        EXPECT(isIdentical(listMesh, hashMesh));
+        EXPECT_EQ(hashMesh.staticData.size(), fanMesh.mesh.vertexCount);
+    }
+
+    CPU_TEST(SceneBuilderHashVertexMergingBenchmark, "Benchmark, enable manually")
+    {
+        // Microbenchmark of the vertex merging on a mesh with many splits per vertex.
+        // The linked-list search is quadratic in the number of splits per vertex, the hash table is not.
+        // The timings are only logged, as they are too noisy on a shared test machine to check.
+        auto pMaterial = Material::create("Test");
+        FanMesh fanMesh(32, 2048, pMaterial);
+
+        auto run = [&](SceneBuilder::Flags flags, SceneBuilder::ProcessedMesh& result)
+        {
+            auto pBuilder = SceneBuilder::create(flags);
+            auto startTime = CpuTimer::getCurrentTimePoint();
+            result = pBuilder->processMesh(fanMesh.mesh);
+            return CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+        };
+
+        SceneBuilder::ProcessedMesh listMesh, hashMesh;
+        double listTime = run(SceneBuilder::Flags::None, listMesh);
+        double hashTime = run(SceneBuilder::Flags::HashVertexMerging, hashMesh);
+
+        logInfo("Vertex merging of " + std::to_string(fanMesh.mesh.faceCount) + " faces: linked list " + std::to_string(listTime) + " ms, hash table " + std::to_string(hashTime) + " ms");
+
+        EXPECT(isIdentical(listMesh, hashMesh));
+    }
+
+    GPU_TEST(SceneBuilderDeduplicateMeshesRigid)
+    {
+        auto pBuilder = SceneBuilder::create(SceneBuilder::Flags::DeduplicateMeshesRigid);
+        auto pMaterial = Material::create("Test");
+        auto addMesh = [&](const TriangleMesh::SharedPtr& pMesh)
+        {
+            uint32_t meshID = pBuilder->addTriangleMesh(pMesh, pMaterial);
+            uint32_t nodeID = pBuilder->addNode(SceneBuilder::Node{ "Node", glm::identity<glm::mat4>(), glm::identity<glm::mat4>() });
+            pBuilder->addMeshInstance(nodeID, meshID);
+        };
+
+        // The copies are baked into the vertex data and should all be replaced by instances of the first mesh.
+        auto pSphere = TriangleMesh::createSphere(1.f, 16, 8);
+        addMesh(pSphere);
+        addMesh(transformMesh(pSphere, glm::translate(float3(5.f, 0.f, -3.f))));
+        addMesh(transformMesh(pSphere, glm::translate(float3(0.f, 2.f, 0.f)) * glm::rotate(1.f, glm::normalize(float3(1.f, 2.f, 3.f)))));
+        addMesh(transformMesh(pSphere, glm::translate(float3(1e4f, -1e4f, 5e3f)) * glm::rotate(2.f, float3(0.f, 1.f, 0.f))));
+
+        // A near miss with one vertex moved by 5% of the mesh size must be kept.
+        TriangleMesh::VertexList vertices = pSphere->getVertices();
+        vertices[vertices.size() / 2].position += float3(0.1f, 0.f, 0.f);
+        addMesh(transformMesh(TriangleMesh::create(vertices, pSphere->getIndices()), glm::translate(float3(1e4f, 0.f, 0.f))));
+
+        auto pScene = pBuilder->getScene();
+        EXPECT_EQ(pScene->getMeshCount(), 2u);
+        EXPECT_EQ(pScene->getMeshInstanceCount(), 5u);
+
+        // The instance transforms must place the copies where the original meshes were.
+        const AABB& bounds = pScene->getSceneBounds();
+        EXPECT_LE(std::abs(bounds.maxPoint.x - (1e4f + 1.f)), 1e-2f);
+        EXPECT_LE(std::abs(bounds.minPoint.y - (-1e4f - 1.f)), 1e-2f);
+    }
+}
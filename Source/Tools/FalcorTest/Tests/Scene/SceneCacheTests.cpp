@@ -0,0 +1,165 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/SceneBuilder.h"
+#include "Scene/SceneCache.h"
+#include <filesystem>
+#include <fstream>
+
+namespace Falcor
+{
+    namespace
+    {
+        const std::string kTestDirectory = (std::filesystem::temp_directory_path() / "FalcorSceneCacheTests").string();
+        const SceneBuilder::Flags kFlags = SceneBuilder::Flags::Default | SceneBuilder::Flags::UseCache;
+
+        std::string writeFile(const std::string& name, const std::string& contents)
+        {
+            std::string path = (std::filesystem::path(kTestDirectory) / name).string();
+            std::ofstream(path, std::ios::trunc) << contents;
+            return path;
+        }
+
+        /** Write an OBJ scene with two meshes. The materials are defined in a separate material library.
+        */
+        std::string writeTestScene(const float3& baseColor)
+        {
+            writeFile("test.mtl",
+                "newmtl Red\n"
+                "Kd " + std::to_string(baseColor.r) + " " + std::to_string(baseColor.g) + " " + std::to_string(baseColor.b) + "\n"
+                "newmtl Green\n"
+                "Kd 0 1 0\n");
+
+            return writeFile("test.obj",
+                "mtllib test.mtl\n"
+                "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+                "v 2 0 1\nv 3 0 1\nv 3 2 1\n"
+                "vt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\n"
+                "vn 0 0 1\n"
+                "o Quad\nusemtl Red\n"
+                "f 1/1/1 2/2/1 3/3/1\nf 1/1/1 3/3/1 4/4/1\n"
+                "o Triangle\nusemtl Green\n"
+                "f 5/1/1 6/2/1 7/3/1\n");
+        }
+
+        template<typename T>
+        std::vector<T> readBuffer(const Buffer::SharedPtr& pBuffer)
+        {
+            std::vector<T> data(pBuffer->getSize() / sizeof(T));
+            std::memcpy(data.data(), pBuffer->map(Buffer::MapType::Read), data.size() * sizeof(T));
+            pBuffer->unmap();
+            return data;
+        }
+
+        bool isEqual(const AABB& a, const AABB& b)
+        {
+            return a.minPoint == b.minPoint && a.maxPoint == b.maxPoint;
+        }
+
+        void compareScenes(GPUUnitTestContext& ctx, const Scene::SharedPtr& pA, const Scene::SharedPtr& pB)
+        {
+            EXPECT_EQ(pA->getMeshCount(), pB->getMeshCount());
+            EXPECT_EQ(pA->getMeshInstanceCount(), pB->getMeshInstanceCount());
+            EXPECT_EQ(pA->getMaterialCount(), pB->getMaterialCount());
+            EXPECT_EQ(pA->getLightCount(), pB->getLightCount());
+            EXPECT(isEqual(pA->getSceneBounds(), pB->getSceneBounds()));
+            if (pA->getMeshCount() != pB->getMeshCount() || pA->getMaterialCount() != pB->getMaterialCount()) return;
+
+            for (uint32_t meshID = 0; meshID < pA->getMeshCount(); meshID++)
+            {
+                EXPECT(std::memcmp(&pA->getMesh(meshID), &pB->getMesh(meshID), sizeof(MeshDesc)) == 0) << "meshID = " << meshID;
+                EXPECT(isEqual(pA->getMeshBounds(meshID), pB->getMeshBounds(meshID))) << "meshID = " << meshID;
+                EXPECT_EQ(pA->getMeshName(meshID), pB->getMeshName(meshID));
+            }
+            for (uint32_t materialID = 0; materialID < pA->getMaterialCount(); materialID++)
+            {
+                EXPECT_EQ(pA->getMaterial(materialID)->getName(), pB->getMaterial(materialID)->getName());
+                EXPECT(pA->getMaterial(materialID)->getBaseColor() == pB->getMaterial(materialID)->getBaseColor()) << "materialID = " << materialID;
+            }
+
+            // Compare the global geometry buffers.
+            const auto& pVaoA = pA->getVao();
+            const auto& pVaoB = pB->getVao();
+            EXPECT_EQ(pVaoA->getVertexBuffersCount(), pVaoB->getVertexBuffersCount());
+            EXPECT(readBuffer<uint8_t>(pVaoA->getIndexBuffer()) == readBuffer<uint8_t>(pVaoB->getIndexBuffer()));
+            for (uint32_t i = 0; i < std::min(pVaoA->getVertexBuffersCount(), pVaoB->getVertexBuffersCount()); i++)
+            {
+                EXPECT(readBuffer<uint8_t>(pVaoA->getVertexBuffer(i)) == readBuffer<uint8_t>(pVaoB->getVertexBuffer(i))) << "vertex buffer " << i;
+            }
+        }
+    }
+
+    GPU_TEST(SceneCacheRoundTrip)
+    {
+        std::filesystem::remove_all(kTestDirectory);
+        std::filesystem::create_directories(kTestDirectory);
+
+        std::string path = writeTestScene(float3(1.f, 0.f, 0.f));
+        auto key = SceneCache::computeKey(path, kFlags, {}, Dictionary());
+        EXPECT(key.has_value());
+        if (!key) return;
+        std::string cacheFilename = SceneCache::getCacheFilename(*key);
+
+        // Import the scene and write the cache.
+        auto pImportedBuilder = SceneBuilder::create(path, kFlags | SceneBuilder::Flags::RebuildCache);
+        EXPECT(pImportedBuilder != nullptr);
+        if (!pImportedBuilder) return;
+        auto pImportedScene = pImportedBuilder->getScene();
+        EXPECT(doesFileExist(cacheFilename));
+
+        // Load the scene from the cache. The builder state must be restored exactly.
+        auto pCachedBuilder = SceneBuilder::create(kFlags);
+        EXPECT(SceneCache::readCache(*pCachedBuilder, *key));
+        compareScenes(ctx, pImportedScene, pCachedBuilder->getScene());
+
+        // Changing the material library must invalidate the cache.
+        writeTestScene(float3(0.f, 0.f, 1.f));
+        EXPECT(!SceneCache::readCache(*SceneBuilder::create(kFlags), *key));
+        auto pChangedScene = SceneBuilder::create(path, kFlags)->getScene();
+        auto pRed = pChangedScene->getMaterialByName("Red");
+        EXPECT(pRed != nullptr);
+        if (pRed)
+        {
+            EXPECT_EQ(pRed->getBaseColor().r, 0.f);
+            EXPECT_EQ(pRed->getBaseColor().b, 1.f);
+        }
+
+        // Adding content after loading from the cache must import the scene again so that all content is post-processed.
+        auto pBuilder = SceneBuilder::create(path, kFlags);
+        uint32_t meshID = pBuilder->addTriangleMesh(TriangleMesh::createQuad(), Material::create("Added"));
+        uint32_t nodeID = pBuilder->addNode(SceneBuilder::Node{ "Added", glm::translate(float3(0.f, 0.f, 5.f)), glm::identity<glm::mat4>() });
+        pBuilder->addMeshInstance(nodeID, meshID);
+        auto pExtendedScene = pBuilder->getScene();
+        EXPECT_EQ(pExtendedScene->getMeshInstanceCount(), pChangedScene->getMeshInstanceCount() + 1);
+        EXPECT(pExtendedScene->getMaterialByName("Added") != nullptr);
+        EXPECT_EQ(pExtendedScene->getSceneBounds().maxPoint.z, 5.5f);
+
+        std::filesystem::remove(cacheFilename);
+        std::filesystem::remove_all(kTestDirectory);
+    }
+}
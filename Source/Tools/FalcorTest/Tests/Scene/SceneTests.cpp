@@ -0,0 +1,108 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/SceneBuilder.h"
+#include "glm/gtx/transform.hpp"
+
+namespace Falcor
+{
+    namespace
+    {
+        /** Copy of a triangle mesh with all vertices bound to a single bone.
+        */
+        struct SkinnedMesh
+        {
+            std::vector<float3> positions;
+            std::vector<float3> normals;
+            std::vector<float2> texCrds;
+            uint4 boneIDs;
+            float4 boneWeights = float4(1.f, 0.f, 0.f, 0.f);
+            SceneBuilder::Mesh mesh;
+
+            SkinnedMesh(const TriangleMesh::SharedPtr& pTriangleMesh, uint32_t boneID, const Material::SharedPtr& pMaterial)
+                : boneIDs(boneID, 0, 0, 0)
+            {
+                for (const auto& v : pTriangleMesh->getVertices())
+                {
+                    positions.push_back(v.position);
+                    normals.push_back(v.normal);
+                    texCrds.push_back(v.texCoord);
+                }
+
+                const auto& indices = pTriangleMesh->getIndices();
+                mesh.name = "SkinnedMesh";
+                mesh.faceCount = (uint32_t)indices.size() / 3;
+                mesh.vertexCount = (uint32_t)positions.size();
+                mesh.indexCount = (uint32_t)indices.size();
+                mesh.pIndices = indices.data();
+                mesh.topology = Vao::Topology::TriangleList;
+                mesh.pMaterial = pMaterial;
+                mesh.positions = { positions.data(), SceneBuilder::Mesh::AttributeFrequency::Vertex };
+                mesh.normals = { normals.data(), SceneBuilder::Mesh::AttributeFrequency::Vertex };
+                mesh.texCrds = { texCrds.data(), SceneBuilder::Mesh::AttributeFrequency::Vertex };
+                mesh.boneIDs = { &boneIDs, SceneBuilder::Mesh::AttributeFrequency::Constant };
+                mesh.boneWeights = { &boneWeights, SceneBuilder::Mesh::AttributeFrequency::Constant };
+            }
+        };
+    }
+
+    GPU_TEST(SceneCullSkinnedMeshes)
+    {
+        auto pBuilder = SceneBuilder::create(SceneBuilder::Flags::Default);
+        auto pMaterial = Material::create("Test");
+        auto pSphere = TriangleMesh::createSphere(1.f, 16, 8);
+        const glm::mat4 identity = glm::identity<glm::mat4>();
+
+        // A static mesh and a skinned mesh, both with bounds around the origin.
+        // The bone moves the skinned mesh far outside of its bind pose bounds.
+        uint32_t staticNodeID = pBuilder->addNode(SceneBuilder::Node{ "Static", identity, identity });
+        pBuilder->addMeshInstance(staticNodeID, pBuilder->addTriangleMesh(pSphere, pMaterial));
+
+        uint32_t boneNodeID = pBuilder->addNode(SceneBuilder::Node{ "Bone", glm::translate(float3(100.f, 0.f, 0.f)), identity });
+        SkinnedMesh skinnedMesh(pSphere, boneNodeID, pMaterial);
+        uint32_t skinnedNodeID = pBuilder->addNode(SceneBuilder::Node{ "Skinned", identity, identity });
+        pBuilder->addMeshInstance(skinnedNodeID, pBuilder->addMesh(skinnedMesh.mesh));
+
+        auto pScene = pBuilder->getScene();
+        EXPECT_EQ(pScene->getMeshInstanceCount(), 2u);
+
+        auto countDraws = [&pScene](const float3& target)
+        {
+            glm::mat4 view = glm::lookAt(target + float3(0.f, 0.f, 10.f), target, float3(0.f, 1.f, 0.f));
+            glm::mat4 proj = glm::perspective(glm::radians(45.f), 1.f, 0.1f, 100.f);
+            Scene::CulledDrawList drawList;
+            auto cullStats = pScene->cullDrawList(InstanceBVH::Frustum::fromViewProjMatrix(proj * view), drawList);
+            return std::make_pair(drawList.getDrawCount(), cullStats.visibleCount);
+        };
+
+        // The skinned mesh is drawn where the bone moved it, and also when the frustum doesn't contain any bounds.
+        EXPECT(countDraws(float3(100.f, 0.f, 0.f)) == std::make_pair(1u, 1u));
+        EXPECT(countDraws(float3(0.f)) == std::make_pair(2u, 2u));
+        EXPECT(countDraws(float3(0.f, 1000.f, 0.f)) == std::make_pair(1u, 1u));
+    }
+}
@@ -0,0 +1,103 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/SceneTypes.slang"
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        bool isEqual(const CompressedStaticVertexData& a, const CompressedStaticVertexData& b)
+        {
+            return std::memcmp(&a, &b, sizeof(CompressedStaticVertexData)) == 0;
+        }
+    }
+
+    CPU_TEST(CompressedStaticVertexData)
+    {
+        std::mt19937 rng;
+        std::uniform_real_distribution<float> u(-1.f, 1.f);
+
+        MeshDesc mesh = {};
+        mesh.positionOffset = float3(10.f, -3.f, 0.5f);
+        mesh.positionScale = float3(4.f, 0.25f, 100.f);
+        mesh.texCrdOffset = float2(-2.f, 0.f);
+        mesh.texCrdScale = float2(3.f, 0.5f);
+
+        const float3 maxPositionError = mesh.positionScale / 32767.f;
+        const float2 maxTexCrdError = mesh.texCrdScale / 65535.f;
+
+        for (uint32_t i = 0; i < 10000; i++)
+        {
+            StaticVertexData v;
+            v.position = mesh.positionOffset + mesh.positionScale * float3(u(rng), u(rng), u(rng));
+            v.normal = glm::normalize(float3(u(rng), u(rng), u(rng)));
+            v.tangent = float4(glm::normalize(glm::cross(v.normal, float3(0.f, 0.f, 1.f))), u(rng) < 0.f ? -1.f : 1.f);
+            v.texCrd = mesh.texCrdOffset + mesh.texCrdScale * float2(0.5f * u(rng) + 0.5f, 0.5f * u(rng) + 0.5f);
+
+            // Texture coordinates as 16-bit unorm relative to the bounds.
+            mesh.flags = (uint32_t)MeshFlags::UseUnormTexCrd;
+            CompressedStaticVertexData c(v, mesh);
+            StaticVertexData d = c.unpack(mesh);
+
+            float3 positionError = abs(d.position - v.position);
+            float2 texCrdError = abs(d.texCrd - v.texCrd);
+            EXPECT(glm::all(glm::lessThanEqual(positionError, maxPositionError))) << "position error (" << positionError.x << ", " << positionError.y << ", " << positionError.z << ")";
+            EXPECT(glm::all(glm::lessThanEqual(texCrdError, maxTexCrdError))) << "texCrd error (" << texCrdError.x << ", " << texCrdError.y << ")";
+            EXPECT_LE(glm::length(d.normal - v.normal), 1e-2f);
+            EXPECT_EQ(d.tangent.w, v.tangent.w);
+
+            // Compressing the decoded position and texture coordinate must reproduce the same bits.
+            // The normal is renormalized on decode and is not guaranteed to round trip.
+            CompressedStaticVertexData r(d, mesh);
+            EXPECT(r.packedPosition == c.packedPosition);
+            EXPECT_EQ(r.packedTexCrd, c.packedTexCrd);
+
+            // Packing from PackedStaticVertexData must match packing from StaticVertexData.
+            EXPECT(isEqual(CompressedStaticVertexData(PackedStaticVertexData(v), mesh), c));
+
+            // Texture coordinates that are already representable in fp16 are stored exactly.
+            mesh.flags = 0;
+            v.texCrd = f16tof32(f32tof16(v.texCrd));
+            d = CompressedStaticVertexData(v, mesh).unpack(mesh);
+            EXPECT(d.texCrd == v.texCrd);
+        }
+
+        // Positions at the bounds map to -1 and 1 exactly.
+        StaticVertexData v = {};
+        v.position = mesh.positionOffset - mesh.positionScale;
+        EXPECT_EQ(CompressedStaticVertexData(v, mesh).packedPosition.x, 0x80018001u);
+        v.position = mesh.positionOffset + mesh.positionScale;
+        EXPECT_EQ(CompressedStaticVertexData(v, mesh).packedPosition.y, 0x7fffu);
+
+        // Degenerate bounds decode to the offset.
+        mesh.positionScale = float3(0.f);
+        EXPECT(CompressedStaticVertexData(v, mesh).unpackPosition(mesh) == mesh.positionOffset);
+    }
+}
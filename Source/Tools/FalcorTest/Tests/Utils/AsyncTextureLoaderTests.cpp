@@ -0,0 +1,147 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Utils/AsyncTextureLoader.h"
+#include <filesystem>
+#include <thread>
+
+namespace Falcor
+{
+    namespace
+    {
+        const std::string kTestDirectory = (std::filesystem::temp_directory_path() / "FalcorAsyncTextureLoaderTests").string();
+
+        std::string writeTestImage(const std::string& name, uint32_t width, uint32_t height)
+        {
+            std::vector<uint8_t> data(width * height * 4);
+            for (size_t i = 0; i < data.size(); i++) data[i] = (uint8_t)(i * 7);
+
+            std::string path = (std::filesystem::path(kTestDirectory) / name).string();
+            Bitmap::saveImage(path, width, height, Bitmap::FileFormat::PngFile, Bitmap::ExportFlags::ExportAlpha, ResourceFormat::RGBA8Unorm, true, data.data());
+            return path;
+        }
+    }
+
+    GPU_TEST(AsyncTextureLoaderBudget)
+    {
+        std::filesystem::remove_all(kTestDirectory);
+        std::filesystem::create_directories(kTestDirectory);
+
+        const uint32_t kImageCount = 8;
+        std::vector<std::string> paths;
+        for (uint32_t i = 0; i < kImageCount; i++)
+        {
+            paths.push_back(writeTestImage("image" + std::to_string(i) + ".png", 16 << (i % 3), 8 + i));
+        }
+
+        std::vector<std::future<Texture::SharedPtr>> futures;
+        AsyncTextureLoader::Stats stats;
+        {
+            // A budget of a single byte only allows one image in flight at a time.
+            AsyncTextureLoader loader(4, 1);
+            for (uint32_t i = 0; i < kImageCount; i++)
+            {
+                futures.push_back(loader.loadFromFile(paths[i], i % 2 == 0, false, Resource::BindFlags::ShaderResource, i));
+            }
+            futures.push_back(loader.loadFromFile((std::filesystem::path(kTestDirectory) / "missing.png").string(), false, false));
+
+            for (uint32_t i = 0; i < kImageCount; i++)
+            {
+                Texture::SharedPtr pTexture = futures[i].get();
+                EXPECT(pTexture != nullptr);
+                if (!pTexture) continue;
+                EXPECT_EQ(pTexture->getWidth(), 16u << (i % 3));
+                EXPECT_EQ(pTexture->getHeight(), 8u + i);
+                EXPECT_EQ(pTexture->getMipCount() > 1, i % 2 == 0);
+            }
+            EXPECT(futures[kImageCount].get() == nullptr);
+
+            stats = loader.getStats();
+        }
+
+        EXPECT_EQ(stats.requestCount, kImageCount + 1ull);
+        EXPECT_EQ(stats.failedCount, 1ull);
+
+        // With one image in flight, the peak is the size of the largest decoded image.
+        uint64_t maxDecodedSize = 0;
+        for (uint32_t i = 0; i < kImageCount; i++) maxDecodedSize = std::max(maxDecodedSize, (uint64_t)(16u << (i % 3)) * (8u + i) * 4);
+        EXPECT_GT(stats.decodedBytes, 0ull);
+        EXPECT_LE(stats.peakInFlightBytes, maxDecodedSize);
+        EXPECT_GT(stats.decodeTime, 0.0);
+        EXPECT_GT(stats.uploadTime, 0.0);
+
+        std::filesystem::remove_all(kTestDirectory);
+    }
+
+    GPU_TEST(AsyncTextureLoaderPriority)
+    {
+        std::filesystem::remove_all(kTestDirectory);
+        std::filesystem::create_directories(kTestDirectory);
+
+        // A large image keeps the loader busy while the other requests are queued.
+        std::string blockerPath = writeTestImage("blocker.png", 2048, 2048);
+
+        const std::vector<uint64_t> kPriorities = { 1, 5, 3, 5, 0, 4 };
+        std::vector<std::string> paths;
+        for (size_t i = 0; i < kPriorities.size(); i++) paths.push_back(writeTestImage("image" + std::to_string(i) + ".png", 16, 16));
+
+        std::vector<size_t> completionOrder;
+        {
+            // A budget of a single byte and a single decode task load one image at a time.
+            AsyncTextureLoader loader(1, 1);
+            auto blocker = loader.loadFromFile(blockerPath, false, false);
+
+            std::vector<std::future<Texture::SharedPtr>> futures;
+            for (size_t i = 0; i < paths.size(); i++)
+            {
+                futures.push_back(loader.loadFromFile(paths[i], false, false, Resource::BindFlags::ShaderResource, kPriorities[i]));
+            }
+
+            // Record the order in which the requests complete. The images are uploaded one at a time, so polling is enough.
+            std::vector<bool> isDone(futures.size(), false);
+            while (completionOrder.size() < futures.size())
+            {
+                for (size_t i = 0; i < futures.size(); i++)
+                {
+                    if (isDone[i] || futures[i].wait_for(std::chrono::seconds(0)) != std::future_status::ready) continue;
+                    EXPECT(futures[i].get() != nullptr) << "i = " << i;
+                    isDone[i] = true;
+                    completionOrder.push_back(i);
+                }
+                std::this_thread::yield();
+            }
+            EXPECT(blocker.get() != nullptr);
+        }
+
+        // Higher priorities complete first, and equal priorities in request order.
+        const std::vector<size_t> kExpectedOrder = { 1, 3, 5, 2, 0, 4 };
+        EXPECT(completionOrder == kExpectedOrder);
+
+        std::filesystem::remove_all(kTestDirectory);
+    }
+}
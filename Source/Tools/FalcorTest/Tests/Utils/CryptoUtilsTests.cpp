@@ -0,0 +1,52 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Utils/CryptoUtils.h"
+
+namespace Falcor
+{
+    CPU_TEST(SHA1)
+    {
+        // Test vectors from FIPS 180-1.
+        EXPECT_EQ(SHA1::toString(SHA1::compute("abc", 3)), "a9993e364706816aba3e25717850c26c9cd0d89d");
+
+        std::string msg = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+        EXPECT_EQ(SHA1::toString(SHA1::compute(msg.data(), msg.size())), "84983e441c3bd26ebaae4aa1f95129e5e54670f1");
+
+        EXPECT_EQ(SHA1::toString(SHA1::compute(nullptr, 0)), "da39a3ee5e6b4b0d3255bfef95601890afd80709");
+
+        // Incremental updates with varying chunk sizes must match hashing in one go.
+        std::string million(1000000, 'a');
+        SHA1 sha1;
+        for (size_t offset = 0, chunk = 1; offset < million.size(); offset += chunk, chunk = chunk * 3 % 1000 + 1)
+        {
+            sha1.update(million.data() + offset, std::min(chunk, million.size() - offset));
+        }
+        EXPECT_EQ(SHA1::toString(sha1.final()), "34aa973cd4c4daa4f61eeb2bdbad27316534016f");
+    }
+}
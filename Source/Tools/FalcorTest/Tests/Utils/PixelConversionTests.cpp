@@ -0,0 +1,114 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Utils/Image/PixelConversion.h"
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        bool isBitwiseEqual(const std::vector<float>& a, const std::vector<float>& b)
+        {
+            return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0;
+        }
+    }
+
+    CPU_TEST(PixelConversionHalfToFloat)
+    {
+        // Test all fp16 values, plus a few extra to exercise the tail of the vectorized loop.
+        std::vector<uint16_t> src(0x10000 + 5);
+        for (size_t i = 0; i < src.size(); i++) src[i] = (uint16_t)i;
+
+        std::vector<float> result(src.size()), reference(src.size());
+        PixelConversion::halfToFloat(src.data(), result.data(), src.size());
+        PixelConversion::halfToFloat(src.data(), reference.data(), src.size(), false);
+        EXPECT(isBitwiseEqual(result, reference));
+
+        for (uint32_t i = 0; i < 0x10000; i++)
+        {
+            if (std::isnan(reference[i])) continue;
+            EXPECT_EQ(reference[i], f16tof32(i)) << "i = " << i;
+        }
+    }
+
+    CPU_TEST(PixelConversionUnormToFloat)
+    {
+        std::vector<uint8_t> src8(0x100 + 5);
+        for (size_t i = 0; i < src8.size(); i++) src8[i] = (uint8_t)i;
+        std::vector<float> result(src8.size()), reference(src8.size());
+        PixelConversion::unormToFloat(src8.data(), result.data(), src8.size());
+        PixelConversion::unormToFloat(src8.data(), reference.data(), src8.size(), false);
+        EXPECT(isBitwiseEqual(result, reference));
+        EXPECT_EQ(reference[0], 0.f);
+        EXPECT_EQ(reference[255], 1.f);
+
+        std::vector<uint16_t> src16(0x10000 + 5);
+        for (size_t i = 0; i < src16.size(); i++) src16[i] = (uint16_t)i;
+        result.resize(src16.size());
+        reference.resize(src16.size());
+        PixelConversion::unormToFloat(src16.data(), result.data(), src16.size());
+        PixelConversion::unormToFloat(src16.data(), reference.data(), src16.size(), false);
+        EXPECT(isBitwiseEqual(result, reference));
+        EXPECT_EQ(reference[0], 0.f);
+        EXPECT_EQ(reference[0xffff], 1.f);
+    }
+
+    CPU_TEST(PixelConversionFloatToUnorm8Dithered)
+    {
+        const uint32_t width = 1001;
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<float> u(-0.2f, 1.2f);
+        std::vector<float> src(width * 4);
+        for (auto& v : src) v = u(rng);
+        src[5] = std::numeric_limits<float>::quiet_NaN();
+        src[9] = std::numeric_limits<float>::infinity();
+        src[10] = -std::numeric_limits<float>::infinity();
+
+        std::vector<uint8_t> result(width * 4), reference(width * 4);
+        for (uint32_t row = 0; row < 4; row++)
+        {
+            PixelConversion::floatToUnorm8Dithered(src.data(), result.data(), width, row);
+            PixelConversion::floatToUnorm8Dithered(src.data(), reference.data(), width, row, false);
+            EXPECT(result == reference) << "row = " << row;
+            EXPECT_EQ(reference[5], 0);
+            EXPECT_EQ(reference[9], 255);
+            EXPECT_EQ(reference[10], 0);
+        }
+
+        // Dithering preserves the average value over a 4x4 block.
+        std::vector<float> constant(4 * 4, 100.25f / 255.f);
+        uint32_t sum = 0;
+        for (uint32_t row = 0; row < 4; row++)
+        {
+            PixelConversion::floatToUnorm8Dithered(constant.data(), result.data(), 4, row);
+            for (uint32_t i = 0; i < 16; i++) sum += result[i];
+        }
+        EXPECT_EQ(sum, 100 * 64 + 16);
+    }
+}
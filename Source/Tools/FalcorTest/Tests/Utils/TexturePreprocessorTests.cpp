@@ -0,0 +1,107 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Utils/Image/TexturePreprocessor.h"
+
+namespace Falcor
+{
+    namespace
+    {
+        using Usage = TexturePreprocessor::Usage;
+        using CompressionMode = ImageIO::CompressionMode;
+
+        CompressionMode getMode(Usage usage, ResourceFormat format, bool hasAlpha = false, bool srgb = false, bool allowBC7 = true)
+        {
+            return TexturePreprocessor::getCompressionMode(usage, format, 256, 128, hasAlpha, srgb, allowBC7);
+        }
+    }
+
+    CPU_TEST(TexturePreprocessorCompressionMode)
+    {
+        // Color.
+        EXPECT(getMode(Usage::Color, ResourceFormat::BGRA8Unorm, false, true) == CompressionMode::BC1);
+        EXPECT(getMode(Usage::Color, ResourceFormat::BGRX8Unorm, false, true) == CompressionMode::BC1);
+        EXPECT(getMode(Usage::Color, ResourceFormat::BGRA8Unorm, true, true) == CompressionMode::BC7);
+        EXPECT(getMode(Usage::Color, ResourceFormat::BGRA8Unorm, true, true, false) == CompressionMode::BC3);
+        EXPECT(getMode(Usage::Color, ResourceFormat::RGBA16Float) == CompressionMode::BC6);
+        EXPECT(getMode(Usage::Color, ResourceFormat::RGB32Float) == CompressionMode::BC6);
+        EXPECT(getMode(Usage::Color, ResourceFormat::RGBA32Float, true) == CompressionMode::None);
+
+        // Packed data.
+        EXPECT(getMode(Usage::PackedData, ResourceFormat::BGRX8Unorm) == CompressionMode::BC7);
+        EXPECT(getMode(Usage::PackedData, ResourceFormat::BGRX8Unorm, false, false, false) == CompressionMode::BC1);
+        EXPECT(getMode(Usage::PackedData, ResourceFormat::BGRA8Unorm, true, false, false) == CompressionMode::BC3);
+
+        // Normal maps.
+        EXPECT(getMode(Usage::Normal, ResourceFormat::BGRX8Unorm) == CompressionMode::BC5);
+        EXPECT(getMode(Usage::Normal, ResourceFormat::RG8Unorm) == CompressionMode::BC5);
+        EXPECT(getMode(Usage::Normal, ResourceFormat::RGBA32Float) == CompressionMode::None);
+
+        // Scalar data. BC4 has no sRGB format.
+        EXPECT(getMode(Usage::Scalar, ResourceFormat::BGRX8Unorm) == CompressionMode::BC4);
+        EXPECT(getMode(Usage::Scalar, ResourceFormat::BGRX8Unorm, false, true) == CompressionMode::BC1);
+        EXPECT(getMode(Usage::Scalar, ResourceFormat::R8Unorm, false, true) == CompressionMode::BC4);
+        EXPECT(getMode(Usage::Scalar, ResourceFormat::R32Float) == CompressionMode::None);
+
+        // One and two channel images keep their channel count.
+        EXPECT(getMode(Usage::Color, ResourceFormat::R8Unorm, false, true) == CompressionMode::BC4);
+        EXPECT(getMode(Usage::Color, ResourceFormat::RG8Unorm) == CompressionMode::BC5);
+
+        // Sizes that are not a multiple of the block size are not compressed.
+        EXPECT(TexturePreprocessor::getCompressionMode(Usage::Color, ResourceFormat::BGRA8Unorm, 256, 130, false, true) == CompressionMode::None);
+        EXPECT(TexturePreprocessor::getCompressionMode(Usage::Color, ResourceFormat::BGRA8Unorm, 2, 4, false, true) == CompressionMode::None);
+
+        // Already compressed.
+        EXPECT(getMode(Usage::Color, ResourceFormat::BC1Unorm) == CompressionMode::None);
+    }
+
+    CPU_TEST(TexturePreprocessorAlpha)
+    {
+        const uint32_t kWidth = 8;
+        const uint32_t kHeight = 4;
+
+        std::vector<uint8_t> data(kWidth * kHeight * 4, 0xff);
+        EXPECT(!TexturePreprocessor::hasNonOpaqueAlpha(*Bitmap::create(kWidth, kHeight, ResourceFormat::BGRA8Unorm, data.data())));
+
+        data[(kWidth * 3 + 5) * 4 + 3] = 0xfe;
+        EXPECT(TexturePreprocessor::hasNonOpaqueAlpha(*Bitmap::create(kWidth, kHeight, ResourceFormat::BGRA8Unorm, data.data())));
+
+        // Formats without alpha are always opaque.
+        EXPECT(!TexturePreprocessor::hasNonOpaqueAlpha(*Bitmap::create(kWidth, kHeight, ResourceFormat::BGRX8Unorm, data.data())));
+
+        std::vector<float> floatData(kWidth * kHeight * 4, 1.f);
+        EXPECT(!TexturePreprocessor::hasNonOpaqueAlpha(*Bitmap::create(kWidth, kHeight, ResourceFormat::RGBA32Float, reinterpret_cast<const uint8_t*>(floatData.data()))));
+        floatData[4 * 7 + 3] = 0.5f;
+        EXPECT(TexturePreprocessor::hasNonOpaqueAlpha(*Bitmap::create(kWidth, kHeight, ResourceFormat::RGBA32Float, reinterpret_cast<const uint8_t*>(floatData.data()))));
+
+        std::vector<uint16_t> halfData(kWidth * kHeight * 4, 0x3c00);
+        EXPECT(!TexturePreprocessor::hasNonOpaqueAlpha(*Bitmap::create(kWidth, kHeight, ResourceFormat::RGBA16Float, reinterpret_cast<const uint8_t*>(halfData.data()))));
+        halfData[4 * 20 + 3] = 0;
+        EXPECT(TexturePreprocessor::hasNonOpaqueAlpha(*Bitmap::create(kWidth, kHeight, ResourceFormat::RGBA16Float, reinterpret_cast<const uint8_t*>(halfData.data()))));
+    }
+}
@@ -0,0 +1,164 @@
+/***************************************************************************
+ # Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Utils/Timing/CpuTimer.h"
+#include <atomic>
+
+namespace Falcor
+{
+    namespace
+    {
+        uint64_t fibonacci(uint32_t n)
+        {
+            if (n < 2) return n;
+            if (n < 16) return fibonacci(n - 1) + fibonacci(n - 2);
+
+            // Spawn a nested task for one branch and compute the other on this thread.
+            uint64_t a = 0;
+            auto task = Threading::dispatchTask([&a, n]() { a = fibonacci(n - 1); });
+            uint64_t b = fibonacci(n - 2);
+            task.finish();
+            return a + b;
+        }
+
+        /** Compute bound workload. Returns a value that depends on all iterations so it can't be optimized away.
+        */
+        float computeWork(size_t i)
+        {
+            float x = (float)i;
+            for (uint32_t k = 0; k < 256; k++) x = std::sqrt(x + (float)k);
+            return x;
+        }
+    }
+
+    CPU_TEST(ThreadingTask)
+    {
+        std::atomic<uint32_t> counter = 0;
+        std::vector<Threading::Task> tasks;
+        for (uint32_t i = 0; i < 100; i++) tasks.push_back(Threading::dispatchTask([&counter]() { counter++; }));
+        for (const auto& task : tasks) task.finish();
+
+        EXPECT_EQ(counter.load(), 100);
+        for (const auto& task : tasks) EXPECT(!task.isRunning());
+
+        // Exceptions thrown by a task are rethrown by finish().
+        auto task = Threading::dispatchTask([]() { throw std::runtime_error("Task failed"); });
+        bool caught = false;
+        try
+        {
+            task.finish();
+        }
+        catch (const std::runtime_error&)
+        {
+            caught = true;
+        }
+        EXPECT(caught);
+
+        // A default constructed task is never running.
+        Threading::Task emptyTask;
+        EXPECT(!emptyTask.isRunning());
+        emptyTask.finish();
+    }
+
+    CPU_TEST(ThreadingNestedTasks)
+    {
+        EXPECT_EQ(fibonacci(28), 317811ull);
+
+        // Nested parallelFor from within parallelFor.
+        std::atomic<uint32_t> counter = 0;
+        Threading::parallelFor(0, 64, [&counter](size_t)
+        {
+            Threading::parallelFor(0, 1000, [&counter](size_t) { counter++; });
+        });
+        EXPECT_EQ(counter.load(), 64000);
+    }
+
+    CPU_TEST(ThreadingParallelFor)
+    {
+        // Check that every index is visited exactly once for a range of sizes and grain sizes.
+        for (size_t count : { 0, 1, 7, 1000, 100003 })
+        {
+            for (size_t grainSize : { 0, 1, 64, 1 << 20 })
+            {
+                std::vector<uint32_t> visits(count, 0);
+                Threading::parallelForRange(10, 10 + count, [&visits](size_t first, size_t last)
+                {
+                    for (size_t i = first; i < last; i++) visits[i - 10]++;
+                }, grainSize);
+
+                bool allOnce = true;
+                for (auto v : visits) allOnce &= v == 1;
+                EXPECT(allOnce) << "count=" << count << " grainSize=" << grainSize;
+            }
+        }
+
+        // Exceptions are propagated to the caller.
+        bool caught = false;
+        try
+        {
+            Threading::parallelFor(0, 1000, [](size_t i) { if (i == 567) throw std::runtime_error("Iteration failed"); });
+        }
+        catch (const std::runtime_error&)
+        {
+            caught = true;
+        }
+        EXPECT(caught);
+    }
+
+    CPU_TEST(ThreadingScaling)
+    {
+        const size_t n = 1 << 20;
+        const uint32_t logicalThreadCount = Threading::getLogicalThreadCount();
+
+        // Serial reference.
+        std::vector<float> reference(n);
+        auto startTime = CpuTimer::getCurrentTimePoint();
+        for (size_t i = 0; i < n; i++) reference[i] = computeWork(i);
+        double serialTime = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+
+        // Restart the pool with increasing thread counts. The calling thread participates in parallelFor too,
+        // so a pool of N - 1 workers is used to run on N threads.
+        // The speedups are only reported, as timings on a shared test machine are too noisy to check.
+        Threading::shutdown();
+        for (uint32_t threadCount = 2; threadCount <= logicalThreadCount; threadCount *= 2)
+        {
+            Threading::start(threadCount - 1);
+
+            std::vector<float> result(n);
+            startTime = CpuTimer::getCurrentTimePoint();
+            Threading::parallelFor(0, n, [&result](size_t i) { result[i] = computeWork(i); });
+            double parallelTime = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+
+            EXPECT(result == reference) << "threadCount=" << threadCount;
+            logInfo("Threading scaling: " + std::to_string(threadCount) + " threads, speedup " + std::to_string(serialTime / parallelTime));
+
+            Threading::shutdown();
+        }
+        Threading::start();
+    }
+}
@@ -35,6 +35,16 @@
 #include <stdexcept>
 #include <map>
 #include <functional>
+#include <optional>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <future>
+#include <filesystem>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <emmintrin.h>
 
 template<typename T>
 T sqr(T x) { return x * x; }
@@ -159,62 +169,199 @@ private:
     {}
 };
 
+/** Error metrics.
+    Each metric computes the error of a single channel, both for scalar values and for four values at once using SSE2.
+    The SSE2 version returns the errors as doubles and matches the scalar version exactly.
+    The error of a pixel is kScale times the average error over its channels.
+*/
 struct MSE
 {
-    double operator()(const float* a, const float* b, size_t count) const
+    static constexpr double kScale = 1.0;
+
+    static double error(float a, float b) { return sqr(a - b); }
+
+    static void error(__m128 a, __m128 b, __m128d& lo, __m128d& hi)
     {
-        double error = 0.0;
-        for (size_t i = 0; i < count; ++i) { error += sqr(a[i] - b[i]); }
-        return error / count;
+        __m128 d = _mm_sub_ps(a, b);
+        __m128 e = _mm_mul_ps(d, d);
+        lo = _mm_cvtps_pd(e);
+        hi = _mm_cvtps_pd(_mm_movehl_ps(e, e));
     }
 };
 
 struct RMSE
 {
-    double operator()(const float* a, const float* b, size_t count) const
+    static constexpr double kScale = 1.0;
+
+    static double error(float a, float b) { return sqr(a - b) / (sqr(a) + 1e-3); }
+
+    static void error(__m128 a, __m128 b, __m128d& lo, __m128d& hi)
     {
-        double error = 0.0;
-        for (size_t i = 0; i < count; ++i) { error += sqr(a[i] - b[i]) / (sqr(a[i]) + 1e-3); }
-        return error / count;
+        __m128 d = _mm_sub_ps(a, b);
+        __m128 e = _mm_mul_ps(d, d);
+        __m128 aa = _mm_mul_ps(a, a);
+        const __m128d bias = _mm_set1_pd(1e-3);
+        lo = _mm_div_pd(_mm_cvtps_pd(e), _mm_add_pd(_mm_cvtps_pd(aa), bias));
+        hi = _mm_div_pd(_mm_cvtps_pd(_mm_movehl_ps(e, e)), _mm_add_pd(_mm_cvtps_pd(_mm_movehl_ps(aa, aa)), bias));
     }
 };
 
 struct MAE
 {
-    double operator()(const float* a, const float* b, size_t count) const
+    static constexpr double kScale = 1.0;
+
+    static double error(float a, float b) { return std::fabs(sqr(a - b)); }
+
+    static void error(__m128 a, __m128 b, __m128d& lo, __m128d& hi)
     {
-        double error = 0.0;
-        for (size_t i = 0; i < count; ++i) { error += std::fabs(sqr(a[i] - b[i])); }
-        return error / count;
+        __m128 d = _mm_sub_ps(a, b);
+        __m128 e = _mm_andnot_ps(_mm_set1_ps(-0.f), _mm_mul_ps(d, d));
+        lo = _mm_cvtps_pd(e);
+        hi = _mm_cvtps_pd(_mm_movehl_ps(e, e));
     }
 };
 
 struct MAPE
 {
-    double operator()(const float* a, const float* b, size_t count) const
+    static constexpr double kScale = 100.0;
+
+    static double error(float a, float b) { return std::fabs((a - b) / (a + 1e-3)); }
+
+    static void error(__m128 a, __m128 b, __m128d& lo, __m128d& hi)
     {
-        double error = 0.0;
-        for (size_t i = 0; i < count; ++i) { error += std::fabs((a[i] - b[i]) / (a[i] + 1e-3)); }
-        return 100.0 * error / count;
+        __m128 d = _mm_sub_ps(a, b);
+        const __m128d bias = _mm_set1_pd(1e-3);
+        const __m128d signMask = _mm_set1_pd(-0.0);
+        lo = _mm_andnot_pd(signMask, _mm_div_pd(_mm_cvtps_pd(d), _mm_add_pd(_mm_cvtps_pd(a), bias)));
+        hi = _mm_andnot_pd(signMask, _mm_div_pd(_mm_cvtps_pd(_mm_movehl_ps(d, d)), _mm_add_pd(_mm_cvtps_pd(_mm_movehl_ps(a, a)), bias)));
     }
 };
 
+/** Runs func(index) for all indices in [0, count) on the given number of threads, including the calling thread.
+*/
+static void parallelFor(size_t count, uint32_t threadCount, const std::function<void(size_t)>& func)
+{
+    std::atomic<size_t> nextIndex{ 0 };
+    auto worker = [&] ()
+    {
+        for (size_t i = nextIndex++; i < count; i = nextIndex++) func(i);
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < std::min<size_t>(threadCount, count); ++i) threads.emplace_back(worker);
+    worker();
+    for (auto& thread : threads) thread.join();
+}
+
+/** Sums up the errors of a range of pixels.
+    Four pixels are processed at once by transposing them to channel vectors.
+    The sum is accumulated in a fixed order, so the result does not depend on the number of threads.
+*/
 template<typename Metric>
-double compare(const Image& imageA, const Image& imageB, bool alpha, float* errorMap)
+double sumErrors(const float* a, const float* b, size_t pixelCount, bool alpha, float* errorMap)
 {
-    Metric metric;
-    double sum = 0.0;
-    const float* a = imageA.getData();
-    const float* b = imageB.getData();
-    size_t count = imageA.getWidth() * imageA.getHeight();
-    for (size_t i = 0; i < count; ++i)
+    const double channelCount = alpha ? 4.0 : 3.0;
+    const __m128d scale = _mm_set1_pd(Metric::kScale);
+    const __m128d channelCountVec = _mm_set1_pd(channelCount);
+
+    __m128d sumLo = _mm_setzero_pd();
+    __m128d sumHi = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= pixelCount; i += 4)
+    {
+        __m128 a0 = _mm_loadu_ps(a + 4 * i), a1 = _mm_loadu_ps(a + 4 * i + 4), a2 = _mm_loadu_ps(a + 4 * i + 8), a3 = _mm_loadu_ps(a + 4 * i + 12);
+        __m128 b0 = _mm_loadu_ps(b + 4 * i), b1 = _mm_loadu_ps(b + 4 * i + 4), b2 = _mm_loadu_ps(b + 4 * i + 8), b3 = _mm_loadu_ps(b + 4 * i + 12);
+        _MM_TRANSPOSE4_PS(a0, a1, a2, a3);
+        _MM_TRANSPOSE4_PS(b0, b1, b2, b3);
+
+        // Sum the channels in the same order as the scalar version.
+        __m128d errorLo, errorHi, lo, hi;
+        Metric::error(a0, b0, errorLo, errorHi);
+        Metric::error(a1, b1, lo, hi);
+        errorLo = _mm_add_pd(errorLo, lo);
+        errorHi = _mm_add_pd(errorHi, hi);
+        Metric::error(a2, b2, lo, hi);
+        errorLo = _mm_add_pd(errorLo, lo);
+        errorHi = _mm_add_pd(errorHi, hi);
+        if (alpha)
+        {
+            Metric::error(a3, b3, lo, hi);
+            errorLo = _mm_add_pd(errorLo, lo);
+            errorHi = _mm_add_pd(errorHi, hi);
+        }
+        errorLo = _mm_div_pd(_mm_mul_pd(scale, errorLo), channelCountVec);
+        errorHi = _mm_div_pd(_mm_mul_pd(scale, errorHi), channelCountVec);
+
+        if (errorMap) _mm_storeu_ps(errorMap + i, _mm_movelh_ps(_mm_cvtpd_ps(errorLo), _mm_cvtpd_ps(errorHi)));
+        sumLo = _mm_add_pd(sumLo, errorLo);
+        sumHi = _mm_add_pd(sumHi, errorHi);
+    }
+
+    double tailSum = 0.0;
+    for (; i < pixelCount; ++i)
     {
-        double error = metric(a, b, alpha ? 4 : 3);
-        if (errorMap) *errorMap++ = float(error);
-        sum += error;
-        a += 4;
-        b += 4;
+        double error = 0.0;
+        for (size_t c = 0; c < (alpha ? 4 : 3); ++c) error += Metric::error(a[4 * i + c], b[4 * i + c]);
+        error = Metric::kScale * error / channelCount;
+        if (errorMap) errorMap[i] = float(error);
+        tailSum += error;
     }
+
+    double sums[4];
+    _mm_storeu_pd(sums, sumLo);
+    _mm_storeu_pd(sums + 2, sumHi);
+    return ((sums[0] + sums[1]) + (sums[2] + sums[3])) + tailSum;
+}
+
+struct CompareOptions
+{
+    bool alpha = false;                 ///< Include the alpha channel.
+    bool earlyExit = false;             ///< Stop comparing once the error provably exceeds the threshold. The returned error is then a lower bound.
+    double threshold = 0.0;             ///< Error threshold used for early exit.
+    uint32_t threadCount = 1;           ///< Number of threads.
+};
+
+/** Compares two images in parallel tiles of rows.
+    All metrics are non-negative, so the errors of the finished tiles are a lower bound of the total error, which allows exiting early.
+    Early exit is not used if an error map is requested.
+*/
+template<typename Metric>
+double compare(const Image& imageA, const Image& imageB, const CompareOptions& options, float* errorMap)
+{
+    const size_t kTileRows = 16;
+
+    const size_t width = imageA.getWidth();
+    const size_t height = imageA.getHeight();
+    const size_t count = width * height;
+    const size_t tileCount = (height + kTileRows - 1) / kTileRows;
+    const bool earlyExit = options.earlyExit && !errorMap;
+
+    std::vector<double> tileSums(tileCount, 0.0);
+    std::mutex mutex;
+    double finishedSum = 0.0;
+    std::atomic<bool> exceeded{ false };
+
+    parallelFor(tileCount, options.threadCount, [&] (size_t tile)
+    {
+        if (exceeded) return;
+
+        size_t offset = tile * kTileRows * width;
+        size_t pixelCount = std::min(kTileRows, height - tile * kTileRows) * width;
+        tileSums[tile] = sumErrors<Metric>(imageA.getData() + 4 * offset, imageB.getData() + 4 * offset, pixelCount, options.alpha, errorMap ? errorMap + offset : nullptr);
+
+        if (earlyExit)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            finishedSum += tileSums[tile];
+            // Also exits on NaNs, which are treated as errors.
+            if (!(finishedSum / count <= options.threshold)) exceeded = true;
+        }
+    });
+
+    if (exceeded) return finishedSum / count;
+
+    double sum = 0.0;
+    for (double tileSum : tileSums) sum += tileSum;
     return sum / count;
 }
 
@@ -222,7 +369,7 @@ struct ErrorMetric
 {
     std::string name;
     std::string desc;
-    std::function<double(const Image& imageA, const Image& imageB, bool alpha, float* errorMap)> compare;
+    std::function<double(const Image& imageA, const Image& imageB, const CompareOptions& options, float* errorMap)> compare;
 };
 
 static const std::vector<ErrorMetric> errorMetrics =
@@ -264,52 +411,49 @@ static Image::SharedPtr generateHeatMap(uint32_t width, uint32_t height, const f
     return image;
 }
 
-static bool compareImages(const std::string& filenameA, const std::string& filenameB, ErrorMetric metric, float threshold, bool alpha, const std::string& heatMapFilename)
+static Image::SharedPtr loadImage(const std::string& filename)
 {
-    auto loadImage = [] (const std::string& filename)
+    try
     {
-        try
-        {
-            return Image::loadFromFile(filename);
-        }
-        catch (const std::runtime_error& e)
-        {
-            std::cerr << "Cannot load image from '" << filename << "' (Error: " << e.what() << ")." << std::endl;
-            return Image::SharedPtr();
-        }
-    };
-
-    auto saveImage = [] (const Image& image, const std::string& filename)
+        return Image::loadFromFile(filename);
+    }
+    catch (const std::runtime_error& e)
     {
-        try
-        {
-            image.saveToFile(filename);
-        }
-        catch (const std::runtime_error& e)
-        {
-            std::cerr << "Cannot save image to '" << filename << "' (Error: " << e.what() << ")." << std::endl;
-        }
-    };
+        std::cerr << "Cannot load image from '" << filename << "' (Error: " << e.what() << ")." << std::endl;
+        return Image::SharedPtr();
+    }
+}
 
-    // Load images.
-    auto imageA = loadImage(filenameA);
-    if (!imageA) return false;
-    auto imageB = loadImage(filenameB);
-    if (!imageB) return false;
+static void saveImage(const Image& image, const std::string& filename)
+{
+    try
+    {
+        image.saveToFile(filename);
+    }
+    catch (const std::runtime_error& e)
+    {
+        std::cerr << "Cannot save image to '" << filename << "' (Error: " << e.what() << ")." << std::endl;
+    }
+}
 
+/** Compares two loaded images and optionally generates a heat map.
+    Returns the error, or nothing if the images cannot be compared.
+*/
+static std::optional<double> compareImages(const Image& imageA, const Image& imageB, const ErrorMetric& metric, const CompareOptions& options, const std::string& heatMapFilename)
+{
     // Check resolution.
-    if (imageA->getWidth() != imageB->getWidth() || imageA->getHeight() != imageB->getHeight())
+    if (imageA.getWidth() != imageB.getWidth() || imageA.getHeight() != imageB.getHeight())
     {
         std::cerr << "Cannot compare images with different resolutions." << std::endl;
-        return false;
+        return {};
     }
 
-    uint32_t width = imageA->getWidth();
-    uint32_t height = imageB->getHeight();
+    uint32_t width = imageA.getWidth();
+    uint32_t height = imageA.getHeight();
 
     // Compare images.
     std::unique_ptr<float[]> errorMap = heatMapFilename.empty() ? nullptr : std::make_unique<float[]>(width * height);
-    double error = metric.compare(*imageA, *imageB, alpha, errorMap.get());
+    double error = metric.compare(imageA, imageB, options, errorMap.get());
 
     // Generate heat map.
     if (errorMap)
@@ -318,14 +462,89 @@ static bool compareImages(const std::string& filenameA, const std::string& filen
         saveImage(*heatMap, heatMapFilename);
     }
 
-    std::cout << error << std::endl;
+    return error;
+}
 
+static bool isWithinThreshold(double error, double threshold)
+{
     // Treat nans and infs as errors.
     if (std::isnan(error) || std::isinf(error)) return false;
 
     return error <= threshold;
 }
 
+static bool compareImages(const std::string& filenameA, const std::string& filenameB, const ErrorMetric& metric, const CompareOptions& options, const std::string& heatMapFilename)
+{
+    // Load images.
+    auto imageA = loadImage(filenameA);
+    if (!imageA) return false;
+    auto imageB = loadImage(filenameB);
+    if (!imageB) return false;
+
+    auto error = compareImages(*imageA, *imageB, metric, options, heatMapFilename);
+    if (!error) return false;
+
+    std::cout << *error << std::endl;
+
+    return isWithinThreshold(*error, options.threshold);
+}
+
+/** Compares all images in directory A with the images of the same name in directory B.
+    Prints one line with the image name and the error per image. The next pair of images is loaded while the current pair is compared.
+    Heat maps are written next to the images in directory B, using the given suffix.
+*/
+static bool compareDirectories(const std::string& dirA, const std::string& dirB, const ErrorMetric& metric, const CompareOptions& options, const std::string& heatMapSuffix)
+{
+    namespace fs = std::filesystem;
+
+    // Collect images, skipping heat maps from previous runs.
+    std::vector<std::string> names;
+    for (const auto& entry : fs::directory_iterator(dirA))
+    {
+        if (!entry.is_regular_file()) continue;
+        std::string name = entry.path().filename().string();
+        if (FreeImage_GetFIFFromFilename(name.c_str()) == FIF_UNKNOWN) continue;
+        if (!heatMapSuffix.empty() && name.size() >= heatMapSuffix.size() && name.compare(name.size() - heatMapSuffix.size(), heatMapSuffix.size(), heatMapSuffix) == 0) continue;
+        names.push_back(name);
+    }
+    std::sort(names.begin(), names.end());
+
+    using ImagePair = std::pair<Image::SharedPtr, Image::SharedPtr>;
+    auto loadImages = [&] (size_t i)
+    {
+        std::string filenameB = (fs::path(dirB) / names[i]).string();
+        if (!fs::exists(filenameB))
+        {
+            std::cerr << "Missing image '" << filenameB << "'." << std::endl;
+            return ImagePair();
+        }
+        return ImagePair(loadImage((fs::path(dirA) / names[i]).string()), loadImage(filenameB));
+    };
+
+    bool success = true;
+    std::future<ImagePair> nextImages;
+    if (!names.empty()) nextImages = std::async(std::launch::async, loadImages, 0);
+
+    for (size_t i = 0; i < names.size(); ++i)
+    {
+        ImagePair images = nextImages.get();
+        if (i + 1 < names.size()) nextImages = std::async(std::launch::async, loadImages, i + 1);
+
+        double error = std::numeric_limits<double>::quiet_NaN();
+        if (images.first && images.second)
+        {
+            std::string heatMapFilename = heatMapSuffix.empty() ? "" : (fs::path(dirB) / (names[i] + heatMapSuffix)).string();
+            error = compareImages(*images.first, *images.second, metric, options, heatMapFilename).value_or(error);
+        }
+
+        bool passed = isWithinThreshold(error, options.threshold);
+        std::cout << names[i] << " " << error << (passed ? "" : " FAILED") << std::endl;
+        success = success && passed;
+    }
+
+    return success;
+}
+
 static void printMetrics(std::ostream &stream = std::cout)
 {
     stream << "Available error metrics:" << std::endl;
@@ -344,9 +563,11 @@ int main(int argc, char** argv)
     args::ValueFlag<std::string> metricFlag(parser, "metric", "The error metric.", {'m'});
     args::ValueFlag<float> thresholdFlag(parser, "threshold", "The error threshold.", {'t'});
     args::Flag alphaFlag(parser, "", "Include alpha channel.", {'a'});
-    args::ValueFlag<std::string> heatMapFlag(parser, "filename", "Generate error heat map.", {'e'});
-    args::Positional<std::string> image1(parser, "image1", "The first image.", args::Options::Required);
-    args::Positional<std::string> image2(parser, "image2", "The second image.", args::Options::Required);
+    args::ValueFlag<std::string> heatMapFlag(parser, "filename", "Generate error heat map. When comparing directories, this is the suffix appended to the image names in the second directory.", {'e'});
+    args::Flag earlyExitFlag(parser, "", "Stop comparing once the error exceeds the threshold. The printed error is then a lower bound. Ignored when generating heat maps.", {'x'});
+    args::ValueFlag<uint32_t> threadsFlag(parser, "threads", "Number of threads (default: number of hardware threads).", {'j'});
+    args::Positional<std::string> image1(parser, "image1", "The first image, or a directory of images.", args::Options::Required);
+    args::Positional<std::string> image2(parser, "image2", "The second image, or a directory containing images of the same names.", args::Options::Required);
     args::CompletionFlag completionFlag(parser, {"complete"});
 
     try
@@ -396,12 +617,20 @@ int main(int argc, char** argv)
         metric = *it;
     }
 
-    return compareImages(
-        args::get(image1),
-        args::get(image2),
-        metric,
-        thresholdFlag ? args::get(thresholdFlag) : 0.f,
-        alphaFlag ? args::get(alphaFlag) : false,
-        heatMapFlag ? args::get(heatMapFlag) : ""
-    ) ? 0 : 1;
+    CompareOptions options;
+    options.alpha = alphaFlag ? args::get(alphaFlag) : false;
+    options.threshold = thresholdFlag ? args::get(thresholdFlag) : 0.f;
+    options.earlyExit = earlyExitFlag ? args::get(earlyExitFlag) : false;
+    options.threadCount = std::max(1u, threadsFlag ? args::get(threadsFlag) : std::thread::hardware_concurrency());
+
+    const std::string heatMap = heatMapFlag ? args::get(heatMapFlag) : "";
+
+    // Compare all images of two directories in batch mode.
+    std::error_code ec;
+    if (std::filesystem::is_directory(args::get(image1), ec) && std::filesystem::is_directory(args::get(image2), ec))
+    {
+        return compareDirectories(args::get(image1), args::get(image2), metric, options, heatMap) ? 0 : 1;
+    }
+
+    return compareImages(args::get(image1), args::get(image2), metric, options, heatMap) ? 0 : 1;
 }